@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "prof/prof.h"
+
+using namespace std;
+
+namespace ast {
+
+// Arena is a bump allocator that owns every node created by New.
+// Nodes are placed contiguously in large blocks and hold their children
+// as raw pointers, so freeing an ast is a flat walk over the arena
+// instead of a recursive chain of refcount releases.
+class Arena {
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        // nodes never touch their children when destroyed, any order is fine,
+        // newest first mirrors stack unwinding.
+        for (auto it = destructors_.rbegin(); it != destructors_.rend(); ++it) {
+            it->destroy(it->object);
+        }
+        for (auto block : blocks_) {
+            ::operator delete(block);
+        }
+    }
+
+    /**
+     * @brief New construct a T in the arena, the arena keeps the ownership.
+     *
+     * @return pointer valid until the arena is destroyed.
+     */
+    template <typename T, typename... Args>
+    T* New(Args&&... args) {
+        void* mem = Allocate(sizeof(T), alignof(T));
+        T* object = new (mem) T(std::forward<Args>(args)...);
+        if (!is_trivially_destructible<T>::value) {
+            destructors_.push_back(Destructor{&Destroy<T>, object});
+        }
+        if (prof::Enabled()) {
+            prof::CountNode(object->Type());
+        }
+        return object;
+    }
+
+    // BytesUsed returns bytes handed out by the arena, include padding.
+    size_t BytesUsed() const { return bytes_used_; }
+private:
+    const static size_t kBlockSize = 64 * 1024;
+
+    struct Destructor {
+        void (*destroy)(void*);
+        void* object;
+    };
+
+    template <typename T>
+    static void Destroy(void* object) { static_cast<T*>(object)->~T(); }
+
+    void* Allocate(size_t size, size_t align) {
+        size_t padding = (align - reinterpret_cast<size_t>(cur_) % align) % align;
+        if (cur_ == nullptr || size + padding > static_cast<size_t>(end_ - cur_)) {
+            // objects larger than a block get a block of their own.
+            size_t block_size = (size + align > kBlockSize) ? size + align : kBlockSize;
+            cur_ = static_cast<char*>(::operator new(block_size));
+            end_ = cur_ + block_size;
+            blocks_.push_back(cur_);
+            padding = (align - reinterpret_cast<size_t>(cur_) % align) % align;
+        }
+
+        void* mem = cur_ + padding;
+        cur_ += padding + size;
+        bytes_used_ += padding + size;
+        return mem;
+    }
+
+    char* cur_{};
+    char* end_{};
+    size_t bytes_used_{};
+    vector<char*> blocks_;
+    vector<Destructor> destructors_;
+};
+
+}// namespace ast
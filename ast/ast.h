@@ -1,11 +1,16 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <memory>
 #include <vector>
+#include <sstream>
 
 #include "token/token.h"
 #include "token/position.h"
+#include "token/interner.h"
+#include "ast/arena.h"
+#include "ast/writer.h"
 
 using namespace std;
 
@@ -172,7 +177,16 @@ public:
     // Pos get position of first character belonging to the node.
     virtual token::Position Pos() const { return pos_; }
 
-    virtual string ToString() const = 0;
+    // Write describe the node and its children to w in a single pass.
+    virtual void Write(Writer* w) const = 0;
+
+    // ToString returns the node in xml layout, prefer Write for large trees.
+    string ToString() const {
+        ostringstream out;
+        XmlWriter w(out);
+        Write(&w);
+        return out.str();
+    }
 
     virtual ~Node() = default;
 public:
@@ -190,11 +204,10 @@ public:
 
     NodeType Type() const override { return NodeType::Type; }
 
-    string ToString() const override {
-        string ret = "<TypeNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "</TypeNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("TypeNode");
+        w->Pos(pos_);
+        w->EndNode();
     }
 };
 
@@ -207,11 +220,10 @@ public:
 
     NodeType Type() const override {return NodeType::Decl;};
     
-    string ToString() const override {
-        string ret = "<DeclNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "</DeclNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("DeclNode");
+        w->Pos(pos_);
+        w->EndNode();
     }
 };
 
@@ -224,11 +236,10 @@ public:
 
     NodeType Type() const override { return NodeType::Expr; };
 
-    string ToString() const override {
-        string ret = "<ExprNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "</ExprNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("ExprNode");
+        w->Pos(pos_);
+        w->EndNode();
     }
 };
 
@@ -241,11 +252,10 @@ public:
 
     NodeType Type() const override {return NodeType::Stmt;};
 
-    string ToString() const override {
-        string ret = "<StmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "</StmtNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("StmtNode");
+        w->Pos(pos_);
+        w->EndNode();
     }
 };
 
@@ -258,11 +268,10 @@ public:
     BadTypeNode() = default;
     ~BadTypeNode() override = default;
     NodeType Type() const override { return NodeType::BadType; };
-    string ToString() const override {
-        string ret = "<BadTypeNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "</BadTypeNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("BadTypeNode");
+        w->Pos(pos_);
+        w->EndNode();
     }
 };
 
@@ -272,11 +281,10 @@ public:
     VoidTypeNode() = default;
     ~VoidTypeNode() override = default;
     NodeType Type() const override { return NodeType::VoidType; };
-    string ToString() const override {
-        string ret = "<VoidTypeNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "</VoidTypeNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("VoidTypeNode");
+        w->Pos(pos_);
+        w->EndNode();
     }
 };
 
@@ -286,11 +294,10 @@ public:
     CharTypeNode() = default;
     ~CharTypeNode() override = default;
     NodeType Type() const override { return NodeType::CharType; };
-    string ToString() const override {
-        string ret = "<CharTypeNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "</CharTypeNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("CharTypeNode");
+        w->Pos(pos_);
+        w->EndNode();
     }
 };
 
@@ -300,11 +307,10 @@ public:
     IntTypeNode() = default;
     ~IntTypeNode() override = default;
     NodeType Type() const override { return NodeType::IntType; };
-    string ToString() const override {
-        string ret = "<IntTypeNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "</IntTypeNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("IntTypeNode");
+        w->Pos(pos_);
+        w->EndNode();
     }
 };
 
@@ -313,20 +319,19 @@ public:
     ArrayTypeNode() = default;
     ~ArrayTypeNode() override = default;
     explicit ArrayTypeNode(const token::Position& pos) :TypeNode(pos) {};
-    ArrayTypeNode(const token::Position& pos, int size, const shared_ptr<TypeNode>& item) 
+    ArrayTypeNode(const token::Position& pos, int size, TypeNode* item) 
         : TypeNode(pos), size_(size), item_(item) {};
     NodeType Type() const override { return NodeType::ArrayType; };
-    string ToString() const override {
-        string ret = "<ArrayTypeNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<size>" + std::to_string(size_) + "</size>";
-        ret += "<item>" + (item_ == nullptr ? item_->ToString() : "") + "</item>";
-        ret += "</ArrayTypeNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("ArrayTypeNode");
+        w->Pos(pos_);
+        w->Int("size", size_);
+        w->Child("item", item_);
+        w->EndNode();
     }
 public:
     int size_{};
-    shared_ptr<TypeNode> item_{};
+    TypeNode* item_{};
 };
 
 class StringTypeNode : public TypeNode {
@@ -335,11 +340,10 @@ public:
     StringTypeNode() = default;
     ~StringTypeNode() override = default;
     NodeType Type() const override { return NodeType::StringType; };
-    string ToString() const override {
-        string ret = "<StringTypeNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "</StringTypeNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("StringTypeNode");
+        w->Pos(pos_);
+        w->EndNode();
     }
 };
 
@@ -354,16 +358,19 @@ public:
     IdentNode() = default;
     ~IdentNode() override = default;
     IdentNode(const token::Position& pos, const string& name): ExprNode(pos), name_(name) {}
+    IdentNode(const token::Position& pos, const string& name, int symbol)
+        : ExprNode(pos), name_(name), symbol_(symbol) {}
     NodeType Type() const override {return NodeType::Ident;};
-    string ToString() const override {
-        string ret = "<IdentNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<name>" + name_ + "</name>";
-        ret += "</IdentNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("IdentNode");
+        w->Pos(pos_);
+        w->String("name", name_);
+        w->EndNode();
     }
 public:
     string name_{};
+    // symbol_ is name_ interned in FileNode::symbols_, -1 if not interned.
+    int symbol_{-1};
 };
 
 
@@ -374,11 +381,10 @@ public:
     explicit BadExprNode(const token::Position& pos) : ExprNode(pos) {}
     ~BadExprNode() override = default;
     NodeType Type() const override {return NodeType::BadExpr;};
-    string ToString() const override {
-        string ret = "<BadExprNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "</BadExprNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("BadExprNode");
+        w->Pos(pos_);
+        w->EndNode();
     }
 };
 
@@ -391,13 +397,12 @@ public:
     BasicLitNode(const token::Position& pos, token::Token token_type, const string& val)
         : ExprNode(pos), tok_(token_type), val_(val) {}
     NodeType Type() const override {return NodeType::BasicLit;};
-    string ToString() const override {
-        string ret = "<BasicLitNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<tok>" + token::GetTokenName(tok_) + "</tok>";
-        ret += "<val>" + val_ + "</val>";
-        ret += "</BasicLitNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("BasicLitNode");
+        w->Pos(pos_);
+        w->String("tok", token::GetTokenName(tok_));
+        w->String("val", val_);
+        w->EndNode();
     }
 public:
     token::Token tok_;
@@ -407,22 +412,50 @@ public:
 class CompositeLitNode: public ExprNode { 
 public:
     explicit CompositeLitNode(const token::Position& pos) : ExprNode(pos) {}
-    CompositeLitNode(const token::Position& pos, const vector<shared_ptr<ExprNode>>& items)
+    CompositeLitNode(const token::Position& pos, const vector<ExprNode*>& items)
         : ExprNode(pos), items_(items) {}
     CompositeLitNode() = default;
     ~CompositeLitNode() override = default;
     NodeType Type() const override {return NodeType::CompositeLit;};
-    string ToString() const override {
-        string ret = "<CompositeLitNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        for (auto item: items_) {
-            ret += "<item>" + (item == nullptr ? "" : item->ToString()) + "</item>";
+
+    // Packed reports whether items are packed into values_.
+    bool Packed() const { return !dims_.empty(); }
+
+    // Write writes a packed literal as its tok, dims and values instead of item nodes,
+    // e.g. <tok>INTCON</tok><dims>2x2</dims><values>1 -2 3 4</values> for '{{1, -2}, {3, 4}}'.
+    void Write(Writer* w) const override {
+        w->BeginNode("CompositeLitNode");
+        w->Pos(pos_);
+        if (Packed()) {
+            w->String("tok", token::GetTokenName(tok_));
+            w->String("dims", JoinInts(dims_, 'x'));
+            w->String("values", JoinInts(values_, ' '));
+        } else {
+            w->Children("item", items_);
         }
-        ret += "</CompositeLitNode>";
-        return ret;
+        w->EndNode();
+    }
+public:
+    vector<ExprNode*> items_{};
+    // A literal of int literals only, which may be signed, or char literals only, nested in
+    // a regular shape is packed by the parser, e.g. '{{1, -2}, {3, 4}}', no node is made for its items.
+    // items_ is empty, tok_ is INTCON or CHARCON, dims_ are sizes of its dimensions,
+    // outermost first, and values_ are values of the items in row major order.
+    token::Token tok_{token::ILLEGAL};
+    vector<int> dims_{};
+    vector<int32_t> values_{};
+private:
+    template <typename T>
+    static string JoinInts(const vector<T>& ints, char sep) {
+        string out;
+        for (size_t i = 0; i < ints.size(); i++) {
+            if (i > 0) {
+                out += sep;
+            }
+            out += to_string(ints[i]);
+        }
+        return out;
     }
-public:
-    vector<shared_ptr<ExprNode>> items_{};
 };
 
 // ParenExprNode represents a parenthesized expression.
@@ -430,18 +463,17 @@ class ParenExprNode: public ExprNode {
 public:
     ParenExprNode() = default;
     ~ParenExprNode() override = default;
-    ParenExprNode(const token::Position& pos, const shared_ptr<ExprNode>& expr)
+    ParenExprNode(const token::Position& pos, ExprNode* expr)
         : ExprNode(pos), expr_(expr) {}
     NodeType Type() const override {return NodeType::ParenExpr;};
-    string ToString() const override {
-        string ret = "<ParenExprNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<expr>" + (expr_ == nullptr ? "" : expr_->ToString()) + "</expr>";
-        ret += "</ParenExprNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("ParenExprNode");
+        w->Pos(pos_);
+        w->Child("expr", expr_);
+        w->EndNode();
     }
 public:
-    shared_ptr<ExprNode> expr_{};
+    ExprNode* expr_{};
 };
 
 // IndexExprNode represents an index expression.
@@ -449,19 +481,18 @@ class IndexExprNode: public ExprNode {
 public:
     IndexExprNode() = default;
     ~IndexExprNode() override = default;
-    IndexExprNode(const token::Position& pos, const shared_ptr<ExprNode>& x, const shared_ptr<ExprNode>& index)
+    IndexExprNode(const token::Position& pos, ExprNode* x, ExprNode* index)
         : ExprNode(pos), x_(x), index_(index) {}
     NodeType Type() const override {return NodeType::IndexExpr;};
-    string ToString() const override {
-        string ret = "<IndexExprNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<x>" + (x_ == nullptr ? "" : x_->ToString()) + "</x>";
-        ret += "<index>" + (index_ == nullptr ? "" : index_->ToString()) + "</index>";
-        ret += "</IndexExprNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("IndexExprNode");
+        w->Pos(pos_);
+        w->Child("x", x_);
+        w->Child("index", index_);
+        w->EndNode();
     }
 public:
-    shared_ptr<ExprNode> x_{}, index_{};
+    ExprNode *x_{}, *index_{};
 };
 
 // CallExprNode represents a function call expression.
@@ -470,22 +501,19 @@ public:
     CallExprNode() = default;
     ~CallExprNode() override= default;
     explicit CallExprNode(const token::Position& pos) : ExprNode(pos) {}
-    CallExprNode(const token::Position& pos, const shared_ptr<ExprNode>& fun, const vector<shared_ptr<ExprNode>>& args)
+    CallExprNode(const token::Position& pos, ExprNode* fun, const vector<ExprNode*>& args)
         : ExprNode(pos), fun_(fun), args_(args) {}
     NodeType Type() const override {return NodeType::CallExpr;};
-    string ToString() const override {
-        string ret = "<CallExprNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<fun>" + (fun_ == nullptr ? "" : fun_->ToString()) + "</fun>";
-        for (auto item: args_) {
-            ret += "<arg>" + (item == nullptr ? "" : item->ToString()) + "</arg>";
-        }
-        ret += "</CallExprNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("CallExprNode");
+        w->Pos(pos_);
+        w->Child("fun", fun_);
+        w->Children("arg", args_);
+        w->EndNode();
     }
 public:
-    shared_ptr<ExprNode> fun_{};
-    vector<shared_ptr<ExprNode>> args_{};
+    ExprNode* fun_{};
+    vector<ExprNode*> args_{};
 };
 
 // UnaryExprNode represents a unary expression.
@@ -493,20 +521,19 @@ class UnaryExprNode: public ExprNode {
 public:
     UnaryExprNode() = default;
     ~UnaryExprNode() override = default;
-    UnaryExprNode(const token::Position& pos, token::Token op_tok, const shared_ptr<ExprNode>& x)
+    UnaryExprNode(const token::Position& pos, token::Token op_tok, ExprNode* x)
         : ExprNode(pos), op_tok_(op_tok), x_(x) {}
     NodeType Type() const override {return NodeType::UnaryExpr;};
-    string ToString() const override {
-        string ret = "<UnaryExprNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<op>" + token::GetTokenName(op_tok_) + "</op>";
-        ret += "<x>" + (x_ == nullptr ? "" : x_->ToString()) + "</x>";
-        ret += "</UnaryExprNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("UnaryExprNode");
+        w->Pos(pos_);
+        w->String("op", token::GetTokenName(op_tok_));
+        w->Child("x", x_);
+        w->EndNode();
     }
 public:
     token::Token op_tok_{};
-    shared_ptr<ExprNode> x_{};
+    ExprNode* x_{};
 };
 
 // BianryExprNode represents a binary expression.
@@ -514,21 +541,20 @@ class BinaryExprNode: public ExprNode {
 public:
     BinaryExprNode() = default;
     ~BinaryExprNode() override = default;
-    BinaryExprNode(const token::Position& pos, token::Token op_tok, const shared_ptr<ExprNode>& x, const shared_ptr<ExprNode>& y)
+    BinaryExprNode(const token::Position& pos, token::Token op_tok, ExprNode* x, ExprNode* y)
         : ExprNode(pos), op_tok_(op_tok), x_(x), y_(y) {}
     NodeType Type() const override {return NodeType::BinaryExpr;};
-    string ToString() const override {
-        string ret = "<BinaryExprNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<op>" + token::GetTokenName(op_tok_) + "</op>";
-        ret += "<x>" + (x_ == nullptr ? "" : x_->ToString()) + "</x>";
-        ret += "<y>" + (y_ == nullptr ? "" : y_->ToString()) + "</y>";
-        ret += "</BinaryExprNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("BinaryExprNode");
+        w->Pos(pos_);
+        w->String("op", token::GetTokenName(op_tok_));
+        w->Child("x", x_);
+        w->Child("y", y_);
+        w->EndNode();
     }
 public:
     token::Token op_tok_{};
-    shared_ptr<ExprNode> x_{}, y_{};
+    ExprNode *x_{}, *y_{};
 };
 
 // ====================================================================
@@ -547,20 +573,19 @@ class FieldNode: public Node {
 public:
     FieldNode() = default;
     ~FieldNode() override = default;
-    FieldNode(const token::Position& pos, const shared_ptr<TypeNode>& type, const shared_ptr<IdentNode>& name)
+    FieldNode(const token::Position& pos, TypeNode* type, IdentNode* name)
         : Node(pos), type_(type), name_(name) {}
     NodeType Type() const override {return NodeType::Field;};
-    string ToString() const override {
-        string ret = "<FieldNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<type>" + (type_ == nullptr ? "" : type_->ToString()) + "</type>";
-        ret += "<name>" + (name_ == nullptr ? "" : name_->ToString()) + "</name>";
-        ret += "</FieldNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("FieldNode");
+        w->Pos(pos_);
+        w->Child("type", type_);
+        w->Child("name", name_);
+        w->EndNode();
     }
 public:
-    shared_ptr<TypeNode> type_{};
-    shared_ptr<IdentNode> name_{};
+    TypeNode* type_{};
+    IdentNode* name_{};
 };
 
 // FieldListNode represents a list of Fields, enclosed by parentheses or braces.
@@ -569,20 +594,17 @@ public:
     FieldListNode() = default;
     ~FieldListNode() override = default;
     explicit FieldListNode(const token::Position& pos) : Node(pos) {}
-    FieldListNode(const token::Position& pos, const vector<shared_ptr<FieldNode>>& fields)
+    FieldListNode(const token::Position& pos, const vector<FieldNode*>& fields)
         : Node(pos), fields_(fields) {}
     NodeType Type() const override {return NodeType::FieldList;};
-    string ToString() const override {
-        string ret = "<FieldListNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        for (const auto& field: fields_) {
-            ret += "<field>" + (field == nullptr ? "" : field->ToString()) + "</field>";
-        }
-        ret += "</FieldListNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("FieldListNode");
+        w->Pos(pos_);
+        w->Children("field", fields_);
+        w->EndNode();
     }
 public:
-    vector<shared_ptr<FieldNode>> fields_{};
+    vector<FieldNode*> fields_{};
 };
 
 // ====================================================================
@@ -597,11 +619,10 @@ public:
     BadDeclNode(const token::Position& pos) : DeclNode(pos) {}
     ~BadDeclNode() override = default;
     NodeType Type() const override {return NodeType::BadDecl;};
-    string ToString() const override {
-        string ret = "<BadDeclNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "</BadDeclNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("BadDeclNode");
+        w->Pos(pos_);
+        w->EndNode();
     }
 };
 
@@ -612,27 +633,26 @@ public:
     ~FuncDeclNode() override = default;
     FuncDeclNode(
         const token::Position& pos,
-        const shared_ptr<TypeNode>& type,
-        const shared_ptr<IdentNode>& name,
-        const shared_ptr<FieldListNode>& params,
-        const shared_ptr<StmtNode>& body)
+        TypeNode* type,
+        IdentNode* name,
+        FieldListNode* params,
+        StmtNode* body)
         : DeclNode(pos), type_(type), name_(name), params_(params), body_(body) {}
     NodeType Type() const override {return NodeType::FuncDecl;};
-    string ToString() const override {
-        string ret = "<FuncDeclNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<type>" + (type_ == nullptr ? "" : type_->ToString()) + "</type>";
-        ret += "<name>" + (name_ == nullptr ? "" : name_->ToString()) + "</name>";
-        ret += "<params>" + (params_ == nullptr ? "" : params_->ToString()) + "</params>";
-        ret += "<body>" + (body_ == nullptr ? "" : body_->ToString()) + "</body>";
-        ret += "</FuncDeclNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("FuncDeclNode");
+        w->Pos(pos_);
+        w->Child("type", type_);
+        w->Child("name", name_);
+        w->Child("params", params_);
+        w->Child("body", body_);
+        w->EndNode();
     }
 public:
-    shared_ptr<TypeNode> type_{};
-    shared_ptr<IdentNode> name_{};
-    shared_ptr<FieldListNode> params_{};
-    shared_ptr<StmtNode> body_{};
+    TypeNode* type_{};
+    IdentNode* name_{};
+    FieldListNode* params_{};
+    StmtNode* body_{};
 };
 
 // SingleVarDeclNode decl a single var.
@@ -644,25 +664,24 @@ public:
     SingleVarDeclNode(
         const token::Position& pos,
         const bool is_const,
-        const shared_ptr<TypeNode>& type,
-        const shared_ptr<IdentNode>& name,
-        const shared_ptr<ExprNode>& val): DeclNode(pos), is_const_(is_const), type_(type), name_(name), val_(val) {}
+        TypeNode* type,
+        IdentNode* name,
+        ExprNode* val): DeclNode(pos), is_const_(is_const), type_(type), name_(name), val_(val) {}
     NodeType Type() const override {return NodeType::SingleVarDecl;};
-    string ToString() const override {
-        string ret = "<SingleVarDeclNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<is_const>" + (is_const_ ? string("true") : string("false")) + "</is_const>";
-        ret += "<type>" + (type_ == nullptr ? "" : type_->ToString()) + "</type>";
-        ret += "<name>" + (name_ == nullptr ? "" : name_->ToString()) + "</name>";
-        ret += "<val>" + (val_ == nullptr ? "" : val_->ToString()) + "</val>";
-        ret += "</SingleVarDeclNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("SingleVarDeclNode");
+        w->Pos(pos_);
+        w->Bool("is_const", is_const_);
+        w->Child("type", type_);
+        w->Child("name", name_);
+        w->Child("val", val_);
+        w->EndNode();
     }
 public:
     bool is_const_{};
-    shared_ptr<TypeNode> type_{};
-    shared_ptr<IdentNode> name_{};
-    shared_ptr<ExprNode> val_{};
+    TypeNode* type_{};
+    IdentNode* name_{};
+    ExprNode* val_{};
 };
 
 // VarDeclNode represents a variable declaration.
@@ -672,19 +691,16 @@ public:
     ~VarDeclNode() override = default;
     explicit VarDeclNode(const token::Position& pos) : DeclNode(pos) {}
     VarDeclNode(
-        const token::Position& pos, const vector<shared_ptr<DeclNode>>& decls) : DeclNode(pos), decls_(decls) {}
+        const token::Position& pos, const vector<DeclNode*>& decls) : DeclNode(pos), decls_(decls) {}
     NodeType Type() const override {return NodeType::VarDecl;};
-    string ToString() const override {
-        string ret = "<VarDeclNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        for (auto decl: decls_) {
-            ret += "<decl>" + (decl == nullptr ? "" : decl->ToString()) + "</decl>";
-        }
-        ret += "</VarDeclNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("VarDeclNode");
+        w->Pos(pos_);
+        w->Children("decl", decls_);
+        w->EndNode();
     }
 public:
-    vector<shared_ptr<DeclNode>> decls_{};
+    vector<DeclNode*> decls_{};
 };
 
 // ====================================================================
@@ -699,11 +715,10 @@ public:
     BadStmtNode() = default;
     ~BadStmtNode() override = default;
     NodeType Type() const override {return NodeType::BadStmt;};
-    string ToString() const override {
-        string ret = "<BadStmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "</BadStmtNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("BadStmtNode");
+        w->Pos(pos_);
+        w->EndNode();
     }
 };
 
@@ -712,17 +727,16 @@ class DeclStmtNode: public StmtNode {
 public:
     DeclStmtNode() = default;
     ~DeclStmtNode() override = default;
-    DeclStmtNode(const token::Position& pos, const shared_ptr<DeclNode>& decl) : StmtNode(pos), decl_(decl) {}
+    DeclStmtNode(const token::Position& pos, DeclNode* decl) : StmtNode(pos), decl_(decl) {}
     NodeType Type() const override {return NodeType::DeclStmt;};
-    string ToString() const override {
-        string ret = "<DeclStmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<decl>" + (decl_ == nullptr ? "" : decl_->ToString()) + "</decl>";
-        ret += "</DeclStmtNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("DeclStmtNode");
+        w->Pos(pos_);
+        w->Child("decl", decl_);
+        w->EndNode();
     }
 public:
-    shared_ptr<DeclNode> decl_{};
+    DeclNode* decl_{};
 };
 
 // EmptyStmtNode represents an empty statement.
@@ -732,11 +746,10 @@ public:
     ~EmptyStmtNode() override = default;
     EmptyStmtNode(const token::Position& pos) : StmtNode(pos) {}
     NodeType Type() const override {return NodeType::EmptyStmt;}
-    string ToString() const override {
-        string ret = "<EmptyStmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "</EmptyStmtNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("EmptyStmtNode");
+        w->Pos(pos_);
+        w->EndNode();
     }
 };
 
@@ -745,17 +758,16 @@ class ExprStmtNode: public StmtNode {
 public:
     ExprStmtNode() = default;
     ~ExprStmtNode() override = default;
-    ExprStmtNode(const token::Position& pos, const shared_ptr<ExprNode>& expr) : StmtNode(pos), expr_(expr) {}
+    ExprStmtNode(const token::Position& pos, ExprNode* expr) : StmtNode(pos), expr_(expr) {}
     NodeType Type() const override {return NodeType::ExprStmt;};
-    string ToString() const override {
-        string ret = "<ExprStmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<expr>" + (expr_ == nullptr ? "" : expr_->ToString()) + "</expr>";
-        ret += "</ExprStmtNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("ExprStmtNode");
+        w->Pos(pos_);
+        w->Child("expr", expr_);
+        w->EndNode();
     }
 public:
-    shared_ptr<ExprNode> expr_{};
+    ExprNode* expr_{};
 };
 
 // AssignStmtNode represents an assignment statement.
@@ -765,20 +777,19 @@ public:
     ~AssignStmtNode() override = default;
     AssignStmtNode(
         const token::Position& pos,
-        const shared_ptr<ExprNode>& lhs,
-        const shared_ptr<ExprNode>& rhs) 
+        ExprNode* lhs,
+        ExprNode* rhs) 
         : StmtNode(pos), lhs_(lhs), rhs_(rhs) {}
     NodeType Type() const override {return NodeType::AssignStmt;};
-    string ToString() const override {
-        string ret = "<AssignStmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<lhs>" + (lhs_ == nullptr ? "" : lhs_->ToString()) + "</lhs>";
-        ret += "<rhs>" + (rhs_ == nullptr ? "" : rhs_->ToString()) + "</rhs>";
-        ret += "</AssignStmtNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("AssignStmtNode");
+        w->Pos(pos_);
+        w->Child("lhs", lhs_);
+        w->Child("rhs", rhs_);
+        w->EndNode();
     }
 public:
-    shared_ptr<ExprNode> lhs_{}, rhs_{};
+    ExprNode *lhs_{}, *rhs_{};
 };
 
 // ForStmtNode represents a for statement.
@@ -788,21 +799,20 @@ public:
     ~ForStmtNode() override = default;
     ForStmtNode(const token::Position& pos) : StmtNode(pos) {}
     NodeType Type() const override {return NodeType::ForStmt;};
-    string ToString() const override {
-        string ret = "<ForStmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<init>" + (init_ == nullptr ? "" : init_->ToString()) + "</init>";
-        ret += "<cond>" + (cond_ == nullptr ? "" : cond_->ToString()) + "</cond>";
-        ret += "<step>" + (step_ == nullptr ? "" : step_->ToString()) + "</step>";
-        ret += "<body>" + (body_ == nullptr ? "" : body_->ToString()) + "</body>";
-        ret += "</ForStmtNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("ForStmtNode");
+        w->Pos(pos_);
+        w->Child("init", init_);
+        w->Child("cond", cond_);
+        w->Child("step", step_);
+        w->Child("body", body_);
+        w->EndNode();
     }
 public:
-    shared_ptr<StmtNode> init_{};
-    shared_ptr<StmtNode> cond_{};
-    shared_ptr<StmtNode> step_{};
-    shared_ptr<StmtNode> body_{}; 
+    StmtNode* init_{};
+    StmtNode* cond_{};
+    StmtNode* step_{};
+    StmtNode* body_{}; 
 };
 
 // WhileStmtNode represents a while statement.
@@ -812,17 +822,16 @@ public:
     ~WhileStmtNode() override = default;
     WhileStmtNode(const token::Position& pos) : StmtNode(pos) {}
     NodeType Type() const override {return NodeType::WhileStmt;};
-    string ToString() const override {
-        string ret = "<WhileStmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<cond>" + (cond_ == nullptr ? "" : cond_->ToString()) + "</cond>";
-        ret += "<body>" + (body_ == nullptr ? "" : body_->ToString()) + "</body>";
-        ret += "</WhileStmtNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("WhileStmtNode");
+        w->Pos(pos_);
+        w->Child("cond", cond_);
+        w->Child("body", body_);
+        w->EndNode();
     }
 public:
-    shared_ptr<ExprNode> cond_{};
-    shared_ptr<StmtNode> body_{};
+    ExprNode* cond_{};
+    StmtNode* body_{};
 };
 
 // ReturnStmtNode represents a return statement.
@@ -831,17 +840,16 @@ public:
     ReturnStmtNode() = default;
     ~ReturnStmtNode() override = default;
     explicit ReturnStmtNode(const token::Position& pos) : StmtNode(pos) {}
-    ReturnStmtNode(const token::Position& pos, const shared_ptr<ExprNode>& results) : StmtNode(pos), results_(results) {}
+    ReturnStmtNode(const token::Position& pos, ExprNode* results) : StmtNode(pos), results_(results) {}
     NodeType Type() const override {return NodeType::ReturnStmt;};
-    string ToString() const override {
-        string ret = "<ReturnStmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<results>" + (results_ == nullptr ? "" : results_->ToString()) + "</results>";
-        ret += "</ReturnStmtNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("ReturnStmtNode");
+        w->Pos(pos_);
+        w->Child("results", results_);
+        w->EndNode();
     }
 public:
-    shared_ptr<ExprNode> results_{};
+    ExprNode* results_{};
 };
 
 // BlockStmtNode represents a block statement.
@@ -850,19 +858,16 @@ public:
     BlockStmtNode() = default;
     ~BlockStmtNode() override = default;
     explicit BlockStmtNode(const token::Position& pos) : StmtNode(pos) {}
-    BlockStmtNode(const token::Position& pos, const vector<shared_ptr<StmtNode>>& stmts) : StmtNode(pos), stmts_(stmts) {}
+    BlockStmtNode(const token::Position& pos, const vector<StmtNode*>& stmts) : StmtNode(pos), stmts_(stmts) {}
     NodeType Type() const override {return NodeType::BlockStmt;};
-    string ToString() const override {
-        string ret = "<BlockStmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        for (auto stmt: stmts_) {
-            ret += "<stmt>" + (stmt == nullptr ? "" : stmt->ToString()) + "</stmt>";
-        }
-        ret += "</BlockStmtNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("BlockStmtNode");
+        w->Pos(pos_);
+        w->Children("stmt", stmts_);
+        w->EndNode();
     }
 public:
-    vector<shared_ptr<StmtNode>> stmts_;
+    vector<StmtNode*> stmts_;
 };
 
 // IfStmtNode represents an if statement.
@@ -873,24 +878,23 @@ public:
     explicit IfStmtNode(const token::Position& pos) : StmtNode(pos) {};
     IfStmtNode(
         const token::Position& pos,
-        const shared_ptr<ExprNode>& cond,
-        const shared_ptr<StmtNode>& body,
-        const shared_ptr<StmtNode>& else_stmt)
+        ExprNode* cond,
+        StmtNode* body,
+        StmtNode* else_stmt)
             : StmtNode(pos), cond_(cond), body_(body), else_(else_stmt) {};
-    NodeType Type() const override {return NodeType::BlockStmt;};
-    string ToString() const override {
-        string ret = "<IfStmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<cond>" + (cond_ == nullptr ? "" : cond_->ToString()) + "</cond>";
-        ret += "<body>" + (body_ == nullptr ? "" : body_->ToString()) + "</body>";
-        ret += "<else>" + (else_ == nullptr ? "" : else_->ToString()) + "</else>";
-        ret += "</IfStmtNode>";
-        return ret;
+    NodeType Type() const override {return NodeType::IfStmt;};
+    void Write(Writer* w) const override {
+        w->BeginNode("IfStmtNode");
+        w->Pos(pos_);
+        w->Child("cond", cond_);
+        w->Child("body", body_);
+        w->Child("else", else_);
+        w->EndNode();
     }
 public:
-    shared_ptr<ExprNode> cond_{};
-    shared_ptr<StmtNode> body_{};
-    shared_ptr<StmtNode> else_{};
+    ExprNode* cond_{};
+    StmtNode* body_{};
+    StmtNode* else_{};
 };
 
 // CaseStmtNode represents a case statement.
@@ -899,22 +903,19 @@ public:
     CaseStmtNode() = default;
     ~CaseStmtNode() override = default;
     explicit CaseStmtNode(const token::Position& pos) : StmtNode(pos) {};
-    CaseStmtNode(const token::Position& pos, const shared_ptr<ExprNode>& cond, const vector<shared_ptr<StmtNode>>& body) :
+    CaseStmtNode(const token::Position& pos, ExprNode* cond, const vector<StmtNode*>& body) :
             StmtNode(pos), cond_(cond), body_(body) {};
     NodeType Type() const override {return NodeType::CaseStmt;};
-    string ToString() const override {
-        string ret = "<CaseStmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<cond>" + (cond_ == nullptr ? "" : cond_->ToString()) + "</cond>";
-        for (auto stmt: body_) {
-            ret += "<body>" + (stmt == nullptr ? "" : stmt->ToString()) + "</body>";
-        }
-        ret += "</CaseStmtNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("CaseStmtNode");
+        w->Pos(pos_);
+        w->Child("cond", cond_);
+        w->Children("body", body_);
+        w->EndNode();
     }
 public:
-    shared_ptr<ExprNode> cond_{};
-    vector<shared_ptr<StmtNode>> body_{};
+    ExprNode* cond_{};
+    vector<StmtNode*> body_{};
 };
 
 // SwitchStmtNode represents a switch statement.
@@ -923,22 +924,19 @@ public:
     SwitchStmtNode() = default;
     ~SwitchStmtNode() override = default;
     explicit SwitchStmtNode(const token::Position& pos) : StmtNode(pos) {};
-    SwitchStmtNode(const token::Position& pos, const shared_ptr<ExprNode>& cond, const vector<shared_ptr<StmtNode>>& cases) :
+    SwitchStmtNode(const token::Position& pos, ExprNode* cond, const vector<StmtNode*>& cases) :
             StmtNode(pos), cond_(cond), cases_(cases) {};
     NodeType Type() const override {return NodeType::SwitchStmt;};
-    string ToString() const override {
-        string ret = "<SwitchStmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<cond>" + (cond_ == nullptr ? "" : cond_->ToString()) + "</cond>";
-        for (auto stmt: cases_) {
-            ret += "<case>" + (stmt == nullptr ? "" : stmt->ToString()) + "</case>";
-        }
-        ret += "</SwitchStmtNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("SwitchStmtNode");
+        w->Pos(pos_);
+        w->Child("cond", cond_);
+        w->Children("case", cases_);
+        w->EndNode();
     }
 public:
-    shared_ptr<ExprNode> cond_{};
-    vector<shared_ptr<StmtNode>> cases_{}; // case only.
+    ExprNode* cond_{};
+    vector<StmtNode*> cases_{}; // case only.
 };
 
 // ScanStmt represents a scan statement.
@@ -947,17 +945,16 @@ public:
     ScanStmtNode() = default;
     ~ScanStmtNode() override = default;
     explicit ScanStmtNode(const token::Position& pos) : StmtNode(pos) {};
-    ScanStmtNode(const token::Position& pos, const shared_ptr<ExprNode>& var) : StmtNode(pos), var_(var) {};
+    ScanStmtNode(const token::Position& pos, ExprNode* var) : StmtNode(pos), var_(var) {};
     NodeType Type() const override {return NodeType::ScanStmt;};
-    string ToString() const override {
-        string ret = "<ScanStmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        ret += "<var>" + (var_ == nullptr ? "" : var_->ToString()) + "</var>";
-        ret += "</ScanStmtNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("ScanStmtNode");
+        w->Pos(pos_);
+        w->Child("var", var_);
+        w->EndNode();
     }
 public:
-    shared_ptr<ExprNode> var_{};
+    ExprNode* var_{};
 };
 
 // PrintfStmt represents a printf statement.
@@ -966,20 +963,17 @@ public:
     PrintfStmtNode() = default;
     ~PrintfStmtNode() override = default;
     explicit PrintfStmtNode(const token::Position& pos) : StmtNode(pos) {};
-    PrintfStmtNode(const token::Position& pos, const vector<shared_ptr<ExprNode>>& args) :
+    PrintfStmtNode(const token::Position& pos, const vector<ExprNode*>& args) :
             StmtNode(pos), args_(args) {};
     NodeType Type() const override {return NodeType::PrintfStmt;};
-    string ToString() const override {
-        string ret = "<PrintfStmtNode>";
-        ret += "<pos>" + pos_.ToString() + "</pos>";
-        for (auto arg: args_) {
-            ret += "<arg>" + (arg == nullptr ? "" : arg->ToString()) + "</arg>";
-        }
-        ret += "</PrintfStmtNode>";
-        return ret;
+    void Write(Writer* w) const override {
+        w->BeginNode("PrintfStmtNode");
+        w->Pos(pos_);
+        w->Children("arg", args_);
+        w->EndNode();
     }
 public:
-    vector<shared_ptr<ExprNode>> args_;
+    vector<ExprNode*> args_;
 };
 
 // ====================================================================
@@ -987,19 +981,26 @@ public:
 // ====================================================================
 
 // FileNode represents a Go source file.
+// All nodes of the file are owned by arena_, they live as long as the FileNode.
 class FileNode {
 public:
-    shared_ptr <IdentNode> name_{};
-    vector <shared_ptr<DeclNode>> decl_{};
+    Arena arena_;
+    // symbols_ interns names of all IdentNode in the file.
+    token::Interner symbols_;
+    IdentNode* name_{};
+    vector <DeclNode*> decl_{};
     FileNode() = default;
+    void Write(Writer* w) const {
+        w->BeginNode("FileNode");
+        w->Child("name", name_);
+        w->Children("decl", decl_);
+        w->EndNode();
+    }
     string ToString() const {
-        string ret = "<FileNode>";
-        ret += "<name>" + (name_ == nullptr ? "" : name_->ToString()) + "</name>";
-        for (auto decl: decl_) {
-            ret += "<decl>" + (decl == nullptr ? "" : decl->ToString()) + "</decl>";
-        }
-        ret += "</FileNode>";
-        return ret;
+        ostringstream out;
+        XmlWriter w(out);
+        Write(&w);
+        return out.str();
     }
     // map<string, Node> scope_;
 };
@@ -0,0 +1,635 @@
+#include <cstring>
+
+#include "ast/flat.h"
+
+namespace ast {
+
+// Flattener appends rows of a file in pre-order.
+class Flattener {
+public:
+    explicit Flattener(FlatFile* flat) : flat_(flat) {}
+
+    void File(const FileNode& file) {
+        for (int i = 0; i < file.symbols_.Size(); i++) {
+            const string& name = file.symbols_.Name(i);
+            flat_->chars_.append(name);
+            flat_->symbol_size_.push_back(static_cast<int32_t>(name.size()));
+        }
+
+        int row = NewRow(static_cast<uint8_t>(ast::File), token::Position{"", 0, 0, 0});
+        kids_.push_back(file.name_);
+        kids_.insert(kids_.end(), file.decl_.begin(), file.decl_.end());
+        AddChildren(row);
+
+        // a loop instead of a recursion, so a long chain of binary exprs can't overflow the stack.
+        while (!work_.empty()) {
+            Item item = work_.back();
+            work_.pop_back();
+            int child = Node(item.node);
+            flat_->children_[item.slot] = child;
+        }
+    }
+
+    // Node appends the row of node and makes its children the next to append.
+    int Node(const ast::Node* node) {
+        if (node == nullptr) {
+            return NewRow(FlatFile::kNone, token::Position{"", 0, 0, 0});
+        }
+
+        int row = NewRow(static_cast<uint8_t>(node->Type()), node->pos_);
+        // children are pushed to kids_ by the switch.
+        switch (node->Type()) {
+            case ArrayType: {
+                auto n = static_cast<const ArrayTypeNode*>(node);
+                flat_->value_[row] = n->size_;
+                kids_.push_back(n->item_);
+                break;
+            }
+            case Ident: {
+                auto n = static_cast<const IdentNode*>(node);
+                flat_->value_[row] = n->symbol_;
+                if (n->symbol_ < 0) {
+                    Text(row, n->name_);
+                }
+                break;
+            }
+            case BasicLit: {
+                auto n = static_cast<const BasicLitNode*>(node);
+                flat_->value_[row] = n->tok_;
+                Text(row, n->val_);
+                break;
+            }
+            case CompositeLit: {
+                auto n = static_cast<const CompositeLitNode*>(node);
+                if (n->Packed()) {
+                    flat_->value_[row] = n->tok_;
+                    Packed(row, *n);
+                } else {
+                    List(n->items_);
+                }
+                break;
+            }
+            case ParenExpr:
+                kids_.push_back(static_cast<const ParenExprNode*>(node)->expr_);
+                break;
+            case IndexExpr: {
+                auto n = static_cast<const IndexExprNode*>(node);
+                kids_.push_back(n->x_);
+                kids_.push_back(n->index_);
+                break;
+            }
+            case CallExpr: {
+                auto n = static_cast<const CallExprNode*>(node);
+                kids_.push_back(n->fun_);
+                List(n->args_);
+                break;
+            }
+            case UnaryExpr: {
+                auto n = static_cast<const UnaryExprNode*>(node);
+                flat_->value_[row] = n->op_tok_;
+                kids_.push_back(n->x_);
+                break;
+            }
+            case BinaryExpr: {
+                auto n = static_cast<const BinaryExprNode*>(node);
+                flat_->value_[row] = n->op_tok_;
+                kids_.push_back(n->x_);
+                kids_.push_back(n->y_);
+                break;
+            }
+            case Field: {
+                auto n = static_cast<const FieldNode*>(node);
+                kids_.push_back(n->type_);
+                kids_.push_back(n->name_);
+                break;
+            }
+            case FieldList:
+                List(static_cast<const FieldListNode*>(node)->fields_);
+                break;
+            case FuncDecl: {
+                auto n = static_cast<const FuncDeclNode*>(node);
+                kids_.push_back(n->type_);
+                kids_.push_back(n->name_);
+                kids_.push_back(n->params_);
+                kids_.push_back(n->body_);
+                break;
+            }
+            case SingleVarDecl: {
+                auto n = static_cast<const SingleVarDeclNode*>(node);
+                flat_->value_[row] = n->is_const_;
+                kids_.push_back(n->type_);
+                kids_.push_back(n->name_);
+                kids_.push_back(n->val_);
+                break;
+            }
+            case VarDecl:
+                List(static_cast<const VarDeclNode*>(node)->decls_);
+                break;
+            case DeclStmt:
+                kids_.push_back(static_cast<const DeclStmtNode*>(node)->decl_);
+                break;
+            case ExprStmt:
+                kids_.push_back(static_cast<const ExprStmtNode*>(node)->expr_);
+                break;
+            case AssignStmt: {
+                auto n = static_cast<const AssignStmtNode*>(node);
+                kids_.push_back(n->lhs_);
+                kids_.push_back(n->rhs_);
+                break;
+            }
+            case ForStmt: {
+                auto n = static_cast<const ForStmtNode*>(node);
+                kids_.push_back(n->init_);
+                kids_.push_back(n->cond_);
+                kids_.push_back(n->step_);
+                kids_.push_back(n->body_);
+                break;
+            }
+            case WhileStmt: {
+                auto n = static_cast<const WhileStmtNode*>(node);
+                kids_.push_back(n->cond_);
+                kids_.push_back(n->body_);
+                break;
+            }
+            case ReturnStmt:
+                kids_.push_back(static_cast<const ReturnStmtNode*>(node)->results_);
+                break;
+            case BlockStmt:
+                List(static_cast<const BlockStmtNode*>(node)->stmts_);
+                break;
+            case IfStmt: {
+                auto n = static_cast<const IfStmtNode*>(node);
+                kids_.push_back(n->cond_);
+                kids_.push_back(n->body_);
+                kids_.push_back(n->else_);
+                break;
+            }
+            case CaseStmt: {
+                auto n = static_cast<const CaseStmtNode*>(node);
+                kids_.push_back(n->cond_);
+                List(n->body_);
+                break;
+            }
+            case SwitchStmt: {
+                auto n = static_cast<const SwitchStmtNode*>(node);
+                kids_.push_back(n->cond_);
+                List(n->cases_);
+                break;
+            }
+            case ScanStmt:
+                kids_.push_back(static_cast<const ScanStmtNode*>(node)->var_);
+                break;
+            case PrintfStmt:
+                List(static_cast<const PrintfStmtNode*>(node)->args_);
+                break;
+            default:
+                // the other nodes have no fields but the position.
+                break;
+        }
+        AddChildren(row);
+        return row;
+    }
+private:
+    // Item is a node whose row is still to append, to children_[slot].
+    class Item {
+    public:
+        const ast::Node* node;
+        size_t slot;
+    };
+
+    int NewRow(uint8_t tag, const token::Position& pos) {
+        flat_->tag_.push_back(tag);
+        flat_->offset_.push_back(pos.offset);
+        flat_->line_.push_back(pos.line);
+        flat_->column_.push_back(pos.column);
+        flat_->value_.push_back(0);
+        flat_->text_begin_.push_back(0);
+        flat_->text_size_.push_back(0);
+        flat_->child_begin_.push_back(static_cast<int32_t>(flat_->children_.size()));
+        flat_->child_count_.push_back(0);
+        return flat_->Rows() - 1;
+    }
+
+    void Text(int row, const string& text) {
+        flat_->text_begin_[row] = static_cast<int32_t>(flat_->chars_.size());
+        flat_->text_size_[row] = static_cast<int32_t>(text.size());
+        flat_->chars_.append(text);
+    }
+
+    // Packed writes dims and values of a packed composite lit as the text of row, see FlatFile.
+    void Packed(int row, const CompositeLitNode& lit) {
+        vector<int32_t> words;
+        words.push_back(static_cast<int32_t>(lit.dims_.size()));
+        words.insert(words.end(), lit.dims_.begin(), lit.dims_.end());
+        words.insert(words.end(), lit.values_.begin(), lit.values_.end());
+        Text(row, string(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(int32_t)));
+    }
+
+    template <typename T>
+    void List(const vector<T*>& items) {
+        kids_.insert(kids_.end(), items.begin(), items.end());
+    }
+
+    // AddChildren makes kids_ the children of row, their rows are appended next in order.
+    void AddChildren(int row) {
+        size_t begin = flat_->children_.size();
+        flat_->child_begin_[row] = static_cast<int32_t>(begin);
+        flat_->child_count_[row] = static_cast<int32_t>(kids_.size());
+        flat_->children_.resize(begin + kids_.size());
+        // work_ is a stack, the first child is pushed last to be appended first.
+        for (size_t i = kids_.size(); i-- > 0;) {
+            work_.push_back(Item{kids_[i], begin + i});
+        }
+        kids_.clear();
+    }
+
+    FlatFile* flat_;
+    vector<const ast::Node*> kids_;
+    vector<Item> work_;
+};
+
+void Flatten(const FileNode& file, FlatFile* flat) {
+    // columns are cleared but not freed, so flattening again into flat mostly doesn't allocate.
+    flat->tag_.clear();
+    for (auto* column : {&flat->offset_, &flat->line_, &flat->column_, &flat->value_, &flat->text_begin_,
+                         &flat->text_size_, &flat->child_begin_, &flat->child_count_, &flat->children_,
+                         &flat->symbol_size_}) {
+        column->clear();
+    }
+    flat->chars_.clear();
+    Flattener(flat).File(file);
+}
+
+// Expander rebuilds nodes from the last row to the first, so children of a row are
+// built before it without a recursion. Every row but the first must be the child of
+// one row before it, so rows make a tree.
+class Expander {
+public:
+    Expander(const FlatFile& flat, const string& filename, FileNode* file)
+        : flat_(flat), filename_(filename), file_(file) {}
+
+    int File() {
+        if (Columns() != 0 || flat_.Rows() == 0 || flat_.tag_[0] != ast::File) {
+            return -1;
+        }
+
+        int32_t begin = 0;
+        for (int32_t size : flat_.symbol_size_) {
+            if (size < 0 || size > static_cast<int64_t>(flat_.chars_.size()) - begin) {
+                return -1;
+            }
+            if (file_->symbols_.Intern(flat_.chars_.data() + begin, size) != file_->symbols_.Size() - 1) {
+                // a name appears twice.
+                return -1;
+            }
+            begin += size;
+        }
+
+        nodes_.assign(flat_.Rows(), nullptr);
+        for (int row = flat_.Rows() - 1; row > 0 && ok_; row--) {
+            nodes_[row] = Row(row);
+        }
+
+        Kids kids(this, 0);
+        file_->name_ = kids.Ident();
+        while (kids.More()) {
+            file_->decl_.push_back(kids.Decl());
+        }
+        return kids.Done() ? 0 : -1;
+    }
+private:
+    // Kids reads children of a row in order.
+    class Kids {
+    public:
+        Kids(Expander* e, int row)
+            : e_(e), cur_(e->flat_.child_begin_[row]), end_(cur_ + e->flat_.child_count_[row]) {}
+
+        bool More() const { return e_->ok_ && cur_ < end_; }
+        // Done reports whether all children were read.
+        bool Done() const { return e_->ok_ && cur_ == end_; }
+
+        TypeNode* Type() { return static_cast<TypeNode*>(Next(type_beg, type_end)); }
+        ExprNode* Expr() { return static_cast<ExprNode*>(Next(expr_beg, expr_end)); }
+        StmtNode* Stmt() { return static_cast<StmtNode*>(Next(stmt_beg, stmt_end)); }
+        DeclNode* Decl() { return static_cast<DeclNode*>(Next(decl_beg, decl_end)); }
+        IdentNode* Ident() { return static_cast<IdentNode*>(Next(BadExpr, BasicLit)); }
+        FieldNode* Field() { return static_cast<FieldNode*>(Next(decl_end, ast::FieldList)); }
+        FieldListNode* FieldList() {
+            return static_cast<FieldListNode*>(Next(ast::Field, static_cast<NodeType>(ast::FieldList + 1)));
+        }
+
+        template <typename T, typename Read>
+        void List(vector<T*>* items, Read read) {
+            items->reserve(end_ - cur_);
+            while (More()) {
+                items->push_back(read());
+            }
+        }
+    private:
+        // Next takes the next child, whose type must be in (lo, hi), or nullptr.
+        ast::Node* Next(NodeType lo, NodeType hi) {
+            if (!More()) {
+                e_->ok_ = false;
+                return nullptr;
+            }
+            return e_->Child(e_->flat_.children_[cur_++], lo, hi);
+        }
+
+        Expander* e_;
+        int32_t cur_;
+        int32_t end_;
+    };
+
+    // Columns checks sizes of columns and ranges they refer to, and that rows make a tree.
+    int Columns() const {
+        size_t rows = flat_.tag_.size();
+        for (const auto* column : {&flat_.offset_, &flat_.line_, &flat_.column_, &flat_.value_, &flat_.text_begin_,
+                                   &flat_.text_size_, &flat_.child_begin_, &flat_.child_count_}) {
+            if (column->size() != rows) {
+                return -1;
+            }
+        }
+
+        vector<bool> has_parent(rows, false);
+        for (size_t i = 0; i < rows; i++) {
+            int64_t begin = flat_.text_begin_[i], count = flat_.text_size_[i];
+            if (begin < 0 || count < 0 || begin + count > static_cast<int64_t>(flat_.chars_.size())) {
+                return -1;
+            }
+
+            begin = flat_.child_begin_[i], count = flat_.child_count_[i];
+            if (begin < 0 || count < 0 || begin + count > static_cast<int64_t>(flat_.children_.size())) {
+                return -1;
+            }
+            for (int64_t k = begin; k < begin + count; k++) {
+                int32_t child = flat_.children_[k];
+                if (child <= static_cast<int64_t>(i) || child >= static_cast<int64_t>(rows) || has_parent[child]) {
+                    return -1;
+                }
+                has_parent[child] = true;
+            }
+        }
+        // a row without parent is never built, which Flatten doesn't write.
+        for (size_t i = 1; i < rows; i++) {
+            if (!has_parent[i]) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    // Child returns the node built for row, whose type must be in (lo, hi), or nullptr.
+    ast::Node* Child(int row, NodeType lo, NodeType hi) {
+        uint8_t tag = flat_.tag_[row];
+        if (tag == FlatFile::kNone) {
+            return nullptr;
+        }
+        if (tag <= lo || tag >= hi) {
+            ok_ = false;
+            return nullptr;
+        }
+        return nodes_[row];
+    }
+
+    ast::Node* Row(int row) {
+        uint8_t tag = flat_.tag_[row];
+        if (tag == FlatFile::kNone) {
+            ok_ = ok_ && flat_.child_count_[row] == 0;
+            return nullptr;
+        }
+
+        token::Position pos{filename_, flat_.offset_[row], flat_.line_[row], flat_.column_[row]};
+        Kids kids(this, row);
+        ast::Node* node = New(static_cast<NodeType>(tag), row, pos, &kids);
+        if (!kids.Done()) {
+            ok_ = false;
+            return nullptr;
+        }
+        return node;
+    }
+
+    string Text(int row) const { return string(flat_.chars_, flat_.text_begin_[row], flat_.text_size_[row]); }
+
+    // Packed reads dims and values of a packed composite lit from the text of row,
+    // they must make a shape the parser could pack.
+    void Packed(int row, CompositeLitNode* lit) {
+        if (lit->tok_ != token::INTCON && lit->tok_ != token::CHARCON) {
+            ok_ = false;
+        }
+        int32_t size = flat_.text_size_[row];
+        if (!ok_ || size % sizeof(int32_t) != 0 || size == 0) {
+            ok_ = false;
+            return;
+        }
+        vector<int32_t> words(size / sizeof(int32_t));
+        memcpy(words.data(), flat_.chars_.data() + flat_.text_begin_[row], size);
+
+        int64_t ndims = words[0], count = 1;
+        if (ndims < 1 || ndims > 2 || static_cast<int64_t>(words.size()) < 1 + ndims) {
+            ok_ = false;
+            return;
+        }
+        for (int64_t i = 1; i <= ndims; i++) {
+            if (words[i] <= 0) {
+                ok_ = false;
+                return;
+            }
+            count *= words[i];
+        }
+        if (count != static_cast<int64_t>(words.size()) - 1 - ndims) {
+            ok_ = false;
+            return;
+        }
+        lit->dims_.assign(words.begin() + 1, words.begin() + 1 + ndims);
+        lit->values_.assign(words.begin() + 1 + ndims, words.end());
+    }
+
+    // Token reads value as a token of (lo, hi).
+    token::Token Token(int32_t value, token::Token lo, token::Token hi) {
+        if (value <= lo || value >= hi) {
+            ok_ = false;
+            return lo;
+        }
+        return static_cast<token::Token>(value);
+    }
+
+    ast::Node* New(NodeType type, int row, const token::Position& pos, Kids* kids) {
+        Arena& arena = file_->arena_;
+        int32_t value = flat_.value_[row];
+        switch (type) {
+            case BadType:
+                return arena.New<BadTypeNode>(pos);
+            case CharType:
+                return arena.New<CharTypeNode>(pos);
+            case IntType:
+                return arena.New<IntTypeNode>(pos);
+            case StringType:
+                return arena.New<StringTypeNode>(pos);
+            case VoidType:
+                return arena.New<VoidTypeNode>(pos);
+            case ArrayType:
+                return arena.New<ArrayTypeNode>(pos, value, kids->Type());
+            case BadExpr:
+                return arena.New<BadExprNode>(pos);
+            case Ident: {
+                if (value >= file_->symbols_.Size()) {
+                    ok_ = false;
+                    return nullptr;
+                }
+                string name = value < 0 ? Text(row) : file_->symbols_.Name(value);
+                return arena.New<IdentNode>(pos, name, value);
+            }
+            case BasicLit:
+                return arena.New<BasicLitNode>(pos, Token(value, token::literal_beg, token::literal_end), Text(row));
+            case CompositeLit: {
+                auto n = arena.New<CompositeLitNode>(pos);
+                if (value != 0) {
+                    n->tok_ = Token(value, token::literal_beg, token::literal_end);
+                    Packed(row, n);
+                    return n;
+                }
+                kids->List(&n->items_, [kids]() { return kids->Expr(); });
+                return n;
+            }
+            case ParenExpr:
+                return arena.New<ParenExprNode>(pos, kids->Expr());
+            case IndexExpr: {
+                auto n = arena.New<IndexExprNode>(pos, nullptr, nullptr);
+                n->x_ = kids->Expr();
+                n->index_ = kids->Expr();
+                return n;
+            }
+            case CallExpr: {
+                auto n = arena.New<CallExprNode>(pos);
+                n->fun_ = kids->Expr();
+                kids->List(&n->args_, [kids]() { return kids->Expr(); });
+                return n;
+            }
+            case UnaryExpr:
+                return arena.New<UnaryExprNode>(pos, Token(value, token::operator_beg, token::operator_end), kids->Expr());
+            case BinaryExpr: {
+                auto n = arena.New<BinaryExprNode>(pos, Token(value, token::operator_beg, token::operator_end), nullptr, nullptr);
+                n->x_ = kids->Expr();
+                n->y_ = kids->Expr();
+                return n;
+            }
+            case Field: {
+                auto n = arena.New<FieldNode>(pos, nullptr, nullptr);
+                n->type_ = kids->Type();
+                n->name_ = kids->Ident();
+                return n;
+            }
+            case FieldList: {
+                auto n = arena.New<FieldListNode>(pos);
+                kids->List(&n->fields_, [kids]() { return kids->Field(); });
+                return n;
+            }
+            case BadDecl:
+                return arena.New<BadDeclNode>(pos);
+            case FuncDecl: {
+                auto n = arena.New<FuncDeclNode>(pos, nullptr, nullptr, nullptr, nullptr);
+                n->type_ = kids->Type();
+                n->name_ = kids->Ident();
+                n->params_ = kids->FieldList();
+                n->body_ = kids->Stmt();
+                return n;
+            }
+            case SingleVarDecl: {
+                auto n = arena.New<SingleVarDeclNode>(pos);
+                n->is_const_ = value != 0;
+                n->type_ = kids->Type();
+                n->name_ = kids->Ident();
+                n->val_ = kids->Expr();
+                return n;
+            }
+            case VarDecl: {
+                auto n = arena.New<VarDeclNode>(pos);
+                kids->List(&n->decls_, [kids]() { return kids->Decl(); });
+                return n;
+            }
+            case BadStmt:
+                return arena.New<BadStmtNode>(pos);
+            case DeclStmt:
+                return arena.New<DeclStmtNode>(pos, kids->Decl());
+            case EmptyStmt:
+                return arena.New<EmptyStmtNode>(pos);
+            case ExprStmt:
+                return arena.New<ExprStmtNode>(pos, kids->Expr());
+            case AssignStmt: {
+                auto n = arena.New<AssignStmtNode>(pos, nullptr, nullptr);
+                n->lhs_ = kids->Expr();
+                n->rhs_ = kids->Expr();
+                return n;
+            }
+            case ForStmt: {
+                auto n = arena.New<ForStmtNode>(pos);
+                n->init_ = kids->Stmt();
+                n->cond_ = kids->Stmt();
+                n->step_ = kids->Stmt();
+                n->body_ = kids->Stmt();
+                return n;
+            }
+            case WhileStmt: {
+                auto n = arena.New<WhileStmtNode>(pos);
+                n->cond_ = kids->Expr();
+                n->body_ = kids->Stmt();
+                return n;
+            }
+            case ReturnStmt:
+                return arena.New<ReturnStmtNode>(pos, kids->Expr());
+            case BlockStmt: {
+                auto n = arena.New<BlockStmtNode>(pos);
+                kids->List(&n->stmts_, [kids]() { return kids->Stmt(); });
+                return n;
+            }
+            case IfStmt: {
+                auto n = arena.New<IfStmtNode>(pos);
+                n->cond_ = kids->Expr();
+                n->body_ = kids->Stmt();
+                n->else_ = kids->Stmt();
+                return n;
+            }
+            case CaseStmt: {
+                auto n = arena.New<CaseStmtNode>(pos);
+                n->cond_ = kids->Expr();
+                kids->List(&n->body_, [kids]() { return kids->Stmt(); });
+                return n;
+            }
+            case SwitchStmt: {
+                auto n = arena.New<SwitchStmtNode>(pos);
+                n->cond_ = kids->Expr();
+                kids->List(&n->cases_, [kids]() { return kids->Stmt(); });
+                return n;
+            }
+            case ScanStmt:
+                return arena.New<ScanStmtNode>(pos, kids->Expr());
+            case PrintfStmt: {
+                auto n = arena.New<PrintfStmtNode>(pos);
+                kids->List(&n->args_, [kids]() { return kids->Expr(); });
+                return n;
+            }
+            default:
+                // e.g. BranchStmt, which the parser never creates.
+                ok_ = false;
+                return nullptr;
+        }
+    }
+
+    const FlatFile& flat_;
+    const string& filename_;
+    FileNode* file_;
+    // nodes_ are built for rows, nullptr for kNone.
+    vector<ast::Node*> nodes_;
+    bool ok_ = true;
+};
+
+int Expand(const FlatFile& flat, const string& filename, shared_ptr<FileNode>* file) {
+    auto result = make_shared<FileNode>();
+    if (Expander(flat, filename, result.get()).File() != 0) {
+        return -1;
+    }
+    *file = result;
+    return 0;
+}
+
+}// namespace ast
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast/ast.h"
+
+using namespace std;
+
+namespace ast {
+
+// FlatFile is a file node laid out as columns, row i of every node column is the
+// i-th node in pre-order and row 0 is the file itself, whose children are its name
+// and its decls. Columns hold no pointers, so a pass may walk them linearly without
+// chasing children, and each may be written or read as one block of memory.
+class FlatFile {
+public:
+    // kNone is the tag of a row standing for a nullptr child.
+    static const uint8_t kNone = 0xFF;
+
+    int Rows() const { return static_cast<int>(tag_.size()); }
+
+    // tag_ is the NodeType of a row, or kNone.
+    vector<uint8_t> tag_;
+    vector<int32_t> offset_;
+    vector<int32_t> line_;
+    vector<int32_t> column_;
+    // value_ is the size of an ArrayType, the symbol of an Ident, the token of a BasicLit,
+    // UnaryExpr, BinaryExpr or packed CompositeLit and is_const of a SingleVarDecl, 0 for other rows.
+    vector<int32_t> value_;
+    // text of a BasicLit, or of an Ident without symbol, is chars_[text_begin_, text_begin_ + text_size_).
+    // A packed CompositeLit has no children, its text is int32s, the number of dims, dims_, then values_.
+    vector<int32_t> text_begin_;
+    vector<int32_t> text_size_;
+    // children of a row are children_[child_begin_, child_begin_ + child_count_), they are
+    // its fields in the order of the node class, then items of its list if it has one.
+    vector<int32_t> child_begin_;
+    vector<int32_t> child_count_;
+
+    vector<int32_t> children_;
+    // chars_ begins with names of symbols of the file, symbol i is the i-th of symbol_size_ long.
+    string chars_;
+    vector<int32_t> symbol_size_;
+};
+
+/**
+ * @brief Flatten lays out file as columns in flat, which is cleared first.
+ */
+void Flatten(const FileNode& file, FlatFile* flat);
+
+/**
+ * @brief Expand rebuilds the file laid out in flat, nodes are created in the arena of file.
+ * Every column is checked, so flat may come from untrusted data, rows may be of any depth.
+ *
+ * @param filename name set to positions of the nodes.
+ * @return 0 for success, -1 if flat isn't a layout Flatten could write.
+ */
+int Expand(const FlatFile& flat, const string& filename, shared_ptr<FileNode>* file);
+
+}// namespace ast
@@ -0,0 +1,149 @@
+#include <vector>
+
+#include "ast/shift.h"
+
+namespace ast {
+
+template <typename T>
+static void PushList(const vector<T*>& items, vector<Node*>* work) {
+    work->insert(work->end(), items.begin(), items.end());
+}
+
+void ShiftPos(Node* node, int offset, int lines) {
+    // a loop instead of a recursion, so a long chain of binary exprs can't overflow the stack.
+    vector<Node*> work{node};
+    while (!work.empty()) {
+        Node* n = work.back();
+        work.pop_back();
+        if (n == nullptr) {
+            continue;
+        }
+
+        if (n->pos_.offset != token::npos.offset) {
+            n->pos_.offset += offset;
+            n->pos_.line += lines;
+        }
+        switch (n->Type()) {
+            case ArrayType:
+                work.push_back(static_cast<ArrayTypeNode*>(n)->item_);
+                break;
+            case CompositeLit:
+                // a packed lit has no items.
+                PushList(static_cast<CompositeLitNode*>(n)->items_, &work);
+                break;
+            case ParenExpr:
+                work.push_back(static_cast<ParenExprNode*>(n)->expr_);
+                break;
+            case IndexExpr: {
+                auto e = static_cast<IndexExprNode*>(n);
+                work.push_back(e->x_);
+                work.push_back(e->index_);
+                break;
+            }
+            case CallExpr: {
+                auto e = static_cast<CallExprNode*>(n);
+                work.push_back(e->fun_);
+                PushList(e->args_, &work);
+                break;
+            }
+            case UnaryExpr:
+                work.push_back(static_cast<UnaryExprNode*>(n)->x_);
+                break;
+            case BinaryExpr: {
+                auto e = static_cast<BinaryExprNode*>(n);
+                work.push_back(e->x_);
+                work.push_back(e->y_);
+                break;
+            }
+            case Field: {
+                auto f = static_cast<FieldNode*>(n);
+                work.push_back(f->type_);
+                work.push_back(f->name_);
+                break;
+            }
+            case FieldList:
+                PushList(static_cast<FieldListNode*>(n)->fields_, &work);
+                break;
+            case FuncDecl: {
+                auto d = static_cast<FuncDeclNode*>(n);
+                work.push_back(d->type_);
+                work.push_back(d->name_);
+                work.push_back(d->params_);
+                work.push_back(d->body_);
+                break;
+            }
+            case SingleVarDecl: {
+                auto d = static_cast<SingleVarDeclNode*>(n);
+                work.push_back(d->type_);
+                work.push_back(d->name_);
+                work.push_back(d->val_);
+                break;
+            }
+            case VarDecl:
+                PushList(static_cast<VarDeclNode*>(n)->decls_, &work);
+                break;
+            case DeclStmt:
+                work.push_back(static_cast<DeclStmtNode*>(n)->decl_);
+                break;
+            case ExprStmt:
+                work.push_back(static_cast<ExprStmtNode*>(n)->expr_);
+                break;
+            case AssignStmt: {
+                auto s = static_cast<AssignStmtNode*>(n);
+                work.push_back(s->lhs_);
+                work.push_back(s->rhs_);
+                break;
+            }
+            case ForStmt: {
+                auto s = static_cast<ForStmtNode*>(n);
+                work.push_back(s->init_);
+                work.push_back(s->cond_);
+                work.push_back(s->step_);
+                work.push_back(s->body_);
+                break;
+            }
+            case WhileStmt: {
+                auto s = static_cast<WhileStmtNode*>(n);
+                work.push_back(s->cond_);
+                work.push_back(s->body_);
+                break;
+            }
+            case ReturnStmt:
+                work.push_back(static_cast<ReturnStmtNode*>(n)->results_);
+                break;
+            case BlockStmt:
+                PushList(static_cast<BlockStmtNode*>(n)->stmts_, &work);
+                break;
+            case IfStmt: {
+                auto s = static_cast<IfStmtNode*>(n);
+                work.push_back(s->cond_);
+                work.push_back(s->body_);
+                work.push_back(s->else_);
+                break;
+            }
+            case CaseStmt: {
+                auto s = static_cast<CaseStmtNode*>(n);
+                work.push_back(s->cond_);
+                PushList(s->body_, &work);
+                break;
+            }
+            case SwitchStmt: {
+                auto s = static_cast<SwitchStmtNode*>(n);
+                work.push_back(s->cond_);
+                PushList(s->cases_, &work);
+                break;
+            }
+            case ScanStmt:
+                work.push_back(static_cast<ScanStmtNode*>(n)->var_);
+                break;
+            case PrintfStmt:
+                PushList(static_cast<PrintfStmtNode*>(n)->args_, &work);
+                break;
+            default:
+                // the other nodes have no children.
+                break;
+        }
+    }
+}
+
+}// namespace ast
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "ast/ast.h"
+
+namespace ast {
+
+/**
+ * @brief ShiftPos moves positions of node and all nodes under it by offset bytes and
+ * lines lines, columns are kept. Nodes at npos stay there.
+ * It's how an edit before a kept decl moves the decl, see incremental::Document.
+ */
+void ShiftPos(Node* node, int offset, int lines);
+
+}// namespace ast
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ast/ast.h"
+
+using namespace std;
+
+namespace ast {
+
+/**
+ * @brief DecodeStringLit strips quotes of a string literal and decodes its C escapes,
+ * an unknown escape is kept as is.
+ *
+ * @param lit literal in source, e.g. "\"a\\tb\"".
+ */
+inline string DecodeStringLit(const string& lit) {
+    string text = lit.size() >= 2 ? lit.substr(1, lit.size() - 2) : "";
+    string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] != '\\' || i + 1 == text.size()) {
+            out += text[i];
+            continue;
+        }
+
+        switch (text[i + 1]) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case '\\': out += '\\'; break;
+            case '"': out += '"'; break;
+            default:
+                out += text[i];
+                continue;
+        }
+        i++;
+    }
+    return out;
+}
+
+/**
+ * @brief CharLitValue returns value of a char literal, e.g. 97 for "'a'".
+ */
+inline int CharLitValue(const string& lit) {
+    return lit.size() >= 3 ? static_cast<unsigned char>(lit[1]) : 0;
+}
+
+/**
+ * @brief FlattenCompositeLit appends items of lit to items in row major order,
+ * a lit which isn't composite is a single item.
+ */
+inline void FlattenCompositeLit(ExprNode* lit, vector<ExprNode*>* items) {
+    if (lit->Type() != NodeType::CompositeLit) {
+        items->push_back(lit);
+        return;
+    }
+
+    for (auto item : static_cast<CompositeLitNode*>(lit)->items_) {
+        FlattenCompositeLit(item, items);
+    }
+}
+
+}// namespace ast
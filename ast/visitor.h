@@ -0,0 +1,150 @@
+#pragma once
+
+#include "ast/ast.h"
+
+namespace ast {
+
+// Visitors dispatch a node to the handler of its concrete class by the
+// Type() tag and static_cast, no RTTI is involved. They are CRTP bases:
+// Derived overrides (hides) the handlers it cares about, the others fall
+// back to VisitOtherStmt / VisitOtherExpr / VisitOtherDecl, which return
+// Ret() unless Derived hides them too. Args are passed through to every
+// handler, e.g. an out param for the type of an expr.
+//
+// e.g.
+//   class Printer : public ast::ExprVisitor<Printer> {
+//   public:
+//       void VisitIdent(ast::IdentNode* ident) { cout << ident->name_; }
+//   };
+//   Printer().VisitExpr(expr);
+
+// StmtVisitor dispatches statement nodes.
+template <typename Derived, typename Ret = void, typename... Args>
+class StmtVisitor {
+public:
+    Ret VisitStmt(StmtNode* stmt, Args... args) {
+        switch (stmt->Type()) {
+            case NodeType::BadStmt:
+                return self()->VisitBadStmt(static_cast<BadStmtNode*>(stmt), args...);
+            case NodeType::DeclStmt:
+                return self()->VisitDeclStmt(static_cast<DeclStmtNode*>(stmt), args...);
+            case NodeType::EmptyStmt:
+                return self()->VisitEmptyStmt(static_cast<EmptyStmtNode*>(stmt), args...);
+            case NodeType::ExprStmt:
+                return self()->VisitExprStmt(static_cast<ExprStmtNode*>(stmt), args...);
+            case NodeType::AssignStmt:
+                return self()->VisitAssignStmt(static_cast<AssignStmtNode*>(stmt), args...);
+            case NodeType::ReturnStmt:
+                return self()->VisitReturnStmt(static_cast<ReturnStmtNode*>(stmt), args...);
+            case NodeType::BlockStmt:
+                return self()->VisitBlockStmt(static_cast<BlockStmtNode*>(stmt), args...);
+            case NodeType::IfStmt:
+                return self()->VisitIfStmt(static_cast<IfStmtNode*>(stmt), args...);
+            case NodeType::CaseStmt:
+                return self()->VisitCaseStmt(static_cast<CaseStmtNode*>(stmt), args...);
+            case NodeType::SwitchStmt:
+                return self()->VisitSwitchStmt(static_cast<SwitchStmtNode*>(stmt), args...);
+            case NodeType::ForStmt:
+                return self()->VisitForStmt(static_cast<ForStmtNode*>(stmt), args...);
+            case NodeType::WhileStmt:
+                return self()->VisitWhileStmt(static_cast<WhileStmtNode*>(stmt), args...);
+            case NodeType::ScanStmt:
+                return self()->VisitScanStmt(static_cast<ScanStmtNode*>(stmt), args...);
+            case NodeType::PrintfStmt:
+                return self()->VisitPrintfStmt(static_cast<PrintfStmtNode*>(stmt), args...);
+            default:
+                return self()->VisitOtherStmt(stmt, args...);
+        }
+    }
+
+    Ret VisitBadStmt(BadStmtNode* stmt, Args... args) { return self()->VisitOtherStmt(stmt, args...); }
+    Ret VisitDeclStmt(DeclStmtNode* stmt, Args... args) { return self()->VisitOtherStmt(stmt, args...); }
+    Ret VisitEmptyStmt(EmptyStmtNode* stmt, Args... args) { return self()->VisitOtherStmt(stmt, args...); }
+    Ret VisitExprStmt(ExprStmtNode* stmt, Args... args) { return self()->VisitOtherStmt(stmt, args...); }
+    Ret VisitAssignStmt(AssignStmtNode* stmt, Args... args) { return self()->VisitOtherStmt(stmt, args...); }
+    Ret VisitReturnStmt(ReturnStmtNode* stmt, Args... args) { return self()->VisitOtherStmt(stmt, args...); }
+    Ret VisitBlockStmt(BlockStmtNode* stmt, Args... args) { return self()->VisitOtherStmt(stmt, args...); }
+    Ret VisitIfStmt(IfStmtNode* stmt, Args... args) { return self()->VisitOtherStmt(stmt, args...); }
+    Ret VisitCaseStmt(CaseStmtNode* stmt, Args... args) { return self()->VisitOtherStmt(stmt, args...); }
+    Ret VisitSwitchStmt(SwitchStmtNode* stmt, Args... args) { return self()->VisitOtherStmt(stmt, args...); }
+    Ret VisitForStmt(ForStmtNode* stmt, Args... args) { return self()->VisitOtherStmt(stmt, args...); }
+    Ret VisitWhileStmt(WhileStmtNode* stmt, Args... args) { return self()->VisitOtherStmt(stmt, args...); }
+    Ret VisitScanStmt(ScanStmtNode* stmt, Args... args) { return self()->VisitOtherStmt(stmt, args...); }
+    Ret VisitPrintfStmt(PrintfStmtNode* stmt, Args... args) { return self()->VisitOtherStmt(stmt, args...); }
+    Ret VisitOtherStmt(StmtNode*, Args...) { return Ret(); }
+private:
+    Derived* self() { return static_cast<Derived*>(this); }
+};
+
+// ExprVisitor dispatches expression nodes.
+template <typename Derived, typename Ret = void, typename... Args>
+class ExprVisitor {
+public:
+    Ret VisitExpr(ExprNode* expr, Args... args) {
+        switch (expr->Type()) {
+            case NodeType::BadExpr:
+                return self()->VisitBadExpr(static_cast<BadExprNode*>(expr), args...);
+            case NodeType::Ident:
+                return self()->VisitIdent(static_cast<IdentNode*>(expr), args...);
+            case NodeType::BasicLit:
+                return self()->VisitBasicLit(static_cast<BasicLitNode*>(expr), args...);
+            case NodeType::CompositeLit:
+                return self()->VisitCompositeLit(static_cast<CompositeLitNode*>(expr), args...);
+            case NodeType::ParenExpr:
+                return self()->VisitParenExpr(static_cast<ParenExprNode*>(expr), args...);
+            case NodeType::IndexExpr:
+                return self()->VisitIndexExpr(static_cast<IndexExprNode*>(expr), args...);
+            case NodeType::CallExpr:
+                return self()->VisitCallExpr(static_cast<CallExprNode*>(expr), args...);
+            case NodeType::UnaryExpr:
+                return self()->VisitUnaryExpr(static_cast<UnaryExprNode*>(expr), args...);
+            case NodeType::BinaryExpr:
+                return self()->VisitBinaryExpr(static_cast<BinaryExprNode*>(expr), args...);
+            default:
+                return self()->VisitOtherExpr(expr, args...);
+        }
+    }
+
+    Ret VisitBadExpr(BadExprNode* expr, Args... args) { return self()->VisitOtherExpr(expr, args...); }
+    Ret VisitIdent(IdentNode* expr, Args... args) { return self()->VisitOtherExpr(expr, args...); }
+    Ret VisitBasicLit(BasicLitNode* expr, Args... args) { return self()->VisitOtherExpr(expr, args...); }
+    Ret VisitCompositeLit(CompositeLitNode* expr, Args... args) { return self()->VisitOtherExpr(expr, args...); }
+    Ret VisitParenExpr(ParenExprNode* expr, Args... args) { return self()->VisitOtherExpr(expr, args...); }
+    Ret VisitIndexExpr(IndexExprNode* expr, Args... args) { return self()->VisitOtherExpr(expr, args...); }
+    Ret VisitCallExpr(CallExprNode* expr, Args... args) { return self()->VisitOtherExpr(expr, args...); }
+    Ret VisitUnaryExpr(UnaryExprNode* expr, Args... args) { return self()->VisitOtherExpr(expr, args...); }
+    Ret VisitBinaryExpr(BinaryExprNode* expr, Args... args) { return self()->VisitOtherExpr(expr, args...); }
+    Ret VisitOtherExpr(ExprNode*, Args...) { return Ret(); }
+private:
+    Derived* self() { return static_cast<Derived*>(this); }
+};
+
+// DeclVisitor dispatches declaration nodes.
+template <typename Derived, typename Ret = void, typename... Args>
+class DeclVisitor {
+public:
+    Ret VisitDecl(DeclNode* decl, Args... args) {
+        switch (decl->Type()) {
+            case NodeType::BadDecl:
+                return self()->VisitBadDecl(static_cast<BadDeclNode*>(decl), args...);
+            case NodeType::VarDecl:
+                return self()->VisitVarDecl(static_cast<VarDeclNode*>(decl), args...);
+            case NodeType::SingleVarDecl:
+                return self()->VisitSingleVarDecl(static_cast<SingleVarDeclNode*>(decl), args...);
+            case NodeType::FuncDecl:
+                return self()->VisitFuncDecl(static_cast<FuncDeclNode*>(decl), args...);
+            default:
+                return self()->VisitOtherDecl(decl, args...);
+        }
+    }
+
+    Ret VisitBadDecl(BadDeclNode* decl, Args... args) { return self()->VisitOtherDecl(decl, args...); }
+    Ret VisitVarDecl(VarDeclNode* decl, Args... args) { return self()->VisitOtherDecl(decl, args...); }
+    Ret VisitSingleVarDecl(SingleVarDeclNode* decl, Args... args) { return self()->VisitOtherDecl(decl, args...); }
+    Ret VisitFuncDecl(FuncDeclNode* decl, Args... args) { return self()->VisitOtherDecl(decl, args...); }
+    Ret VisitOtherDecl(DeclNode*, Args...) { return Ret(); }
+private:
+    Derived* self() { return static_cast<Derived*>(this); }
+};
+
+}// namespace ast
@@ -0,0 +1,148 @@
+#include "ast/writer.h"
+#include "ast/ast.h"
+
+namespace ast {
+
+// ====================================================================
+// ======================XmlWriter=====================================
+// ====================================================================
+
+void XmlWriter::BeginNode(const char* name) {
+    out_ << '<' << name << '>';
+    nodes_.push_back(name);
+}
+
+void XmlWriter::EndNode() {
+    out_ << "</" << nodes_.back() << '>';
+    nodes_.pop_back();
+}
+
+void XmlWriter::Pos(const token::Position& pos) {
+    out_ << "<pos>(" << pos.line << ", " << pos.column << ")</pos>";
+}
+
+void XmlWriter::String(const char* key, const string& val) {
+    out_ << '<' << key << '>' << val << "</" << key << '>';
+}
+
+void XmlWriter::Int(const char* key, int val) {
+    out_ << '<' << key << '>' << val << "</" << key << '>';
+}
+
+void XmlWriter::Bool(const char* key, bool val) {
+    out_ << '<' << key << '>' << (val ? "true" : "false") << "</" << key << '>';
+}
+
+void XmlWriter::Child(const char* key, const Node* child) {
+    out_ << '<' << key << '>';
+    if (child != nullptr) {
+        child->Write(this);
+    }
+    out_ << "</" << key << '>';
+}
+
+void XmlWriter::BeginList(const char* key) {
+    lists_.push_back(key);
+}
+
+void XmlWriter::ListItem(const Node* item) {
+    Child(lists_.back(), item);
+}
+
+void XmlWriter::EndList() {
+    lists_.pop_back();
+}
+
+// ====================================================================
+// ======================JsonWriter====================================
+// ====================================================================
+
+void JsonWriter::Key(const char* key) {
+    out_ << ",\"" << key << "\":";
+}
+
+void JsonWriter::Quote(const string& val) {
+    static const char* kHex = "0123456789abcdef";
+
+    out_ << '"';
+    for (char c : val) {
+        unsigned char uc = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out_ << '\\' << c;
+        } else if (c == '\n') {
+            out_ << "\\n";
+        } else if (c == '\t') {
+            out_ << "\\t";
+        } else if (c == '\r') {
+            out_ << "\\r";
+        } else if (uc < 0x20) {
+            out_ << "\\u00" << kHex[uc >> 4] << kHex[uc & 0xf];
+        } else {
+            out_ << c;
+        }
+    }
+    out_ << '"';
+}
+
+void JsonWriter::BeginNode(const char* name) {
+    out_ << "{\"node\":\"" << name << '"';
+}
+
+void JsonWriter::EndNode() {
+    out_ << '}';
+}
+
+void JsonWriter::Pos(const token::Position& pos) {
+    Key("pos");
+    out_ << '[' << pos.line << ',' << pos.column << ']';
+}
+
+void JsonWriter::String(const char* key, const string& val) {
+    Key(key);
+    Quote(val);
+}
+
+void JsonWriter::Int(const char* key, int val) {
+    Key(key);
+    out_ << val;
+}
+
+void JsonWriter::Bool(const char* key, bool val) {
+    Key(key);
+    out_ << (val ? "true" : "false");
+}
+
+void JsonWriter::Child(const char* key, const Node* child) {
+    Key(key);
+    if (child == nullptr) {
+        out_ << "null";
+        return;
+    }
+    child->Write(this);
+}
+
+void JsonWriter::BeginList(const char* key) {
+    Key(key);
+    out_ << '[';
+    first_in_list_.push_back(true);
+}
+
+void JsonWriter::ListItem(const Node* item) {
+    if (!first_in_list_.back()) {
+        out_ << ',';
+    }
+    first_in_list_.back() = false;
+
+    if (item == nullptr) {
+        out_ << "null";
+        return;
+    }
+    item->Write(this);
+}
+
+void JsonWriter::EndList() {
+    out_ << ']';
+    first_in_list_.pop_back();
+}
+
+}// namespace ast
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "token/position.h"
+
+using namespace std;
+
+namespace ast {
+
+class Node;
+
+// Writer receives a node tree in a single pass, every node describes itself
+// by Node::Write and the writer puts it straight into an output stream,
+// no per subtree string is built.
+class Writer {
+public:
+    virtual ~Writer() = default;
+
+    // BeginNode starts a node named name, fields and children follow until EndNode.
+    virtual void BeginNode(const char* name) = 0;
+    virtual void EndNode() = 0;
+
+    // Pos writes the position of current node.
+    virtual void Pos(const token::Position& pos) = 0;
+
+    // String, Int, Bool write a leaf field of current node.
+    virtual void String(const char* key, const string& val) = 0;
+    virtual void Int(const char* key, int val) = 0;
+    virtual void Bool(const char* key, bool val) = 0;
+
+    // Child writes a child node, child may be nullptr.
+    virtual void Child(const char* key, const Node* child) = 0;
+
+    // BeginList starts a list of children named key, items are written by ListItem.
+    virtual void BeginList(const char* key) = 0;
+    virtual void ListItem(const Node* item) = 0;
+    virtual void EndList() = 0;
+
+    template <typename T>
+    void Children(const char* key, const vector<T*>& items) {
+        BeginList(key);
+        for (const auto& item : items) {
+            ListItem(item);
+        }
+        EndList();
+    }
+};
+
+// XmlWriter writes nodes in the xml-ish layout, e.g.
+// <IdentNode><pos>(1, 5)</pos><name>a</name></IdentNode>.
+// Items of a list are written one by one, each wrapped by the list key.
+class XmlWriter : public Writer {
+public:
+    explicit XmlWriter(ostream& out) : out_(out) {}
+
+    void BeginNode(const char* name) override;
+    void EndNode() override;
+    void Pos(const token::Position& pos) override;
+    void String(const char* key, const string& val) override;
+    void Int(const char* key, int val) override;
+    void Bool(const char* key, bool val) override;
+    void Child(const char* key, const Node* child) override;
+    void BeginList(const char* key) override;
+    void ListItem(const Node* item) override;
+    void EndList() override;
+private:
+    ostream& out_;
+    vector<const char*> nodes_;
+    vector<const char*> lists_;
+};
+
+// JsonWriter writes nodes as compact json, e.g.
+// {"node":"IdentNode","pos":[1,5],"name":"a"}, pos is [line, column].
+// Lists are json arrays and missing children are null.
+class JsonWriter : public Writer {
+public:
+    explicit JsonWriter(ostream& out) : out_(out) {}
+
+    void BeginNode(const char* name) override;
+    void EndNode() override;
+    void Pos(const token::Position& pos) override;
+    void String(const char* key, const string& val) override;
+    void Int(const char* key, int val) override;
+    void Bool(const char* key, bool val) override;
+    void Child(const char* key, const Node* child) override;
+    void BeginList(const char* key) override;
+    void ListItem(const Node* item) override;
+    void EndList() override;
+private:
+    // Key writes ,"key": for a field of current node.
+    void Key(const char* key);
+
+    // Quote writes val as a json string.
+    void Quote(const string& val);
+
+    ostream& out_;
+    // first_in_list_ tells if no item is written yet, one for each open list.
+    vector<bool> first_in_list_;
+};
+
+}// namespace ast
@@ -0,0 +1,395 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ast/flat.h"
+#include "bench/gen.h"
+#include "check/check.h"
+#include "input/source_buffer.h"
+#include "parser/parser.h"
+#include "parser/var_table.h"
+#include "scanner/scanner.h"
+#include "scanner/token_columns.h"
+#include "token/token.h"
+
+using namespace std;
+
+namespace bench {
+
+// CountingErrorHandler counts scan errors, generated programs must have none.
+class CountingErrorHandler: public ErrorHandler {
+public:
+    ~CountingErrorHandler() override = default;
+    void Report(const token::Position&, const string&) override { count++; }
+    int count = 0;
+};
+
+// Options are the command line of the bench.
+class Options {
+public:
+    size_t size = 1 << 20;
+    int min_ms = 300;
+    uint32_t seed = 1;
+    string filter;
+};
+
+// Result is the throughput of a benchmark, bytes and tokens are per iteration, 0 if not meaningful.
+class Result {
+public:
+    string name;
+    long iters = 0;
+    double ns_per_iter = 0;
+    double bytes = 0;
+    double tokens = 0;
+    double ops = 0;
+};
+
+// sink keeps results of benchmarked code alive, so it isn't optimized out.
+static volatile long sink = 0;
+
+// Measure runs fn until min_ms passed, after one warm up run.
+static Result Measure(const string& name, int min_ms, const function<void()>& fn) {
+    fn();
+
+    Result result;
+    result.name = name;
+    auto start = chrono::steady_clock::now();
+    auto deadline = start + chrono::milliseconds(min_ms);
+    auto now = start;
+    do {
+        fn();
+        result.iters++;
+        now = chrono::steady_clock::now();
+    } while (now < deadline);
+
+    result.ns_per_iter = chrono::duration<double, nano>(now - start).count() / result.iters;
+    return result;
+}
+
+static void Print(const Result& r) {
+    char line[160];
+    double per_sec = 1e9 / r.ns_per_iter;
+    snprintf(line, sizeof(line), "%-24s %8ld %12.3f", r.name.c_str(), r.iters, r.ns_per_iter / 1e6);
+    cout << line;
+    if (r.bytes > 0) {
+        snprintf(line, sizeof(line), " %10.2f MB/s %10.2f Mtok/s", r.bytes * per_sec / 1e6, r.tokens * per_sec / 1e6);
+        cout << line;
+    }
+    if (r.ops > 0) {
+        snprintf(line, sizeof(line), " %10.2f ns/op %10.2f Mop/s", r.ns_per_iter / r.ops, r.ops * per_sec / 1e6);
+        cout << line;
+    }
+    cout << endl;
+}
+
+// Input is a generated program and the count of its tokens.
+class Input {
+public:
+    Shape shape;
+    shared_ptr<input::SourceBuffer> src;
+    long tokens = 0;
+};
+
+static long Scan(const shared_ptr<input::SourceBuffer>& src, const shared_ptr<ErrorHandler>& err) {
+    auto file = make_shared<token::File>();
+    file->size = src->size();
+    Scanner scanner(file, src, err);
+
+    long n = 0;
+    TokenRecord rec{};
+    do {
+        scanner.Scan(&rec);
+        n++;
+    } while (rec.tok != token::END_OF_FILE);
+    return n;
+}
+
+static long ScanColumns(const shared_ptr<input::SourceBuffer>& src, const shared_ptr<ErrorHandler>& err) {
+    auto file = make_shared<token::File>();
+    file->size = src->size();
+    Scanner scanner(file, src, err);
+
+    TokenColumns tokens;
+    tokens.ScanAll(&scanner);
+    return tokens.Size();
+}
+
+static shared_ptr<ast::FileNode> Parse(
+    const shared_ptr<input::SourceBuffer>& src,
+    const shared_ptr<ec::ErrorReminder>& errors,
+    bool pipelined = false
+) {
+    auto file = make_shared<token::File>();
+    file->name = "bench.txt";
+    file->size = src->size();
+    Parser parser(file, src, make_shared<CountingErrorHandler>(), errors);
+    parser.SetThrowOnError(true);
+    if (pipelined) {
+        parser.StartPipeline();
+    }
+    return parser.Parse();
+}
+
+// Check checks file on jobs threads and returns the count of errors found.
+static size_t Check(const shared_ptr<ast::FileNode>& file, int jobs = 1) {
+    auto errors = make_shared<ec::ErrorReminder>(false, cerr);
+    check::Checker checker(file, errors);
+    checker.SetJobs(jobs);
+    checker.Check();
+    return errors->Size();
+}
+
+static bool Selected(const Options& opts, const string& name) {
+    return opts.filter.empty() || name.find(opts.filter) != string::npos;
+}
+
+static void RunFrontEnd(const Options& opts, const Input& in) {
+    string shape = ShapeName(in.shape);
+    double bytes = in.src->size();
+
+    string name = "scan/" + shape;
+    if (Selected(opts, name)) {
+        auto err = make_shared<CountingErrorHandler>();
+        Result r = Measure(name, opts.min_ms, [&]() { sink += Scan(in.src, err); });
+        r.bytes = bytes;
+        r.tokens = in.tokens;
+        Print(r);
+    }
+
+    name = "scan-columns/" + shape;
+    if (Selected(opts, name)) {
+        auto err = make_shared<CountingErrorHandler>();
+        Result r = Measure(name, opts.min_ms, [&]() { sink += ScanColumns(in.src, err); });
+        r.bytes = bytes;
+        r.tokens = in.tokens;
+        Print(r);
+    }
+
+    name = "parse/" + shape;
+    if (Selected(opts, name)) {
+        auto errors = make_shared<ec::ErrorReminder>(false, cerr);
+        Result r = Measure(name, opts.min_ms, [&]() { sink += Parse(in.src, errors)->decl_.size(); });
+        r.bytes = bytes;
+        r.tokens = in.tokens;
+        Print(r);
+    }
+
+    // the scanner runs on its own thread, so this is scan and parse overlapped.
+    name = "parse-piped/" + shape;
+    if (Selected(opts, name)) {
+        auto errors = make_shared<ec::ErrorReminder>(false, cerr);
+        Result r = Measure(name, opts.min_ms, [&]() { sink += Parse(in.src, errors, true)->decl_.size(); });
+        r.bytes = bytes;
+        r.tokens = in.tokens;
+        Print(r);
+    }
+
+    name = "flatten/" + shape;
+    if (Selected(opts, name)) {
+        auto file = Parse(in.src, make_shared<ec::ErrorReminder>(false, cerr));
+        ast::FlatFile flat;
+        Result r = Measure(name, opts.min_ms, [&]() {
+            ast::Flatten(*file, &flat);
+            sink += flat.Rows();
+        });
+        r.bytes = bytes;
+        r.tokens = in.tokens;
+        Print(r);
+    }
+
+    name = "expand/" + shape;
+    if (Selected(opts, name)) {
+        ast::FlatFile flat;
+        ast::Flatten(*Parse(in.src, make_shared<ec::ErrorReminder>(false, cerr)), &flat);
+        Result r = Measure(name, opts.min_ms, [&]() {
+            shared_ptr<ast::FileNode> file;
+            sink += ast::Expand(flat, "bench.txt", &file) == 0 ? file->decl_.size() : 0;
+        });
+        r.bytes = bytes;
+        r.tokens = in.tokens;
+        Print(r);
+    }
+
+    name = "check/" + shape;
+    if (Selected(opts, name)) {
+        auto file = Parse(in.src, make_shared<ec::ErrorReminder>(false, cerr));
+        Result r = Measure(name, opts.min_ms, [&]() { sink += Check(file); });
+        r.bytes = bytes;
+        r.tokens = in.tokens;
+        Print(r);
+    }
+
+    // function bodies are checked on all cores, at least two threads even on one.
+    name = "check-mt/" + shape;
+    if (Selected(opts, name)) {
+        auto file = Parse(in.src, make_shared<ec::ErrorReminder>(false, cerr));
+        int jobs = max(2, static_cast<int>(thread::hardware_concurrency()));
+        Result r = Measure(name, opts.min_ms, [&]() { sink += Check(file, jobs); });
+        r.bytes = bytes;
+        r.tokens = in.tokens;
+        Print(r);
+    }
+
+    name = "front-end/" + shape;
+    if (Selected(opts, name)) {
+        Result r = Measure(name, opts.min_ms, [&]() {
+            sink += Check(Parse(in.src, make_shared<ec::ErrorReminder>(false, cerr)));
+        });
+        r.bytes = bytes;
+        r.tokens = in.tokens;
+        Print(r);
+    }
+}
+
+// RunLookUp looks up a mix of keywords and identifiers, as the scanner does for every word.
+static void RunLookUp(const Options& opts) {
+    if (!Selected(opts, "lookup")) {
+        return;
+    }
+
+    const vector<string> words = {
+        "int", "char", "const", "void", "main", "if", "else", "switch", "case", "default", "while",
+        "for", "scanf", "printf", "return", "a", "b", "t", "u", "counter", "value", "f12", "result",
+        "intx", "cha", "whilst", "returns",
+    };
+    const int rounds = 4096;
+    Result r = Measure("lookup", opts.min_ms, [&]() {
+        long n = 0;
+        for (int i = 0; i < rounds; i++) {
+            for (const auto& w : words) {
+                n += token::LookUp(w.data(), static_cast<int>(w.size()));
+            }
+        }
+        sink += n;
+    });
+    r.ops = static_cast<double>(rounds) * words.size();
+    Print(r);
+}
+
+// RunVarTable looks up symbols of globals and of 16 nested blocks, most found in inner ones.
+static void RunVarTable(const Options& opts) {
+    if (!Selected(opts, "var-table")) {
+        return;
+    }
+
+    const int globals = 1024, depth = 16, locals = 16;
+    ast::IntTypeNode type;
+    VarTable table;
+    for (int s = 0; s < globals; s++) {
+        table.AddVar(s, &type);
+    }
+    for (int d = 0; d < depth; d++) {
+        table.CreateCodeBlock();
+        for (int s = 0; s < locals; s++) {
+            table.AddVar(globals + d * locals + s, &type);
+        }
+    }
+
+    const int symbols = globals + depth * locals;
+    vector<int> queries;
+    uint32_t x = opts.seed | 1;
+    for (int i = 0; i < 16384; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        // a quarter are globals, the others locals, a few are never declared.
+        int q = (x & 3) == 0 ? static_cast<int>(x % globals) : globals + static_cast<int>(x % (symbols - globals + 8));
+        queries.push_back(q);
+    }
+
+    Result r = Measure("var-table", opts.min_ms, [&]() {
+        long n = 0;
+        for (int q : queries) {
+            const VarTable::Identifier* ident = nullptr;
+            n += table.GetVar(q, &ident);
+        }
+        sink += n;
+    });
+    r.ops = static_cast<double>(queries.size());
+    Print(r);
+}
+
+static void Usage(const char* argv0) {
+    cerr << "usage: " << argv0 << " [--size bytes] [--min-ms ms] [--seed n] [--filter name]\n"
+         << "       " << argv0 << " --gen shape [--size bytes] [--seed n]\n"
+         << "shapes: deep-expr wide-switch many-funcs big-arrays mixed" << endl;
+}
+
+int BenchMain(int argc, char** argv) {
+    Options opts;
+    string gen;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        string val = argv[++i];
+        if (arg == "--size") {
+            opts.size = strtoul(val.c_str(), nullptr, 10);
+        } else if (arg == "--min-ms") {
+            opts.min_ms = atoi(val.c_str());
+        } else if (arg == "--seed") {
+            opts.seed = static_cast<uint32_t>(strtoul(val.c_str(), nullptr, 10));
+        } else if (arg == "--filter") {
+            opts.filter = val;
+        } else if (arg == "--gen") {
+            gen = val;
+        } else {
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // '--gen shape' writes a program, e.g. for profiling the compiler on it.
+    if (!gen.empty()) {
+        Shape shape;
+        if (ParseShape(gen, &shape) != 0) {
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        cout << Generate(shape, opts.size, opts.seed);
+        return EXIT_SUCCESS;
+    }
+
+    cout << "benchmark                   iters      ms/iter   throughput" << endl;
+    RunLookUp(opts);
+    RunVarTable(opts);
+
+    for (int s = 0; s < shape_end; s++) {
+        Input in;
+        in.shape = static_cast<Shape>(s);
+        in.src = input::SourceBuffer::FromString(Generate(in.shape, opts.size, opts.seed));
+
+        // a generated program with errors benchmarks error paths instead, which is a bug of the generator.
+        auto err = make_shared<CountingErrorHandler>();
+        in.tokens = Scan(in.src, err);
+        size_t errors = 0;
+        try {
+            errors = Check(Parse(in.src, make_shared<ec::ErrorReminder>(false, cerr)));
+        } catch (const ParserError& e) {
+            cerr << ShapeName(in.shape) << ": parse error at " << e.pos.ToString() << ": " << e.message << endl;
+            return EXIT_FAILURE;
+        }
+        if (err->count != 0 || errors != 0) {
+            cerr << ShapeName(in.shape) << ": generated program has " << err->count + errors << " errors" << endl;
+            return EXIT_FAILURE;
+        }
+
+        RunFrontEnd(opts, in);
+    }
+    return EXIT_SUCCESS;
+}
+
+}// namespace bench
+
+int main(int argc, char** argv) {
+    return bench::BenchMain(argc, argv);
+}
@@ -0,0 +1,253 @@
+#include "bench/gen.h"
+
+namespace bench {
+
+static const char* const kShapeNames[shape_end] = {
+    "deep-expr", "wide-switch", "many-funcs", "big-arrays", "mixed",
+};
+
+// kNestDepth is how deep parens of a DeepExpr statement nest.
+const static int kNestDepth = 48;
+// kSwitchCases is the count of cases of a WideSwitch switch.
+const static int kSwitchCases = 256;
+// kArrayLen is the length of a BigArrays array, 2-D ones are about as big.
+const static int kArrayLen = 1024;
+
+const char* ShapeName(Shape shape) {
+    return kShapeNames[shape];
+}
+
+int ParseShape(const string& name, Shape* shape) {
+    for (int i = 0; i < shape_end; i++) {
+        if (name == kShapeNames[i]) {
+            *shape = static_cast<Shape>(i);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Rng is xorshift32, so programs don't depend on the std distributions.
+class Rng {
+public:
+    explicit Rng(uint32_t seed) : state_(seed == 0 ? 0x9E3779B9u : seed) {}
+
+    uint32_t Next() {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 17;
+        state_ ^= state_ << 5;
+        return state_;
+    }
+
+    // Below returns a number in [0, n).
+    int Below(int n) { return static_cast<int>(Next() % static_cast<uint32_t>(n)); }
+private:
+    uint32_t state_;
+};
+
+// Generator writes a program: consts and globals, then functions, then main.
+// Every function is 'int fN(int a, int b)' with locals t, u, i and v[8], and
+// only calls the functions before it.
+class Generator {
+public:
+    Generator(Shape shape, size_t size, uint32_t seed) : shape_(shape), size_(size), rng_(seed) {}
+
+    string Run() {
+        out_ += "const int K0 = 7, K1 = -3;\n";
+        out_ += "const char C0 = 'x';\n";
+        out_ += "int g0, g1, g2;\n";
+
+        if (shape_ == BigArrays || shape_ == Mixed) {
+            size_t arrays = shape_ == BigArrays ? size_ : size_ / 4;
+            for (int n = 0; out_.size() < arrays; n++) {
+                Array(n);
+            }
+        }
+
+        while (out_.size() < size_ || funcs_ == 0) {
+            Shape shape = shape_ == Mixed ? static_cast<Shape>(rng_.Below(BigArrays)) : shape_;
+            Func(shape == BigArrays ? ManyFuncs : shape);
+        }
+
+        Main();
+        return move(out_);
+    }
+private:
+    void Array(int n) {
+        switch (n % 3) {
+            case 0:
+                out_ += "int arr" + to_string(n) + "[" + to_string(kArrayLen) + "] = {";
+                for (int i = 0; i < kArrayLen; i++) {
+                    out_ += (i == 0 ? "" : ", ") + to_string(rng_.Below(2000));
+                }
+                out_ += "};\n";
+                break;
+            case 1: {
+                const int rows = 32, cols = kArrayLen / 32;
+                out_ += "int mat" + to_string(n) + "[" + to_string(rows) + "][" + to_string(cols) + "] = {";
+                for (int r = 0; r < rows; r++) {
+                    out_ += r == 0 ? "{" : ",\n    {";
+                    for (int c = 0; c < cols; c++) {
+                        out_ += (c == 0 ? "" : ",") + to_string(rng_.Below(100));
+                    }
+                    out_ += "}";
+                }
+                out_ += "};\n";
+                break;
+            }
+            default:
+                out_ += "char str" + to_string(n) + "[" + to_string(kArrayLen / 4) + "] = {";
+                for (int i = 0; i < kArrayLen / 4; i++) {
+                    out_ += (i == 0 ? "'" : ", '") + string(1, static_cast<char>('a' + rng_.Below(26))) + "'";
+                }
+                out_ += "};\n";
+                break;
+        }
+    }
+
+    // Leaf returns an int operand.
+    string Leaf() {
+        switch (rng_.Below(9)) {
+            case 0: return "a";
+            case 1: return "b";
+            case 2: return "t";
+            case 3: return "u";
+            case 4: return "K" + to_string(rng_.Below(2));
+            case 5: return "g" + to_string(rng_.Below(3));
+            case 6: return "v[" + to_string(rng_.Below(8)) + "]";
+            case 7:
+                if (funcs_ > 0) {
+                    return "f" + to_string(rng_.Below(funcs_)) + "(" + to_string(rng_.Below(10)) + ", u)";
+                }
+                return "a";
+            default: return to_string(rng_.Below(100));
+        }
+    }
+
+    string Op() {
+        static const char* const kOps[] = {" + ", " - ", " * ", " + ", " - "};
+        return kOps[rng_.Below(5)];
+    }
+
+    // Expr returns an expression whose parens nest depth deep, each level is a short chain.
+    string Expr(int depth) {
+        if (depth == 0) {
+            return Leaf();
+        }
+
+        string e = Leaf() + Op();
+        if (rng_.Below(4) == 0) {
+            e = "-" + e;
+        }
+        e += "(" + Expr(depth - 1) + ")";
+        if (rng_.Below(2) == 0) {
+            e += Op() + Leaf();
+        }
+        if (rng_.Below(4) == 0) {
+            e += " / " + to_string(1 + rng_.Below(9));
+        }
+        return e;
+    }
+
+    string Cond() {
+        static const char* const kRels[] = {" < ", " <= ", " > ", " >= ", " == ", " != "};
+        return Expr(1) + kRels[rng_.Below(6)] + Expr(1);
+    }
+
+    void Func(Shape shape) {
+        int n = funcs_;
+        out_ += "int f" + to_string(n) + "(int a, int b) {\n";
+        out_ += "    int t, u, i;\n";
+        out_ += "    int v[8];\n";
+        out_ += "    t = a;\n";
+        out_ += "    u = b;\n";
+        out_ += "    for (i = 0; i < 8; i = i + 1) v[i] = i;\n";
+
+        switch (shape) {
+            case DeepExpr:
+                for (int i = 0; i < 4; i++) {
+                    out_ += "    t = " + Expr(kNestDepth) + ";\n";
+                }
+                break;
+            case WideSwitch:
+                out_ += "    switch (a + b) {\n";
+                for (int i = 0; i < kSwitchCases; i++) {
+                    out_ += "        case " + to_string(i * 3 - 100) + ": t = t" + Op() + Expr(1) + ";\n";
+                }
+                out_ += "        default: u = " + Leaf() + ";\n";
+                out_ += "    }\n";
+                break;
+            default:
+                Stmts(2 + rng_.Below(4), 1);
+                break;
+        }
+
+        // the checker looks at return values before the locals are declared.
+        out_ += "    g0 = t + u;\n";
+        out_ += "    return g0 + a;\n";
+        out_ += "}\n";
+        funcs_++;
+    }
+
+    void Stmts(int count, int indent) {
+        string sp(4 * indent, ' ');
+        for (int i = 0; i < count; i++) {
+            switch (indent < 3 ? rng_.Below(6) : 0) {
+                case 0:
+                    out_ += sp + (rng_.Below(2) == 0 ? "t" : "u") + " = " + Expr(2) + ";\n";
+                    break;
+                case 1:
+                    out_ += sp + "if (" + Cond() + ") {\n";
+                    Stmts(1 + rng_.Below(2), indent + 1);
+                    out_ += sp + "} else {\n";
+                    Stmts(1, indent + 1);
+                    out_ += sp + "}\n";
+                    break;
+                case 2:
+                    out_ += sp + "i = 0;\n";
+                    out_ += sp + "while (i < " + to_string(1 + rng_.Below(4)) + ") {\n";
+                    out_ += sp + "    v[i] = " + Expr(1) + ";\n";
+                    out_ += sp + "    i = i + 1;\n";
+                    out_ += sp + "}\n";
+                    break;
+                case 3:
+                    out_ += sp + "printf(\"t = \", t" + Op() + Leaf() + ");\n";
+                    break;
+                case 4:
+                    out_ += sp + "g" + to_string(rng_.Below(3)) + " = " + Expr(1) + ";\n";
+                    break;
+                default:
+                    out_ += sp + "switch (t) {\n";
+                    for (int c = 0; c < 4; c++) {
+                        out_ += sp + "    case " + to_string(c) + ": u = " + Expr(1) + ";\n";
+                    }
+                    out_ += sp + "    default: u = u + 1;\n";
+                    out_ += sp + "}\n";
+                    break;
+            }
+        }
+    }
+
+    void Main() {
+        out_ += "void main() {\n";
+        out_ += "    int r;\n";
+        out_ += "    r = 0;\n";
+        for (int i = 0; i < 4 && i < funcs_; i++) {
+            out_ += "    r = r + f" + to_string(funcs_ - 1 - i) + "(" + to_string(i) + ", r);\n";
+        }
+        out_ += "    printf(\"r = \", r);\n";
+        out_ += "}\n";
+    }
+
+    Shape shape_;
+    size_t size_;
+    Rng rng_;
+    string out_;
+    int funcs_ = 0;
+};
+
+string Generate(Shape shape, size_t size, uint32_t seed) {
+    return Generator(shape, size, seed).Run();
+}
+
+}// namespace bench
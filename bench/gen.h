@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+namespace bench {
+
+// Shape is the kind of synthetic program, each stresses another part of the front end.
+enum Shape {
+    // DeepExpr has long statements of nested parens and operator chains.
+    DeepExpr,
+    // WideSwitch has switches of many cases.
+    WideSwitch,
+    // ManyFuncs has many small functions calling each other.
+    ManyFuncs,
+    // BigArrays has large global arrays initialized by composite literals.
+    BigArrays,
+    // Mixed has a bit of all of the above.
+    Mixed,
+    shape_end,
+};
+
+// ShapeName returns the name of shape, as taken by ParseShape.
+const char* ShapeName(Shape shape);
+
+/**
+ * @brief ParseShape finds the shape of name, e.g. "deep-expr".
+ *
+ * @return 0 for success, -1 if name is unknown.
+ */
+int ParseShape(const string& name, Shape* shape);
+
+/**
+ * @brief Generate returns a program of about size bytes which scans, parses and
+ * checks without errors. The same seed gives the same program on all platforms.
+ */
+string Generate(Shape shape, size_t size, uint32_t seed);
+
+}// namespace bench
@@ -0,0 +1,70 @@
+#include "ast/flat.h"
+#include "cache/ast_codec.h"
+#include "cache/codec.h"
+
+namespace cache {
+
+template <typename T>
+static void EncodeColumn(const vector<T>& column, Encoder* enc) {
+    enc->Raw(column.data(), column.size() * sizeof(T));
+}
+
+// DecodeColumn reads n items of column, n is checked against the data left before it is allocated.
+template <typename T>
+static void DecodeColumn(uint64_t n, vector<T>* column, Decoder* dec) {
+    if (n > dec->Remaining() / sizeof(T)) {
+        dec->Fail();
+        return;
+    }
+    column->resize(static_cast<size_t>(n));
+    dec->Raw(column->data(), column->size() * sizeof(T));
+}
+
+void EncodeFile(const ast::FileNode& file, string* out) {
+    ast::FlatFile flat;
+    ast::Flatten(file, &flat);
+
+    Encoder enc(out);
+    enc.Uint(flat.Rows());
+    enc.Uint(flat.children_.size());
+    enc.Uint(flat.chars_.size());
+    enc.Uint(flat.symbol_size_.size());
+
+    EncodeColumn(flat.tag_, &enc);
+    for (const auto* column : {&flat.offset_, &flat.line_, &flat.column_, &flat.value_, &flat.text_begin_,
+                               &flat.text_size_, &flat.child_begin_, &flat.child_count_}) {
+        EncodeColumn(*column, &enc);
+    }
+    EncodeColumn(flat.children_, &enc);
+    enc.Raw(flat.chars_.data(), flat.chars_.size());
+    EncodeColumn(flat.symbol_size_, &enc);
+}
+
+int DecodeFile(const char* data, size_t size, const string& filename, shared_ptr<ast::FileNode>* file) {
+    Decoder dec(data, size);
+    uint64_t rows = dec.Uint();
+    uint64_t children = dec.Uint();
+    uint64_t chars = dec.Uint();
+    uint64_t symbols = dec.Uint();
+
+    ast::FlatFile flat;
+    DecodeColumn(rows, &flat.tag_, &dec);
+    for (auto* column : {&flat.offset_, &flat.line_, &flat.column_, &flat.value_, &flat.text_begin_,
+                         &flat.text_size_, &flat.child_begin_, &flat.child_count_}) {
+        DecodeColumn(rows, column, &dec);
+    }
+    DecodeColumn(children, &flat.children_, &dec);
+    if (chars > dec.Remaining()) {
+        return -1;
+    }
+    flat.chars_.resize(static_cast<size_t>(chars));
+    dec.Raw(&flat.chars_[0], flat.chars_.size());
+    DecodeColumn(symbols, &flat.symbol_size_, &dec);
+    if (!dec.Ok() || dec.Remaining() != 0) {
+        return -1;
+    }
+
+    return ast::Expand(flat, filename, file);
+}
+
+}// namespace cache
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "ast/ast.h"
+
+using namespace std;
+
+namespace cache {
+
+/**
+ * @brief EncodeFile appends a binary form of file to out.
+ * It is the file flattened by ast::Flatten: sizes of the columns, then each column
+ * as it is in memory, so it is read back by a copy per column. Integers are in the
+ * byte order of the machine, which is the one that reads the cache.
+ */
+void EncodeFile(const ast::FileNode& file, string* out);
+
+/**
+ * @brief DecodeFile rebuilds the ast encoded by EncodeFile, nodes are created in the arena of file.
+ *
+ * @param filename name set to positions of the nodes.
+ * @return 0 for success, -1 if data is malformed.
+ */
+int DecodeFile(const char* data, size_t size, const string& filename, shared_ptr<ast::FileNode>* file);
+
+}// namespace cache
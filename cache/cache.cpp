@@ -0,0 +1,189 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache/ast_codec.h"
+#include "cache/cache.h"
+#include "cache/codec.h"
+#include "prof/prof.h"
+
+namespace cache {
+
+// kMagic starts every artifact, the digit is the layout version.
+const static char kMagic[] = "SLCACHE1";
+const static size_t kMagicSize = sizeof(kMagic) - 1;
+
+const static uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const static uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+
+static uint64_t Rotl(uint64_t v, int n) { return (v << n) | (v >> (64 - n)); }
+
+static uint64_t Mix(uint64_t v) {
+    v ^= v >> 33;
+    v *= 0xFF51AFD7ED558CCDULL;
+    v ^= v >> 33;
+    v *= 0xC4CEB9FE1A85EC53ULL;
+    v ^= v >> 33;
+    return v;
+}
+
+// Hasher hashes bytes a word at a time on two independent lanes.
+class Hasher {
+public:
+    void Update(const char* data, size_t size) {
+        const char* end = data + size;
+        for (; end - data >= 8; data += 8) {
+            uint64_t w;
+            memcpy(&w, data, sizeof(w));
+            Word(w);
+        }
+
+        // the tail is a word of its bytes and count.
+        uint64_t w = static_cast<uint64_t>(end - data) << 56;
+        memcpy(&w, data, static_cast<size_t>(end - data));
+        Word(w);
+    }
+
+    Key Final(uint64_t size) const {
+        Key key;
+        key.lo = Mix(a_ ^ Rotl(b_, 17) ^ size);
+        key.hi = Mix(b_ + key.lo * kPrime1);
+        key.size = size;
+        return key;
+    }
+private:
+    void Word(uint64_t w) {
+        a_ = Rotl(a_ ^ (w * kPrime2), 31) * kPrime1;
+        b_ = Rotl(b_ + w, 27) * kPrime2 + a_;
+    }
+
+    uint64_t a_ = kPrime1;
+    uint64_t b_ = kPrime2;
+};
+
+string Key::Hex() const {
+    char buf[33];
+    snprintf(buf, sizeof(buf), "%016llx%016llx", static_cast<unsigned long long>(hi), static_cast<unsigned long long>(lo));
+    return buf;
+}
+
+Key HashSource(const char* data, size_t size) {
+    prof::ScopedPhase phase(prof::Cache);
+    Hasher hasher;
+    hasher.Update(kCompilerVersion.data(), kCompilerVersion.size());
+    hasher.Update(data, size);
+    return hasher.Final(size);
+}
+
+int Artifact::File(const string& filename, shared_ptr<ast::FileNode>* file) const {
+    prof::ScopedPhase phase(prof::Cache);
+    if (!HasFile()) {
+        return -1;
+    }
+    return DecodeFile(ast_, ast_size_, filename, file);
+}
+
+shared_ptr<Cache> Cache::FromEnv() {
+    const char* dir = getenv(kCacheDirEnv.c_str());
+    if (dir == nullptr || dir[0] == '\0') {
+        return nullptr;
+    }
+    return make_shared<Cache>(dir);
+}
+
+int Cache::Load(const Key& key, const string& filename, Artifact* artifact) const {
+    prof::ScopedPhase phase(prof::Cache);
+    shared_ptr<input::SourceBuffer> buf;
+    if (input::SourceBuffer::Open(Path(key), &buf) != 0) {
+        return -1;
+    }
+
+    Decoder dec(buf->data(), static_cast<size_t>(buf->size()));
+    char magic[kMagicSize];
+    if (!dec.Raw(magic, kMagicSize) || memcmp(magic, kMagic, kMagicSize) != 0) {
+        return -1;
+    }
+    // guards against a collision of the keys.
+    if (dec.Bytes() != kCompilerVersion || dec.Uint() != key.size) {
+        return -1;
+    }
+
+    Artifact result;
+    result.ok = dec.Uint() != 0;
+    uint64_t n = dec.Uint();
+    if (n > dec.Remaining()) {
+        return -1;
+    }
+    for (uint64_t i = 0; i < n && dec.Ok(); i++) {
+        ec::Error error;
+        error.type_ = static_cast<ec::Type>(dec.Uint());
+        error.pos_.offset = static_cast<int>(dec.Int());
+        error.pos_.line = static_cast<int>(dec.Int());
+        error.pos_.column = static_cast<int>(dec.Int());
+        error.pos_.filename = error.pos_.offset == token::npos.offset ? token::npos.filename : filename;
+        error.msg_ = dec.Bytes();
+        if (error.type_ >= ec::type_end) {
+            return -1;
+        }
+        result.errors.push_back(error);
+    }
+    bool has_file = dec.Uint() != 0;
+    if (!dec.Ok()) {
+        return -1;
+    }
+
+    if (has_file) {
+        result.ast_ = dec.Cur();
+        result.ast_size_ = dec.Remaining();
+    }
+    result.buf_ = buf;
+    *artifact = move(result);
+    return 0;
+}
+
+void Cache::Store(const Key& key, bool ok, const vector<ec::Error>& errors, const ast::FileNode* file) const {
+    prof::ScopedPhase phase(prof::Cache);
+    string out(kMagic, kMagicSize);
+    Encoder enc(&out);
+    enc.Bytes(kCompilerVersion);
+    enc.Uint(key.size);
+    enc.Uint(ok);
+    enc.Uint(errors.size());
+    for (const auto& error : errors) {
+        enc.Uint(error.type_);
+        enc.Int(error.pos_.offset);
+        enc.Int(error.pos_.line);
+        enc.Int(error.pos_.column);
+        enc.Bytes(error.msg_);
+    }
+    enc.Uint(file != nullptr);
+    if (file != nullptr) {
+        EncodeFile(*file, &out);
+    }
+
+    mkdir(dir_.c_str(), 0755);
+
+    // the temporary name is unique among threads and processes.
+    static atomic<unsigned> seq(0);
+    string path = Path(key);
+    string tmp = path + ".tmp." + to_string(getpid()) + "." + to_string(seq.fetch_add(1));
+    {
+        ofstream f(tmp, ios::out | ios::binary | ios::trunc);
+        f.write(out.data(), static_cast<streamsize>(out.size()));
+        if (!f.good()) {
+            f.close();
+            unlink(tmp.c_str());
+            return;
+        }
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+    }
+}
+
+}// namespace cache
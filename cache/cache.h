@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast/ast.h"
+#include "error.h"
+#include "input/source_buffer.h"
+
+using namespace std;
+
+namespace cache {
+
+// kCompilerVersion is hashed into every key, bump it when parse or check results change.
+const string kCompilerVersion = "simple_lang 22";
+
+// kCacheDirEnv names the environment variable holding the cache directory.
+const string kCacheDirEnv = "SIMPLE_LANG_CACHE";
+
+// Key is the 128 bits content hash of a source file.
+class Key {
+public:
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+    // size of the source, checked again on load.
+    uint64_t size = 0;
+
+    // Hex returns the key as 32 hex digits, the file name of its artifact.
+    string Hex() const;
+};
+
+/**
+ * @brief HashSource returns the key of a source, computed from the source and kCompilerVersion.
+ */
+Key HashSource(const char* data, size_t size);
+
+/**
+ * @brief Artifact is the cached result of scanning, parsing and checking a source.
+ * Errors are decoded on load, the ast is decoded from the mapped artifact on demand.
+ */
+class Artifact {
+public:
+    // ok is false if the source has a parse error.
+    bool ok = true;
+    // errors found in the source, sorted by position, npos errors last.
+    vector<ec::Error> errors;
+
+    // HasFile reports whether the ast is stored.
+    bool HasFile() const { return ast_size_ != 0; }
+
+    /**
+     * @brief File decodes the stored ast.
+     *
+     * @param filename name set to positions of the nodes.
+     * @return 0 for success, -1 if no ast is stored or it is malformed.
+     */
+    int File(const string& filename, shared_ptr<ast::FileNode>* file) const;
+private:
+    friend class Cache;
+
+    shared_ptr<input::SourceBuffer> buf_;
+    const char* ast_ = nullptr;
+    size_t ast_size_ = 0;
+};
+
+/**
+ * @brief Cache is a directory of artifacts named by the keys of their sources.
+ * Artifacts are written to a temporary file and renamed, so concurrent
+ * compilers sharing a directory never see a partial one.
+ */
+class Cache {
+public:
+    explicit Cache(const string& dir) : dir_(dir) {}
+
+    /**
+     * @brief FromEnv returns the cache in the directory named by kCacheDirEnv, nullptr if it is unset.
+     */
+    static shared_ptr<Cache> FromEnv();
+
+    /**
+     * @brief Load maps the artifact of key.
+     *
+     * @param filename name set to positions of the errors.
+     * @return 0 for a hit, -1 if there is no valid artifact.
+     */
+    int Load(const Key& key, const string& filename, Artifact* artifact) const;
+
+    /**
+     * @brief Store writes the artifact of key, failures are ignored, it is only a cache.
+     *
+     * @param file ast of the source, nullptr to store only the errors.
+     */
+    void Store(const Key& key, bool ok, const vector<ec::Error>& errors, const ast::FileNode* file) const;
+private:
+    string Path(const Key& key) const { return dir_ + "/" + key.Hex(); }
+
+    string dir_;
+};
+
+}// namespace cache
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+namespace cache {
+
+// Encoder appends values to a byte string. Integers are LEB128 varints,
+// signed ones zigzag encoded first, so small values take one byte.
+class Encoder {
+public:
+    explicit Encoder(string* out) : out_(out) {}
+
+    void Uint(uint64_t v) {
+        while (v >= 0x80) {
+            out_->push_back(static_cast<char>((v & 0x7F) | 0x80));
+            v >>= 7;
+        }
+        out_->push_back(static_cast<char>(v));
+    }
+
+    void Int(int64_t v) { Uint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63)); }
+
+    void Bytes(const string& s) {
+        Uint(s.size());
+        out_->append(s);
+    }
+
+    void Raw(const void* data, size_t size) { out_->append(static_cast<const char*>(data), size); }
+private:
+    string* out_;
+};
+
+// Decoder reads values written by Encoder from a byte range. A read past the
+// end or a malformed varint fails the decoder, later reads return zeros.
+class Decoder {
+public:
+    Decoder(const char* data, size_t size) : cur_(data), end_(data + size) {}
+
+    uint64_t Uint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (cur_ == end_) {
+                break;
+            }
+            uint8_t b = static_cast<uint8_t>(*cur_++);
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) {
+                return v;
+            }
+        }
+        Fail();
+        return 0;
+    }
+
+    int64_t Int() {
+        uint64_t v = Uint();
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    string Bytes() {
+        uint64_t size = Uint();
+        if (size > Remaining()) {
+            Fail();
+            return string();
+        }
+        string s(cur_, static_cast<size_t>(size));
+        cur_ += size;
+        return s;
+    }
+
+    bool Raw(void* data, size_t size) {
+        if (size > Remaining()) {
+            Fail();
+            return false;
+        }
+        memcpy(data, cur_, size);
+        cur_ += size;
+        return true;
+    }
+
+    const char* Cur() const { return cur_; }
+    size_t Remaining() const { return static_cast<size_t>(end_ - cur_); }
+    bool Ok() const { return ok_; }
+    void Fail() {
+        ok_ = false;
+        cur_ = end_;
+    }
+private:
+    const char* cur_;
+    const char* end_;
+    bool ok_ = true;
+};
+
+}// namespace cache
@@ -0,0 +1,458 @@
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#include "check/bounds.h"
+#include "ast/util.h"
+#include "prof/prof.h"
+
+namespace check {
+
+// values are ints of the vm, ranges are computed wider, so a result which may wrap is seen.
+static const int64_t kMin = INT32_MIN;
+static const int64_t kMax = INT32_MAX;
+
+static void Any(int64_t* lo, int64_t* hi) {
+    *lo = kMin;
+    *hi = kMax;
+}
+
+// Fit sets [lo, hi] to [l, h], or to any int if a value of [l, h] wraps.
+static void Fit(int64_t l, int64_t h, int64_t* lo, int64_t* hi) {
+    if (l < kMin || h > kMax) {
+        Any(lo, hi);
+        return;
+    }
+    *lo = l;
+    *hi = h;
+}
+
+static bool IsIdent(ast::ExprNode* expr, int symbol) {
+    return expr != nullptr && expr->Type() == ast::NodeType::Ident && static_cast<ast::IdentNode*>(expr)->symbol_ == symbol;
+}
+
+// Writes reports whether stmt may assign or scan a variable named by symbol, in any scope.
+static bool Writes(ast::StmtNode* stmt, int symbol) {
+    if (stmt == nullptr) {
+        return false;
+    }
+
+    switch (stmt->Type()) {
+        case ast::NodeType::AssignStmt:
+            return IsIdent(static_cast<ast::AssignStmtNode*>(stmt)->lhs_, symbol);
+        case ast::NodeType::ScanStmt:
+            return IsIdent(static_cast<ast::ScanStmtNode*>(stmt)->var_, symbol);
+        case ast::NodeType::BlockStmt:
+            for (auto sub_stmt : static_cast<ast::BlockStmtNode*>(stmt)->stmts_) {
+                if (Writes(sub_stmt, symbol)) {
+                    return true;
+                }
+            }
+            return false;
+        case ast::NodeType::IfStmt: {
+            auto if_stmt = static_cast<ast::IfStmtNode*>(stmt);
+            return Writes(if_stmt->body_, symbol) || Writes(if_stmt->else_, symbol);
+        }
+        case ast::NodeType::SwitchStmt:
+            for (auto case_stmt : static_cast<ast::SwitchStmtNode*>(stmt)->cases_) {
+                if (Writes(case_stmt, symbol)) {
+                    return true;
+                }
+            }
+            return false;
+        case ast::NodeType::CaseStmt:
+            for (auto body_stmt : static_cast<ast::CaseStmtNode*>(stmt)->body_) {
+                if (Writes(body_stmt, symbol)) {
+                    return true;
+                }
+            }
+            return false;
+        case ast::NodeType::ForStmt: {
+            auto for_stmt = static_cast<ast::ForStmtNode*>(stmt);
+            return Writes(for_stmt->init_, symbol) || Writes(for_stmt->step_, symbol) || Writes(for_stmt->body_, symbol);
+        }
+        case ast::NodeType::WhileStmt:
+            return Writes(static_cast<ast::WhileStmtNode*>(stmt)->body_, symbol);
+        default:
+            // decls, exprs and calls don't write a local of the caller.
+            return false;
+    }
+}
+
+Bounds::Bounds(const shared_ptr<ast::FileNode>& ast_file) :
+    ast_file_(ast_file), warnings_(nullptr), in_func_(false) {}
+
+void Bounds::Analyze(vector<ec::Error>* warnings) {
+    prof::ScopedPhase phase(prof::Check);
+    warnings_ = warnings;
+    in_bounds_.clear();
+
+    for (auto decl : ast_file_->decl_) {
+        if (decl->Type() == ast::NodeType::FuncDecl) {
+            AnalyzeFuncDecl(static_cast<ast::FuncDeclNode*>(decl));
+        } else {
+            AnalyzeVarDecl(decl);
+        }
+    }
+    warnings_ = nullptr;
+}
+
+void Bounds::AnalyzeVarDecl(ast::DeclNode* decl) {
+    if (decl->Type() == ast::NodeType::SingleVarDecl) {
+        AnalyzeSingleVarDecl(static_cast<ast::SingleVarDeclNode*>(decl));
+        return;
+    }
+
+    if (decl->Type() == ast::NodeType::VarDecl) {
+        for (auto single_decl : static_cast<ast::VarDeclNode*>(decl)->decls_) {
+            AnalyzeVarDecl(single_decl);
+        }
+    }
+}
+
+void Bounds::AnalyzeSingleVarDecl(ast::SingleVarDeclNode* decl) {
+    Var var{};
+    var.global = !in_func_;
+    ast::TypeNode* item = decl->type_;
+    while (item != nullptr && item->Type() == ast::NodeType::ArrayType) {
+        auto array_type = static_cast<ast::ArrayTypeNode*>(item);
+        var.dims.push_back(array_type->size_);
+        item = array_type->item_;
+    }
+    var.is_char = item != nullptr && item->Type() == ast::NodeType::CharType;
+
+    // a const keeps the range of its value, other vars may be set to any int.
+    int64_t lo, hi;
+    Any(&lo, &hi);
+    if (decl->val_ != nullptr) {
+        AnalyzeExpr(decl->val_, &lo, &hi);
+    }
+    if (decl->is_const_ && decl->val_ != nullptr && var.dims.empty()) {
+        var.lo = lo;
+        var.hi = hi;
+    } else {
+        Any(&var.lo, &var.hi);
+    }
+    AddVar(decl->name_, decl->type_, decl->is_const_, var);
+}
+
+void Bounds::AnalyzeFuncDecl(ast::FuncDeclNode* decl) {
+    in_func_ = true;
+    var_table_.CreateCodeBlock();
+    if (decl->params_ != nullptr) {
+        for (auto field : decl->params_->fields_) {
+            Var var{};
+            var.global = false;
+            var.is_char = field->type_ != nullptr && field->type_->Type() == ast::NodeType::CharType;
+            Any(&var.lo, &var.hi);
+            AddVar(field->name_, field->type_, false, var);
+        }
+    }
+
+    if (decl->body_ != nullptr) {
+        VisitStmt(decl->body_);
+    }
+    var_table_.DestroyCodeBlock();
+    in_func_ = false;
+}
+
+void Bounds::VisitDeclStmt(ast::DeclStmtNode* stmt) {
+    AnalyzeVarDecl(stmt->decl_);
+}
+
+void Bounds::VisitExprStmt(ast::ExprStmtNode* stmt) {
+    AnalyzeExpr(stmt->expr_);
+}
+
+void Bounds::VisitAssignStmt(ast::AssignStmtNode* stmt) {
+    AnalyzeExpr(stmt->lhs_);
+    AnalyzeExpr(stmt->rhs_);
+}
+
+void Bounds::VisitReturnStmt(ast::ReturnStmtNode* stmt) {
+    if (stmt->results_ != nullptr) {
+        AnalyzeExpr(stmt->results_);
+    }
+}
+
+void Bounds::VisitBlockStmt(ast::BlockStmtNode* stmt) {
+    var_table_.CreateCodeBlock();
+    for (auto sub_stmt : stmt->stmts_) {
+        VisitStmt(sub_stmt);
+    }
+    var_table_.DestroyCodeBlock();
+}
+
+void Bounds::VisitIfStmt(ast::IfStmtNode* stmt) {
+    AnalyzeExpr(stmt->cond_);
+    VisitStmt(stmt->body_);
+    if (stmt->else_ != nullptr) {
+        VisitStmt(stmt->else_);
+    }
+}
+
+void Bounds::VisitCaseStmt(ast::CaseStmtNode* stmt) {
+    if (stmt->cond_ != nullptr) {
+        AnalyzeExpr(stmt->cond_);
+    }
+    for (auto body_stmt : stmt->body_) {
+        VisitStmt(body_stmt);
+    }
+}
+
+void Bounds::VisitSwitchStmt(ast::SwitchStmtNode* stmt) {
+    AnalyzeExpr(stmt->cond_);
+    for (auto case_stmt : stmt->cases_) {
+        VisitStmt(case_stmt);
+    }
+}
+
+void Bounds::VisitForStmt(ast::ForStmtNode* stmt) {
+    // init, cond and step are in the ranges around the loop.
+    for (auto sub_stmt : {stmt->init_, stmt->cond_, stmt->step_}) {
+        if (sub_stmt != nullptr) {
+            VisitStmt(sub_stmt);
+        }
+    }
+    if (stmt->body_ == nullptr) {
+        return;
+    }
+
+    int id = -1;
+    int64_t lo, hi;
+    if (!InductionRange(stmt, &id, &lo, &hi)) {
+        VisitStmt(stmt->body_);
+        return;
+    }
+
+    int64_t outer_lo = vars_[id].lo, outer_hi = vars_[id].hi;
+    vars_[id].lo = lo;
+    vars_[id].hi = hi;
+    VisitStmt(stmt->body_);
+    vars_[id].lo = outer_lo;
+    vars_[id].hi = outer_hi;
+}
+
+bool Bounds::InductionRange(ast::ForStmtNode* stmt, int* id, int64_t* lo, int64_t* hi) {
+    if (stmt->init_ == nullptr || stmt->init_->Type() != ast::NodeType::AssignStmt
+        || stmt->step_ == nullptr || stmt->step_->Type() != ast::NodeType::AssignStmt
+        || stmt->cond_ == nullptr || stmt->cond_->Type() != ast::NodeType::ExprStmt) {
+        return false;
+    }
+    auto init = static_cast<ast::AssignStmtNode*>(stmt->init_);
+    auto step = static_cast<ast::AssignStmtNode*>(stmt->step_);
+    ast::ExprNode* cond = static_cast<ast::ExprStmtNode*>(stmt->cond_)->expr_;
+    if (init->lhs_->Type() != ast::NodeType::Ident) {
+        return false;
+    }
+
+    // only a local int is sure to be left alone by calls in the body.
+    auto ident = static_cast<ast::IdentNode*>(init->lhs_);
+    int symbol = ident->symbol_;
+    *id = LookupVar(ident);
+    if (*id < 0 || vars_[*id].global || vars_[*id].is_char || !vars_[*id].dims.empty()) {
+        return false;
+    }
+    if (!IsIdent(step->lhs_, symbol) || Writes(stmt->body_, symbol)) {
+        return false;
+    }
+    if (step->rhs_->Type() != ast::NodeType::BinaryExpr || cond->Type() != ast::NodeType::BinaryExpr) {
+        return false;
+    }
+    auto next = static_cast<ast::BinaryExprNode*>(step->rhs_);
+    auto test = static_cast<ast::BinaryExprNode*>(cond);
+    if (!IsIdent(test->x_, symbol)) {
+        return false;
+    }
+
+    // init and bound were analyzed by the visit already, in the same ranges, so no
+    // warning is given twice.
+    vector<ec::Error>* warnings = warnings_;
+    warnings_ = nullptr;
+    int64_t init_lo, init_hi, bound_lo, bound_hi, delta_lo, delta_hi;
+    AnalyzeExpr(init->rhs_, &init_lo, &init_hi);
+    AnalyzeExpr(test->y_, &bound_lo, &bound_hi);
+    int64_t delta = 0;
+    if (next->op_tok_ == token::Token::PLUS && IsIdent(next->x_, symbol)) {
+        AnalyzeExpr(next->y_, &delta_lo, &delta_hi);
+        delta = delta_lo == delta_hi ? delta_lo : 0;
+    } else if (next->op_tok_ == token::Token::PLUS && IsIdent(next->y_, symbol)) {
+        AnalyzeExpr(next->x_, &delta_lo, &delta_hi);
+        delta = delta_lo == delta_hi ? delta_lo : 0;
+    } else if (next->op_tok_ == token::Token::MINU && IsIdent(next->x_, symbol)) {
+        AnalyzeExpr(next->y_, &delta_lo, &delta_hi);
+        delta = delta_lo == delta_hi ? -delta_lo : 0;
+    }
+    warnings_ = warnings;
+
+    // the var moves one way from init, and stops before the step past the bound could wrap.
+    if (delta > 0 && (test->op_tok_ == token::Token::LSS || test->op_tok_ == token::Token::LEQ)) {
+        *lo = init_lo;
+        *hi = test->op_tok_ == token::Token::LSS ? bound_hi - 1 : bound_hi;
+        return *hi + delta <= kMax;
+    }
+    if (delta < 0 && (test->op_tok_ == token::Token::GRE || test->op_tok_ == token::Token::GEQ)) {
+        *lo = test->op_tok_ == token::Token::GRE ? bound_lo + 1 : bound_lo;
+        *hi = init_hi;
+        return *lo + delta >= kMin;
+    }
+    return false;
+}
+
+void Bounds::VisitWhileStmt(ast::WhileStmtNode* stmt) {
+    AnalyzeExpr(stmt->cond_);
+    VisitStmt(stmt->body_);
+}
+
+void Bounds::VisitPrintfStmt(ast::PrintfStmtNode* stmt) {
+    for (auto arg : stmt->args_) {
+        AnalyzeExpr(arg);
+    }
+}
+
+void Bounds::VisitIdent(ast::IdentNode* expr, int64_t* lo, int64_t* hi) {
+    int id = LookupVar(expr);
+    if (id < 0 || !vars_[id].dims.empty()) {
+        Any(lo, hi);
+        return;
+    }
+    *lo = vars_[id].lo;
+    *hi = vars_[id].hi;
+}
+
+void Bounds::VisitBasicLit(ast::BasicLitNode* expr, int64_t* lo, int64_t* hi) {
+    if (expr->tok_ == token::Token::INTCON) {
+        *lo = *hi = static_cast<int32_t>(strtoll(expr->val_.c_str(), nullptr, 10));
+    } else if (expr->tok_ == token::Token::CHARCON) {
+        *lo = *hi = ast::CharLitValue(expr->val_);
+    } else {
+        Any(lo, hi);
+    }
+}
+
+void Bounds::VisitCompositeLit(ast::CompositeLitNode* expr, int64_t* lo, int64_t* hi) {
+    for (auto item : expr->items_) {
+        AnalyzeExpr(item);
+    }
+    Any(lo, hi);
+}
+
+void Bounds::VisitParenExpr(ast::ParenExprNode* expr, int64_t* lo, int64_t* hi) {
+    AnalyzeExpr(expr->expr_, lo, hi);
+}
+
+void Bounds::VisitIndexExpr(ast::IndexExprNode* expr, int64_t* lo, int64_t* hi) {
+    vector<ast::ExprNode*> indexes;
+    ast::ExprNode* x = expr;
+    while (x->Type() == ast::NodeType::IndexExpr) {
+        indexes.push_back(static_cast<ast::IndexExprNode*>(x)->index_);
+        x = static_cast<ast::IndexExprNode*>(x)->x_;
+    }
+    reverse(indexes.begin(), indexes.end());
+
+    int id = x->Type() == ast::NodeType::Ident ? LookupVar(static_cast<ast::IdentNode*>(x)) : -1;
+    bool shaped = id >= 0 && vars_[id].dims.size() == indexes.size();
+    for (size_t i = 0; i < indexes.size(); i++) {
+        int64_t index_lo, index_hi;
+        AnalyzeExpr(indexes[i], &index_lo, &index_hi);
+        if (!shaped) {
+            continue;
+        }
+
+        int dim = vars_[id].dims[i];
+        if (index_lo >= 0 && index_hi < dim) {
+            in_bounds_.insert(indexes[i]);
+        } else if (index_lo == index_hi && warnings_ != nullptr) {
+            warnings_->emplace_back(
+                indexes[i]->Pos(),
+                ec::Type::IndexOutOfBounds,
+                "for index expression, index " + to_string(index_lo) + " out of range [0, " + to_string(dim) + ")"
+            );
+        }
+    }
+    Any(lo, hi);
+}
+
+void Bounds::VisitCallExpr(ast::CallExprNode* expr, int64_t* lo, int64_t* hi) {
+    for (auto arg : expr->args_) {
+        AnalyzeExpr(arg);
+    }
+    Any(lo, hi);
+}
+
+void Bounds::VisitUnaryExpr(ast::UnaryExprNode* expr, int64_t* lo, int64_t* hi) {
+    int64_t x_lo, x_hi;
+    AnalyzeExpr(expr->x_, &x_lo, &x_hi);
+    if (expr->op_tok_ == token::Token::MINU) {
+        Fit(-x_hi, -x_lo, lo, hi);
+    } else {
+        *lo = x_lo;
+        *hi = x_hi;
+    }
+}
+
+void Bounds::VisitBinaryExpr(ast::BinaryExprNode* expr, int64_t* lo, int64_t* hi) {
+    int64_t x_lo, x_hi, y_lo, y_hi;
+    AnalyzeExpr(expr->x_, &x_lo, &x_hi);
+    AnalyzeExpr(expr->y_, &y_lo, &y_hi);
+
+    switch (expr->op_tok_) {
+        case token::Token::PLUS:
+            Fit(x_lo + y_lo, x_hi + y_hi, lo, hi);
+            return;
+        case token::Token::MINU:
+            Fit(x_lo - y_hi, x_hi - y_lo, lo, hi);
+            return;
+        case token::Token::MULT: {
+            int64_t products[] = {x_lo * y_lo, x_lo * y_hi, x_hi * y_lo, x_hi * y_hi};
+            Fit(*min_element(products, products + 4), *max_element(products, products + 4), lo, hi);
+            return;
+        }
+        case token::Token::DIV:
+            // a quotient moves with the dividend for a constant divisor.
+            if (y_lo == y_hi && y_lo > 0) {
+                Fit(x_lo / y_lo, x_hi / y_lo, lo, hi);
+            } else if (y_lo == y_hi && y_lo < 0) {
+                Fit(x_hi / y_lo, x_lo / y_lo, lo, hi);
+            } else {
+                Any(lo, hi);
+            }
+            return;
+        case token::Token::LSS:
+        case token::Token::LEQ:
+        case token::Token::GRE:
+        case token::Token::GEQ:
+        case token::Token::EQL:
+        case token::Token::NEQ:
+            *lo = 0;
+            *hi = 1;
+            return;
+        default:
+            Any(lo, hi);
+    }
+}
+
+void Bounds::VisitOtherExpr(ast::ExprNode*, int64_t* lo, int64_t* hi) {
+    Any(lo, hi);
+}
+
+void Bounds::AddVar(ast::IdentNode* name, ast::TypeNode* type, bool is_const, const Var& var) {
+    var_table_.AddVar(name->symbol_, type, is_const);
+
+    const VarTable::Identifier* ident = nullptr;
+    var_table_.GetVar(name->symbol_, &ident);
+    if (ident->unique_id >= static_cast<int>(vars_.size())) {
+        vars_.resize(ident->unique_id + 1);
+    }
+    vars_[ident->unique_id] = var;
+}
+
+int Bounds::LookupVar(ast::IdentNode* ident) const {
+    const VarTable::Identifier* var = nullptr;
+    if (var_table_.GetVar(ident->symbol_, &var) != 0 || var->unique_id >= static_cast<int>(vars_.size())) {
+        return -1;
+    }
+    return var->unique_id;
+}
+
+}// namespace check
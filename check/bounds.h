@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "ast/ast.h"
+#include "ast/visitor.h"
+#include "error.h"
+#include "parser/var_table.h"
+
+using namespace std;
+
+namespace check {
+
+// Bounds proves indexes of arrays in range before the file is lowered, so the
+// backends may drop the runtime check of those. An index is bounded by the ranges
+// of the values it is made of: literals, consts, and induction variables of for
+// stmts such as 'for (i = 0; i < n; i = i + 1)', whose range holds in the body
+// if nothing else there writes them. Other values may be any int.
+class Bounds : private ast::StmtVisitor<Bounds>, private ast::ExprVisitor<Bounds, void, int64_t*, int64_t*> {
+    friend class ast::StmtVisitor<Bounds>;
+    friend class ast::ExprVisitor<Bounds, void, int64_t*, int64_t*>;
+public:
+    explicit Bounds(const shared_ptr<ast::FileNode>& ast_file);
+
+    /**
+     * @brief Analyze walks the file, which should have passed the checker.
+     *
+     * @param warnings constant indexes out of range of their dimension are appended, may be nullptr.
+     */
+    void Analyze(vector<ec::Error>* warnings);
+
+    // InBounds reports whether index, an index_ of an IndexExprNode, is in range of its dimension.
+    bool InBounds(const ast::ExprNode* index) const { return in_bounds_.count(index) != 0; }
+private:
+    // Var is what is known of a variable.
+    struct Var {
+        bool global;
+        bool is_char;
+        // dims of an array, row major, empty for scalars.
+        vector<int> dims;
+        // value is in [lo, hi] wherever the var is visible.
+        int64_t lo;
+        int64_t hi;
+    };
+
+    void AnalyzeVarDecl(ast::DeclNode* decl);
+    void AnalyzeSingleVarDecl(ast::SingleVarDeclNode* decl);
+    void AnalyzeFuncDecl(ast::FuncDeclNode* decl);
+
+    void VisitDeclStmt(ast::DeclStmtNode* stmt);
+    void VisitExprStmt(ast::ExprStmtNode* stmt);
+    void VisitAssignStmt(ast::AssignStmtNode* stmt);
+    void VisitReturnStmt(ast::ReturnStmtNode* stmt);
+    void VisitBlockStmt(ast::BlockStmtNode* stmt);
+    void VisitIfStmt(ast::IfStmtNode* stmt);
+    void VisitCaseStmt(ast::CaseStmtNode* stmt);
+    void VisitSwitchStmt(ast::SwitchStmtNode* stmt);
+    void VisitForStmt(ast::ForStmtNode* stmt);
+    void VisitWhileStmt(ast::WhileStmtNode* stmt);
+    void VisitPrintfStmt(ast::PrintfStmtNode* stmt);
+
+    // Expr handlers set [lo, hi] to the range of the value.
+    void VisitIdent(ast::IdentNode* expr, int64_t* lo, int64_t* hi);
+    void VisitBasicLit(ast::BasicLitNode* expr, int64_t* lo, int64_t* hi);
+    void VisitCompositeLit(ast::CompositeLitNode* expr, int64_t* lo, int64_t* hi);
+    void VisitParenExpr(ast::ParenExprNode* expr, int64_t* lo, int64_t* hi);
+    void VisitIndexExpr(ast::IndexExprNode* expr, int64_t* lo, int64_t* hi);
+    void VisitCallExpr(ast::CallExprNode* expr, int64_t* lo, int64_t* hi);
+    void VisitUnaryExpr(ast::UnaryExprNode* expr, int64_t* lo, int64_t* hi);
+    void VisitBinaryExpr(ast::BinaryExprNode* expr, int64_t* lo, int64_t* hi);
+    void VisitOtherExpr(ast::ExprNode* expr, int64_t* lo, int64_t* hi);
+
+    void AnalyzeExpr(ast::ExprNode* expr, int64_t* lo, int64_t* hi) { VisitExpr(expr, lo, hi); }
+    void AnalyzeExpr(ast::ExprNode* expr) {
+        int64_t lo, hi;
+        VisitExpr(expr, &lo, &hi);
+    }
+
+    /**
+     * @brief InductionRange finds the range of the induction variable of stmt in its body.
+     *
+     * @param id var id of the variable, a local int.
+     * @return true if stmt counts it up or down by a constant to a bound and its body doesn't write it.
+     */
+    bool InductionRange(ast::ForStmtNode* stmt, int* id, int64_t* lo, int64_t* hi);
+
+    // AddVar adds a var to current code block.
+    void AddVar(ast::IdentNode* name, ast::TypeNode* type, bool is_const, const Var& var);
+
+    // LookupVar returns var id of the innermost variable named by ident, an index of vars_, -1 if none.
+    int LookupVar(ast::IdentNode* ident) const;
+private:
+    shared_ptr<ast::FileNode> ast_file_;
+    vector<ec::Error>* warnings_;
+    bool in_func_;
+
+    VarTable var_table_;
+    // vars_[unique id in var table] is the var.
+    vector<Var> vars_;
+    unordered_set<const ast::ExprNode*> in_bounds_;
+};
+
+}// namespace check
@@ -1,37 +1,121 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
 #include <queue>
+#include <thread>
 
 #include "check/check.h"
 #include "token/position.h"
+#include "prof/prof.h"
 
 using namespace std;
 
 namespace check {
 Checker::Checker(const shared_ptr<ast::FileNode>& file_node, const shared_ptr<ec::ErrorReminder>& error_reminder)
-    : ast_(file_node), errors_(error_reminder) {
+    : ast_(file_node), errors_(error_reminder), jobs_(1) {
     var_table_ = make_shared<VarTable>();
 }
 
-shared_ptr<ast::TypeNode> CreateBasicTypeNodeByNodeType(const ast::NodeType& typ) {
-    if (typ == ast::IntType) {
-        return make_shared<ast::IntTypeNode>();
-    } else if (typ == ast::CharType) {
-        return make_shared<ast::CharTypeNode>();
-    } else if (typ == ast::StringType) {
-        return make_shared<ast::StringTypeNode>();
+void Checker::Check() {
+    prof::ScopedPhase phase(prof::Check);
+    if (jobs_ > 1) {
+        CheckConcurrently();
+        return;
+    }
+    for (const auto& decl: ast_->decl_) {
+        if (CheckDecl(decl, nullptr) != 0) {
+            return;
+        }
     }
-
-    return make_shared<ast::BadTypeNode>();
 }
 
-void Checker::Check() {
+// FuncTask is a function body to check, in the global scope as it was after the function was declared.
+class FuncTask {
+public:
+    ast::FuncDeclNode* decl;
+    VarTable::Mark mark;
+    shared_ptr<ec::ErrorReminder> errors;
+};
+
+void Checker::CheckConcurrently() {
+    // errors are kept in runs of decls ending with a function, the errors of its body
+    // are the last of a run. Runs are added in order at last, as checking decls one by
+    // one adds them.
+    auto errors = errors_;
+    vector<shared_ptr<ec::ErrorReminder>> runs;
+    vector<FuncTask> tasks;
     for (const auto& decl: ast_->decl_) {
-        if (decl->Type() == ast::VarDecl) {
-            CheckVarDeclNode(dynamic_pointer_cast<ast::VarDeclNode>(decl));
-        } else if (decl->Type() == ast::FuncDecl) {
-            CheckFuncDeclNode(dynamic_pointer_cast<ast::FuncDeclNode>(decl));
+        if (errors_ == errors) {
+            runs.push_back(make_shared<ec::ErrorReminder>(false, cerr));
+            errors_ = runs.back();
+        }
+        if (decl->Type() == ast::FuncDecl) {
+            auto func = static_cast<ast::FuncDeclNode*>(decl);
+            if (DeclareFunc(func) == 0) {
+                tasks.push_back(FuncTask{func, var_table_->GlobalMark(), errors_});
+            }
+            errors_ = errors;
+        } else if (CheckDecl(decl, nullptr) != 0) {
+            break;
+        }
+    }
+    errors_ = errors;
+
+    // the global scope is frozen now, each thread checks bodies in its own view of it.
+    atomic<size_t> next(0);
+    auto worker = [&]() {
+        prof::ScopedPhase phase(prof::Check);
+        Checker checker(ast_, nullptr);
+        checker.var_table_ = make_shared<VarTable>(var_table_.get());
+        for (size_t i = next.fetch_add(1); i < tasks.size(); i = next.fetch_add(1)) {
+            checker.errors_ = tasks[i].errors;
+            checker.var_table_->SetGlobalMark(tasks[i].mark);
+            checker.CheckFuncBody(tasks[i].decl);
+        }
+    };
+
+    int jobs = min(jobs_, max(1, static_cast<int>(tasks.size())));
+    vector<thread> pool;
+    for (int i = 1; i < jobs; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : pool) {
+        t.join();
+    }
+
+    vector<ec::Error> list;
+    for (const auto& reminder : runs) {
+        list.clear();
+        reminder->Collect(&list);
+        for (const auto& error : list) {
+            errors_->Add(error.pos_, error);
+        }
+    }
+}
+
+int Checker::CheckDecl(ast::DeclNode* decl, VarTable::Journal* journal) {
+    var_table_->SetJournal(journal);
+    int ret = 0;
+    if (decl->Type() == ast::VarDecl) {
+        CheckVarDeclNode(static_cast<ast::VarDeclNode*>(decl));
+    } else if (decl->Type() == ast::FuncDecl) {
+        CheckFuncDeclNode(static_cast<ast::FuncDeclNode*>(decl));
+    } else {
+        errors_->Emplace(decl->Pos(), ec::NotInHomeWork, "for root decl, expect var or func decl");
+        ret = -1;
+    }
+    var_table_->SetJournal(nullptr);
+
+    return ret;
+}
+
+void Checker::Declare(const vector<VarTable::Global>& globals) {
+    for (const auto& global : globals) {
+        if (global.func != nullptr) {
+            var_table_->AddFunc(global.symbol, global.func);
         } else {
-            errors_->Emplace(decl->Pos(), ec::NotInHomeWork, "for root decl, expect var or func decl");
-            return;
+            var_table_->AddVar(global.symbol, global.type, global.is_const);
         }
     }
 }
@@ -42,7 +126,7 @@ void Checker::Check() {
  * 
  * @param decl var decl node. 
  */
-void Checker::CheckVarDeclNode(const shared_ptr<ast::VarDeclNode>& decl) {
+void Checker::CheckVarDeclNode(ast::VarDeclNode* decl) {
     if (decl == nullptr || decl->Type() != ast::VarDecl) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckVarDeclNode: decl is nullptr or not var decl node.");
         return;
@@ -50,7 +134,7 @@ void Checker::CheckVarDeclNode(const shared_ptr<ast::VarDeclNode>& decl) {
 
     for (auto& single_decl: decl->decls_) {
         if (single_decl->Type() == ast::SingleVarDecl) {
-            CheckSingleVarDeclNode(dynamic_pointer_cast<ast::SingleVarDeclNode>(single_decl));
+            CheckSingleVarDeclNode(static_cast<ast::SingleVarDeclNode*>(single_decl));
         } else {
             errors_->Emplace(single_decl->Pos(), ec::NotInHomeWork, "for var decl, expect single var decl");
         }
@@ -62,7 +146,7 @@ void Checker::CheckVarDeclNode(const shared_ptr<ast::VarDeclNode>& decl) {
  *
  * @param decl single var decl node.
  */
-void Checker::CheckSingleVarDeclNode(const shared_ptr<ast::SingleVarDeclNode> &decl) {
+void Checker::CheckSingleVarDeclNode(ast::SingleVarDeclNode* decl) {
     if (decl == nullptr || decl->Type() != ast::SingleVarDecl) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckSingleVarDeclNode: decl is nullptr or not single var decl node.");
         return;
@@ -88,46 +172,60 @@ void Checker::CheckSingleVarDeclNode(const shared_ptr<ast::SingleVarDeclNode> &d
  *
  * @param decl func decl node.
  */
-void Checker::CheckFuncDeclNode(const shared_ptr<ast::FuncDeclNode>& decl) {
+void Checker::CheckFuncDeclNode(ast::FuncDeclNode* decl) {
+    if (DeclareFunc(decl) == 0) {
+        CheckFuncBody(decl);
+    }
+}
+
+int Checker::DeclareFunc(ast::FuncDeclNode* decl) {
     if (decl == nullptr || decl->Type() != ast::FuncDecl) {
         errors_->Emplace(decl->Pos(), ec::Type::NotInHomeWork, "for funcdecl node, node type error");
-        return;
+        return -1;
     }
 
-    if (decl->name_ == nullptr || var_table_->IsVarExistedInCurrentCodeBlock(decl->name_->name_)) {
+    if (decl->name_ == nullptr || var_table_->IsVarExistedInCurrentCodeBlock(decl->name_->symbol_)) {
         errors_->Emplace(decl->Pos(), ec::Type::Redefine, "for funcdecl, func name already defined");
-        return;
+        return -1;
     }
 
-    var_table_->AddFunc(decl->name_->name_, decl);
+    var_table_->AddFunc(decl->name_->symbol_, decl);
+    return 0;
+}
+
+void Checker::CheckFuncBody(ast::FuncDeclNode* decl) {
     var_table_->CreateCodeBlock();
 
     // check func params.
     if (decl->params_ == nullptr || decl->params_->Type() != ast::FieldList) {
         errors_->Emplace(decl->Pos(), ec::Type::NotInHomeWork, "for funcdecl params, expect field_list");
+        var_table_->DestroyCodeBlock();
         return;
     }
 
     for (auto& field: decl->params_->fields_) {
         if (field == nullptr || field->Type() != ast::Field) {
             errors_->Emplace(field->Pos(), ec::Type::NotInHomeWork, "for funcdecl field_list, expect field");
+            var_table_->DestroyCodeBlock();
             return;
         }
         
-        auto field_decl = dynamic_pointer_cast<ast::FieldNode>(field);
-        if (field_decl->name_ == nullptr || var_table_->IsVarExistedInCurrentCodeBlock(field_decl->name_->name_)) {
+        auto field_decl = field;
+        if (field_decl->name_ == nullptr || var_table_->IsVarExistedInCurrentCodeBlock(field_decl->name_->symbol_)) {
             errors_->Emplace(field_decl->Pos(), ec::Type::Redefine, "for funcdecl field, var name already defined");
+            var_table_->DestroyCodeBlock();
             return;
         }
-        var_table_->AddVar(field_decl->name_->name_, CreateBasicTypeNodeByNodeType(field_decl->type_->Type()));
+        var_table_->AddVar(field_decl->name_->symbol_, types_.Intern(field_decl->type_));
     }
 
     // check body.
     if (decl->body_ == nullptr || decl->body_->Type() != ast::BlockStmt) {
         errors_->Emplace(decl->Pos(), ec::Type::NotInHomeWork, "for funcdecl body, expect block_stmt");
+        var_table_->DestroyCodeBlock();
         return;
     }
-    auto block_stmt_body = dynamic_pointer_cast<ast::BlockStmtNode>(decl->body_);
+    auto block_stmt_body = static_cast<ast::BlockStmtNode*>(decl->body_);
     
     // return type check.
     bool have_return = false;
@@ -136,14 +234,15 @@ void Checker::CheckFuncDeclNode(const shared_ptr<ast::FuncDeclNode>& decl) {
             continue;
         }
 
-        shared_ptr<ast::TypeNode> return_type;
-        CheckExprAndGetType(dynamic_pointer_cast<ast::ReturnStmtNode>(stmt_node)->results_, &return_type);
+        ast::TypeNode* return_type = nullptr;
+        CheckExprAndGetType(static_cast<ast::ReturnStmtNode*>(stmt_node)->results_, &return_type);
 
-        if (return_type->Type() != decl->type_->Type()) {
+        if (return_type != types_.Intern(decl->type_)) {
             errors_->Emplace(
                 stmt_node->Pos(), 
                 (decl->type_->Type() == ast::VoidType) ? ec::Type::ReturnValueNotAllowed : ec::Type::ReturnValueRequired,
                 "for funcdecl return type, expect return type");
+            var_table_->DestroyCodeBlock();
             return;
         }
 
@@ -156,32 +255,33 @@ void Checker::CheckFuncDeclNode(const shared_ptr<ast::FuncDeclNode>& decl) {
             (decl->type_->Type() == ast::VoidType) ? ec::Type::ReturnValueNotAllowed : ec::Type::ReturnValueRequired,
             "for funcdecl return type, expect void or return stmt"
         );
+        var_table_->DestroyCodeBlock();
         return;
     }
 
     // check body.
-    CheckBlockStmt(dynamic_pointer_cast<ast::BlockStmtNode>(decl->body_));
+    CheckBlockStmt(static_cast<ast::BlockStmtNode*>(decl->body_));
 
     var_table_->DestroyCodeBlock();
 }
 
-void Checker::CheckArrayVarDeclNode(const shared_ptr<ast::SingleVarDeclNode> &decl) {
+void Checker::CheckArrayVarDeclNode(ast::SingleVarDeclNode* decl) {
     auto get_demissions_and_basic_token = [&](
-        const shared_ptr<ast::TypeNode>& arr,
+        ast::TypeNode* arr,
         vector<int>* demissions,
-        shared_ptr<ast::TypeNode>* typ
+        ast::TypeNode** typ
     ) {
-        shared_ptr<ast::TypeNode> cur_demission = arr;
+        ast::TypeNode* cur_demission = arr;
         while(true) {
             if (cur_demission->Type() == ast::ArrayType) {
-                auto cur_demission_arr = dynamic_pointer_cast<ast::ArrayTypeNode>(cur_demission);
+                auto cur_demission_arr = static_cast<ast::ArrayTypeNode*>(cur_demission);
                 demissions->push_back(cur_demission_arr->size_);
                 cur_demission = cur_demission_arr->item_;
             } else if (cur_demission->Type() == ast::BadType) {
                 errors_->Emplace(decl->Pos(), ec::NotInHomeWork, "for array var decl, expect array type");
                 return;
             } else {
-                *typ = CreateBasicTypeNodeByNodeType(cur_demission->Type());
+                *typ = types_.Basic(cur_demission->Type());
                 break;
             }
         }
@@ -198,12 +298,12 @@ void Checker::CheckArrayVarDeclNode(const shared_ptr<ast::SingleVarDeclNode> &de
     }
 
     // check var name is not duplicate in current code block.
-    auto decl_name = dynamic_pointer_cast<ast::IdentNode>(decl->name_);
-    if (var_table_->IsVarExistedInCurrentCodeBlock(decl_name->name_)) {
+    auto decl_name = decl->name_;
+    if (var_table_->IsVarExistedInCurrentCodeBlock(decl_name->symbol_)) {
         errors_->Emplace(decl->name_->Pos(), ec::Redefine, "in single var decl, var name is duplicate");
         return;
     }
-    var_table_->AddVar(decl_name->name_, decl->type_);
+    var_table_->AddVar(decl_name->symbol_, decl->type_);
 
     if (decl->val_ == nullptr) {
         return;
@@ -215,8 +315,8 @@ void Checker::CheckArrayVarDeclNode(const shared_ptr<ast::SingleVarDeclNode> &de
     }
 
     // check decl val.
-    shared_ptr<ast::TypeNode> composite_lit_type;
-    CheckCompositeLitNodeAndGetType(dynamic_pointer_cast<ast::CompositeLitNode>(decl->val_), &composite_lit_type);
+    ast::TypeNode* composite_lit_type = nullptr;
+    CheckCompositeLitNodeAndGetType(static_cast<ast::CompositeLitNode*>(decl->val_), &composite_lit_type);
 
     // check if composite lit is equal to array type.
     if (composite_lit_type->Type() != ast::ArrayType) {
@@ -224,8 +324,13 @@ void Checker::CheckArrayVarDeclNode(const shared_ptr<ast::SingleVarDeclNode> &de
         return;
     }
 
+    // items of a literal are always basic lits, so the same node means the same shape and a valid decl type.
+    if (composite_lit_type == types_.Intern(decl->type_)) {
+        return;
+    }
+
     vector<int> decl_demissions, composite_lit_demissions;
-    shared_ptr<ast::TypeNode> decl_basic_token, composite_lit_basic_token;
+    ast::TypeNode *decl_basic_token = nullptr, *composite_lit_basic_token = nullptr;
 
     get_demissions_and_basic_token(decl->type_, &decl_demissions, &decl_basic_token);
     get_demissions_and_basic_token(composite_lit_type, &composite_lit_demissions, &composite_lit_basic_token);
@@ -245,7 +350,7 @@ void Checker::CheckArrayVarDeclNode(const shared_ptr<ast::SingleVarDeclNode> &de
     }
 }
 
-void Checker::CheckBasicVarDeclNode(const shared_ptr<ast::SingleVarDeclNode> &decl) {
+void Checker::CheckBasicVarDeclNode(ast::SingleVarDeclNode* decl) {
     // check decl type.
     if (decl->type_->Type() != ast::IntType && decl->type_->Type() != ast::CharType) {
         errors_->Emplace(decl->type_->Pos(), ec::NotInHomeWork, "for basic var decl type, expect int or char type");
@@ -259,22 +364,22 @@ void Checker::CheckBasicVarDeclNode(const shared_ptr<ast::SingleVarDeclNode> &de
     }
 
     // check var name is not duplicate in current code block.
-    auto decl_name = dynamic_pointer_cast<ast::IdentNode>(decl->name_);
-    if (var_table_->IsVarExistedInCurrentCodeBlock(decl_name->name_)) {
+    auto decl_name = decl->name_;
+    if (var_table_->IsVarExistedInCurrentCodeBlock(decl_name->symbol_)) {
         errors_->Emplace(decl->name_->Pos(), ec::Redefine, "in single var decl, var name is duplicate");
         return;
     }
-    var_table_->AddVar(decl_name->name_, decl->type_);
+    var_table_->AddVar(decl_name->symbol_, decl->type_);
 
     if (decl->val_ == nullptr) {
         return;
     }
 
     // check var init.
-    auto init_lit_type = make_shared<ast::TypeNode>();
+    ast::TypeNode* init_lit_type = types_.Bad();
     CheckExprAndGetType(decl->val_, &init_lit_type);
 
-    if (init_lit_type->Type() != decl->type_->Type()) {
+    if (init_lit_type != types_.Intern(decl->type_)) {
         errors_->Emplace(decl->val_->Pos(), ec::Type::ExprTypeNotMatched, "for single var decl init value, type not equal");
         return;
     }
@@ -285,54 +390,23 @@ void Checker::CheckBasicVarDeclNode(const shared_ptr<ast::SingleVarDeclNode> &de
  * 
  * @param stmt stmt node.
  */
-void Checker::CheckStmt(const shared_ptr<ast::StmtNode>& stmt) {
+void Checker::CheckStmt(ast::StmtNode* stmt) {
     if (stmt == nullptr) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckStmt: stmt is nullptr");
         return;
     }
 
-    switch (stmt->Type()) {
-        case ast::DeclStmt:
-            CheckDeclStmt(dynamic_pointer_cast<ast::DeclStmtNode>(stmt));
-            return;
-        case ast::ExprStmt:
-            CheckExprStmt(dynamic_pointer_cast<ast::ExprStmtNode>(stmt));
-            return;
-        case ast::AssignStmt:
-            CheckAssignStmt(dynamic_pointer_cast<ast::AssignStmtNode>(stmt));
-            return;
-        case ast::ReturnStmt:
-            CheckReturnStmt(dynamic_pointer_cast<ast::ReturnStmtNode>(stmt));
-            return;
-        case ast::BlockStmt:
-            var_table_->CreateCodeBlock();
-            CheckBlockStmt(dynamic_pointer_cast<ast::BlockStmtNode>(stmt));
-            var_table_->DestroyCodeBlock();
-            return;
-        case ast::IfStmt:
-            CheckIfStmt(dynamic_pointer_cast<ast::IfStmtNode>(stmt));
-            return;
-        case ast::SwitchStmt:
-            CheckSwitchStmt(dynamic_pointer_cast<ast::SwitchStmtNode>(stmt));
-            return;
-        case ast::ForStmt:
-            CheckForStmt(dynamic_pointer_cast<ast::ForStmtNode>(stmt));
-            return;
-        case ast::WhileStmt:
-            CheckWhileStmt(dynamic_pointer_cast<ast::WhileStmtNode>(stmt));
-            return;
-        case ast::ScanStmt:
-            CheckScanStmt(dynamic_pointer_cast<ast::ScanStmtNode>(stmt));
-            return;
-        case ast::PrintfStmt:
-            CheckPrintfStmt(dynamic_pointer_cast<ast::PrintfStmtNode>(stmt));
-            return;
-        case ast::EmptyStmt:
-            return;
-        default:
-            errors_->Emplace(stmt->Pos(), ec::Type::NotInHomeWork, "CheckStmt: stmt type error");
-            return;
-    }
+    VisitStmt(stmt);
+}
+
+void Checker::VisitBlockStmt(ast::BlockStmtNode* stmt) {
+    var_table_->CreateCodeBlock();
+    CheckBlockStmt(stmt);
+    var_table_->DestroyCodeBlock();
+}
+
+void Checker::VisitOtherStmt(ast::StmtNode* stmt) {
+    errors_->Emplace(stmt->Pos(), ec::Type::NotInHomeWork, "CheckStmt: stmt type error");
 }
 
 /**
@@ -340,7 +414,7 @@ void Checker::CheckStmt(const shared_ptr<ast::StmtNode>& stmt) {
  * 
  * @param decl_stmt decl stmt node.
  */
-void Checker::CheckDeclStmt(const shared_ptr<ast::DeclStmtNode>& decl_stmt) {
+void Checker::CheckDeclStmt(ast::DeclStmtNode* decl_stmt) {
     if (decl_stmt == nullptr || decl_stmt->Type() != ast::DeclStmt) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckDeclStmt: decl stmt is nullptr");
         return;
@@ -351,7 +425,7 @@ void Checker::CheckDeclStmt(const shared_ptr<ast::DeclStmtNode>& decl_stmt) {
         return;
     }
 
-    CheckVarDeclNode(dynamic_pointer_cast<ast::VarDeclNode>(decl_stmt->decl_));
+    CheckVarDeclNode(static_cast<ast::VarDeclNode*>(decl_stmt->decl_));
 }
 
 /**
@@ -359,13 +433,13 @@ void Checker::CheckDeclStmt(const shared_ptr<ast::DeclStmtNode>& decl_stmt) {
  * 
  * @param expr_stmt expr stmt node.
  */
-void Checker::CheckExprStmt(const shared_ptr<ast::ExprStmtNode>& expr_stmt) {
+void Checker::CheckExprStmt(ast::ExprStmtNode* expr_stmt) {
     if (expr_stmt == nullptr || expr_stmt->Type() != ast::ExprStmt) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckExprStmt: expr stmt is nullptr");
         return;
     }
 
-    shared_ptr<ast::TypeNode> typ;
+    ast::TypeNode* typ = nullptr;
     CheckExprAndGetType(expr_stmt->expr_, &typ);
 }
 
@@ -374,7 +448,7 @@ void Checker::CheckExprStmt(const shared_ptr<ast::ExprStmtNode>& expr_stmt) {
  * 
  * @param assign_stmt assign stmt node.
  */
-void Checker::CheckAssignStmt(const shared_ptr<ast::AssignStmtNode>& assign_stmt) {
+void Checker::CheckAssignStmt(ast::AssignStmtNode* assign_stmt) {
     if (assign_stmt == nullptr || assign_stmt->Type() != ast::AssignStmt) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckAssignStmt: assign stmt is nullptr");
         return;
@@ -390,9 +464,9 @@ void Checker::CheckAssignStmt(const shared_ptr<ast::AssignStmtNode>& assign_stmt
     }
 
     if (assign_stmt->lhs_->Type() == ast::Ident) {
-        auto ident = dynamic_pointer_cast<ast::IdentNode>(assign_stmt->lhs_);
-        VarTable::Identifier ident_info;
-        int ret = var_table_->GetVar(ident->name_, &ident_info);
+        auto ident = static_cast<ast::IdentNode*>(assign_stmt->lhs_);
+        const VarTable::Identifier* ident_info = nullptr;
+        int ret = var_table_->GetVar(ident->symbol_, &ident_info);
         if (ret) {
             errors_->Emplace(
                 assign_stmt->lhs_->Pos(),
@@ -402,7 +476,7 @@ void Checker::CheckAssignStmt(const shared_ptr<ast::AssignStmtNode>& assign_stmt
             return;
         }
 
-        if (ident_info.is_const) {
+        if (ident_info->is_const) {
             errors_->Emplace(
                 assign_stmt->lhs_->Pos(),
                 ec::Type::UpdateConstValue,
@@ -412,7 +486,7 @@ void Checker::CheckAssignStmt(const shared_ptr<ast::AssignStmtNode>& assign_stmt
         }
     }
 
-    shared_ptr<ast::TypeNode> lhs_type, rhs_type;
+    ast::TypeNode *lhs_type = nullptr, *rhs_type = nullptr;
     CheckExprAndGetType(assign_stmt->lhs_, &lhs_type);
     CheckExprAndGetType(assign_stmt->rhs_, &rhs_type);
 }
@@ -422,7 +496,7 @@ void Checker::CheckAssignStmt(const shared_ptr<ast::AssignStmtNode>& assign_stmt
  * 
  * @param return_stmt return stmt node.
  */
-void Checker::CheckReturnStmt(const shared_ptr<ast::ReturnStmtNode>& return_stmt) {
+void Checker::CheckReturnStmt(ast::ReturnStmtNode* return_stmt) {
     return;
 }
 
@@ -431,7 +505,7 @@ void Checker::CheckReturnStmt(const shared_ptr<ast::ReturnStmtNode>& return_stmt
  * 
  * @param block_stmt block stmt node.
  */
-void Checker::CheckBlockStmt(const shared_ptr<ast::BlockStmtNode>& block_stmt) {
+void Checker::CheckBlockStmt(ast::BlockStmtNode* block_stmt) {
     if (block_stmt == nullptr || block_stmt->Type() != ast::BlockStmt) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckBlockStmt: block stmt is nullptr");
         return;
@@ -447,7 +521,7 @@ void Checker::CheckBlockStmt(const shared_ptr<ast::BlockStmtNode>& block_stmt) {
  * 
  * @param if_stmt if stmt node.
  */
-void Checker::CheckIfStmt(const shared_ptr<ast::IfStmtNode>& if_stmt) {
+void Checker::CheckIfStmt(ast::IfStmtNode* if_stmt) {
     if (if_stmt == nullptr || if_stmt->Type() != ast::IfStmt) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckIfStmt: if stmt is nullptr");
         return;
@@ -478,7 +552,7 @@ void Checker::CheckIfStmt(const shared_ptr<ast::IfStmtNode>& if_stmt) {
  * 
  * @param switch_stmt switch stmt node.
  */
-void Checker::CheckSwitchStmt(const shared_ptr<ast::SwitchStmtNode>& switch_stmt) {
+void Checker::CheckSwitchStmt(ast::SwitchStmtNode* switch_stmt) {
     if (switch_stmt == nullptr || switch_stmt->Type() != ast::SwitchStmt) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckSwitchStmt: switch stmt is nullptr");
         return;
@@ -489,7 +563,7 @@ void Checker::CheckSwitchStmt(const shared_ptr<ast::SwitchStmtNode>& switch_stmt
         errors_->Emplace(switch_stmt->Pos(), ec::Type::NotInHomeWork, "CheckSwitchStmt: switch stmt cond is nullptr");
         return;
     }
-    shared_ptr<ast::TypeNode> switch_cond_type;
+    ast::TypeNode* switch_cond_type = nullptr;
     CheckExprAndGetType(switch_stmt->cond_, &switch_cond_type);
 
     if (switch_cond_type->Type() != ast::IntType && switch_cond_type->Type() != ast::CharType) {
@@ -509,7 +583,7 @@ void Checker::CheckSwitchStmt(const shared_ptr<ast::SwitchStmtNode>& switch_stmt
             return;
         }
 
-        auto case_stmt = dynamic_pointer_cast<ast::CaseStmtNode>(cas);
+        auto case_stmt = static_cast<ast::CaseStmtNode*>(cas);
 
         // check case cond.
         if (case_stmt->cond_ == nullptr) {
@@ -524,10 +598,10 @@ void Checker::CheckSwitchStmt(const shared_ptr<ast::SwitchStmtNode>& switch_stmt
 
             get_default_case = true;
         } else {
-            shared_ptr<ast::TypeNode> case_cond_type;
+            ast::TypeNode* case_cond_type = nullptr;
             CheckExprAndGetType(case_stmt->cond_, &case_cond_type);
 
-            if (case_cond_type->Type() != switch_cond_type->Type()) {
+            if (case_cond_type != switch_cond_type) {
                 errors_->Emplace(
                     case_stmt->cond_->Pos(),
                     ec::Type::ExprTypeNotMatched,
@@ -558,7 +632,7 @@ void Checker::CheckSwitchStmt(const shared_ptr<ast::SwitchStmtNode>& switch_stmt
  * 
  * @param for_stmt for stmt node.
  */
-void Checker::CheckForStmt(const shared_ptr<ast::ForStmtNode>& for_stmt) {
+void Checker::CheckForStmt(ast::ForStmtNode* for_stmt) {
     if (for_stmt == nullptr || for_stmt->Type() != ast::ForStmt) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckForStmt: for stmt is nullptr");
         return;
@@ -580,7 +654,7 @@ void Checker::CheckForStmt(const shared_ptr<ast::ForStmtNode>& for_stmt) {
             return;
         }
 
-        CheckCondExpr(dynamic_pointer_cast<ast::ExprStmtNode>(for_stmt->cond_)->expr_);
+        CheckCondExpr(static_cast<ast::ExprStmtNode*>(for_stmt->cond_)->expr_);
     }
 
     if (for_stmt->step_ != nullptr) {
@@ -596,7 +670,7 @@ void Checker::CheckForStmt(const shared_ptr<ast::ForStmtNode>& for_stmt) {
  * 
  * @param while_stmt while stmt node.
  */
-void Checker::CheckWhileStmt(const shared_ptr<ast::WhileStmtNode>& while_stmt) {
+void Checker::CheckWhileStmt(ast::WhileStmtNode* while_stmt) {
     if (while_stmt == nullptr || while_stmt->Type() != ast::WhileStmt) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckWhileStmt: while stmt is nullptr");
         return;
@@ -616,7 +690,7 @@ void Checker::CheckWhileStmt(const shared_ptr<ast::WhileStmtNode>& while_stmt) {
  * 
  * @param scan_stmt scan stmt node.
  */
-void Checker::CheckScanStmt(const shared_ptr<ast::ScanStmtNode>& scan_stmt) {
+void Checker::CheckScanStmt(ast::ScanStmtNode* scan_stmt) {
     if (scan_stmt == nullptr || scan_stmt->Type() != ast::ScanStmt) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckScanStmt: scan stmt is nullptr");
         return;
@@ -637,11 +711,13 @@ void Checker::CheckScanStmt(const shared_ptr<ast::ScanStmtNode>& scan_stmt) {
         return;
     }
 
-    auto ident = dynamic_pointer_cast<ast::IdentNode>(scan_stmt->var_);
-    VarTable::Identifier ident_info;
-    var_table_->GetVar(ident->name_, &ident_info);
+    auto ident = static_cast<ast::IdentNode*>(scan_stmt->var_);
+    const VarTable::Identifier* ident_info = nullptr;
+    if (var_table_->GetVar(ident->symbol_, &ident_info)) {
+        return;
+    }
 
-    if (ident_info.is_const) {
+    if (ident_info->is_const) {
         errors_->Emplace(
             scan_stmt->var_->Pos(),
             ec::Type::UpdateConstValue,
@@ -656,76 +732,52 @@ void Checker::CheckScanStmt(const shared_ptr<ast::ScanStmtNode>& scan_stmt) {
  * 
  * @param printf_stmt printf stmt node.
  */
-void Checker::CheckPrintfStmt(const shared_ptr<ast::PrintfStmtNode>& printf_stmt) {
+void Checker::CheckPrintfStmt(ast::PrintfStmtNode* printf_stmt) {
     if (printf_stmt == nullptr || printf_stmt->Type() != ast::PrintfStmt) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckPrintfStmt: printf stmt is nullptr");
         return;
     }
 
     for (const auto& arg: printf_stmt->args_) {
-        shared_ptr<ast::TypeNode> arg_type;
+        ast::TypeNode* arg_type = nullptr;
         CheckExprAndGetType(arg, &arg_type);
     }
 
     return;
 }
 
-void Checker::CheckExprAndGetType(const shared_ptr<ast::ExprNode> &expr, shared_ptr<ast::TypeNode> *typ) {
+void Checker::CheckExprAndGetType(ast::ExprNode* expr, ast::TypeNode** typ) {
     if (expr == nullptr) {
-        *typ = make_shared<ast::VoidTypeNode>();
+        *typ = types_.Void();
         return;
     }
 
-    switch (expr->Type()) {
-        case ast::Ident:
-            CheckIdentExprNodeAndGetType(dynamic_pointer_cast<ast::IdentNode>(expr), typ);
-            return;
-        case ast::BasicLit:
-            CheckBasicLitNodeAndGetType(dynamic_pointer_cast<ast::BasicLitNode>(expr), typ);
-            return;
-        case ast::CompositeLit:
-            CheckCompositeLitNodeAndGetType(dynamic_pointer_cast<ast::CompositeLitNode>(expr), typ);
-            return;
-        case ast::IndexExpr:
-            CheckIndexExprNodeAndGetType(dynamic_pointer_cast<ast::IndexExprNode>(expr), typ);
-            return;
-        case ast::CallExpr:
-            CheckCallExprNodeAndGetType(dynamic_pointer_cast<ast::CallExprNode>(expr), typ);
-            return;
-        case ast::UnaryExpr:
-            CheckUnaryExprNodeAndGetType(dynamic_pointer_cast<ast::UnaryExprNode>(expr), typ);
-            return;
-        case ast::BinaryExpr:
-            CheckBinaryExprNodeAndGetType(dynamic_pointer_cast<ast::BinaryExprNode>(expr), typ);
-            return;
-        case ast::ParenExpr:
-            CheckExprAndGetType(dynamic_pointer_cast<ast::ParenExprNode>(expr)->expr_, typ);
-            return;
-        default:
-            errors_->Emplace(expr->Pos(), ec::NotInHomeWork, "unknown expr type");
-            return;
-    }
+    VisitExpr(expr, typ);
+}
+
+void Checker::VisitOtherExpr(ast::ExprNode* expr, ast::TypeNode** typ) {
+    errors_->Emplace(expr->Pos(), ec::NotInHomeWork, "unknown expr type");
 }
 
-void Checker::CheckIdentExprNodeAndGetType(const shared_ptr<ast::IdentNode> &expr, shared_ptr<ast::TypeNode> *typ) {
+void Checker::CheckIdentExprNodeAndGetType(ast::IdentNode* expr, ast::TypeNode** typ) {
     if (expr == nullptr) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckIdentExprNodeAndGetType: expr is nullptr");
         return;
     }
 
     // check if ident existed.
-    VarTable::Identifier ident;
-    if (var_table_->GetVar(expr->name_, &ident)) {
-        *typ = make_shared<ast::BadTypeNode>(expr->Pos());
+    const VarTable::Identifier* ident = nullptr;
+    if (var_table_->GetVar(expr->symbol_, &ident)) {
+        *typ = types_.Bad();
         errors_->Emplace(expr->Pos(), ec::Undefine, "for ident expr, var not found");
         return;
     }
 
-    *typ = ident.type;
+    *typ = types_.Intern(ident->type);
 }
 
-void Checker::CheckBasicLitNodeAndGetType(const shared_ptr<ast::BasicLitNode> &expr, shared_ptr<ast::TypeNode> *typ) {
-    *typ = make_shared<ast::BadTypeNode>(expr->Pos());
+void Checker::CheckBasicLitNodeAndGetType(ast::BasicLitNode* expr, ast::TypeNode** typ) {
+    *typ = types_.Bad();
     if (expr == nullptr) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckBasicLitNodeAndGetType: expr is nullptr");
         return;
@@ -768,32 +820,40 @@ void Checker::CheckBasicLitNodeAndGetType(const shared_ptr<ast::BasicLitNode> &e
     }
 
     if (expr->tok_ == token::Token::INTCON) {
-        *typ = make_shared<ast::IntTypeNode>(expr->Pos());
+        *typ = types_.Int();
     } else if (expr->tok_ == token::Token::CHARCON) {
-        *typ = make_shared<ast::CharTypeNode>(expr->Pos());
+        *typ = types_.Char();
     } else if (expr->tok_ == token::Token::STRCON) {
-        *typ = make_shared<ast::StringTypeNode>(expr->Pos());
+        *typ = types_.String();
     }
 }
 
-void Checker::CheckCompositeLitNodeAndGetType(const shared_ptr<ast::CompositeLitNode> &expr,
-                                              shared_ptr<ast::TypeNode> *typ) {
-    *typ = make_shared<ast::BadTypeNode>(expr->Pos());
+void Checker::CheckCompositeLitNodeAndGetType(ast::CompositeLitNode* expr,
+                                              ast::TypeNode** typ) {
+    *typ = types_.Bad();
     if (expr == nullptr) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckCompositeLitNodeAndGetType: expr is nullptr");
         return;
     }
 
-    vector<shared_ptr<ast::ExprNode>> cur_demission_nodes, next_demission_nodes;
+    // the parser packs regular literals only, the type of one is made of its dims at once.
+    if (expr->Packed()) {
+        *typ = (expr->tok_ == token::INTCON) ? types_.Int() : types_.Char();
+        for (size_t i = expr->dims_.size(); i-- > 0;) {
+            *typ = types_.Array(expr->dims_[i], *typ);
+        }
+        return;
+    }
+
+    vector<ast::ExprNode*> cur_demission_nodes, next_demission_nodes;
     cur_demission_nodes.push_back(expr);
 
     vector<int> demissions;
     pair<bool, token::Token> get_basic_type_token;
     while(!cur_demission_nodes.empty()) {
         auto cur_demission_first_node = cur_demission_nodes.front();
-        shared_ptr<ast::CompositeLitNode> cur_demission_ref_composite_lit_node;
-        shared_ptr<ast::BasicLitNode> cur_demission_ref_basic_lit_node;
-
+        ast::CompositeLitNode* cur_demission_ref_composite_lit_node = nullptr;
+        ast::BasicLitNode* cur_demission_ref_basic_lit_node = nullptr;
         if (cur_demission_first_node->Type() == ast::CompositeLit) {
             goto CompositeLitDemissionCheck;
         } else if (cur_demission_first_node->Type() == ast::BasicLit)  {
@@ -809,7 +869,7 @@ void Checker::CheckCompositeLitNodeAndGetType(const shared_ptr<ast::CompositeLit
 
 // nodes in current demission are all array type.
 CompositeLitDemissionCheck:
-        cur_demission_ref_composite_lit_node = dynamic_pointer_cast<ast::CompositeLitNode>(cur_demission_first_node);
+        cur_demission_ref_composite_lit_node = static_cast<ast::CompositeLitNode*>(cur_demission_first_node);
         demissions.push_back(cur_demission_ref_composite_lit_node->items_.size());
 
         for (const auto& node: cur_demission_nodes) {
@@ -822,7 +882,7 @@ CompositeLitDemissionCheck:
                 return;
             }
 
-            auto composite_lit_node = dynamic_pointer_cast<ast::CompositeLitNode>(node);
+            auto composite_lit_node = static_cast<ast::CompositeLitNode*>(node);
             if (composite_lit_node->items_.size() != cur_demission_ref_composite_lit_node->items_.size()) {
                 errors_->Emplace(
                     node->Pos(),
@@ -842,7 +902,7 @@ CompositeLitDemissionCheck:
 
 // nodes in current demission have same tok_.
 BasicLitDemissionCheck:
-        cur_demission_ref_basic_lit_node = dynamic_pointer_cast<ast::BasicLitNode>(cur_demission_first_node);
+        cur_demission_ref_basic_lit_node = static_cast<ast::BasicLitNode*>(cur_demission_first_node);
         for(const auto& node: cur_demission_nodes) {
             if (node->Type() != ast::BasicLit) {
                 errors_->Emplace(
@@ -853,7 +913,7 @@ BasicLitDemissionCheck:
                 return;
             }
 
-            auto basic_lit_node = dynamic_pointer_cast<ast::BasicLitNode>(node);
+            auto basic_lit_node = static_cast<ast::BasicLitNode*>(node);
             if (basic_lit_node->tok_ != cur_demission_ref_basic_lit_node->tok_) {
                 errors_->Emplace(
                     node->Pos(),
@@ -882,28 +942,28 @@ PostCheckProcess:
     }
 
     // write back type.
-    if (get_basic_type_token.second == token::INTCON) *typ = make_shared<ast::IntTypeNode>(expr->Pos());
-    else if (get_basic_type_token.second == token::CHARCON) *typ = make_shared<ast::CharTypeNode>(expr->Pos());
-    else if (get_basic_type_token.second == token::STRCON) *typ = make_shared<ast::StringTypeNode>(expr->Pos());
-    else *typ = make_shared<ast::BadTypeNode>(expr->Pos());
+    if (get_basic_type_token.second == token::INTCON) *typ = types_.Int();
+    else if (get_basic_type_token.second == token::CHARCON) *typ = types_.Char();
+    else if (get_basic_type_token.second == token::STRCON) *typ = types_.String();
+    else *typ = types_.Bad();
 
     for (int i = demissions.size() - 1; i >= 0; i--) {
-        *typ= make_shared<ast::ArrayTypeNode>(expr->Pos(), demissions.at(i), *typ);
+        *typ = types_.Array(demissions.at(i), *typ);
     }
 }
 
-void Checker::CheckIndexExprNodeAndGetType(const shared_ptr<ast::IndexExprNode> &expr, shared_ptr<ast::TypeNode> *typ) {
-    *typ = make_shared<ast::VoidTypeNode>();
+void Checker::CheckIndexExprNodeAndGetType(ast::IndexExprNode* expr, ast::TypeNode** typ) {
+    *typ = types_.Void();
     if (expr == nullptr || expr->Type() != ast::IndexExpr) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckIndexExprNodeAndGetType: expr is nullptr");
         return;
     }
 
-    shared_ptr<ast::ExprNode> cur_node = expr;
+    ast::ExprNode* cur_node = expr;
     while (cur_node != nullptr && cur_node->Type() == ast::IndexExpr) {
-        auto index_expr_node = dynamic_pointer_cast<ast::IndexExprNode>(cur_node);
+        auto index_expr_node = static_cast<ast::IndexExprNode*>(cur_node);
 
-        shared_ptr<ast::TypeNode> cur_index_type;
+        ast::TypeNode* cur_index_type = nullptr;
         CheckExprAndGetType(index_expr_node->index_, &cur_index_type);
 
         if (cur_index_type->Type() != ast::IntType) {
@@ -927,9 +987,9 @@ void Checker::CheckIndexExprNodeAndGetType(const shared_ptr<ast::IndexExprNode>
         return;
     }
 
-    auto ident_node = dynamic_pointer_cast<ast::IdentNode>(cur_node);
-    VarTable::Identifier ident_info;
-    if (var_table_->GetVar(ident_node->name_, &ident_info)) {
+    auto ident_node = static_cast<ast::IdentNode*>(cur_node);
+    const VarTable::Identifier* ident_info = nullptr;
+    if (var_table_->GetVar(ident_node->symbol_, &ident_info)) {
         errors_->Emplace(
             ident_node->Pos(),
             ec::Type::Undefine,
@@ -938,7 +998,7 @@ void Checker::CheckIndexExprNodeAndGetType(const shared_ptr<ast::IndexExprNode>
         return;
     }
 
-    if (ident_info.type->Type() != ast::ArrayType) {
+    if (ident_info->type->Type() != ast::ArrayType) {
         errors_->Emplace(
             ident_node->Pos(),
             ec::Type::Undefine,
@@ -947,10 +1007,10 @@ void Checker::CheckIndexExprNodeAndGetType(const shared_ptr<ast::IndexExprNode>
         return;
     }
 
-    auto array_type_node = dynamic_pointer_cast<ast::ArrayTypeNode>(ident_info.type);
-    shared_ptr<ast::TypeNode> decl_type_node = array_type_node;
+    auto array_type_node = static_cast<ast::ArrayTypeNode*>(ident_info->type);
+    ast::TypeNode* decl_type_node = array_type_node;
     while(decl_type_node != nullptr && decl_type_node->Type() == ast::ArrayType) {
-        decl_type_node = dynamic_pointer_cast<ast::ArrayTypeNode>(decl_type_node)->item_;
+        decl_type_node = static_cast<ast::ArrayTypeNode*>(decl_type_node)->item_;
     }
 
     if (decl_type_node == nullptr) {
@@ -961,12 +1021,12 @@ void Checker::CheckIndexExprNodeAndGetType(const shared_ptr<ast::IndexExprNode>
         );
         return;
     }
-    *typ = decl_type_node;
+    *typ = types_.Intern(decl_type_node);
     return;
 }
 
-void Checker::CheckCallExprNodeAndGetType(const shared_ptr<ast::CallExprNode> &expr, shared_ptr<ast::TypeNode> *typ) {
-    *typ = make_shared<ast::BadTypeNode>(expr->Pos());
+void Checker::CheckCallExprNodeAndGetType(ast::CallExprNode* expr, ast::TypeNode** typ) {
+    *typ = types_.Bad();
     if (expr == nullptr || expr->Type() != ast::CallExpr) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckCallExprNodeAndGetType: expr is nullptr");
         return;
@@ -978,16 +1038,16 @@ void Checker::CheckCallExprNodeAndGetType(const shared_ptr<ast::CallExprNode> &e
         errors_->Emplace(expr->Pos(), ec::Type::NotInHomeWork, "CheckCallExprNodeAndGetType: func_name is nullptr");
         return;
     }
-    auto func_name_ident = dynamic_pointer_cast<ast::IdentNode>(func_name);
+    auto func_name_ident = static_cast<ast::IdentNode*>(func_name);
 
-    shared_ptr<ast::FuncDeclNode> func_decl;
-    if (var_table_->GetFunc(func_name_ident->name_, &func_decl) != 0) {
+    ast::FuncDeclNode* func_decl = nullptr;
+    if (var_table_->GetFunc(func_name_ident->symbol_, &func_decl) != 0) {
         errors_->Emplace(expr->Pos(), ec::Type::NotInHomeWork, "CheckCallExprNodeAndGetType: func decl not found");
         return;
     }
 
     // set type.
-    *typ = func_decl->type_ == nullptr ? make_shared<ast::BadTypeNode>() : func_decl->type_;
+    *typ = types_.Intern(func_decl->type_);
 
     // check func params.
     auto decl_params = func_decl->params_->fields_;
@@ -1005,10 +1065,10 @@ void Checker::CheckCallExprNodeAndGetType(const shared_ptr<ast::CallExprNode> &e
     for (int i = 0; i < decl_params.size(); i++) {
         auto decl_param = decl_params.at(i);
         auto pass_param = pass_params.at(i);
-        shared_ptr<ast::TypeNode> pass_param_type;
+        ast::TypeNode* pass_param_type = nullptr;
         CheckExprAndGetType(pass_param, &pass_param_type);
 
-        if (decl_param->type_->Type() != pass_param_type->Type()) {
+        if (pass_param_type != types_.Intern(decl_param->type_)) {
             errors_->Emplace(
                 pass_param->Pos(),
                 ec::Type::ArgTypeNotMatched,
@@ -1019,8 +1079,8 @@ void Checker::CheckCallExprNodeAndGetType(const shared_ptr<ast::CallExprNode> &e
     }
 }
 
-void Checker::CheckUnaryExprNodeAndGetType(const shared_ptr<ast::UnaryExprNode> &expr, shared_ptr<ast::TypeNode> *typ) {
-    *typ = make_shared<ast::BadTypeNode>(expr->Pos());
+void Checker::CheckUnaryExprNodeAndGetType(ast::UnaryExprNode* expr, ast::TypeNode** typ) {
+    *typ = types_.Bad();
     if (expr == nullptr || expr->Type() != ast::UnaryExpr) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckUnaryExprNodeAndGetType: expr is nullptr");
         return;
@@ -1033,7 +1093,7 @@ void Checker::CheckUnaryExprNodeAndGetType(const shared_ptr<ast::UnaryExprNode>
     }
 
     // check expr.
-    shared_ptr<ast::TypeNode> expr_type;
+    ast::TypeNode* expr_type = nullptr;
     CheckExprAndGetType(expr->x_, &expr_type);
 
     if (expr_type->Type() != ast::IntType) {
@@ -1041,7 +1101,7 @@ void Checker::CheckUnaryExprNodeAndGetType(const shared_ptr<ast::UnaryExprNode>
         return;
     }
 
-    *typ = make_shared<ast::IntTypeNode>(expr->Pos());
+    *typ = types_.Int();
 }
 
 /**
@@ -1049,9 +1109,9 @@ void Checker::CheckUnaryExprNodeAndGetType(const shared_ptr<ast::UnaryExprNode>
  * @param expr binary expr node.
  * @param typ type of binary expr node.
  */
-void Checker::CheckBinaryExprNodeAndGetType(const shared_ptr<ast::BinaryExprNode> &expr,
-                                            shared_ptr<ast::TypeNode> *typ) {
-    *typ = make_shared<ast::BadTypeNode>(expr->Pos());
+void Checker::CheckBinaryExprNodeAndGetType(ast::BinaryExprNode* expr,
+                                            ast::TypeNode** typ) {
+    *typ = types_.Bad();
     if (expr == nullptr || expr->Type() != ast::BinaryExpr) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckBinaryExprNodeAndGetType: expr is nullptr");
         return;
@@ -1070,7 +1130,7 @@ void Checker::CheckBinaryExprNodeAndGetType(const shared_ptr<ast::BinaryExprNode
     }
 
     // check expr.
-    shared_ptr<ast::TypeNode> lhs_type, rhs_type;
+    ast::TypeNode *lhs_type = nullptr, *rhs_type = nullptr;
     CheckExprAndGetType(expr->x_, &lhs_type);
     CheckExprAndGetType(expr->y_, &rhs_type);
 
@@ -1083,19 +1143,19 @@ void Checker::CheckBinaryExprNodeAndGetType(const shared_ptr<ast::BinaryExprNode
  * 
  * @param cond_expr cond expr node.
  */
-void Checker::CheckCondExpr(const shared_ptr<ast::ExprNode>& cond_expr) {
+void Checker::CheckCondExpr(ast::ExprNode* cond_expr) {
     if (cond_expr == nullptr || (cond_expr->Type() != ast::BinaryExpr && cond_expr->Type() != ast::ParenExpr)) {
         errors_->Emplace(token::npos, ec::Type::NotInHomeWork, "CheckCondExpr: cond_expr should be a binary expr or paren expr");
         return;
     }
 
     if (cond_expr->Type() == ast::ParenExpr) {
-        CheckCondExpr(dynamic_pointer_cast<ast::ParenExprNode>(cond_expr)->expr_);
+        CheckCondExpr(static_cast<ast::ParenExprNode*>(cond_expr)->expr_);
         return;
     }
 
     // check op.
-    auto binary_expr = dynamic_pointer_cast<ast::BinaryExprNode>(cond_expr);
+    auto binary_expr = static_cast<ast::BinaryExprNode*>(cond_expr);
     bool get_expect_op_token = false;
 
     vector<token::Token> expect_op_tokens{
@@ -1115,7 +1175,7 @@ void Checker::CheckCondExpr(const shared_ptr<ast::ExprNode>& cond_expr) {
     }
 
     // check expr.
-    shared_ptr<ast::TypeNode> lhs_type, rhs_type;
+    ast::TypeNode *lhs_type = nullptr, *rhs_type = nullptr;
     CheckExprAndGetType(binary_expr->x_, &lhs_type);
     CheckExprAndGetType(binary_expr->y_, &rhs_type);
 }
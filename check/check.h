@@ -1,6 +1,8 @@
 #pragma once
 
 #include "ast/ast.h"
+#include "ast/visitor.h"
+#include "check/types.h"
 #include "error.h"
 #include "parser/var_table.h"
 
@@ -13,59 +15,107 @@ using namespace std;
 
 namespace check{
 // Checker check errors builded ast tree.
-class Checker {
+class Checker : private ast::StmtVisitor<Checker>, private ast::ExprVisitor<Checker, void, ast::TypeNode**> {
+    friend class ast::StmtVisitor<Checker>;
+    friend class ast::ExprVisitor<Checker, void, ast::TypeNode**>;
 public:
     Checker(const shared_ptr<ast::FileNode>& ast_file, const shared_ptr<ec::ErrorReminder>& error_reminder);
     void Check();
+
+    /**
+     * @brief SetJobs makes Check check function bodies on jobs threads, 1 by default.
+     * Globals and function names are still checked in order first, errors are the same for any jobs.
+     */
+    void SetJobs(int jobs) { jobs_ = jobs; }
+
+    /**
+     * @brief CheckDecl checks a top level decl in the global scope left by decls checked
+     * or declared before it, so decls of a file can be checked one by one.
+     *
+     * @param decl top level decl.
+     * @param journal records globals decl defines and names it looks up, may be nullptr.
+     * @return 0, or -1 if decl is neither a var nor a func decl, which stops the check of a file.
+     */
+    int CheckDecl(ast::DeclNode* decl, VarTable::Journal* journal);
+
+    /**
+     * @brief Declare adds globals a decl defined when it was checked, without checking it again.
+     */
+    void Declare(const vector<VarTable::Global>& globals);
+
+    /**
+     * @brief SetErrorReminder makes errors found from now on go to error_reminder.
+     */
+    void SetErrorReminder(const shared_ptr<ec::ErrorReminder>& error_reminder) { errors_ = error_reminder; }
 private:
+    /**
+     * @brief CheckConcurrently is Check with function bodies checked on jobs_ threads.
+     */
+    void CheckConcurrently();
+
     /**
      * @brief CheckVarDeclNode check var decl node in any position.
      * 
      * @param decl var decl node. 
      */
-    void CheckVarDeclNode(const shared_ptr<ast::VarDeclNode>& decl);
+    void CheckVarDeclNode(ast::VarDeclNode* decl);
 
     /**
      * @brief CheckFuncDeclNode check func decl node in root.
      *
      * @param decl func decl node.
      */
-    void CheckFuncDeclNode(const shared_ptr<ast::FuncDeclNode>& decl);
+    void CheckFuncDeclNode(ast::FuncDeclNode* decl);
+
+    /**
+     * @brief DeclareFunc checks the name of func decl node and adds it to the global scope.
+     *
+     * @param decl func decl node.
+     * @return 0 if its body is to be checked, -1 if not.
+     */
+    int DeclareFunc(ast::FuncDeclNode* decl);
+
+    /**
+     * @brief CheckFuncBody checks params and body of a declared func decl node.
+     *
+     * @param decl func decl node.
+     */
+    void CheckFuncBody(ast::FuncDeclNode* decl);
 
     /**
      * @brief CheckSingleVarDecl check single var decl node.
      *
      * @param decl single var decl node.
      */
-    void CheckSingleVarDeclNode(const shared_ptr<ast::SingleVarDeclNode>& decl);
+    void CheckSingleVarDeclNode(ast::SingleVarDeclNode* decl);
 
     /**
      * @brief CheckArrayVarDeclNode check array var decl node.
      *
      * @param decl array var decl node.
      */
-    void CheckArrayVarDeclNode(const shared_ptr<ast::SingleVarDeclNode>& decl);
+    void CheckArrayVarDeclNode(ast::SingleVarDeclNode* decl);
 
     /**
      * @brief CheckBasicVarDeclNode check basic var decl node.
      *
      * @param decl basic var decl node, e.g. int, char.
      */
-    void CheckBasicVarDeclNode(const shared_ptr<ast::SingleVarDeclNode>& decl);
+    void CheckBasicVarDeclNode(ast::SingleVarDeclNode* decl);
 
     /**
      * CheckExprAndGetType check expr node and get its type.
      * @param expr expr node.
      * @param typ type of expr node.
      */
-    void CheckExprAndGetType(const shared_ptr<ast::ExprNode>& expr, shared_ptr<ast::TypeNode>* typ);
+    void CheckExprAndGetType(ast::ExprNode* expr, ast::TypeNode** typ);
 
     /**
      * @brief CheckCondExpr check cond expr node.
      * 
      * @param cond_expr cond expr node.
      */
-    void CheckCondExpr(const shared_ptr<ast::ExprNode>& cond_expr);
+    void CheckCondExpr(ast::ExprNode* cond_expr);
 
     /**
      * @brief CheckIdentNodeAndGetType check ident expr node and get its type.
@@ -73,7 +123,7 @@ private:
      * @param ident ident expr node.
      * @param typ type of ident expr node.
      */
-    void CheckIdentExprNodeAndGetType(const shared_ptr<ast::IdentNode>& expr, shared_ptr<ast::TypeNode>* typ);
+    void CheckIdentExprNodeAndGetType(ast::IdentNode* expr, ast::TypeNode** typ);
 
     /**
      * @brief CheckBasicLitNodeAndGetType check basic literal expr node.
@@ -81,7 +131,7 @@ private:
      * @param expr basic literal expr node.
      * @param typ type of basic literal expr node.
      */
-    void CheckBasicLitNodeAndGetType(const shared_ptr<ast::BasicLitNode>& expr, shared_ptr<ast::TypeNode>* typ);
+    void CheckBasicLitNodeAndGetType(ast::BasicLitNode* expr, ast::TypeNode** typ);
 
     /**
      * @brief CheckCompositeLitNodeAndGetType check composite literal expr node.
@@ -89,7 +139,7 @@ private:
      * @param expr composite literal expr node.
      * @param typ type of composite literal expr node.
      */
-    void CheckCompositeLitNodeAndGetType(const shared_ptr<ast::CompositeLitNode>& expr, shared_ptr<ast::TypeNode>* typ);
+    void CheckCompositeLitNodeAndGetType(ast::CompositeLitNode* expr, ast::TypeNode** typ);
 
     /**
      * @brief CheckIndexExprNodeAndGetType check index expr node and get its type.
@@ -97,7 +147,7 @@ private:
      * @param expr index expr node.
      * @param typ type of index expr node.
      */
-    void CheckIndexExprNodeAndGetType(const shared_ptr<ast::IndexExprNode>& expr, shared_ptr<ast::TypeNode>* typ);
+    void CheckIndexExprNodeAndGetType(ast::IndexExprNode* expr, ast::TypeNode** typ);
 
     /**
      * @brief CheckCallExprNodeAndGetType check call expr node and get its type.
@@ -105,7 +155,7 @@ private:
      * @param expr call expr node.
      * @param typ type of call expr node.
      */
-    void CheckCallExprNodeAndGetType(const shared_ptr<ast::CallExprNode>& expr, shared_ptr<ast::TypeNode>* typ);
+    void CheckCallExprNodeAndGetType(ast::CallExprNode* expr, ast::TypeNode** typ);
 
     /**
      * @brief CheckUnaryExprNodeAndGetType check unary expr node and get its type.
@@ -113,7 +163,7 @@ private:
      * @param expr unary expr node.
      * @param typ type of unary expr node.
      */
-    void CheckUnaryExprNodeAndGetType(const shared_ptr<ast::UnaryExprNode>& expr, shared_ptr<ast::TypeNode>* typ);
+    void CheckUnaryExprNodeAndGetType(ast::UnaryExprNode* expr, ast::TypeNode** typ);
 
     /**
      * @brief CheckBinaryExprNodeAndGetType check binary expr node and get its type.
@@ -121,95 +171,125 @@ private:
      * @param expr binary expr node.
      * @param typ type of binary expr node.
      */
-    void CheckBinaryExprNodeAndGetType(const shared_ptr<ast::BinaryExprNode>& expr, shared_ptr<ast::TypeNode>* typ);
+    void CheckBinaryExprNodeAndGetType(ast::BinaryExprNode* expr, ast::TypeNode** typ);
 
     /**
      * @brief CheckStmt check stmt node.
      * 
      * @param stmt 
      */
-    void CheckStmt(const shared_ptr<ast::StmtNode>& stmt);
+    void CheckStmt(ast::StmtNode* stmt);
 
     /**
      * @brief CheckDeclStmt check decl stmt node.
      * 
      * @param decl_stmt decl stmt node.
      */
-    void CheckDeclStmt(const shared_ptr<ast::DeclStmtNode>& decl_stmt);
+    void CheckDeclStmt(ast::DeclStmtNode* decl_stmt);
 
     /**
      * @brief CheckExprStmt check expr stmt node.
      * 
      * @param expr_stmt expr stmt node.
      */
-    void CheckExprStmt(const shared_ptr<ast::ExprStmtNode>& expr_stmt);
+    void CheckExprStmt(ast::ExprStmtNode* expr_stmt);
 
     /**
      * @brief CheckAssignStmt check assign stmt node.
      * 
      * @param assign_stmt assign stmt node.
      */
-    void CheckAssignStmt(const shared_ptr<ast::AssignStmtNode>& assign_stmt);
+    void CheckAssignStmt(ast::AssignStmtNode* assign_stmt);
 
     /**
      * @brief CheckReturnStmt check return stmt node.
      * 
      * @param return_stmt return stmt node.
      */
-    void CheckReturnStmt(const shared_ptr<ast::ReturnStmtNode>& return_stmt);
+    void CheckReturnStmt(ast::ReturnStmtNode* return_stmt);
 
     /**
      * @brief CheckBlockStmt check block stmt node.
      * 
      * @param block_stmt block stmt node.
      */
-    void CheckBlockStmt(const shared_ptr<ast::BlockStmtNode>& block_stmt);
+    void CheckBlockStmt(ast::BlockStmtNode* block_stmt);
     
     /**
      * @brief CheckIfStmt check if stmt node.
      * 
      * @param if_stmt if stmt node.
      */
-    void CheckIfStmt(const shared_ptr<ast::IfStmtNode>& if_stmt);
+    void CheckIfStmt(ast::IfStmtNode* if_stmt);
 
     /**
      * @brief CheckSwitchStmt check switch stmt node.
      * 
      * @param switch_stmt switch stmt node.
      */
-    void CheckSwitchStmt(const shared_ptr<ast::SwitchStmtNode>& switch_stmt);
+    void CheckSwitchStmt(ast::SwitchStmtNode* switch_stmt);
 
     /**
      * @brief CheckForStmt check for stmt node.
      * 
      * @param for_stmt for stmt node.
      */
-    void CheckForStmt(const shared_ptr<ast::ForStmtNode>& for_stmt);
+    void CheckForStmt(ast::ForStmtNode* for_stmt);
 
     /**
      * @brief CheckWhileStmt check while stmt node.
      * 
      * @param while_stmt while stmt node.
      */
-    void CheckWhileStmt(const shared_ptr<ast::WhileStmtNode>& while_stmt);
+    void CheckWhileStmt(ast::WhileStmtNode* while_stmt);
 
     /**
      * @brief CheckScanStmt check scan stmt node.
      * 
      * @param scan_stmt scan stmt node.
      */
-    void CheckScanStmt(const shared_ptr<ast::ScanStmtNode>& scan_stmt);
+    void CheckScanStmt(ast::ScanStmtNode* scan_stmt);
 
     /**
      * @brief CheckPrintfStmt check printf stmt node.
      * 
      * @param printf_stmt printf stmt node.
      */
-    void CheckPrintfStmt(const shared_ptr<ast::PrintfStmtNode>& printf_stmt);
+    void CheckPrintfStmt(ast::PrintfStmtNode* printf_stmt);
+
+    // Visitor handlers, CheckStmt and CheckExprAndGetType dispatch to them by node tag.
+    void VisitDeclStmt(ast::DeclStmtNode* stmt) { CheckDeclStmt(stmt); }
+    void VisitExprStmt(ast::ExprStmtNode* stmt) { CheckExprStmt(stmt); }
+    void VisitAssignStmt(ast::AssignStmtNode* stmt) { CheckAssignStmt(stmt); }
+    void VisitReturnStmt(ast::ReturnStmtNode* stmt) { CheckReturnStmt(stmt); }
+    void VisitBlockStmt(ast::BlockStmtNode* stmt);
+    void VisitIfStmt(ast::IfStmtNode* stmt) { CheckIfStmt(stmt); }
+    void VisitSwitchStmt(ast::SwitchStmtNode* stmt) { CheckSwitchStmt(stmt); }
+    void VisitForStmt(ast::ForStmtNode* stmt) { CheckForStmt(stmt); }
+    void VisitWhileStmt(ast::WhileStmtNode* stmt) { CheckWhileStmt(stmt); }
+    void VisitScanStmt(ast::ScanStmtNode* stmt) { CheckScanStmt(stmt); }
+    void VisitPrintfStmt(ast::PrintfStmtNode* stmt) { CheckPrintfStmt(stmt); }
+    void VisitEmptyStmt(ast::EmptyStmtNode*) {}
+    void VisitOtherStmt(ast::StmtNode* stmt);
+
+    void VisitIdent(ast::IdentNode* expr, ast::TypeNode** typ) { CheckIdentExprNodeAndGetType(expr, typ); }
+    void VisitBasicLit(ast::BasicLitNode* expr, ast::TypeNode** typ) { CheckBasicLitNodeAndGetType(expr, typ); }
+    void VisitCompositeLit(ast::CompositeLitNode* expr, ast::TypeNode** typ) { CheckCompositeLitNodeAndGetType(expr, typ); }
+    void VisitIndexExpr(ast::IndexExprNode* expr, ast::TypeNode** typ) { CheckIndexExprNodeAndGetType(expr, typ); }
+    void VisitCallExpr(ast::CallExprNode* expr, ast::TypeNode** typ) { CheckCallExprNodeAndGetType(expr, typ); }
+    void VisitUnaryExpr(ast::UnaryExprNode* expr, ast::TypeNode** typ) { CheckUnaryExprNodeAndGetType(expr, typ); }
+    void VisitBinaryExpr(ast::BinaryExprNode* expr, ast::TypeNode** typ) { CheckBinaryExprNodeAndGetType(expr, typ); }
+    void VisitParenExpr(ast::ParenExprNode* expr, ast::TypeNode** typ) { CheckExprAndGetType(expr->expr_, typ); }
+    void VisitOtherExpr(ast::ExprNode* expr, ast::TypeNode** typ);
 
     shared_ptr<ast::FileNode> ast_;
 
+    // types_ interns types of exprs, types got while checking are compared by pointer.
+    TypeTable types_;
+
     shared_ptr<VarTable> var_table_;
     shared_ptr<ec::ErrorReminder> errors_;
+
+    int jobs_;
 };
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "check/types.h"
+
+namespace check {
+
+ast::TypeNode* TypeTable::Basic(ast::NodeType tag) {
+    switch (tag) {
+        case ast::IntType: return Int();
+        case ast::CharType: return Char();
+        case ast::VoidType: return Void();
+        case ast::StringType: return String();
+        default: return Bad();
+    }
+}
+
+ast::TypeNode* TypeTable::Array(int size, ast::TypeNode* item) {
+    ArrayKey key{size, item};
+    auto it = array_types_.find(key);
+    if (it != array_types_.end()) {
+        return it->second;
+    }
+
+    auto array = arrays_.New<ast::ArrayTypeNode>(token::npos, size, item);
+    array_types_.emplace(key, array);
+    return array;
+}
+
+ast::TypeNode* TypeTable::Intern(const ast::TypeNode* type) {
+    if (type == nullptr) {
+        return Bad();
+    }
+    if (type->Type() != ast::ArrayType) {
+        return Basic(type->Type());
+    }
+
+    auto array = static_cast<const ast::ArrayTypeNode*>(type);
+    return Array(array->size_, Intern(array->item_));
+}
+
+}// namespace check
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ast/arena.h"
+#include "ast/ast.h"
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+using namespace std;
+
+namespace check {
+
+// TypeTable interns types the checker works with, each distinct type has one node:
+// int, char, void, string, the bad type, and each array shape such as int[3][3].
+// Types got from one table are equal if and only if their pointers are, and a
+// type seen before is got again without allocation. Nodes have no position, they
+// are valid until the table is destroyed. A table must be used by one thread.
+class TypeTable {
+public:
+    TypeTable() = default;
+    TypeTable(const TypeTable&) = delete;
+    TypeTable& operator=(const TypeTable&) = delete;
+
+    ast::TypeNode* Int() { return &int_; }
+    ast::TypeNode* Char() { return &char_; }
+    ast::TypeNode* Void() { return &void_; }
+    ast::TypeNode* String() { return &string_; }
+    ast::TypeNode* Bad() { return &bad_; }
+
+    // Basic returns the type of int, char, void or string tag, the bad type for other tags.
+    ast::TypeNode* Basic(ast::NodeType tag);
+
+    // Array returns the type of an array of size items, item must be got from this table.
+    ast::TypeNode* Array(int size, ast::TypeNode* item);
+
+    // Intern returns the type equal to type, e.g. a type node of a decl, nullptr is the bad type.
+    ast::TypeNode* Intern(const ast::TypeNode* type);
+private:
+    class ArrayKey {
+    public:
+        int size;
+        const ast::TypeNode* item;
+        bool operator==(const ArrayKey& other) const { return size == other.size && item == other.item; }
+    };
+
+    class ArrayKeyHash {
+    public:
+        size_t operator()(const ArrayKey& key) const {
+            return hash<const void*>()(key.item) * 31 + static_cast<uint32_t>(key.size);
+        }
+    };
+
+    ast::IntTypeNode int_;
+    ast::CharTypeNode char_;
+    ast::VoidTypeNode void_;
+    ast::StringTypeNode string_;
+    ast::BadTypeNode bad_;
+
+    // arrays_ owns array types, array_types_ finds them by shape.
+    ast::Arena arrays_;
+    unordered_map<ArrayKey, ast::ArrayTypeNode*, ArrayKeyHash> array_types_;
+};
+
+}// namespace check
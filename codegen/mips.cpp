@@ -0,0 +1,536 @@
+#include <algorithm>
+
+#include "codegen/mips.h"
+#include "codegen/regalloc.h"
+
+namespace codegen {
+
+// MIPS registers used by name, the allocatable ones are $t0-$t7 and $s0-$s7.
+enum MipsReg {
+    Zero = 0,
+    V0 = 2,
+    V1 = 3,
+    A0 = 4,
+    T0 = 8,
+    S0 = 16,
+    T8 = 24,
+    T9 = 25,
+    Sp = 29,
+    Ra = 31,
+};
+
+static const char* const mips_reg_names[32] = {
+    "$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
+    "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
+    "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
+    "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra",
+};
+
+// Scratch registers, $t8 holds a first operand or a spilled dst, $t9 a
+// second operand or an index, $v1 an address with a large offset.
+static const int Scratch1 = T8;
+static const int Scratch2 = T9;
+static const int AddrReg = V1;
+
+static bool IsInt16(long long value) {
+    return value >= -32768 && value <= 32767;
+}
+
+// EscapeAsciiz escapes text for a MARS string directive.
+static string EscapeAsciiz(const string& text) {
+    string out;
+    for (char ch : text) {
+        switch (ch) {
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            default: out += ch; break;
+        }
+    }
+    return out;
+}
+
+// MipsEmitter writes a module, functions are emitted one by one, each right
+// after its registers are allocated.
+class MipsEmitter {
+public:
+    MipsEmitter(const ir::Module& module, ostream& out) : module_(module), out_(out) {
+        for (int i = 0; i < 8; i++) {
+            regs_.caller_saved.push_back(T0 + i);
+            regs_.callee_saved.push_back(S0 + i);
+        }
+        // syscalls only touch $v0 and $a0.
+        regs_.io_clobbers = false;
+    }
+
+    void Emit() {
+        EmitData();
+
+        out_ << "\n.text\n";
+        out_ << "    jal f_" << module_.funcs[module_.main].name << "\n";
+        out_ << "    li $v0, 10\n";
+        out_ << "    syscall\n";
+
+        for (size_t i = 0; i < module_.funcs.size(); i++) {
+            EmitFunc(static_cast<int>(i));
+        }
+
+        EmitRuntime();
+    }
+private:
+    const char* R(int reg) const { return mips_reg_names[reg]; }
+
+    void EmitData() {
+        out_ << ".data\n";
+        out_ << ".align 2\n";
+        for (const auto& global : module_.globals) {
+            out_ << "g_" << global.name << ":";
+            if (global.init.empty()) {
+                out_ << " .space " << 4 * global.size << "\n";
+                continue;
+            }
+
+            for (size_t i = 0; i < global.init.size(); i++) {
+                out_ << (i % 16 == 0 ? (i == 0 ? " .word " : "\n    .word ") : ", ") << global.init[i];
+            }
+            out_ << "\n";
+        }
+
+        for (size_t i = 0; i < module_.strings.size(); i++) {
+            out_ << "s_" << i << ": .asciiz \"" << EscapeAsciiz(module_.strings[i]) << "\"\n";
+        }
+        out_ << "rt_msg_index: .asciiz \"runtime error: index out of range\\n\"\n";
+        out_ << "rt_msg_div: .asciiz \"runtime error: division by zero\\n\"\n";
+    }
+
+    void EmitRuntime() {
+        // rt_read_char skips blanks, like the vm.
+        out_ << "rt_read_char:\n";
+        out_ << "    li $v0, 12\n";
+        out_ << "    syscall\n";
+        for (int blank : {' ', '\t', '\n', '\r'}) {
+            out_ << "    li $v1, " << blank << "\n";
+            out_ << "    beq $v0, $v1, rt_read_char\n";
+        }
+        out_ << "    jr $ra\n";
+
+        out_ << "rt_index_error:\n";
+        out_ << "    la $a0, rt_msg_index\n";
+        out_ << "    j rt_fail\n";
+        out_ << "rt_div_error:\n";
+        out_ << "    la $a0, rt_msg_div\n";
+        out_ << "rt_fail:\n";
+        out_ << "    li $v0, 4\n";
+        out_ << "    syscall\n";
+        out_ << "    li $a0, 1\n";
+        out_ << "    li $v0, 17\n";
+        out_ << "    syscall\n";
+    }
+
+    // Frame, from $sp up: outgoing args, spill slots, local arrays, saved registers.
+    void LayoutFrame() {
+        int max_args = 4;
+        for (const auto& block : func_->blocks) {
+            for (const auto& instr : block.instrs) {
+                if (instr.op == ir::Opcode::Call) {
+                    max_args = max(max_args, static_cast<int>(instr.args.size()));
+                }
+            }
+        }
+
+        int offset = 4 * max_args;
+        spill_base_ = offset;
+        offset += 4 * alloc_.num_slots;
+
+        slot_offsets_.clear();
+        for (int size : func_->slots) {
+            slot_offsets_.push_back(offset);
+            offset += 4 * size;
+        }
+
+        save_base_ = offset;
+        offset += 4 * (1 + static_cast<int>(alloc_.used_callee_saved.size()));
+        frame_size_ = (offset + 7) / 8 * 8;
+    }
+
+    void EmitFunc(int index) {
+        func_ = &module_.funcs[index];
+        func_index_ = index;
+        AllocateRegisters(*func_, regs_, &alloc_);
+        LayoutFrame();
+
+        out_ << "\nf_" << func_->name << ":\n";
+        AddSp(-frame_size_);
+        Mem("sw", Ra, save_base_, Sp);
+        for (size_t i = 0; i < alloc_.used_callee_saved.size(); i++) {
+            Mem("sw", alloc_.used_callee_saved[i], save_base_ + 4 * (static_cast<int>(i) + 1), Sp);
+        }
+
+        for (size_t b = 0; b < func_->blocks.size(); b++) {
+            out_ << Label(static_cast<int>(b)) << ":\n";
+            for (const auto& instr : func_->blocks[b].instrs) {
+                EmitInstr(instr, static_cast<int>(b));
+            }
+        }
+
+        out_ << "L" << func_index_ << "_ret:\n";
+        for (size_t i = 0; i < alloc_.used_callee_saved.size(); i++) {
+            Mem("lw", alloc_.used_callee_saved[i], save_base_ + 4 * (static_cast<int>(i) + 1), Sp);
+        }
+        Mem("lw", Ra, save_base_, Sp);
+        AddSp(frame_size_);
+        out_ << "    jr $ra\n";
+    }
+
+    string Label(int block) const {
+        return "L" + to_string(func_index_) + "_" + to_string(block);
+    }
+
+    void AddSp(int delta) {
+        if (IsInt16(delta)) {
+            out_ << "    addiu $sp, $sp, " << delta << "\n";
+        } else {
+            out_ << "    li $v1, " << delta << "\n";
+            out_ << "    addu $sp, $sp, $v1\n";
+        }
+    }
+
+    // Mem emits a load or store, an offset out of 16 bits goes through AddrReg.
+    void Mem(const char* op, int reg, int offset, int base) {
+        if (IsInt16(offset)) {
+            out_ << "    " << op << " " << R(reg) << ", " << offset << "(" << R(base) << ")\n";
+            return;
+        }
+        out_ << "    li $v1, " << offset << "\n";
+        out_ << "    addu $v1, $v1, " << R(base) << "\n";
+        out_ << "    " << op << " " << R(reg) << ", 0($v1)\n";
+    }
+
+    int SpillOffset(int vreg) const {
+        return spill_base_ + 4 * alloc_.slot[vreg];
+    }
+
+    // Move loads value into reg.
+    void Move(int reg, const ir::Value& value) {
+        if (value.IsImm()) {
+            out_ << "    li " << R(reg) << ", " << value.v << "\n";
+        } else if (value.IsReg() && alloc_.reg[value.v] >= 0) {
+            if (alloc_.reg[value.v] != reg) {
+                out_ << "    move " << R(reg) << ", " << R(alloc_.reg[value.v]) << "\n";
+            }
+        } else if (value.IsReg() && alloc_.slot[value.v] >= 0) {
+            Mem("lw", reg, SpillOffset(value.v), Sp);
+        } else {
+            out_ << "    move " << R(reg) << ", $zero\n";
+        }
+    }
+
+    // Use returns a register holding value, scratch is loaded if needed.
+    int Use(const ir::Value& value, int scratch) {
+        if (value.IsImm() && value.v == 0) {
+            return Zero;
+        }
+        if (value.IsReg() && alloc_.reg[value.v] >= 0) {
+            return alloc_.reg[value.v];
+        }
+        Move(scratch, value);
+        return scratch;
+    }
+
+    // Def returns the register to write vreg to, Commit stores it if vreg is spilled.
+    int Def(int vreg) {
+        return vreg >= 0 && alloc_.reg[vreg] >= 0 ? alloc_.reg[vreg] : Scratch1;
+    }
+
+    void Commit(int vreg, int reg) {
+        if (vreg >= 0 && alloc_.slot[vreg] >= 0) {
+            Mem("sw", reg, SpillOffset(vreg), Sp);
+        }
+    }
+
+    void EmitBinary(const ir::Instr& instr) {
+        int a = Use(instr.a, Scratch1);
+        int d = Def(instr.dst);
+        const ir::Value& b = instr.b;
+
+        if (instr.op == ir::Opcode::Add && b.IsImm() && IsInt16(b.v)) {
+            out_ << "    addiu " << R(d) << ", " << R(a) << ", " << b.v << "\n";
+        } else if (instr.op == ir::Opcode::Sub && b.IsImm() && IsInt16(-static_cast<long long>(b.v))) {
+            out_ << "    addiu " << R(d) << ", " << R(a) << ", " << -b.v << "\n";
+        } else if (instr.op == ir::Opcode::Lss && b.IsImm() && IsInt16(b.v)) {
+            out_ << "    slti " << R(d) << ", " << R(a) << ", " << b.v << "\n";
+        } else {
+            int rb = Use(b, Scratch2);
+            switch (instr.op) {
+                case ir::Opcode::Add:
+                    out_ << "    addu " << R(d) << ", " << R(a) << ", " << R(rb) << "\n";
+                    break;
+                case ir::Opcode::Sub:
+                    out_ << "    subu " << R(d) << ", " << R(a) << ", " << R(rb) << "\n";
+                    break;
+                case ir::Opcode::Mul:
+                    out_ << "    mul " << R(d) << ", " << R(a) << ", " << R(rb) << "\n";
+                    break;
+                case ir::Opcode::Div:
+                    out_ << "    beq " << R(rb) << ", $zero, rt_div_error\n";
+                    out_ << "    div " << R(a) << ", " << R(rb) << "\n";
+                    out_ << "    mflo " << R(d) << "\n";
+                    break;
+                case ir::Opcode::Lss:
+                    out_ << "    slt " << R(d) << ", " << R(a) << ", " << R(rb) << "\n";
+                    break;
+                case ir::Opcode::Gre:
+                    out_ << "    slt " << R(d) << ", " << R(rb) << ", " << R(a) << "\n";
+                    break;
+                case ir::Opcode::Leq:
+                    out_ << "    slt " << R(d) << ", " << R(rb) << ", " << R(a) << "\n";
+                    out_ << "    xori " << R(d) << ", " << R(d) << ", 1\n";
+                    break;
+                case ir::Opcode::Geq:
+                    out_ << "    slt " << R(d) << ", " << R(a) << ", " << R(rb) << "\n";
+                    out_ << "    xori " << R(d) << ", " << R(d) << ", 1\n";
+                    break;
+                case ir::Opcode::Eql:
+                    out_ << "    subu " << R(d) << ", " << R(a) << ", " << R(rb) << "\n";
+                    out_ << "    sltiu " << R(d) << ", " << R(d) << ", 1\n";
+                    break;
+                case ir::Opcode::Neq:
+                    out_ << "    subu " << R(d) << ", " << R(a) << ", " << R(rb) << "\n";
+                    out_ << "    sltu " << R(d) << ", $zero, " << R(d) << "\n";
+                    break;
+                default:
+                    break;
+            }
+        }
+        Commit(instr.dst, d);
+    }
+
+    void EmitBranch(const ir::Instr& instr, int block) {
+        int a = Use(instr.a, Scratch1);
+        int b = Use(instr.b, Scratch2);
+
+        ir::Opcode cond = instr.cond;
+        int target = instr.target;
+        int other = instr.other;
+        if (target == block + 1) {
+            // fall into target, branch to other on the inverse.
+            swap(target, other);
+            switch (cond) {
+                case ir::Opcode::Lss: cond = ir::Opcode::Geq; break;
+                case ir::Opcode::Leq: cond = ir::Opcode::Gre; break;
+                case ir::Opcode::Gre: cond = ir::Opcode::Leq; break;
+                case ir::Opcode::Geq: cond = ir::Opcode::Lss; break;
+                case ir::Opcode::Eql: cond = ir::Opcode::Neq; break;
+                default: cond = ir::Opcode::Eql; break;
+            }
+        }
+
+        const char* op = "bne";
+        switch (cond) {
+            case ir::Opcode::Lss: op = "blt"; break;
+            case ir::Opcode::Leq: op = "ble"; break;
+            case ir::Opcode::Gre: op = "bgt"; break;
+            case ir::Opcode::Geq: op = "bge"; break;
+            case ir::Opcode::Eql: op = "beq"; break;
+            default: break;
+        }
+        out_ << "    " << op << " " << R(a) << ", " << R(b) << ", " << Label(target) << "\n";
+        if (other != block + 1) {
+            out_ << "    j " << Label(other) << "\n";
+        }
+    }
+
+    // SlotElem returns the offset of a slot element from base, an indexed base is Scratch2.
+    int SlotElem(const ir::Instr& instr, int* base) {
+        int offset = slot_offsets_[instr.sym];
+        if (instr.a.IsImm()) {
+            *base = Sp;
+            return offset + 4 * instr.a.v;
+        }
+
+        int index = Use(instr.a, Scratch2);
+        out_ << "    sll $t9, " << R(index) << ", 2\n";
+        out_ << "    addu $t9, $t9, $sp\n";
+        *base = Scratch2;
+        return offset;
+    }
+
+    // GlobalElem returns address operand of a global element, e.g. 'g_a+8', 'g_a($t9)'.
+    string GlobalElem(const ir::Instr& instr) {
+        string label = "g_" + module_.globals[instr.sym].name;
+        if (instr.a.IsImm()) {
+            return instr.a.v == 0 ? label : label + "+" + to_string(4 * instr.a.v);
+        }
+
+        int index = Use(instr.a, Scratch2);
+        out_ << "    sll $t9, " << R(index) << ", 2\n";
+        return label + "($t9)";
+    }
+
+    void EmitInstr(const ir::Instr& instr, int block) {
+        switch (instr.op) {
+            case ir::Opcode::Copy: {
+                int d = Def(instr.dst);
+                Move(d, instr.a);
+                Commit(instr.dst, d);
+                break;
+            }
+            case ir::Opcode::Neg: {
+                int a = Use(instr.a, Scratch1);
+                int d = Def(instr.dst);
+                out_ << "    subu " << R(d) << ", $zero, " << R(a) << "\n";
+                Commit(instr.dst, d);
+                break;
+            }
+            case ir::Opcode::Add:
+            case ir::Opcode::Sub:
+            case ir::Opcode::Mul:
+            case ir::Opcode::Div:
+            case ir::Opcode::Lss:
+            case ir::Opcode::Leq:
+            case ir::Opcode::Gre:
+            case ir::Opcode::Geq:
+            case ir::Opcode::Eql:
+            case ir::Opcode::Neq:
+                EmitBinary(instr);
+                break;
+            case ir::Opcode::Param: {
+                int d = Def(instr.dst);
+                if (instr.sym < 4) {
+                    out_ << "    move " << R(d) << ", " << R(A0 + instr.sym) << "\n";
+                } else {
+                    Mem("lw", d, frame_size_ + 4 * instr.sym, Sp);
+                }
+                Commit(instr.dst, d);
+                break;
+            }
+            case ir::Opcode::LoadGlobal: {
+                string addr = GlobalElem(instr);
+                int d = Def(instr.dst);
+                out_ << "    lw " << R(d) << ", " << addr << "\n";
+                Commit(instr.dst, d);
+                break;
+            }
+            case ir::Opcode::StoreGlobal: {
+                int value = Use(instr.b, Scratch1);
+                string addr = GlobalElem(instr);
+                out_ << "    sw " << R(value) << ", " << addr << "\n";
+                break;
+            }
+            case ir::Opcode::LoadSlot: {
+                int base;
+                int offset = SlotElem(instr, &base);
+                int d = Def(instr.dst);
+                Mem("lw", d, offset, base);
+                Commit(instr.dst, d);
+                break;
+            }
+            case ir::Opcode::StoreSlot: {
+                int value = Use(instr.b, Scratch1);
+                int base;
+                int offset = SlotElem(instr, &base);
+                Mem("sw", value, offset, base);
+                break;
+            }
+            case ir::Opcode::CheckIndex: {
+                if (instr.a.IsImm()) {
+                    if (instr.a.v < 0 || instr.a.v >= instr.b.v) {
+                        out_ << "    j rt_index_error\n";
+                    }
+                    break;
+                }
+
+                int index = Use(instr.a, Scratch1);
+                if (IsInt16(instr.b.v)) {
+                    out_ << "    sltiu $t9, " << R(index) << ", " << instr.b.v << "\n";
+                } else {
+                    out_ << "    li $t9, " << instr.b.v << "\n";
+                    out_ << "    sltu $t9, " << R(index) << ", $t9\n";
+                }
+                out_ << "    beq $t9, $zero, rt_index_error\n";
+                break;
+            }
+            case ir::Opcode::Call: {
+                for (size_t i = 0; i < instr.args.size(); i++) {
+                    if (i < 4) {
+                        Move(A0 + static_cast<int>(i), instr.args[i]);
+                    } else {
+                        Mem("sw", Use(instr.args[i], Scratch1), 4 * static_cast<int>(i), Sp);
+                    }
+                }
+                out_ << "    jal f_" << module_.funcs[instr.sym].name << "\n";
+                if (instr.dst >= 0) {
+                    int d = Def(instr.dst);
+                    out_ << "    move " << R(d) << ", $v0\n";
+                    Commit(instr.dst, d);
+                }
+                break;
+            }
+            case ir::Opcode::Read: {
+                if (instr.is_char) {
+                    out_ << "    jal rt_read_char\n";
+                } else {
+                    out_ << "    li $v0, 5\n";
+                    out_ << "    syscall\n";
+                }
+                int d = Def(instr.dst);
+                out_ << "    move " << R(d) << ", $v0\n";
+                Commit(instr.dst, d);
+                break;
+            }
+            case ir::Opcode::Print:
+                Move(A0, instr.a);
+                out_ << "    li $v0, " << (instr.is_char ? 11 : 1) << "\n";
+                out_ << "    syscall\n";
+                break;
+            case ir::Opcode::PrintStr:
+                out_ << "    la $a0, s_" << instr.sym << "\n";
+                out_ << "    li $v0, 4\n";
+                out_ << "    syscall\n";
+                break;
+            case ir::Opcode::PrintLine:
+                out_ << "    li $a0, 10\n";
+                out_ << "    li $v0, 11\n";
+                out_ << "    syscall\n";
+                break;
+            case ir::Opcode::Jump:
+                if (instr.target != block + 1) {
+                    out_ << "    j " << Label(instr.target) << "\n";
+                }
+                break;
+            case ir::Opcode::Branch:
+                EmitBranch(instr, block);
+                break;
+            case ir::Opcode::Return:
+                if (!instr.a.IsNone()) {
+                    Move(V0, instr.a);
+                }
+                if (block + 1 != static_cast<int>(func_->blocks.size())) {
+                    out_ << "    j L" << func_index_ << "_ret\n";
+                }
+                break;
+            case ir::Opcode::Phi:
+                // functions are out of ssa form before codegen.
+                break;
+        }
+    }
+
+    const ir::Module& module_;
+    ostream& out_;
+    RegisterSet regs_;
+
+    const ir::Function* func_ = nullptr;
+    int func_index_ = 0;
+    Allocation alloc_;
+    int frame_size_ = 0;
+    int spill_base_ = 0;
+    int save_base_ = 0;
+    vector<int> slot_offsets_;
+};
+
+void EmitMips(const ir::Module& module, ostream& out) {
+    MipsEmitter(module, out).Emit();
+}
+
+}// namespace codegen
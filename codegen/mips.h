@@ -0,0 +1,21 @@
+#pragma once
+
+#include <ostream>
+
+#include "ir/ir.h"
+
+using namespace std;
+
+namespace codegen {
+
+/**
+ * @brief EmitMips writes module as MIPS assembly for MARS, io goes through syscalls.
+ * Functions are 'f_<name>', globals 'g_<name>' and strings 's_<n>', so no
+ * name of the program can clash with a mnemonic or a label of the emitter.
+ *
+ * @param module ir of the program.
+ * @param out assembly.
+ */
+void EmitMips(const ir::Module& module, ostream& out);
+
+}// namespace codegen
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+#include "codegen/regalloc.h"
+#include "ir/bitset.h"
+
+namespace codegen {
+
+// Interval is the live range of a vreg over linear positions. Instruction k
+// reads its operands at 2k and writes its dst at 2k + 1.
+struct Interval {
+    int vreg;
+    int start;
+    int end;
+    bool crosses_call;
+};
+
+using ir::BitSet;
+
+static bool IsCall(const ir::Instr& instr, bool io_clobbers) {
+    switch (instr.op) {
+        case ir::Opcode::Call:
+            return true;
+        case ir::Opcode::Read:
+        case ir::Opcode::Print:
+        case ir::Opcode::PrintStr:
+        case ir::Opcode::PrintLine:
+            return io_clobbers;
+        default:
+            return false;
+    }
+}
+
+// BuildIntervals computes a single conservative interval per vreg from the
+// live sets of blocks, holes in a range are not tracked.
+static void BuildIntervals(const ir::Function& func, const RegisterSet& regs, vector<Interval>* intervals) {
+    int num_blocks = static_cast<int>(func.blocks.size());
+    int n = func.num_vregs;
+
+    vector<BitSet> use(num_blocks, BitSet(n)), def(num_blocks, BitSet(n));
+    vector<BitSet> live_in(num_blocks, BitSet(n)), live_out(num_blocks, BitSet(n));
+    vector<int> block_start(num_blocks), block_end(num_blocks);
+
+    vector<int> regs_used;
+    int pos = 0;
+    for (int b = 0; b < num_blocks; b++) {
+        block_start[b] = pos;
+        for (const auto& instr : func.blocks[b].instrs) {
+            regs_used.clear();
+            ir::Uses(instr, &regs_used);
+            for (int reg : regs_used) {
+                if (!def[b].Has(reg)) {
+                    use[b].Add(reg);
+                }
+            }
+            if (instr.dst >= 0) {
+                def[b].Add(instr.dst);
+            }
+            pos += 2;
+        }
+        block_end[b] = pos - 1;
+    }
+
+    // backward data flow, blocks are mostly in forward order so walk them reversed.
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int b = num_blocks - 1; b >= 0; b--) {
+            const auto& instrs = func.blocks[b].instrs;
+            int succ[2];
+            int num_succ = instrs.empty() ? 0 : ir::Successors(instrs.back(), succ);
+            for (int i = 0; i < num_succ; i++) {
+                changed |= live_out[b].Union(live_in[succ[i]]);
+            }
+            changed |= live_in[b].Union(use[b]);
+            changed |= live_in[b].UnionMinus(live_out[b], def[b]);
+        }
+    }
+
+    vector<int> start(n, INT_MAX), end(n, -1);
+    auto extend = [&](int reg, int p) {
+        start[reg] = min(start[reg], p);
+        end[reg] = max(end[reg], p);
+    };
+
+    vector<int> calls;
+    pos = 0;
+    for (int b = 0; b < num_blocks; b++) {
+        live_in[b].ForEach([&](int reg) { extend(reg, block_start[b]); });
+        live_out[b].ForEach([&](int reg) { extend(reg, block_end[b]); });
+
+        for (const auto& instr : func.blocks[b].instrs) {
+            regs_used.clear();
+            ir::Uses(instr, &regs_used);
+            for (int reg : regs_used) {
+                extend(reg, pos);
+            }
+            if (instr.dst >= 0) {
+                extend(instr.dst, pos + 1);
+            }
+            if (IsCall(instr, regs.io_clobbers)) {
+                calls.push_back(pos);
+            }
+            pos += 2;
+        }
+    }
+
+    for (int reg = 0; reg < n; reg++) {
+        if (end[reg] < 0) {
+            continue;
+        }
+
+        // an interval crosses a call if it is live both before and after it.
+        auto it = upper_bound(calls.begin(), calls.end(), start[reg]);
+        bool crosses_call = it != calls.end() && *it + 1 < end[reg];
+        intervals->push_back(Interval{reg, start[reg], end[reg], crosses_call});
+    }
+}
+
+void AllocateRegisters(const ir::Function& func, const RegisterSet& regs, Allocation* alloc) {
+    alloc->reg.assign(func.num_vregs, -1);
+    alloc->slot.assign(func.num_vregs, -1);
+    alloc->num_slots = 0;
+    alloc->used_callee_saved.clear();
+
+    vector<Interval> intervals;
+    BuildIntervals(func, regs, &intervals);
+    sort(intervals.begin(), intervals.end(), [](const Interval& x, const Interval& y) {
+        return x.start != y.start ? x.start < y.start : x.vreg < y.vreg;
+    });
+
+    int max_reg = 0;
+    for (int reg : regs.caller_saved) {
+        max_reg = max(max_reg, reg + 1);
+    }
+    for (int reg : regs.callee_saved) {
+        max_reg = max(max_reg, reg + 1);
+    }
+    vector<bool> busy(max_reg, false), callee_saved(max_reg, false), used(max_reg, false);
+    for (int reg : regs.callee_saved) {
+        callee_saved[reg] = true;
+    }
+
+    auto spill = [&](int vreg) {
+        alloc->reg[vreg] = -1;
+        alloc->slot[vreg] = alloc->num_slots++;
+    };
+
+    // active intervals hold a register, sorted by end.
+    vector<const Interval*> active;
+    for (const auto& cur : intervals) {
+        size_t kept = 0;
+        for (auto interval : active) {
+            if (interval->end < cur.start) {
+                busy[alloc->reg[interval->vreg]] = false;
+            } else {
+                active[kept++] = interval;
+            }
+        }
+        active.resize(kept);
+
+        int pick = -1;
+        if (!cur.crosses_call) {
+            for (int reg : regs.caller_saved) {
+                if (!busy[reg]) {
+                    pick = reg;
+                    break;
+                }
+            }
+        }
+        if (pick < 0) {
+            for (int reg : regs.callee_saved) {
+                if (!busy[reg]) {
+                    pick = reg;
+                    break;
+                }
+            }
+        }
+
+        if (pick < 0) {
+            // take the register of the active interval which ends last, if it ends after cur.
+            const Interval* victim = nullptr;
+            for (auto it = active.rbegin(); it != active.rend(); ++it) {
+                if (!cur.crosses_call || callee_saved[alloc->reg[(*it)->vreg]]) {
+                    victim = *it;
+                    break;
+                }
+            }
+
+            if (victim == nullptr || victim->end <= cur.end) {
+                spill(cur.vreg);
+                continue;
+            }
+
+            pick = alloc->reg[victim->vreg];
+            spill(victim->vreg);
+            active.erase(find(active.begin(), active.end(), victim));
+        }
+
+        alloc->reg[cur.vreg] = pick;
+        busy[pick] = true;
+        used[pick] = true;
+        auto pos = upper_bound(active.begin(), active.end(), &cur, [](const Interval* x, const Interval* y) {
+            return x->end < y->end;
+        });
+        active.insert(pos, &cur);
+    }
+
+    for (int reg : regs.callee_saved) {
+        if (used[reg]) {
+            alloc->used_callee_saved.push_back(reg);
+        }
+    }
+}
+
+}// namespace codegen
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include "ir/ir.h"
+
+using namespace std;
+
+namespace codegen {
+
+// RegisterSet is the allocatable registers of a target, in target numbering.
+// Registers the target keeps for itself, e.g. scratch or argument ones, are
+// left out.
+class RegisterSet {
+public:
+    // caller_saved registers are clobbered by calls.
+    vector<int> caller_saved;
+    // callee_saved registers survive calls, the prologue saves those used.
+    vector<int> callee_saved;
+    // io_clobbers is set if reads and prints are calls on the target.
+    bool io_clobbers = false;
+};
+
+// Allocation maps virtual registers of a function to registers or spill slots.
+class Allocation {
+public:
+    // reg[vreg] is the assigned register, -1 if spilled or never live.
+    vector<int> reg;
+    // slot[vreg] is the spill slot, -1 if not spilled.
+    vector<int> slot;
+    int num_slots = 0;
+    // used_callee_saved are callee saved registers assigned to any vreg, in set order.
+    vector<int> used_callee_saved;
+};
+
+/**
+ * @brief AllocateRegisters assigns registers to vregs of func by linear scan over live intervals.
+ * A vreg live across a call only gets a callee saved register, the other vregs prefer caller
+ * saved ones. When registers run out the interval ending last is spilled.
+ *
+ * @param func function to allocate.
+ * @param regs allocatable registers of the target.
+ * @param alloc result.
+ */
+void AllocateRegisters(const ir::Function& func, const RegisterSet& regs, Allocation* alloc);
+
+}// namespace codegen
@@ -0,0 +1,755 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "codegen/x86.h"
+#include "codegen/regalloc.h"
+
+namespace codegen {
+
+// X86Reg numbers registers as the instruction encoding does.
+enum X86Reg {
+    Rax = 0,
+    Rcx = 1,
+    Rdx = 2,
+    Rbx = 3,
+    Rsp = 4,
+    Rbp = 5,
+    Rsi = 6,
+    Rdi = 7,
+    R8 = 8,
+    R9 = 9,
+    R10 = 10,
+    R11 = 11,
+    R12 = 12,
+    R13 = 13,
+    R14 = 14,
+    R15 = 15,
+};
+
+static const char* const x86_reg32_names[16] = {
+    "%eax", "%ecx", "%edx", "%ebx", "%esp", "%ebp", "%esi", "%edi",
+    "%r8d", "%r9d", "%r10d", "%r11d", "%r12d", "%r13d", "%r14d", "%r15d",
+};
+
+static const char* const x86_reg64_names[16] = {
+    "%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+    "%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "%r15",
+};
+
+// RuntimeBufferSize is the size of the input and the output buffer of the runtime.
+static const int RuntimeBufferSize = 1 << 16;
+
+// Scratch registers, %r10d holds a first operand or a spilled dst, %r11 an
+// index, %rax an address, %eax and %edx are taken by idiv.
+static const int Scratch1 = R10;
+static const int IndexReg = R11;
+
+// EscapeString escapes text for a GNU as string directive.
+static string EscapeString(const string& text) {
+    string out;
+    for (char ch : text) {
+        unsigned char uch = static_cast<unsigned char>(ch);
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (uch < 0x20 || uch >= 0x7f) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\%03o", uch);
+            out += buf;
+        } else {
+            out += ch;
+        }
+    }
+    return out;
+}
+
+static const char* JumpName(ir::Opcode cond) {
+    switch (cond) {
+        case ir::Opcode::Lss: return "jl";
+        case ir::Opcode::Leq: return "jle";
+        case ir::Opcode::Gre: return "jg";
+        case ir::Opcode::Geq: return "jge";
+        case ir::Opcode::Eql: return "je";
+        default: return "jne";
+    }
+}
+
+static const char* SetName(ir::Opcode cond) {
+    switch (cond) {
+        case ir::Opcode::Lss: return "setl";
+        case ir::Opcode::Leq: return "setle";
+        case ir::Opcode::Gre: return "setg";
+        case ir::Opcode::Geq: return "setge";
+        case ir::Opcode::Eql: return "sete";
+        default: return "setne";
+    }
+}
+
+static ir::Opcode Inverse(ir::Opcode cond) {
+    switch (cond) {
+        case ir::Opcode::Lss: return ir::Opcode::Geq;
+        case ir::Opcode::Leq: return ir::Opcode::Gre;
+        case ir::Opcode::Gre: return ir::Opcode::Leq;
+        case ir::Opcode::Geq: return ir::Opcode::Lss;
+        case ir::Opcode::Eql: return ir::Opcode::Neq;
+        default: return ir::Opcode::Eql;
+    }
+}
+
+// X86Emitter writes a module, functions are emitted one by one, each right
+// after its registers are allocated.
+class X86Emitter {
+public:
+    X86Emitter(const ir::Module& module, ostream& out) : module_(module), out_(out) {
+        regs_.caller_saved = {Rcx, Rsi, Rdi, R8, R9};
+        regs_.callee_saved = {Rbx, R12, R13, R14, R15};
+        // io goes through libc calls.
+        regs_.io_clobbers = true;
+    }
+
+    void Emit() {
+        EmitData();
+
+        out_ << "\n    .text\n";
+        out_ << "    .globl main\n";
+        out_ << "main:\n";
+        out_ << "    pushq %rbp\n";
+        out_ << "    movq %rsp, %rbp\n";
+        out_ << "    call f_" << module_.funcs[module_.main].name << "\n";
+        out_ << "    call rt_flush\n";
+        out_ << "    xorl %eax, %eax\n";
+        out_ << "    popq %rbp\n";
+        out_ << "    ret\n";
+
+        for (size_t i = 0; i < module_.funcs.size(); i++) {
+            EmitFunc(static_cast<int>(i));
+        }
+
+        EmitRuntime();
+        out_ << "    .section .note.GNU-stack,\"\",@progbits\n";
+    }
+private:
+    const char* R(int reg) const { return x86_reg32_names[reg]; }
+    const char* Q(int reg) const { return x86_reg64_names[reg]; }
+
+    void EmitData() {
+        out_ << "    .data\n";
+        out_ << "    .align 4\n";
+        for (const auto& global : module_.globals) {
+            out_ << "g_" << global.name << ":\n";
+            if (global.init.empty()) {
+                out_ << "    .zero " << 4 * global.size << "\n";
+                continue;
+            }
+
+            for (size_t i = 0; i < global.init.size(); i++) {
+                out_ << (i % 16 == 0 ? (i == 0 ? "    .long " : "\n    .long ") : ", ") << global.init[i];
+            }
+            out_ << "\n";
+        }
+
+        out_ << "\n    .section .rodata\n";
+        for (size_t i = 0; i < module_.strings.size(); i++) {
+            out_ << "s_" << i << ":\n";
+            out_ << "    .string \"" << EscapeString(module_.strings[i]) << "\"\n";
+        }
+        out_ << "rt_msg_index:\n    .string \"runtime error: index out of range\\n\"\n";
+        out_ << "rt_msg_div:\n    .string \"runtime error: division by zero\\n\"\n";
+
+        // io buffers of the runtime, rt_in_failed is set once a read failed.
+        out_ << "\n    .bss\n";
+        out_ << "    .align 16\n";
+        out_ << "rt_out_buf:\n    .zero " << RuntimeBufferSize << "\n";
+        out_ << "rt_in_buf:\n    .zero " << RuntimeBufferSize << "\n";
+        out_ << "rt_out_len:\n    .zero 4\n";
+        out_ << "rt_in_pos:\n    .zero 4\n";
+        out_ << "rt_in_end:\n    .zero 4\n";
+        out_ << "rt_in_failed:\n    .zero 4\n";
+    }
+
+    // EmitRuntime writes the io and error helpers, they are entered with an
+    // aligned stack and realign it for libc with a push. Output is buffered and
+    // written only when the buffer fills and at exit, input is read by blocks and
+    // ints are scanned and formatted by hand, as the runtime of the vm does.
+    void EmitRuntime() {
+        const string size = to_string(RuntimeBufferSize);
+
+        // rt_flush writes the buffered output, what write refuses is dropped.
+        out_ << "\nrt_flush:\n";
+        out_ << "    pushq %rbx\n";
+        out_ << "    xorl %ebx, %ebx\n";
+        out_ << "1:\n";
+        out_ << "    movl rt_out_len(%rip), %edx\n";
+        out_ << "    subl %ebx, %edx\n";
+        out_ << "    jle 2f\n";
+        out_ << "    leaq rt_out_buf(%rip), %rsi\n";
+        out_ << "    addq %rbx, %rsi\n";
+        out_ << "    movl $1, %edi\n";
+        out_ << "    call write@PLT\n";
+        out_ << "    testq %rax, %rax\n";
+        out_ << "    jle 2f\n";
+        out_ << "    addl %eax, %ebx\n";
+        out_ << "    jmp 1b\n";
+        out_ << "2:\n";
+        out_ << "    movl $0, rt_out_len(%rip)\n";
+        out_ << "    popq %rbx\n";
+        out_ << "    ret\n";
+
+        out_ << "rt_print_char:\n";
+        out_ << "    movl rt_out_len(%rip), %eax\n";
+        out_ << "    cmpl $" << size << ", %eax\n";
+        out_ << "    jb 1f\n";
+        out_ << "    pushq %rdi\n";
+        out_ << "    call rt_flush\n";
+        out_ << "    popq %rdi\n";
+        out_ << "    xorl %eax, %eax\n";
+        out_ << "1:\n";
+        out_ << "    leaq rt_out_buf(%rip), %rcx\n";
+        out_ << "    movb %dil, (%rcx,%rax)\n";
+        out_ << "    incl %eax\n";
+        out_ << "    movl %eax, rt_out_len(%rip)\n";
+        out_ << "    ret\n";
+
+        out_ << "rt_print_str:\n";
+        out_ << "    pushq %rbx\n";
+        out_ << "    movq %rdi, %rbx\n";
+        out_ << "1:\n";
+        out_ << "    movzbl (%rbx), %edi\n";
+        out_ << "    testl %edi, %edi\n";
+        out_ << "    je 2f\n";
+        out_ << "    call rt_print_char\n";
+        out_ << "    incq %rbx\n";
+        out_ << "    jmp 1b\n";
+        out_ << "2:\n";
+        out_ << "    popq %rbx\n";
+        out_ << "    ret\n";
+
+        // digits are made backwards in the red zone, then copied after at most a flush.
+        out_ << "rt_print_int:\n";
+        out_ << "    movl rt_out_len(%rip), %eax\n";
+        out_ << "    cmpl $" << RuntimeBufferSize - 12 << ", %eax\n";
+        out_ << "    jbe 1f\n";
+        out_ << "    pushq %rdi\n";
+        out_ << "    call rt_flush\n";
+        out_ << "    popq %rdi\n";
+        out_ << "1:\n";
+        out_ << "    movl %edi, %eax\n";
+        out_ << "    testl %eax, %eax\n";
+        out_ << "    jns 2f\n";
+        out_ << "    negl %eax\n";
+        out_ << "2:\n";
+        out_ << "    movq %rsp, %rsi\n";
+        out_ << "    movl $10, %ecx\n";
+        out_ << "3:\n";
+        out_ << "    xorl %edx, %edx\n";
+        out_ << "    divl %ecx\n";
+        out_ << "    addl $48, %edx\n";
+        out_ << "    decq %rsi\n";
+        out_ << "    movb %dl, (%rsi)\n";
+        out_ << "    testl %eax, %eax\n";
+        out_ << "    jne 3b\n";
+        out_ << "    testl %edi, %edi\n";
+        out_ << "    jns 4f\n";
+        out_ << "    decq %rsi\n";
+        out_ << "    movb $45, (%rsi)\n";
+        out_ << "4:\n";
+        out_ << "    movl rt_out_len(%rip), %eax\n";
+        out_ << "    leaq rt_out_buf(%rip), %rcx\n";
+        out_ << "5:\n";
+        out_ << "    movb (%rsi), %dl\n";
+        out_ << "    movb %dl, (%rcx,%rax)\n";
+        out_ << "    incl %eax\n";
+        out_ << "    incq %rsi\n";
+        out_ << "    cmpq %rsp, %rsi\n";
+        out_ << "    jb 5b\n";
+        out_ << "    movl %eax, rt_out_len(%rip)\n";
+        out_ << "    ret\n";
+
+        // rt_getc returns the next input byte, -1 at the end of input.
+        out_ << "rt_getc:\n";
+        out_ << "    movl rt_in_pos(%rip), %eax\n";
+        out_ << "    cmpl rt_in_end(%rip), %eax\n";
+        out_ << "    jb 1f\n";
+        out_ << "    pushq %rbp\n";
+        out_ << "    xorl %edi, %edi\n";
+        out_ << "    leaq rt_in_buf(%rip), %rsi\n";
+        out_ << "    movl $" << size << ", %edx\n";
+        out_ << "    call read@PLT\n";
+        out_ << "    popq %rbp\n";
+        out_ << "    movl $0, rt_in_pos(%rip)\n";
+        out_ << "    movl $0, rt_in_end(%rip)\n";
+        out_ << "    testq %rax, %rax\n";
+        out_ << "    jle 2f\n";
+        out_ << "    movl %eax, rt_in_end(%rip)\n";
+        out_ << "    xorl %eax, %eax\n";
+        out_ << "1:\n";
+        out_ << "    leaq rt_in_buf(%rip), %rcx\n";
+        out_ << "    movzbl (%rcx,%rax), %ecx\n";
+        out_ << "    incl %eax\n";
+        out_ << "    movl %eax, rt_in_pos(%rip)\n";
+        out_ << "    movl %ecx, %eax\n";
+        out_ << "    ret\n";
+        out_ << "2:\n";
+        out_ << "    movl $-1, %eax\n";
+        out_ << "    ret\n";
+
+        // rt_skip_blanks returns the next input byte which isn't blank, as isspace.
+        out_ << "rt_skip_blanks:\n";
+        out_ << "    pushq %rbp\n";
+        out_ << "1:\n";
+        out_ << "    call rt_getc\n";
+        out_ << "    cmpl $32, %eax\n";
+        out_ << "    je 1b\n";
+        out_ << "    leal -9(%rax), %ecx\n";
+        out_ << "    cmpl $4, %ecx\n";
+        out_ << "    jbe 1b\n";
+        out_ << "    popq %rbp\n";
+        out_ << "    ret\n";
+
+        // reads leave 0 once a scan failed, like the vm, an int must fit in 64 bits
+        // and is wrapped to 32. %rbx is the magnitude, %r12 is 1 for a negative int.
+        out_ << "rt_read_int:\n";
+        out_ << "    pushq %rbx\n";
+        out_ << "    pushq %r12\n";
+        out_ << "    subq $8, %rsp\n";
+        out_ << "    cmpl $0, rt_in_failed(%rip)\n";
+        out_ << "    jne 9f\n";
+        out_ << "    call rt_skip_blanks\n";
+        out_ << "    xorl %r12d, %r12d\n";
+        out_ << "    cmpl $45, %eax\n";
+        out_ << "    jne 1f\n";
+        out_ << "    movl $1, %r12d\n";
+        out_ << "    call rt_getc\n";
+        out_ << "    jmp 2f\n";
+        out_ << "1:\n";
+        out_ << "    cmpl $43, %eax\n";
+        out_ << "    jne 2f\n";
+        out_ << "    call rt_getc\n";
+        out_ << "2:\n";
+        out_ << "    leal -48(%rax), %ecx\n";
+        out_ << "    cmpl $9, %ecx\n";
+        out_ << "    ja 9f\n";
+        out_ << "    xorl %ebx, %ebx\n";
+        out_ << "3:\n";
+        out_ << "    leal -48(%rax), %ecx\n";
+        out_ << "    cmpl $9, %ecx\n";
+        out_ << "    ja 4f\n";
+        out_ << "    movabsq $922337203685477580, %rdx\n";
+        out_ << "    cmpq %rdx, %rbx\n";
+        out_ << "    ja 9f\n";
+        out_ << "    imulq $10, %rbx\n";
+        out_ << "    addq %rcx, %rbx\n";
+        out_ << "    movabsq $9223372036854775807, %rdx\n";
+        out_ << "    addq %r12, %rdx\n";
+        out_ << "    cmpq %rdx, %rbx\n";
+        out_ << "    ja 9f\n";
+        out_ << "    call rt_getc\n";
+        out_ << "    jmp 3b\n";
+        out_ << "4:\n";
+        // the byte after the int is left for the next read.
+        out_ << "    cmpl $-1, %eax\n";
+        out_ << "    je 5f\n";
+        out_ << "    decl rt_in_pos(%rip)\n";
+        out_ << "5:\n";
+        out_ << "    movl %ebx, %eax\n";
+        out_ << "    testl %r12d, %r12d\n";
+        out_ << "    je 6f\n";
+        out_ << "    negl %eax\n";
+        out_ << "6:\n";
+        out_ << "    addq $8, %rsp\n";
+        out_ << "    popq %r12\n";
+        out_ << "    popq %rbx\n";
+        out_ << "    ret\n";
+        out_ << "9:\n";
+        out_ << "    movl $1, rt_in_failed(%rip)\n";
+        out_ << "    xorl %eax, %eax\n";
+        out_ << "    jmp 6b\n";
+
+        out_ << "rt_read_char:\n";
+        out_ << "    pushq %rbp\n";
+        out_ << "    cmpl $0, rt_in_failed(%rip)\n";
+        out_ << "    jne 1f\n";
+        out_ << "    call rt_skip_blanks\n";
+        out_ << "    cmpl $-1, %eax\n";
+        out_ << "    je 1f\n";
+        out_ << "    popq %rbp\n";
+        out_ << "    ret\n";
+        out_ << "1:\n";
+        out_ << "    movl $1, rt_in_failed(%rip)\n";
+        out_ << "    xorl %eax, %eax\n";
+        out_ << "    popq %rbp\n";
+        out_ << "    ret\n";
+
+        // output before the error is flushed first, as the vm does.
+        out_ << "rt_index_error:\n";
+        out_ << "    leaq rt_msg_index(%rip), %rdi\n";
+        out_ << "    jmp rt_fail\n";
+        out_ << "rt_div_error:\n";
+        out_ << "    leaq rt_msg_div(%rip), %rdi\n";
+        out_ << "rt_fail:\n";
+        out_ << "    andq $-16, %rsp\n";
+        out_ << "    movq %rdi, %rbx\n";
+        out_ << "    call rt_flush\n";
+        out_ << "    movq stderr@GOTPCREL(%rip), %rax\n";
+        out_ << "    movq (%rax), %rsi\n";
+        out_ << "    movq %rbx, %rdi\n";
+        out_ << "    call fputs@PLT\n";
+        out_ << "    movl $1, %edi\n";
+        out_ << "    call exit@PLT\n";
+    }
+
+    // Frame, from %rbp down: saved registers, spill slots, local arrays, and
+    // outgoing args at the bottom. Params are above the return address.
+    void LayoutFrame() {
+        int max_args = 0;
+        for (const auto& block : func_->blocks) {
+            for (const auto& instr : block.instrs) {
+                if (instr.op == ir::Opcode::Call) {
+                    max_args = max(max_args, static_cast<int>(instr.args.size()));
+                }
+            }
+        }
+
+        int offset = 8 * static_cast<int>(alloc_.used_callee_saved.size());
+        spill_base_ = offset;
+        offset += 4 * alloc_.num_slots;
+
+        slot_offsets_.clear();
+        for (int size : func_->slots) {
+            offset += 4 * size;
+            slot_offsets_.push_back(-offset);
+        }
+
+        offset += 8 * max_args;
+        frame_size_ = (offset + 15) / 16 * 16;
+    }
+
+    void EmitFunc(int index) {
+        func_ = &module_.funcs[index];
+        func_index_ = index;
+        AllocateRegisters(*func_, regs_, &alloc_);
+        LayoutFrame();
+
+        out_ << "\nf_" << func_->name << ":\n";
+        out_ << "    pushq %rbp\n";
+        out_ << "    movq %rsp, %rbp\n";
+        if (frame_size_ > 0) {
+            out_ << "    subq $" << frame_size_ << ", %rsp\n";
+        }
+        for (size_t i = 0; i < alloc_.used_callee_saved.size(); i++) {
+            out_ << "    movq " << Q(alloc_.used_callee_saved[i]) << ", " << -8 * (static_cast<int>(i) + 1) << "(%rbp)\n";
+        }
+
+        for (size_t b = 0; b < func_->blocks.size(); b++) {
+            out_ << Label(static_cast<int>(b)) << ":\n";
+            for (const auto& instr : func_->blocks[b].instrs) {
+                EmitInstr(instr, static_cast<int>(b));
+            }
+        }
+
+        out_ << ".L" << func_index_ << "_ret:\n";
+        for (size_t i = 0; i < alloc_.used_callee_saved.size(); i++) {
+            out_ << "    movq " << -8 * (static_cast<int>(i) + 1) << "(%rbp), " << Q(alloc_.used_callee_saved[i]) << "\n";
+        }
+        out_ << "    leave\n";
+        out_ << "    ret\n";
+    }
+
+    string Label(int block) const {
+        return ".L" + to_string(func_index_) + "_" + to_string(block);
+    }
+
+    string NewLabel() {
+        return ".L" + to_string(func_index_) + "_l" + to_string(num_labels_++);
+    }
+
+    // Operand returns value as an instruction operand, a spilled vreg is a memory one.
+    string Operand(const ir::Value& value) const {
+        if (value.IsImm()) {
+            return "$" + to_string(value.v);
+        }
+        if (value.IsReg() && alloc_.reg[value.v] >= 0) {
+            return R(alloc_.reg[value.v]);
+        }
+        if (value.IsReg() && alloc_.slot[value.v] >= 0) {
+            return to_string(-spill_base_ - 4 * (alloc_.slot[value.v] + 1)) + "(%rbp)";
+        }
+        return "$0";
+    }
+
+    bool InReg(const ir::Value& value, int reg) const {
+        return value.IsReg() && alloc_.reg[value.v] == reg;
+    }
+
+    // Move loads value into reg.
+    void Move(int reg, const ir::Value& value) {
+        if (!InReg(value, reg)) {
+            out_ << "    movl " << Operand(value) << ", " << R(reg) << "\n";
+        }
+    }
+
+    // Load returns a register holding value, scratch is loaded if needed.
+    int Load(const ir::Value& value, int scratch) {
+        if (value.IsReg() && alloc_.reg[value.v] >= 0) {
+            return alloc_.reg[value.v];
+        }
+        Move(scratch, value);
+        return scratch;
+    }
+
+    // Def returns the register to write vreg to, Commit stores it if vreg is spilled.
+    int Def(int vreg) {
+        return vreg >= 0 && alloc_.reg[vreg] >= 0 ? alloc_.reg[vreg] : Scratch1;
+    }
+
+    void Commit(int vreg, int reg) {
+        if (vreg >= 0 && alloc_.slot[vreg] >= 0) {
+            out_ << "    movl " << R(reg) << ", " << Operand(ir::Value::Vreg(vreg)) << "\n";
+        }
+    }
+
+    void EmitArith(const ir::Instr& instr, const char* op, bool commutative) {
+        int d = Def(instr.dst);
+        ir::Value a = instr.a;
+        ir::Value b = instr.b;
+        if (InReg(b, d) && commutative) {
+            swap(a, b);
+        }
+
+        // d can't hold a before b is read, compute in the scratch then.
+        int t = InReg(b, d) ? Scratch1 : d;
+        Move(t, a);
+        out_ << "    " << op << " " << Operand(b) << ", " << R(t) << "\n";
+        if (t != d) {
+            out_ << "    movl " << R(t) << ", " << R(d) << "\n";
+        }
+        Commit(instr.dst, d);
+    }
+
+    // EmitDiv divides with idiv, a zero divisor fails and -1 negates, so that
+    // INT_MIN / -1 wraps instead of trapping.
+    void EmitDiv(const ir::Instr& instr) {
+        Move(Rax, instr.a);
+        Move(IndexReg, instr.b);
+        string slow = NewLabel();
+        string done = NewLabel();
+        out_ << "    testl %r11d, %r11d\n";
+        out_ << "    je rt_div_error\n";
+        out_ << "    cmpl $-1, %r11d\n";
+        out_ << "    jne " << slow << "\n";
+        out_ << "    negl %eax\n";
+        out_ << "    jmp " << done << "\n";
+        out_ << slow << ":\n";
+        out_ << "    cltd\n";
+        out_ << "    idivl %r11d\n";
+        out_ << done << ":\n";
+
+        int d = Def(instr.dst);
+        out_ << "    movl %eax, " << R(d) << "\n";
+        Commit(instr.dst, d);
+    }
+
+    void EmitCompare(const ir::Instr& instr) {
+        int a = Load(instr.a, Scratch1);
+        out_ << "    cmpl " << Operand(instr.b) << ", " << R(a) << "\n";
+        out_ << "    " << SetName(instr.op) << " %al\n";
+        int d = Def(instr.dst);
+        out_ << "    movzbl %al, " << R(d) << "\n";
+        Commit(instr.dst, d);
+    }
+
+    void EmitBranch(const ir::Instr& instr, int block) {
+        int a = Load(instr.a, Scratch1);
+        if (instr.b.IsImm() && instr.b.v == 0) {
+            out_ << "    testl " << R(a) << ", " << R(a) << "\n";
+        } else {
+            out_ << "    cmpl " << Operand(instr.b) << ", " << R(a) << "\n";
+        }
+
+        ir::Opcode cond = instr.cond;
+        int target = instr.target;
+        int other = instr.other;
+        if (target == block + 1) {
+            // fall into target, jump to other on the inverse.
+            swap(target, other);
+            cond = Inverse(cond);
+        }
+
+        out_ << "    " << JumpName(cond) << " " << Label(target) << "\n";
+        if (other != block + 1) {
+            out_ << "    jmp " << Label(other) << "\n";
+        }
+    }
+
+    // SlotElem returns the address operand of a slot element.
+    string SlotElem(const ir::Instr& instr) {
+        int offset = slot_offsets_[instr.sym];
+        if (instr.a.IsImm()) {
+            return to_string(offset + 4 * instr.a.v) + "(%rbp)";
+        }
+
+        out_ << "    movslq " << Operand(instr.a) << ", %r11\n";
+        return to_string(offset) + "(%rbp,%r11,4)";
+    }
+
+    // GlobalElem returns the address operand of a global element, %rax is its base if indexed.
+    string GlobalElem(const ir::Instr& instr) {
+        string label = "g_" + module_.globals[instr.sym].name;
+        if (instr.a.IsImm()) {
+            return (instr.a.v == 0 ? label : label + "+" + to_string(4 * instr.a.v)) + "(%rip)";
+        }
+
+        out_ << "    movslq " << Operand(instr.a) << ", %r11\n";
+        out_ << "    leaq " << label << "(%rip), %rax\n";
+        return "(%rax,%r11,4)";
+    }
+
+    // Store writes value to the memory operand addr, through the scratch unless it is a register or an immediate.
+    void Store(const ir::Value& value, const string& addr) {
+        string src = value.IsImm() ? Operand(value) : R(Load(value, Scratch1));
+        out_ << "    movl " << src << ", " << addr << "\n";
+    }
+
+    void EmitInstr(const ir::Instr& instr, int block) {
+        switch (instr.op) {
+            case ir::Opcode::Copy: {
+                int d = Def(instr.dst);
+                Move(d, instr.a);
+                Commit(instr.dst, d);
+                break;
+            }
+            case ir::Opcode::Neg: {
+                int d = Def(instr.dst);
+                Move(d, instr.a);
+                out_ << "    negl " << R(d) << "\n";
+                Commit(instr.dst, d);
+                break;
+            }
+            case ir::Opcode::Add:
+                EmitArith(instr, "addl", true);
+                break;
+            case ir::Opcode::Sub:
+                EmitArith(instr, "subl", false);
+                break;
+            case ir::Opcode::Mul:
+                EmitArith(instr, "imull", true);
+                break;
+            case ir::Opcode::Div:
+                EmitDiv(instr);
+                break;
+            case ir::Opcode::Lss:
+            case ir::Opcode::Leq:
+            case ir::Opcode::Gre:
+            case ir::Opcode::Geq:
+            case ir::Opcode::Eql:
+            case ir::Opcode::Neq:
+                EmitCompare(instr);
+                break;
+            case ir::Opcode::Param: {
+                int d = Def(instr.dst);
+                out_ << "    movl " << 16 + 8 * instr.sym << "(%rbp), " << R(d) << "\n";
+                Commit(instr.dst, d);
+                break;
+            }
+            case ir::Opcode::LoadGlobal: {
+                string addr = GlobalElem(instr);
+                int d = Def(instr.dst);
+                out_ << "    movl " << addr << ", " << R(d) << "\n";
+                Commit(instr.dst, d);
+                break;
+            }
+            case ir::Opcode::StoreGlobal:
+                Store(instr.b, GlobalElem(instr));
+                break;
+            case ir::Opcode::LoadSlot: {
+                string addr = SlotElem(instr);
+                int d = Def(instr.dst);
+                out_ << "    movl " << addr << ", " << R(d) << "\n";
+                Commit(instr.dst, d);
+                break;
+            }
+            case ir::Opcode::StoreSlot:
+                Store(instr.b, SlotElem(instr));
+                break;
+            case ir::Opcode::CheckIndex:
+                if (instr.a.IsImm()) {
+                    if (instr.a.v < 0 || instr.a.v >= instr.b.v) {
+                        out_ << "    jmp rt_index_error\n";
+                    }
+                    break;
+                }
+                // unsigned compare catches negative indexes too.
+                out_ << "    cmpl $" << instr.b.v << ", " << Operand(instr.a) << "\n";
+                out_ << "    jae rt_index_error\n";
+                break;
+            case ir::Opcode::Call: {
+                for (size_t i = 0; i < instr.args.size(); i++) {
+                    Store(instr.args[i], to_string(8 * i) + "(%rsp)");
+                }
+                out_ << "    call f_" << module_.funcs[instr.sym].name << "\n";
+                if (instr.dst >= 0) {
+                    int d = Def(instr.dst);
+                    out_ << "    movl %eax, " << R(d) << "\n";
+                    Commit(instr.dst, d);
+                }
+                break;
+            }
+            case ir::Opcode::Read: {
+                out_ << "    call " << (instr.is_char ? "rt_read_char" : "rt_read_int") << "\n";
+                int d = Def(instr.dst);
+                out_ << "    movl %eax, " << R(d) << "\n";
+                Commit(instr.dst, d);
+                break;
+            }
+            case ir::Opcode::Print:
+                Move(Rdi, instr.a);
+                out_ << "    call " << (instr.is_char ? "rt_print_char" : "rt_print_int") << "\n";
+                break;
+            case ir::Opcode::PrintStr:
+                out_ << "    leaq s_" << instr.sym << "(%rip), %rdi\n";
+                out_ << "    call rt_print_str\n";
+                break;
+            case ir::Opcode::PrintLine:
+                out_ << "    movl $10, %edi\n";
+                out_ << "    call rt_print_char\n";
+                break;
+            case ir::Opcode::Jump:
+                if (instr.target != block + 1) {
+                    out_ << "    jmp " << Label(instr.target) << "\n";
+                }
+                break;
+            case ir::Opcode::Branch:
+                EmitBranch(instr, block);
+                break;
+            case ir::Opcode::Return:
+                if (!instr.a.IsNone()) {
+                    Move(Rax, instr.a);
+                }
+                if (block + 1 != static_cast<int>(func_->blocks.size())) {
+                    out_ << "    jmp .L" << func_index_ << "_ret\n";
+                }
+                break;
+            case ir::Opcode::Phi:
+                // functions are out of ssa form before codegen.
+                break;
+        }
+    }
+
+    const ir::Module& module_;
+    ostream& out_;
+    RegisterSet regs_;
+
+    const ir::Function* func_ = nullptr;
+    int func_index_ = 0;
+    int num_labels_ = 0;
+    Allocation alloc_;
+    int frame_size_ = 0;
+    int spill_base_ = 0;
+    vector<int> slot_offsets_;
+};
+
+void EmitX86(const ir::Module& module, ostream& out) {
+    X86Emitter(module, out).Emit();
+}
+
+}// namespace codegen
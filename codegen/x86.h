@@ -0,0 +1,20 @@
+#pragma once
+
+#include <ostream>
+
+#include "ir/ir.h"
+
+using namespace std;
+
+namespace codegen {
+
+/**
+ * @brief EmitX86 writes module as x86-64 assembly in AT&T syntax for the GNU assembler,
+ * to be linked with libc, e.g. 'gcc out.s'. io calls printf and scanf, names follow EmitMips.
+ *
+ * @param module ir of the program.
+ * @param out assembly.
+ */
+void EmitX86(const ir::Module& module, ostream& out);
+
+}// namespace codegen
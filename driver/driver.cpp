@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "driver/driver.h"
+#include "check/check.h"
+#include "input/source_buffer.h"
+#include "parser/parser.h"
+#include "scanner/scanner.h"
+
+namespace driver {
+
+// ReminderErrorHandler adds scan errors to the error reminder of the file.
+class ReminderErrorHandler: public ErrorHandler {
+public:
+    explicit ReminderErrorHandler(const shared_ptr<ec::ErrorReminder>& errors) : errors_(errors) {}
+    ~ReminderErrorHandler() override = default;
+    void Report(const token::Position& pos, const string& msg) override {
+        errors_->Emplace(pos, ec::NotInHomeWork, msg);
+    }
+private:
+    shared_ptr<ec::ErrorReminder> errors_;
+};
+
+// CollectDir appends regular files under dir to files, in name order.
+static void CollectDir(const string& dir, vector<string>* files) {
+    DIR* d = opendir(dir.c_str());
+    if (d == nullptr) {
+        files->push_back(dir);
+        return;
+    }
+
+    vector<string> names;
+    while (struct dirent* entry = readdir(d)) {
+        if (entry->d_name[0] != '.') {
+            names.emplace_back(entry->d_name);
+        }
+    }
+    closedir(d);
+
+    sort(names.begin(), names.end());
+    for (const auto& name : names) {
+        string path = dir + "/" + name;
+        struct stat st{};
+        if (stat(path.c_str(), &st) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            CollectDir(path, files);
+        } else if (S_ISREG(st.st_mode)) {
+            files->push_back(path);
+        }
+    }
+}
+
+void CollectSources(const vector<string>& paths, vector<string>* files) {
+    for (const auto& path : paths) {
+        struct stat st{};
+        if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            CollectDir(path, files);
+        } else {
+            files->push_back(path);
+        }
+    }
+}
+
+FileResult CompileFile(const string& filename, const cache::Cache* cache) {
+    FileResult result;
+    result.filename = filename;
+
+    shared_ptr<input::SourceBuffer> src;
+    if (input::SourceBuffer::Open(filename, &src) != 0) {
+        result.ok = false;
+        result.errors.emplace_back(token::npos, ec::NotInHomeWork, "input file not found!");
+        return result;
+    }
+
+    cache::Key key;
+    if (cache != nullptr) {
+        key = cache::HashSource(src->data(), static_cast<size_t>(src->size()));
+        cache::Artifact artifact;
+        if (cache->Load(key, filename, &artifact) == 0) {
+            result.ok = artifact.ok;
+            result.errors = move(artifact.errors);
+            return result;
+        }
+    }
+
+    auto file = make_shared<token::File>();
+    file->name = filename;
+    file->size = src->size();
+
+    // nothing is written on add, errors are merged after all files are done.
+    auto errors = make_shared<ec::ErrorReminder>(false, cerr);
+    auto err_handler = make_shared<ReminderErrorHandler>(errors);
+
+    // all syntax errors of a file are reported, not only the first one.
+    Parser parser(file, src, err_handler, errors);
+    parser.SetRecover(true);
+
+    shared_ptr<ast::FileNode> ast_file = parser.Parse();
+    if (parser.ErrorCount() != 0) {
+        result.ok = false;
+    }
+
+    // an ast with skipped tokens would give checking errors of code which isn't there.
+    if (!parser.Partial()) {
+        check::Checker checker(ast_file, errors);
+        checker.Check();
+    }
+    if (!result.ok) {
+        ast_file = nullptr;
+    }
+
+    errors->Collect(&result.errors);
+
+    if (cache != nullptr) {
+        cache->Store(key, result.ok, result.errors, ast_file.get());
+    }
+
+    return result;
+}
+
+vector<FileResult> CompileFiles(const vector<string>& files, int jobs, const cache::Cache* cache) {
+    vector<FileResult> results(files.size());
+    if (jobs <= 0) {
+        jobs = max(1, static_cast<int>(thread::hardware_concurrency()));
+    }
+    jobs = min(jobs, max(1, static_cast<int>(files.size())));
+
+    // each task owns its file and writes only its own slot of results.
+    atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < files.size(); i = next.fetch_add(1)) {
+            results[i] = CompileFile(files[i], cache);
+        }
+    };
+
+    vector<thread> pool;
+    for (int i = 1; i < jobs; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : pool) {
+        t.join();
+    }
+
+    return results;
+}
+
+int WriteResults(const vector<FileResult>& results, ostream& out) {
+    int failed = 0;
+    for (const auto& result : results) {
+        for (const auto& error : result.errors) {
+            out << result.filename << ": " << error.ToString() << "\n";
+        }
+
+        if (!result.ok || !result.errors.empty()) {
+            failed++;
+        }
+    }
+    out.flush();
+
+    return failed;
+}
+
+int DriverMain(int argc, char** argv) {
+    int jobs = 0;
+    vector<string> paths;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else if (arg.size() > 2 && arg.compare(0, 2, "-j") == 0) {
+            jobs = atoi(arg.c_str() + 2);
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    if (paths.empty()) {
+        cerr << "usage: " << argv[0] << " [-j jobs] <file|dir>..." << endl;
+        return EXIT_FAILURE;
+    }
+
+    vector<string> files;
+    CollectSources(paths, &files);
+
+    auto cache = cache::Cache::FromEnv();
+    int failed = WriteResults(CompileFiles(files, jobs, cache.get()), cout);
+    cerr << files.size() << " files, " << failed << " with errors" << endl;
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}// namespace driver
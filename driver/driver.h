@@ -0,0 +1,69 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "cache/cache.h"
+#include "error.h"
+
+using namespace std;
+
+namespace driver {
+
+// FileResult is the outcome of compiling one source file.
+class FileResult {
+public:
+    string filename;
+    // ok is false if the file can't be read or has parse errors.
+    bool ok = true;
+    // errors found in the file, sorted by position, npos errors last.
+    vector<ec::Error> errors;
+};
+
+/**
+ * @brief CollectSources expands paths into source files, directories are walked
+ * recursively and their regular files are taken in name order, hidden entries are skipped.
+ * Other paths are taken as files, unreadable ones are reported when compiled.
+ *
+ * @param paths files or directories.
+ * @param files collected files, in the order of paths.
+ */
+void CollectSources(const vector<string>& paths, vector<string>* files);
+
+/**
+ * @brief CompileFile scan, parse and check a single file.
+ * It touches no shared mutable state, so it can run on any thread.
+ *
+ * @param cache results are looked up in and stored to cache, nullptr for no cache.
+ */
+FileResult CompileFile(const string& filename, const cache::Cache* cache = nullptr);
+
+/**
+ * @brief CompileFiles compile files on a pool of jobs threads, one file per task.
+ *
+ * @param files source files.
+ * @param jobs thread count, 0 for hardware concurrency.
+ * @param cache results are looked up in and stored to cache, nullptr for no cache.
+ * @return results in the order of files, independent of scheduling.
+ */
+vector<FileResult> CompileFiles(const vector<string>& files, int jobs, const cache::Cache* cache = nullptr);
+
+/**
+ * @brief WriteResults writes errors of all results to out, file by file, one error per line.
+ * e.g. 'dir/a.txt: [b] => (3, 1) :: for funcdecl, func name already defined'
+ *
+ * @return count of files which are not ok or have errors.
+ */
+int WriteResults(const vector<FileResult>& results, ostream& out);
+
+/**
+ * @brief DriverMain is main function for compiling many files.
+ * usage: simple_lang [-j jobs] <file|dir>...
+ * Results are cached in the directory named by SIMPLE_LANG_CACHE, if it is set.
+ *
+ * @return process exit code, 0 if all files are clean.
+ */
+int DriverMain(int argc, char** argv);
+
+}// namespace driver
@@ -1,6 +1,9 @@
 #pragma once
 
-#include <map>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
 #include <iostream>
 
 #include "token/position.h"
@@ -41,7 +44,13 @@ enum Type {
     SwitchTypeError,
     // default case should be the last one.
     DefaultExpected,
+    // expression type not matched, e.g. int a = 'c'.
+    ExprTypeNotMatched,
     NotInHomeWork,
+    // warning, a constant index is out of range of its array dimension, e.g. a[3] of int a[3].
+    IndexOutOfBounds,
+    // type_end is the count of types, new types are added before it.
+    type_end,
 };
 
 class Error {
@@ -65,37 +74,161 @@ public:
     string msg_;
 };
 
-// ErrorReminder is a reminder of error.
+// ErrorReminder collects errors in memory and writes them at once.
+// Errors at a position are keyed by the file and offset, the last one added
+// wins, npos errors are kept in the order they are added. File names are kept
+// once per file, not once per error.
 class ErrorReminder {
 public:
     ErrorReminder() = default;
-    ErrorReminder(bool report_on_add_, ostream& out) : report_on_add_(report_on_add_), out_(out) {}
-    string ToString() const {
-        string result;
-        for (const auto& error : errors_) {
-            result += error.second.ToString() + "\n";
+    /**
+     * @param report errors are written to out by Flush, which runs on destruction too.
+     * @param one_per_line only the first error of each source line is written.
+     */
+    ErrorReminder(bool report, ostream& out, bool one_per_line = false)
+        : report_(report), one_per_line_(one_per_line), out_(&out) {}
+    ErrorReminder(const ErrorReminder&) = delete;
+    ErrorReminder& operator=(const ErrorReminder&) = delete;
+    ~ErrorReminder() {
+        if (!flushed_) {
+            Flush();
         }
-        return result;
     }
+
+    // Add adds err, which is at pos.
     void Add(const token::Position& pos, const Error& err) {
         if (pos.offset == token::npos.offset) {
             npos_errors_.push_back(err);
+            flushed_ = false;
+            return;
+        }
+        Emplace(pos, err.type_, err.msg_);
+    }
+    void Emplace(const token::Position& pos, const Type& typ, const string& msg) {
+        if (pos.offset == token::npos.offset) {
+            npos_errors_.emplace_back(pos, typ, msg);
         } else {
-            errors_[pos] = err;
+            entries_.push_back(Entry{Key(pos), pos.line, pos.column, typ, msg});
+            sorted_ = false;
         }
+        flushed_ = false;
+    }
 
-        if (report_on_add_) {
-            out_ << err.ToString() << std::endl;
+    // Empty reports whether no error is added.
+    bool Empty() const { return entries_.empty() && npos_errors_.empty(); }
+
+    // Size returns count of errors, errors at the same position count once.
+    size_t Size() const { return Sorted().size() + npos_errors_.size(); }
+
+    /**
+     * @brief Collect appends errors to errors, sorted by position, npos errors last.
+     */
+    void Collect(vector<Error>* errors) const {
+        for (const auto& entry : Sorted()) {
+            errors->push_back(ErrorOf(entry));
         }
+        errors->insert(errors->end(), npos_errors_.begin(), npos_errors_.end());
     }
-    void Emplace(const token::Position& pos, const Type& typ, const string& msg) {
-        Add(pos, Error(pos, typ, msg));
+
+    // ToString returns errors at a position, one per line.
+    string ToString() const {
+        string result;
+        for (const auto& entry : Sorted()) {
+            result += ErrorOf(entry).ToString() + "\n";
+        }
+        return result;
     }
 
-public:
-    std::map<token::Position, Error> errors_;
-    std::vector<Error> npos_errors_;
-    bool report_on_add_ = false;
-    ostream& out_;
+    /**
+     * @brief Flush writes all errors to out with a single write if report is set,
+     * errors at a position first.
+     */
+    void Flush() {
+        flushed_ = true;
+        if (!report_ || out_ == nullptr || Empty()) {
+            return;
+        }
+
+        string text;
+        int last_file = -1, last_line = 0;
+        for (const auto& entry : Sorted()) {
+            int file = static_cast<int>(entry.key >> 32);
+            if (one_per_line_ && file == last_file && entry.line == last_line) {
+                continue;
+            }
+            last_file = file;
+            last_line = entry.line;
+            text += ErrorOf(entry).ToString();
+            text += '\n';
+        }
+        for (const auto& err : npos_errors_) {
+            text += err.ToString();
+            text += '\n';
+        }
+        out_->write(text.data(), static_cast<streamsize>(text.size()));
+        out_->flush();
+    }
+private:
+    // Entry is an error at a position, key is file id << 32 | offset, the file name
+    // is files_[file id].
+    struct Entry {
+        uint64_t key;
+        int line;
+        int column;
+        Type type;
+        string msg;
+    };
+
+    // ErrorOf rebuilds the error of entry.
+    Error ErrorOf(const Entry& entry) const {
+        token::Position pos{files_[entry.key >> 32], static_cast<int>(static_cast<uint32_t>(entry.key)),
+                            entry.line, entry.column};
+        return Error(pos, entry.type, entry.msg);
+    }
+
+    // Key returns the key of pos, files are numbered in the order they are seen.
+    uint64_t Key(const token::Position& pos) {
+        if (files_.empty() || files_[last_file_] != pos.filename) {
+            last_file_ = 0;
+            while (last_file_ < files_.size() && files_[last_file_] != pos.filename) {
+                last_file_++;
+            }
+            if (last_file_ == files_.size()) {
+                files_.push_back(pos.filename);
+            }
+        }
+        return static_cast<uint64_t>(last_file_) << 32 | static_cast<uint32_t>(pos.offset);
+    }
+
+    // Sorted sorts entries by key, keeping the last added of equal keys.
+    const vector<Entry>& Sorted() const {
+        if (!sorted_) {
+            stable_sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+            size_t n = 0;
+            for (size_t i = 0; i < entries_.size(); i++) {
+                if (i + 1 < entries_.size() && entries_[i + 1].key == entries_[i].key) {
+                    continue;
+                }
+                if (n != i) {
+                    entries_[n] = move(entries_[i]);
+                }
+                n++;
+            }
+            entries_.resize(n);
+            sorted_ = true;
+        }
+        return entries_;
+    }
+
+    mutable vector<Entry> entries_;
+    mutable bool sorted_ = true;
+    vector<Error> npos_errors_;
+    vector<string> files_;
+    size_t last_file_ = 0;
+
+    bool report_ = false;
+    bool one_per_line_ = false;
+    bool flushed_ = true;
+    ostream* out_ = nullptr;
 };
 }
\ No newline at end of file
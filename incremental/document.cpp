@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+#include "ast/shift.h"
+#include "check/check.h"
+#include "incremental/document.h"
+#include "parser/parser.h"
+#include "scanner/scanner.h"
+
+namespace incremental {
+
+// kMaxArenaGrowth bounds bytes of replaced decls kept in the arena, relative to a full parse.
+const static size_t kMaxArenaGrowth = 4;
+
+// ReminderErrorHandler adds scan errors to the error reminder of the document.
+class ReminderErrorHandler: public ErrorHandler {
+public:
+    explicit ReminderErrorHandler(const shared_ptr<ec::ErrorReminder>& errors) : errors_(errors) {}
+    ~ReminderErrorHandler() override = default;
+    void Report(const token::Position& pos, const string& msg) override {
+        errors_->Emplace(pos, ec::NotInHomeWork, msg);
+    }
+private:
+    shared_ptr<ec::ErrorReminder> errors_;
+};
+
+static bool SameType(const ast::TypeNode* a, const ast::TypeNode* b) {
+    if (a == nullptr || b == nullptr || a->Type() != b->Type()) {
+        return a == b;
+    }
+    if (a->Type() != ast::ArrayType) {
+        return true;
+    }
+
+    auto x = static_cast<const ast::ArrayTypeNode*>(a);
+    auto y = static_cast<const ast::ArrayTypeNode*>(b);
+    return x->size_ == y->size_ && SameType(x->item_, y->item_);
+}
+
+// SameGlobal reports whether a and b look the same to decls which use them.
+static bool SameGlobal(const VarTable::Global& a, const VarTable::Global& b) {
+    if (a.symbol != b.symbol || (a.func == nullptr) != (b.func == nullptr)) {
+        return false;
+    }
+    if (a.func == nullptr) {
+        return a.is_const == b.is_const && SameType(a.type, b.type);
+    }
+
+    if (!SameType(a.func->type_, b.func->type_) || (a.func->params_ == nullptr) != (b.func->params_ == nullptr)) {
+        return false;
+    }
+    if (a.func->params_ == nullptr) {
+        return true;
+    }
+
+    const auto& x = a.func->params_->fields_;
+    const auto& y = b.func->params_->fields_;
+    if (x.size() != y.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < x.size(); i++) {
+        if (!SameType(x[i]->type_, y[i]->type_)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// MarkChanged marks symbols of a and b in changed, unless a and b define the same globals.
+static void MarkChanged(const vector<VarTable::Global>& a, const vector<VarTable::Global>& b, vector<bool>* changed) {
+    if (a.size() == b.size() && equal(a.begin(), a.end(), b.begin(), SameGlobal)) {
+        return;
+    }
+
+    for (const auto* globals : {&a, &b}) {
+        for (const auto& global : *globals) {
+            if (global.symbol >= static_cast<int>(changed->size())) {
+                changed->resize(global.symbol + 1, false);
+            }
+            (*changed)[global.symbol] = true;
+        }
+    }
+}
+
+static bool UsesChanged(const vector<int>& used, const vector<bool>& changed) {
+    for (int symbol : used) {
+        if (symbol < static_cast<int>(changed.size()) && changed[symbol]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void ShiftPos(int offset, int lines, token::Position* pos) {
+    if (pos->offset != token::npos.offset) {
+        pos->offset += offset;
+        pos->line += lines;
+    }
+}
+
+static void CollectErrors(const ec::ErrorReminder& reminder, vector<ec::Error>* errors) {
+    reminder.Collect(errors);
+}
+
+Document::Document(const string& filename) : filename_(filename) {
+    Load();
+}
+
+void Document::Open(string text) {
+    text_ = move(text);
+    Load();
+    ParseAll();
+}
+
+void Document::Load() {
+    src_ = input::SourceBuffer::FromString(text_);
+    file_ = make_shared<token::File>();
+    file_->name = filename_;
+    file_->size = src_->size();
+
+    // all lines are known before parsing, so parsing may start anywhere.
+    vector<int> lines;
+    const char* data = src_->data();
+    for (const char* p = data; (p = static_cast<const char*>(memchr(p, '\n', data + src_->size() - p))) != nullptr; p++) {
+        lines.push_back(static_cast<int>(p - data) + 1);
+    }
+    file_->AddLines(lines.data(), static_cast<int>(lines.size()));
+}
+
+void Document::ParseAll() {
+    ast_ = make_shared<ast::FileNode>();
+    units_.clear();
+    parse_errors_.clear();
+
+    auto errors = make_shared<ec::ErrorReminder>(false, cerr);
+    Parser parser(file_, src_, make_shared<ReminderErrorHandler>(errors), errors);
+    parser.SetThrowOnError(true);
+    try {
+        while (!parser.AtEnd()) {
+            Unit unit;
+            unit.start = parser.Offset();
+            ast_->decl_.push_back(parser.ParseNextDecl(ast_.get()));
+            units_.push_back(unit);
+        }
+    } catch (const ParserError&) {
+        CollectErrors(*errors, &parse_errors_);
+        ast_ = nullptr;
+        units_.clear();
+        reparsed_ = rechecked_ = 0;
+        return;
+    }
+
+    vector<ec::Error> scanned;
+    CollectErrors(*errors, &scanned);
+    AddScanErrors(scanned, INT_MAX);
+
+    full_bytes_ = ast_->arena_.BytesUsed();
+    reparsed_ = static_cast<int>(units_.size());
+    vector<bool> changed;
+    CheckUnits(0, reparsed_, vector<VarTable::Global>(), &changed);
+}
+
+int Document::Update(const Edit& edit) {
+    int size = static_cast<int>(text_.size());
+    if (edit.offset < 0 || edit.length < 0 || edit.offset > size || edit.length > size - edit.offset) {
+        return -1;
+    }
+
+    int begin = edit.offset;
+    int end = edit.offset + edit.length;
+    bool from_scratch = ast_ == nullptr || ast_->arena_.BytesUsed() > kMaxArenaGrowth * full_bytes_;
+
+    // decls from first on are parsed again, until one resyncs with a kept decl. Decls on the
+    // line where the edit ends can't be kept, their columns move.
+    int n = static_cast<int>(units_.size());
+    int first = 0, kept = n;
+    if (!from_scratch) {
+        while (first + 1 < n && units_[first + 1].start <= begin) {
+            first++;
+        }
+        int end_line = file_->GetPositionByOffset(end).line;
+        kept = first;
+        while (kept < n && (units_[kept].start <= end || file_->GetPositionByOffset(units_[kept].start).line == end_line)) {
+            kept++;
+        }
+    }
+
+    int delta = static_cast<int>(edit.text.size()) - edit.length;
+    int delta_lines = static_cast<int>(count(edit.text.begin(), edit.text.end(), '\n') -
+        count(text_.begin() + begin, text_.begin() + end, '\n'));
+    text_.replace(static_cast<size_t>(begin), static_cast<size_t>(edit.length), edit.text);
+    Load();
+    if (from_scratch) {
+        ParseAll();
+        return 0;
+    }
+
+    auto errors = make_shared<ec::ErrorReminder>(false, cerr);
+    Parser parser(file_, src_, make_shared<ReminderErrorHandler>(errors), errors);
+    parser.SetThrowOnError(true);
+    parser.Reset(first > 0 ? units_[first].start : 0);
+
+    vector<ast::DeclNode*> decls;
+    vector<Unit> units;
+    bool synced = false;
+    try {
+        while (!parser.AtEnd()) {
+            int offset = parser.Offset();
+            while (kept < n && units_[kept].start + delta < offset) {
+                kept++;
+            }
+            if (kept < n && units_[kept].start + delta == offset) {
+                synced = true;
+                break;
+            }
+
+            Unit unit;
+            unit.start = offset;
+            decls.push_back(parser.ParseNextDecl(ast_.get()));
+            units.push_back(unit);
+        }
+    } catch (const ParserError&) {
+        // as in a full parse, the decls before the failed one are scanned too.
+        parse_errors_.clear();
+        for (int i = 0; i < first; i++) {
+            parse_errors_.insert(parse_errors_.end(), units_[i].scan_errors.begin(), units_[i].scan_errors.end());
+        }
+        CollectErrors(*errors, &parse_errors_);
+        ast_ = nullptr;
+        units_.clear();
+        reparsed_ = rechecked_ = 0;
+        return 0;
+    }
+    if (!synced) {
+        kept = n;
+    }
+
+    // columns of kept decls are kept, they never start on the line of the edit.
+    for (int i = kept; i < n; i++) {
+        if (delta != 0 || delta_lines != 0) {
+            ast::ShiftPos(ast_->decl_[i], delta, delta_lines);
+            for (auto* errors : {&units_[i].errors, &units_[i].scan_errors}) {
+                for (auto& error : *errors) {
+                    ShiftPos(delta, delta_lines, &error.pos_);
+                }
+            }
+        }
+        units_[i].start += delta;
+    }
+
+    vector<VarTable::Global> removed;
+    for (int i = first; i < kept; i++) {
+        removed.insert(removed.end(), units_[i].defined.begin(), units_[i].defined.end());
+    }
+    ast_->decl_.erase(ast_->decl_.begin() + first, ast_->decl_.begin() + kept);
+    ast_->decl_.insert(ast_->decl_.begin() + first, decls.begin(), decls.end());
+    units_.erase(units_.begin() + first, units_.begin() + kept);
+    units_.insert(units_.begin() + first, units.begin(), units.end());
+
+    reparsed_ = static_cast<int>(decls.size());
+    vector<ec::Error> scanned;
+    CollectErrors(*errors, &scanned);
+    AddScanErrors(scanned, first + reparsed_ < static_cast<int>(units_.size()) ? units_[first + reparsed_].start : INT_MAX);
+
+    vector<bool> changed;
+    CheckUnits(first, reparsed_, removed, &changed);
+    return 0;
+}
+
+void Document::AddScanErrors(const vector<ec::Error>& errors, int end) {
+    if (units_.empty()) {
+        return;
+    }
+
+    for (const auto& error : errors) {
+        int offset = error.pos_.offset;
+        if (offset >= end) {
+            break;
+        }
+        // an error is in the text of the last unit starting at or before it.
+        auto it = upper_bound(units_.begin(), units_.end(), offset, [](int offset, const Unit& unit) {
+            return offset < unit.start;
+        });
+        (it == units_.begin() ? *it : *(it - 1)).scan_errors.push_back(error);
+    }
+}
+
+void Document::CheckUnits(int first, int count, const vector<VarTable::Global>& removed, vector<bool>* changed) {
+    check::Checker checker(ast_, make_shared<ec::ErrorReminder>(false, cerr));
+    vector<VarTable::Global> added;
+    bool stopped = false;
+    rechecked_ = 0;
+
+    for (int i = 0; i < static_cast<int>(units_.size()); i++) {
+        if (i == first + count) {
+            MarkChanged(removed, added, changed);
+        }
+
+        Unit& unit = units_[i];
+        if (stopped) {
+            Unit unchecked;
+            unchecked.start = unit.start;
+            unchecked.scan_errors = move(unit.scan_errors);
+            unit = move(unchecked);
+            continue;
+        }
+        if (unit.checked && !UsesChanged(unit.used, *changed)) {
+            checker.Declare(unit.defined);
+            stopped = unit.stops;
+            continue;
+        }
+
+        auto reminder = make_shared<ec::ErrorReminder>(false, cerr);
+        checker.SetErrorReminder(reminder);
+        VarTable::Journal journal;
+        unit.stops = checker.CheckDecl(ast_->decl_[i], &journal) != 0;
+
+        if (i >= first && i < first + count) {
+            added.insert(added.end(), journal.defined.begin(), journal.defined.end());
+        } else {
+            MarkChanged(unit.defined, journal.defined, changed);
+        }
+        unit.defined = move(journal.defined);
+        sort(journal.used.begin(), journal.used.end());
+        journal.used.erase(unique(journal.used.begin(), journal.used.end()), journal.used.end());
+        unit.used = move(journal.used);
+        unit.errors.clear();
+        CollectErrors(*reminder, &unit.errors);
+        unit.checked = true;
+        stopped = unit.stops;
+        rechecked_++;
+    }
+}
+
+void Document::Errors(vector<ec::Error>* errors) const {
+    errors->clear();
+    if (ast_ == nullptr) {
+        *errors = parse_errors_;
+        return;
+    }
+
+    for (const auto& unit : units_) {
+        // scan errors are merged by offset, a check error at the same offset wins as in a reminder.
+        const auto& scanned = unit.scan_errors;
+        size_t i = 0;
+        for (const auto& error : unit.errors) {
+            if (error.pos_.offset == token::npos.offset) {
+                continue;
+            }
+            for (; i < scanned.size() && scanned[i].pos_.offset <= error.pos_.offset; i++) {
+                if (scanned[i].pos_.offset < error.pos_.offset) {
+                    errors->push_back(scanned[i]);
+                }
+            }
+            errors->push_back(error);
+        }
+        errors->insert(errors->end(), scanned.begin() + i, scanned.end());
+    }
+    for (const auto& unit : units_) {
+        for (const auto& error : unit.errors) {
+            if (error.pos_.offset == token::npos.offset) {
+                errors->push_back(error);
+            }
+        }
+    }
+}
+
+}// namespace incremental
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast/ast.h"
+#include "error.h"
+#include "input/source_buffer.h"
+#include "parser/var_table.h"
+#include "token/position.h"
+
+using namespace std;
+
+namespace incremental {
+
+// Edit replaces length bytes of the text from offset by text.
+class Edit {
+public:
+    int offset = 0;
+    int length = 0;
+    string text;
+};
+
+/**
+ * @brief Document is a source file which is kept parsed and checked while it is edited.
+ * Top level decls are independent units: an edit re-parses the decls it touches until
+ * the parser meets the start of an old decl again, the decls after it are kept and
+ * moved. New decls are checked again, and so are old decls which look up a name whose
+ * global definition changed, e.g. callers of a function whose params are edited.
+ * Results are the same as scanning, parsing and checking the whole text.
+ */
+class Document {
+public:
+    explicit Document(const string& filename);
+
+    /**
+     * @brief Open replaces the whole text, which is parsed and checked from scratch.
+     */
+    void Open(string text);
+
+    /**
+     * @brief Update applies edit to the text and parses and checks it again.
+     *
+     * @return 0, or -1 if edit is out of the text, which is kept then.
+     */
+    int Update(const Edit& edit);
+
+    const string& Text() const { return text_; }
+
+    // Ok reports whether the text parses, no ast is kept if not.
+    bool Ok() const { return ast_ != nullptr; }
+
+    // File returns the ast of the text, nullptr if it doesn't parse.
+    const shared_ptr<ast::FileNode>& File() const { return ast_; }
+
+    /**
+     * @brief Errors returns errors of the text sorted by position, npos errors last.
+     * If the text doesn't parse, only the errors found until the parse failed are returned,
+     * the scan errors and the parse error.
+     */
+    void Errors(vector<ec::Error>* errors) const;
+
+    // Reparsed returns count of decls parsed by the last Open or Update.
+    int Reparsed() const { return reparsed_; }
+
+    // Rechecked returns count of decls checked by the last Open or Update.
+    int Rechecked() const { return rechecked_; }
+private:
+    // Unit is a top level decl and the results of checking it.
+    class Unit {
+    public:
+        // start is offset of the first token of the decl.
+        int start = 0;
+        // checked is false if decl must be checked again.
+        bool checked = false;
+        // stops is true if decl stops the check of the decls after it.
+        bool stops = false;
+        vector<ec::Error> errors;
+        // scan_errors are errors the scanner found in the text of decl, sorted, they are
+        // kept until decl is parsed again.
+        vector<ec::Error> scan_errors;
+        // defined are globals decl adds, used the names it looks up, sorted.
+        vector<VarTable::Global> defined;
+        vector<int> used;
+    };
+
+    /**
+     * @brief Load makes the source buffer and line table of text_.
+     */
+    void Load();
+
+    /**
+     * @brief ParseAll parses text_ from scratch.
+     */
+    void ParseAll();
+
+    /**
+     * @brief AddScanErrors adds errors found by scanning to the units whose text they are in.
+     *
+     * @param errors sorted by offset.
+     * @param end offset of the first kept unit after the parsed ones, errors from there on
+     * were found when the parser met it again, it has them already.
+     */
+    void AddScanErrors(const vector<ec::Error>& errors, int end);
+
+    /**
+     * @brief CheckUnits checks units which are not checked, or look up names in changed.
+     * Units from first to first + count are new, they replaced units which defined removed.
+     *
+     * @param changed symbols whose global definition changed, grown while checking.
+     */
+    void CheckUnits(int first, int count, const vector<VarTable::Global>& removed, vector<bool>* changed);
+
+    string filename_;
+    string text_;
+    shared_ptr<input::SourceBuffer> src_;
+    shared_ptr<token::File> file_;
+
+    shared_ptr<ast::FileNode> ast_;
+    // units_[i] is the unit of ast_->decl_[i].
+    vector<Unit> units_;
+    // parse_errors_ are errors of the last parse which failed.
+    vector<ec::Error> parse_errors_;
+
+    // full_bytes_ is size of the arena after the last full parse, replaced decls
+    // stay in the arena, so the text is parsed from scratch once it grows too much.
+    size_t full_bytes_ = 0;
+
+    int reparsed_ = 0;
+    int rechecked_ = 0;
+};
+
+}// namespace incremental
@@ -0,0 +1,114 @@
+#include "input/source_buffer.h"
+#include "prof/prof.h"
+
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace input {
+
+// kReadChunkSize is the size of each read for sources which can't be mapped.
+const static size_t kReadChunkSize = 64 * 1024;
+
+SourceBuffer::~SourceBuffer() {
+    if (mapped_ != nullptr) {
+        munmap(mapped_, size_);
+    }
+}
+
+int SourceBuffer::Open(const string& filename, shared_ptr<SourceBuffer>* buf) {
+    prof::ScopedPhase phase(prof::Read);
+    if (filename == kStdinName) {
+        return ReadFrom(STDIN_FILENO, buf);
+    }
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    // only non-empty regular files could be mapped, others are read as stream.
+    if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+        int ret = ReadFrom(fd, buf);
+        close(fd);
+        return ret;
+    }
+
+    // offsets of tokens are int.
+    if (st.st_size > INT_MAX) {
+        close(fd);
+        return -1;
+    }
+
+    void* mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return -1;
+    }
+    madvise(mapped, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    auto source = shared_ptr<SourceBuffer>(new SourceBuffer());
+    source->mapped_ = mapped;
+    source->data_ = (const char*)mapped;
+    source->size_ = (size_t)st.st_size;
+
+    *buf = source;
+    return 0;
+}
+
+int SourceBuffer::ReadFrom(int fd, shared_ptr<SourceBuffer>* buf) {
+    auto source = shared_ptr<SourceBuffer>(new SourceBuffer());
+    string& text = source->owned_;
+
+    size_t len = 0;
+    while (true) {
+        if (text.size() - len < kReadChunkSize) {
+            text.resize(len + kReadChunkSize + text.size() / 2);
+        }
+
+        ssize_t n = read(fd, &text[len], text.size() - len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        len += (size_t)n;
+
+        if (len > INT_MAX) {
+            return -1;
+        }
+    }
+
+    text.resize(len);
+    text.shrink_to_fit();
+
+    source->data_ = text.data();
+    source->size_ = text.size();
+
+    *buf = source;
+    return 0;
+}
+
+shared_ptr<SourceBuffer> SourceBuffer::FromString(string text) {
+    auto source = shared_ptr<SourceBuffer>(new SourceBuffer());
+    source->owned_ = std::move(text);
+    source->data_ = source->owned_.data();
+    source->size_ = source->owned_.size();
+
+    return source;
+}
+
+}// namespace input
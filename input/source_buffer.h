@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <memory>
+
+using namespace std;
+
+namespace input {
+
+// kStdinName is the file name which means reading source from stdin.
+const string kStdinName = "-";
+
+/**
+ * @brief SourceBuffer holds the whole text of a source file.
+ * Regular files are memory mapped, pipes and stdin are read by chunks,
+ * so the source is stored only once in memory.
+ */
+class SourceBuffer {
+public:
+    ~SourceBuffer();
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    /**
+     * @brief Open maps the given file, "-" for stdin.
+     * @param filename source file name.
+     * @param buf opened source buffer.
+     * @return 0 for success, -1 for fail.
+     */
+    static int Open(const string& filename, shared_ptr<SourceBuffer>* buf);
+
+    /**
+     * @brief ReadFrom reads all data from fd by chunks, fd is not closed.
+     * @param fd file descriptor, e.g. pipe or stdin.
+     * @param buf source buffer.
+     * @return 0 for success, -1 for fail.
+     */
+    static int ReadFrom(int fd, shared_ptr<SourceBuffer>* buf);
+
+    /**
+     * @brief FromString creates a buffer which owns the given text.
+     */
+    static shared_ptr<SourceBuffer> FromString(string text);
+
+    const char* data() const { return data_; }
+    int size() const { return (int)size_; }
+private:
+    SourceBuffer() = default;
+
+    const char* data_{""};
+    size_t size_{};
+
+    // mapped region, nullptr if source is not memory mapped.
+    void* mapped_{};
+    // owned text for sources which can't be mapped.
+    string owned_{};
+};
+
+}// namespace input
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+namespace ir {
+
+// BitSet is a set of small ints, e.g. vregs or blocks.
+class BitSet {
+public:
+    explicit BitSet(int n = 0) : words_((n + 63) / 64, 0) {}
+
+    bool Has(int i) const { return (words_[i / 64] >> (i % 64)) & 1; }
+    void Add(int i) { words_[i / 64] |= uint64_t(1) << (i % 64); }
+    void Remove(int i) { words_[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+
+    // Union adds all of other, returns whether anything was added.
+    bool Union(const BitSet& other) {
+        bool changed = false;
+        for (size_t i = 0; i < words_.size(); i++) {
+            uint64_t word = words_[i] | other.words_[i];
+            changed |= word != words_[i];
+            words_[i] = word;
+        }
+        return changed;
+    }
+
+    // UnionMinus adds all of a which are not in b, returns whether anything was added.
+    bool UnionMinus(const BitSet& a, const BitSet& b) {
+        bool changed = false;
+        for (size_t i = 0; i < words_.size(); i++) {
+            uint64_t word = words_[i] | (a.words_[i] & ~b.words_[i]);
+            changed |= word != words_[i];
+            words_[i] = word;
+        }
+        return changed;
+    }
+
+    template <typename F>
+    void ForEach(F f) const {
+        for (size_t i = 0; i < words_.size(); i++) {
+            for (uint64_t word = words_[i]; word != 0; word &= word - 1) {
+                f(static_cast<int>(i * 64 + __builtin_ctzll(word)));
+            }
+        }
+    }
+private:
+    vector<uint64_t> words_;
+};
+
+}// namespace ir
@@ -0,0 +1,932 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "ir/builder.h"
+#include "ast/util.h"
+#include "prof/prof.h"
+
+namespace ir {
+
+// BinaryOpcode returns opcode of a binary operator, returns false if tok isn't one.
+static bool BinaryOpcode(token::Token tok, Opcode* op) {
+    switch (tok) {
+        case token::Token::PLUS: *op = Opcode::Add; return true;
+        case token::Token::MINU: *op = Opcode::Sub; return true;
+        case token::Token::MULT: *op = Opcode::Mul; return true;
+        case token::Token::DIV: *op = Opcode::Div; return true;
+        case token::Token::LSS: *op = Opcode::Lss; return true;
+        case token::Token::LEQ: *op = Opcode::Leq; return true;
+        case token::Token::GRE: *op = Opcode::Gre; return true;
+        case token::Token::GEQ: *op = Opcode::Geq; return true;
+        case token::Token::EQL: *op = Opcode::Eql; return true;
+        case token::Token::NEQ: *op = Opcode::Neq; return true;
+        default: return false;
+    }
+}
+
+static bool IsCompare(Opcode op) {
+    return op >= Opcode::Lss && op <= Opcode::Neq;
+}
+
+Builder::Builder(const shared_ptr<ast::FileNode>& ast_file) :
+    ast_file_(ast_file), bounds_(nullptr), module_(nullptr), func_(nullptr), cur_block_(0) {}
+
+int Builder::Build(Module* module, string* err) {
+    prof::ScopedPhase phase(prof::Lower);
+    module_ = module;
+    *module_ = Module();
+    error_.clear();
+
+    // all functions are indexed first, so a call may refer to any of them.
+    for (auto decl : ast_file_->decl_) {
+        if (decl->Type() != ast::NodeType::FuncDecl) {
+            continue;
+        }
+
+        auto func_decl = static_cast<ast::FuncDeclNode*>(decl);
+        int index = static_cast<int>(module_->funcs.size());
+        module_->funcs.emplace_back();
+        Function& func = module_->funcs.back();
+        func.name = func_decl->name_->name_;
+        func.num_params = func_decl->params_ != nullptr ? static_cast<int>(func_decl->params_->fields_.size()) : 0;
+        func.returns_value = func_decl->type_ != nullptr && func_decl->type_->Type() != ast::NodeType::VoidType;
+        func_index_[func_decl] = index;
+        var_table_.AddFunc(func_decl->name_->symbol_, func_decl);
+
+        if (func.name == "main") {
+            module_->main = index;
+        }
+    }
+    if (module_->main < 0) {
+        Fail(nullptr, "main function not found");
+    }
+
+    // globals are static data, all of them are laid out before any function.
+    func_ = nullptr;
+    for (auto decl : ast_file_->decl_) {
+        if (decl->Type() != ast::NodeType::FuncDecl) {
+            BuildVarDecl(decl);
+        }
+    }
+
+    for (auto decl : ast_file_->decl_) {
+        if (decl->Type() == ast::NodeType::FuncDecl) {
+            auto func_decl = static_cast<ast::FuncDeclNode*>(decl);
+            BuildFuncDecl(func_decl, func_index_[func_decl]);
+        }
+    }
+
+    if (!error_.empty()) {
+        *err = error_;
+        return -1;
+    }
+
+    return 0;
+}
+
+void Builder::BuildVarDecl(ast::DeclNode* decl) {
+    if (decl->Type() == ast::NodeType::SingleVarDecl) {
+        BuildSingleVarDecl(static_cast<ast::SingleVarDeclNode*>(decl));
+        return;
+    }
+
+    if (decl->Type() != ast::NodeType::VarDecl) {
+        Fail(decl, "bad declaration");
+        return;
+    }
+
+    for (auto single_decl : static_cast<ast::VarDeclNode*>(decl)->decls_) {
+        BuildVarDecl(single_decl);
+    }
+}
+
+void Builder::BuildSingleVarDecl(ast::SingleVarDeclNode* decl) {
+    Var var{};
+    ast::TypeNode* item = decl->type_;
+    long long size = 1;
+    while (item != nullptr && item->Type() == ast::NodeType::ArrayType) {
+        auto array_type = static_cast<ast::ArrayTypeNode*>(item);
+        var.dims.push_back(array_type->size_);
+        size *= max(array_type->size_, 0);
+        item = array_type->item_;
+    }
+
+    if (item == nullptr || (item->Type() != ast::NodeType::IntType && item->Type() != ast::NodeType::CharType)) {
+        Fail(decl, "for var decl, expect int or char elements");
+        return;
+    }
+    if (size <= 0 || size > (1 << 28)) {
+        Fail(decl, "for var decl, array size out of range");
+        return;
+    }
+    var.is_char = item->Type() == ast::NodeType::CharType;
+
+    if (func_ == nullptr) {
+        BuildGlobalVarDecl(decl, &var, static_cast<int>(size));
+        AddVar(decl->name_, decl->type_, decl->is_const_, var);
+        return;
+    }
+
+    if (!var.dims.empty()) {
+        var.kind = Var::Slot;
+        var.id = static_cast<int>(func_->slots.size());
+        func_->slots.push_back(static_cast<int>(size));
+    } else {
+        var.kind = Var::Vreg;
+        var.id = NewVreg();
+        is_home_.resize(func_->num_vregs, false);
+        is_home_[var.id] = true;
+        var.is_const = decl->is_const_ && decl->val_ != nullptr && ConstEval(decl->val_, &var.const_value);
+    }
+    AddVar(decl->name_, decl->type_, decl->is_const_, var);
+
+    if (decl->val_ == nullptr) {
+        // locals start zeroed, as in the vm.
+        if (var.kind == Var::Vreg) {
+            AssignVreg(var.id, Value::Const(0));
+        } else {
+            ZeroSlot(var.id, static_cast<int>(size));
+        }
+        return;
+    }
+
+    if (decl->val_->Type() == ast::NodeType::CompositeLit && static_cast<ast::CompositeLitNode*>(decl->val_)->Packed()) {
+        const auto& values = static_cast<ast::CompositeLitNode*>(decl->val_)->values_;
+        if (var.kind != Var::Slot || static_cast<long long>(values.size()) != size) {
+            Fail(decl, "for var decl, initializer doesn't match the type");
+            return;
+        }
+        CopySlot(var.id, values);
+        return;
+    }
+
+    vector<ast::ExprNode*> items;
+    ast::FlattenCompositeLit(decl->val_, &items);
+    if (static_cast<long long>(items.size()) != size) {
+        Fail(decl, "for var decl, initializer doesn't match the type");
+        return;
+    }
+
+    if (var.kind == Var::Vreg) {
+        AssignVreg(var.id, BuildExpr(items[0]));
+        return;
+    }
+
+    for (size_t i = 0; i < items.size(); i++) {
+        Instr store(Opcode::StoreSlot);
+        store.sym = var.id;
+        store.a = Value::Const(static_cast<int32_t>(i));
+        store.b = BuildExpr(items[i]);
+        Emit(store);
+    }
+}
+
+void Builder::ZeroSlot(int slot, int size) {
+    if (size <= 8) {
+        for (int i = 0; i < size; i++) {
+            Instr store(Opcode::StoreSlot);
+            store.sym = slot;
+            store.a = Value::Const(i);
+            store.b = Value::Const(0);
+            Emit(store);
+        }
+        return;
+    }
+
+    int index = NewVreg();
+    Instr init(Opcode::Copy);
+    init.dst = index;
+    init.a = Value::Const(0);
+    Emit(init);
+
+    int body_block = NewBlock();
+    int end_block = NewBlock();
+    EmitJump(body_block);
+
+    cur_block_ = body_block;
+    Instr store(Opcode::StoreSlot);
+    store.sym = slot;
+    store.a = Value::Vreg(index);
+    store.b = Value::Const(0);
+    Emit(store);
+
+    Instr next(Opcode::Add);
+    next.dst = index;
+    next.a = Value::Vreg(index);
+    next.b = Value::Const(1);
+    Emit(next);
+    EmitBranch(Opcode::Lss, Value::Vreg(index), Value::Const(size), body_block, end_block);
+
+    cur_block_ = end_block;
+}
+
+void Builder::CopySlot(int slot, const vector<int32_t>& values) {
+    int size = static_cast<int>(values.size());
+    if (size <= 8) {
+        for (int i = 0; i < size; i++) {
+            Instr store(Opcode::StoreSlot);
+            store.sym = slot;
+            store.a = Value::Const(i);
+            store.b = Value::Const(values[i]);
+            Emit(store);
+        }
+        return;
+    }
+
+    // larger ones are kept as a global table, which names in source can't clash with.
+    Global table;
+    table.name = "lit." + to_string(module_->globals.size());
+    table.size = size;
+    table.is_array = true;
+    table.init = values;
+    int sym = static_cast<int>(module_->globals.size());
+    module_->globals.push_back(move(table));
+
+    int index = NewVreg();
+    Instr init(Opcode::Copy);
+    init.dst = index;
+    init.a = Value::Const(0);
+    Emit(init);
+
+    int body_block = NewBlock();
+    int end_block = NewBlock();
+    EmitJump(body_block);
+
+    cur_block_ = body_block;
+    int item = NewVreg();
+    Instr load(Opcode::LoadGlobal);
+    load.dst = item;
+    load.sym = sym;
+    load.a = Value::Vreg(index);
+    Emit(load);
+
+    Instr store(Opcode::StoreSlot);
+    store.sym = slot;
+    store.a = Value::Vreg(index);
+    store.b = Value::Vreg(item);
+    Emit(store);
+
+    Instr next(Opcode::Add);
+    next.dst = index;
+    next.a = Value::Vreg(index);
+    next.b = Value::Const(1);
+    Emit(next);
+    EmitBranch(Opcode::Lss, Value::Vreg(index), Value::Const(size), body_block, end_block);
+
+    cur_block_ = end_block;
+}
+
+void Builder::BuildGlobalVarDecl(ast::SingleVarDeclNode* decl, Var* var, int size) {
+    var->kind = Var::Global;
+    var->id = static_cast<int>(module_->globals.size());
+
+    Global global;
+    global.name = decl->name_->name_;
+    global.size = size;
+    global.is_array = !var->dims.empty();
+
+    if (decl->val_ != nullptr && decl->val_->Type() == ast::NodeType::CompositeLit &&
+        static_cast<ast::CompositeLitNode*>(decl->val_)->Packed()) {
+        // a packed literal is the data of the global as it is.
+        const auto& values = static_cast<ast::CompositeLitNode*>(decl->val_)->values_;
+        if (static_cast<int>(values.size()) != size) {
+            Fail(decl, "for var decl, initializer doesn't match the type");
+            return;
+        }
+        global.init = values;
+    } else if (decl->val_ != nullptr) {
+        vector<ast::ExprNode*> items;
+        ast::FlattenCompositeLit(decl->val_, &items);
+        if (static_cast<int>(items.size()) != size) {
+            Fail(decl, "for var decl, initializer doesn't match the type");
+            return;
+        }
+
+        global.init.resize(size);
+        for (int i = 0; i < size; i++) {
+            if (!ConstEval(items[i], &global.init[i])) {
+                Fail(items[i], "for global var decl, initializer must be constant");
+                return;
+            }
+        }
+
+        if (!global.is_array && decl->is_const_) {
+            var->is_const = true;
+            var->const_value = global.init[0];
+        }
+    }
+
+    module_->globals.push_back(move(global));
+}
+
+void Builder::BuildFuncDecl(ast::FuncDeclNode* decl, int index) {
+    func_ = &module_->funcs[index];
+    is_home_.clear();
+    cur_block_ = NewBlock();
+
+    var_table_.CreateCodeBlock();
+    if (decl->params_ != nullptr) {
+        for (size_t i = 0; i < decl->params_->fields_.size(); i++) {
+            auto field = decl->params_->fields_[i];
+            Var var{};
+            var.kind = Var::Vreg;
+            var.id = NewVreg();
+            var.is_char = field->type_ != nullptr && field->type_->Type() == ast::NodeType::CharType;
+            AddVar(field->name_, field->type_, false, var);
+            is_home_.resize(func_->num_vregs, false);
+            is_home_[var.id] = true;
+
+            Instr param(Opcode::Param);
+            param.dst = var.id;
+            param.sym = static_cast<int>(i);
+            Emit(param);
+        }
+    }
+
+    VisitStmt(decl->body_);
+
+    // falling off the end returns 0, also for int and char functions.
+    Instr ret(Opcode::Return);
+    if (func_->returns_value) {
+        ret.a = Value::Const(0);
+    }
+    Emit(ret);
+    var_table_.DestroyCodeBlock();
+
+    RemoveUnreachableBlocks(func_);
+    func_ = nullptr;
+}
+
+void Builder::VisitBadStmt(ast::BadStmtNode* stmt) {
+    Fail(stmt, "bad statement");
+}
+
+void Builder::VisitDeclStmt(ast::DeclStmtNode* stmt) {
+    BuildVarDecl(stmt->decl_);
+}
+
+void Builder::VisitExprStmt(ast::ExprStmtNode* stmt) {
+    BuildExpr(stmt->expr_);
+}
+
+void Builder::VisitAssignStmt(ast::AssignStmtNode* stmt) {
+    if (stmt->lhs_->Type() == ast::NodeType::IndexExpr) {
+        const Var* var = nullptr;
+        Value index;
+        if (!BuildElem(static_cast<ast::IndexExprNode*>(stmt->lhs_), &var, &index)) {
+            return;
+        }
+
+        Instr store(var->kind == Var::Global ? Opcode::StoreGlobal : Opcode::StoreSlot);
+        store.sym = var->id;
+        store.a = index;
+        store.b = BuildExpr(stmt->rhs_);
+        Emit(store);
+        return;
+    }
+
+    const Var* var = nullptr;
+    if (stmt->lhs_->Type() == ast::NodeType::Ident) {
+        var = LookupVar(static_cast<ast::IdentNode*>(stmt->lhs_));
+    }
+    if (var == nullptr || !var->dims.empty()) {
+        Fail(stmt, "for assign stmt, expect a scalar var on the left");
+        return;
+    }
+
+    if (var->kind == Var::Vreg) {
+        int home = var->id;
+        AssignVreg(home, BuildExpr(stmt->rhs_));
+        return;
+    }
+
+    Instr store(Opcode::StoreGlobal);
+    store.sym = var->id;
+    store.a = Value::Const(0);
+    store.b = BuildExpr(stmt->rhs_);
+    Emit(store);
+}
+
+void Builder::VisitReturnStmt(ast::ReturnStmtNode* stmt) {
+    Instr ret(Opcode::Return);
+    if (stmt->results_ != nullptr) {
+        ret.a = BuildExpr(stmt->results_);
+    } else if (func_->returns_value) {
+        ret.a = Value::Const(0);
+    }
+    Emit(ret);
+}
+
+void Builder::VisitBlockStmt(ast::BlockStmtNode* stmt) {
+    var_table_.CreateCodeBlock();
+    for (auto sub_stmt : stmt->stmts_) {
+        VisitStmt(sub_stmt);
+    }
+    var_table_.DestroyCodeBlock();
+}
+
+void Builder::BuildCond(ast::ExprNode* cond, int on_true, int on_false) {
+    while (cond->Type() == ast::NodeType::ParenExpr) {
+        cond = static_cast<ast::ParenExprNode*>(cond)->expr_;
+    }
+
+    Opcode op;
+    if (cond->Type() == ast::NodeType::BinaryExpr
+        && BinaryOpcode(static_cast<ast::BinaryExprNode*>(cond)->op_tok_, &op) && IsCompare(op)) {
+        auto binary = static_cast<ast::BinaryExprNode*>(cond);
+        Value x = BuildExpr(binary->x_);
+        Value y = BuildExpr(binary->y_);
+        EmitBranch(op, x, y, on_true, on_false);
+        return;
+    }
+
+    EmitBranch(Opcode::Neq, BuildExpr(cond), Value::Const(0), on_true, on_false);
+}
+
+void Builder::VisitIfStmt(ast::IfStmtNode* stmt) {
+    int then_block = NewBlock();
+    int end_block = NewBlock();
+    int else_block = stmt->else_ != nullptr ? NewBlock() : end_block;
+
+    BuildCond(stmt->cond_, then_block, else_block);
+    cur_block_ = then_block;
+    VisitStmt(stmt->body_);
+    EmitJump(end_block);
+
+    if (stmt->else_ != nullptr) {
+        cur_block_ = else_block;
+        VisitStmt(stmt->else_);
+        EmitJump(end_block);
+    }
+    cur_block_ = end_block;
+}
+
+// switch is lowered to a chain of compares ahead of the case bodies, a case
+// body jumps to the end after it is done, there is no fall through.
+void Builder::VisitSwitchStmt(ast::SwitchStmtNode* stmt) {
+    Value value = BuildExpr(stmt->cond_);
+
+    vector<ast::CaseStmtNode*> cases;
+    for (auto case_stmt : stmt->cases_) {
+        if (case_stmt->Type() != ast::NodeType::CaseStmt) {
+            Fail(case_stmt, "for switch stmt, expect case stmt");
+            return;
+        }
+        cases.push_back(static_cast<ast::CaseStmtNode*>(case_stmt));
+    }
+
+    int end_block = NewBlock();
+    int default_block = end_block;
+    vector<int> case_blocks;
+    for (auto case_stmt : cases) {
+        case_blocks.push_back(NewBlock());
+        if (case_stmt->cond_ == nullptr) {
+            default_block = case_blocks.back();
+        }
+    }
+
+    for (size_t i = 0; i < cases.size(); i++) {
+        if (cases[i]->cond_ == nullptr) {
+            continue;
+        }
+
+        int next_block = NewBlock();
+        EmitBranch(Opcode::Eql, value, BuildExpr(cases[i]->cond_), case_blocks[i], next_block);
+        cur_block_ = next_block;
+    }
+    EmitJump(default_block);
+
+    for (size_t i = 0; i < cases.size(); i++) {
+        cur_block_ = case_blocks[i];
+        for (auto body_stmt : cases[i]->body_) {
+            VisitStmt(body_stmt);
+        }
+        EmitJump(end_block);
+    }
+    cur_block_ = end_block;
+}
+
+void Builder::VisitForStmt(ast::ForStmtNode* stmt) {
+    if (stmt->init_ != nullptr) {
+        VisitStmt(stmt->init_);
+    }
+
+    if (stmt->cond_ == nullptr || stmt->cond_->Type() != ast::NodeType::ExprStmt) {
+        Fail(stmt, "for for stmt, expect cond expr");
+        return;
+    }
+
+    int cond_block = NewBlock();
+    int body_block = NewBlock();
+    int end_block = NewBlock();
+
+    EmitJump(cond_block);
+    cur_block_ = cond_block;
+    BuildCond(static_cast<ast::ExprStmtNode*>(stmt->cond_)->expr_, body_block, end_block);
+
+    cur_block_ = body_block;
+    VisitStmt(stmt->body_);
+    if (stmt->step_ != nullptr) {
+        VisitStmt(stmt->step_);
+    }
+    EmitJump(cond_block);
+    cur_block_ = end_block;
+}
+
+void Builder::VisitWhileStmt(ast::WhileStmtNode* stmt) {
+    int cond_block = NewBlock();
+    int body_block = NewBlock();
+    int end_block = NewBlock();
+
+    EmitJump(cond_block);
+    cur_block_ = cond_block;
+    BuildCond(stmt->cond_, body_block, end_block);
+
+    cur_block_ = body_block;
+    VisitStmt(stmt->body_);
+    EmitJump(cond_block);
+    cur_block_ = end_block;
+}
+
+void Builder::VisitScanStmt(ast::ScanStmtNode* stmt) {
+    const Var* var = nullptr;
+    if (stmt->var_ != nullptr && stmt->var_->Type() == ast::NodeType::Ident) {
+        var = LookupVar(static_cast<ast::IdentNode*>(stmt->var_));
+    }
+    if (var == nullptr || !var->dims.empty()) {
+        Fail(stmt, "for scan stmt, expect a scalar var");
+        return;
+    }
+
+    Instr read(Opcode::Read);
+    read.is_char = var->is_char;
+    read.dst = var->kind == Var::Vreg ? var->id : NewVreg();
+    Emit(read);
+
+    if (var->kind == Var::Global) {
+        Instr store(Opcode::StoreGlobal);
+        store.sym = var->id;
+        store.a = Value::Const(0);
+        store.b = Value::Vreg(read.dst);
+        Emit(store);
+    }
+}
+
+void Builder::VisitPrintfStmt(ast::PrintfStmtNode* stmt) {
+    for (auto arg : stmt->args_) {
+        if (arg->Type() == ast::NodeType::BasicLit && static_cast<ast::BasicLitNode*>(arg)->tok_ == token::Token::STRCON) {
+            Instr print(Opcode::PrintStr);
+            print.sym = static_cast<int>(module_->strings.size());
+            module_->strings.push_back(ast::DecodeStringLit(static_cast<ast::BasicLitNode*>(arg)->val_));
+            Emit(print);
+            continue;
+        }
+
+        Instr print(Opcode::Print);
+        print.is_char = IsCharExpr(arg);
+        print.a = BuildExpr(arg);
+        Emit(print);
+    }
+    Emit(Instr(Opcode::PrintLine));
+}
+
+void Builder::VisitOtherStmt(ast::StmtNode* stmt) {
+    Fail(stmt, "unexpected statement");
+}
+
+Value Builder::VisitIdent(ast::IdentNode* expr) {
+    const Var* var = LookupVar(expr);
+    if (var == nullptr || !var->dims.empty()) {
+        Fail(expr, "for ident expr, expect a scalar var");
+        return Value::Const(0);
+    }
+
+    if (var->kind == Var::Vreg) {
+        return Value::Vreg(var->id);
+    }
+
+    Instr load(Opcode::LoadGlobal);
+    load.dst = NewVreg();
+    load.sym = var->id;
+    load.a = Value::Const(0);
+    Emit(load);
+    return Value::Vreg(load.dst);
+}
+
+Value Builder::VisitBasicLit(ast::BasicLitNode* expr) {
+    if (expr->tok_ == token::Token::INTCON) {
+        return Value::Const(static_cast<int32_t>(strtoll(expr->val_.c_str(), nullptr, 10)));
+    }
+    if (expr->tok_ == token::Token::CHARCON) {
+        return Value::Const(ast::CharLitValue(expr->val_));
+    }
+
+    Fail(expr, "for basic lit, a string isn't a value");
+    return Value::Const(0);
+}
+
+Value Builder::VisitParenExpr(ast::ParenExprNode* expr) {
+    return BuildExpr(expr->expr_);
+}
+
+Value Builder::VisitIndexExpr(ast::IndexExprNode* expr) {
+    const Var* var = nullptr;
+    Value index;
+    if (!BuildElem(expr, &var, &index)) {
+        return Value::Const(0);
+    }
+
+    Instr load(var->kind == Var::Global ? Opcode::LoadGlobal : Opcode::LoadSlot);
+    load.dst = NewVreg();
+    load.sym = var->id;
+    load.a = index;
+    Emit(load);
+    return Value::Vreg(load.dst);
+}
+
+Value Builder::VisitCallExpr(ast::CallExprNode* expr) {
+    ast::FuncDeclNode* decl = nullptr;
+    int index = -1;
+    if (expr->fun_->Type() == ast::NodeType::Ident) {
+        index = LookupFunc(static_cast<ast::IdentNode*>(expr->fun_), &decl);
+    }
+    if (index < 0) {
+        Fail(expr, "for call expr, function not found");
+        return Value::Const(0);
+    }
+
+    if (static_cast<int>(expr->args_.size()) != module_->funcs[index].num_params) {
+        Fail(expr, "for call expr, args count doesn't match params");
+        return Value::Const(0);
+    }
+
+    Instr call(Opcode::Call);
+    call.sym = index;
+    for (auto arg : expr->args_) {
+        call.args.push_back(BuildExpr(arg));
+    }
+
+    if (!module_->funcs[index].returns_value) {
+        Emit(call);
+        return Value::Const(0);
+    }
+
+    call.dst = NewVreg();
+    Emit(call);
+    return Value::Vreg(call.dst);
+}
+
+Value Builder::VisitUnaryExpr(ast::UnaryExprNode* expr) {
+    if (expr->op_tok_ == token::Token::PLUS) {
+        return BuildExpr(expr->x_);
+    }
+
+    if (expr->op_tok_ != token::Token::MINU) {
+        Fail(expr, "for unary expr, expect '+' or '-'");
+        return Value::Const(0);
+    }
+
+    return EmitOp(Opcode::Neg, BuildExpr(expr->x_));
+}
+
+Value Builder::VisitBinaryExpr(ast::BinaryExprNode* expr) {
+    Opcode op;
+    if (!BinaryOpcode(expr->op_tok_, &op)) {
+        Fail(expr, "for binary expr, unexpected operator");
+        return Value::Const(0);
+    }
+
+    Value x = BuildExpr(expr->x_);
+    Value y = BuildExpr(expr->y_);
+    return EmitOp(op, x, y);
+}
+
+Value Builder::VisitOtherExpr(ast::ExprNode* expr) {
+    Fail(expr, "unexpected expression");
+    return Value::Const(0);
+}
+
+bool Builder::BuildElem(ast::IndexExprNode* expr, const Var** var, Value* index) {
+    vector<ast::ExprNode*> indexes;
+    ast::ExprNode* x = expr;
+    while (x->Type() == ast::NodeType::IndexExpr) {
+        indexes.push_back(static_cast<ast::IndexExprNode*>(x)->index_);
+        x = static_cast<ast::IndexExprNode*>(x)->x_;
+    }
+    reverse(indexes.begin(), indexes.end());
+
+    const Var* array = x->Type() == ast::NodeType::Ident ? LookupVar(static_cast<ast::IdentNode*>(x)) : nullptr;
+    if (array == nullptr || array->dims.size() != indexes.size()) {
+        Fail(expr, "for index expr, expect an array indexed by all dimensions");
+        return false;
+    }
+    *var = array;
+
+    Value flat;
+    for (size_t i = 0; i < indexes.size(); i++) {
+        Value sub = BuildExpr(indexes[i]);
+        int dim = array->dims[i];
+        // a constant in range, or an index proved in range, needs no check.
+        bool proved = bounds_ != nullptr && bounds_->InBounds(indexes[i]);
+        if (!proved && (!sub.IsImm() || sub.v < 0 || sub.v >= dim)) {
+            Instr check(Opcode::CheckIndex);
+            check.a = sub;
+            check.b = Value::Const(dim);
+            Emit(check);
+        }
+
+        flat = i == 0 ? sub : EmitOp(Opcode::Add, EmitOp(Opcode::Mul, flat, Value::Const(dim)), sub);
+    }
+    *index = flat;
+    return true;
+}
+
+void Builder::AssignVreg(int home, const Value& value) {
+    auto& instrs = func_->blocks[cur_block_].instrs;
+    bool is_home = value.IsReg() && value.v < static_cast<int>(is_home_.size()) && is_home_[value.v];
+    if (value.IsReg() && !is_home && !instrs.empty() && instrs.back().dst == value.v) {
+        // a temp is used once, let the instr which made it write home instead.
+        instrs.back().dst = home;
+        return;
+    }
+
+    Instr copy(Opcode::Copy);
+    copy.dst = home;
+    copy.a = value;
+    Emit(copy);
+}
+
+bool Builder::ConstEval(ast::ExprNode* expr, int32_t* value) const {
+    switch (expr->Type()) {
+        case ast::NodeType::BasicLit: {
+            auto lit = static_cast<ast::BasicLitNode*>(expr);
+            if (lit->tok_ == token::Token::INTCON) {
+                *value = static_cast<int32_t>(strtoll(lit->val_.c_str(), nullptr, 10));
+                return true;
+            }
+            if (lit->tok_ == token::Token::CHARCON) {
+                *value = ast::CharLitValue(lit->val_);
+                return true;
+            }
+            return false;
+        }
+        case ast::NodeType::Ident: {
+            const Var* var = LookupVar(static_cast<ast::IdentNode*>(expr));
+            if (var == nullptr || !var->is_const) {
+                return false;
+            }
+            *value = var->const_value;
+            return true;
+        }
+        case ast::NodeType::ParenExpr:
+            return ConstEval(static_cast<ast::ParenExprNode*>(expr)->expr_, value);
+        case ast::NodeType::UnaryExpr: {
+            auto unary = static_cast<ast::UnaryExprNode*>(expr);
+            int32_t x;
+            if (!ConstEval(unary->x_, &x)) {
+                return false;
+            }
+            *value = unary->op_tok_ == token::Token::MINU ? static_cast<int32_t>(0u - static_cast<uint32_t>(x)) : x;
+            return true;
+        }
+        case ast::NodeType::BinaryExpr: {
+            auto binary = static_cast<ast::BinaryExprNode*>(expr);
+            int32_t x, y;
+            if (!ConstEval(binary->x_, &x) || !ConstEval(binary->y_, &y)) {
+                return false;
+            }
+
+            uint32_t ux = static_cast<uint32_t>(x), uy = static_cast<uint32_t>(y);
+            switch (binary->op_tok_) {
+                case token::Token::PLUS: *value = static_cast<int32_t>(ux + uy); return true;
+                case token::Token::MINU: *value = static_cast<int32_t>(ux - uy); return true;
+                case token::Token::MULT: *value = static_cast<int32_t>(ux * uy); return true;
+                case token::Token::DIV:
+                    if (y == 0) {
+                        return false;
+                    }
+                    *value = y == -1 ? static_cast<int32_t>(0u - ux) : x / y;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+        default:
+            return false;
+    }
+}
+
+bool Builder::IsCharExpr(ast::ExprNode* expr) const {
+    switch (expr->Type()) {
+        case ast::NodeType::BasicLit:
+            return static_cast<ast::BasicLitNode*>(expr)->tok_ == token::Token::CHARCON;
+        case ast::NodeType::Ident: {
+            const Var* var = LookupVar(static_cast<ast::IdentNode*>(expr));
+            return var != nullptr && var->is_char;
+        }
+        case ast::NodeType::IndexExpr: {
+            ast::ExprNode* x = expr;
+            while (x->Type() == ast::NodeType::IndexExpr) {
+                x = static_cast<ast::IndexExprNode*>(x)->x_;
+            }
+            return x->Type() == ast::NodeType::Ident && IsCharExpr(x);
+        }
+        case ast::NodeType::CallExpr: {
+            auto call = static_cast<ast::CallExprNode*>(expr);
+            ast::FuncDeclNode* decl = nullptr;
+            return call->fun_->Type() == ast::NodeType::Ident
+                && LookupFunc(static_cast<ast::IdentNode*>(call->fun_), &decl) >= 0
+                && decl->type_ != nullptr && decl->type_->Type() == ast::NodeType::CharType;
+        }
+        default:
+            // operators and parens make an int, e.g. '+c', '(c)'.
+            return false;
+    }
+}
+
+void Builder::AddVar(ast::IdentNode* name, ast::TypeNode* type, bool is_const, const Var& var) {
+    var_table_.AddVar(name->symbol_, type, is_const);
+
+    const VarTable::Identifier* ident = nullptr;
+    var_table_.GetVar(name->symbol_, &ident);
+    if (ident->unique_id >= static_cast<int>(vars_.size())) {
+        vars_.resize(ident->unique_id + 1);
+    }
+    vars_[ident->unique_id] = var;
+}
+
+const Builder::Var* Builder::LookupVar(ast::IdentNode* ident) const {
+    const VarTable::Identifier* var = nullptr;
+    if (var_table_.GetVar(ident->symbol_, &var) != 0 || var->unique_id >= static_cast<int>(vars_.size())) {
+        return nullptr;
+    }
+    return &vars_[var->unique_id];
+}
+
+int Builder::LookupFunc(ast::IdentNode* ident, ast::FuncDeclNode** decl) const {
+    if (var_table_.GetFunc(ident->symbol_, decl) != 0) {
+        return -1;
+    }
+
+    auto it = func_index_.find(*decl);
+    return it != func_index_.end() ? it->second : -1;
+}
+
+int Builder::NewBlock() {
+    func_->blocks.emplace_back();
+    return static_cast<int>(func_->blocks.size()) - 1;
+}
+
+void Builder::Emit(const Instr& instr) {
+    if (func_ == nullptr) {
+        Fail(nullptr, "global initializer must be constant");
+        return;
+    }
+
+    auto* instrs = &func_->blocks[cur_block_].instrs;
+    if (!instrs->empty() && instrs->back().IsTerminator()) {
+        // e.g. stmts after a return, the block is dropped as unreachable.
+        cur_block_ = NewBlock();
+        instrs = &func_->blocks[cur_block_].instrs;
+    }
+    instrs->push_back(instr);
+}
+
+Value Builder::EmitOp(Opcode op, const Value& a, const Value& b) {
+    Instr instr(op);
+    instr.dst = NewVreg();
+    instr.a = a;
+    instr.b = b;
+    Emit(instr);
+    return Value::Vreg(instr.dst);
+}
+
+void Builder::EmitJump(int target) {
+    Instr jump(Opcode::Jump);
+    jump.target = target;
+    Emit(jump);
+}
+
+void Builder::EmitBranch(Opcode cond, const Value& a, const Value& b, int on_true, int on_false) {
+    Instr branch(Opcode::Branch);
+    branch.cond = cond;
+    branch.a = a;
+    branch.b = b;
+    branch.target = on_true;
+    branch.other = on_false;
+    Emit(branch);
+}
+
+void Builder::Fail(const ast::Node* node, const string& msg) {
+    if (!error_.empty()) {
+        return;
+    }
+
+    if (node == nullptr) {
+        error_ = msg;
+        return;
+    }
+    error_ = "(" + to_string(node->Pos().line) + ", " + to_string(node->Pos().column) + ") :: " + msg;
+}
+
+}// namespace ir
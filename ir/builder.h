@@ -0,0 +1,165 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast/ast.h"
+#include "ast/visitor.h"
+#include "check/bounds.h"
+#include "ir/ir.h"
+#include "parser/var_table.h"
+
+using namespace std;
+
+namespace ir {
+
+// Builder lowers a checked ast file to ir.
+// Local scalars and params are virtual registers, local arrays are slots and
+// globals are static data, so initializers of globals must be constant.
+class Builder : private ast::StmtVisitor<Builder>, private ast::ExprVisitor<Builder, Value> {
+    friend class ast::StmtVisitor<Builder>;
+    friend class ast::ExprVisitor<Builder, Value>;
+public:
+    explicit Builder(const shared_ptr<ast::FileNode>& ast_file);
+
+    /**
+     * @brief Build lowers the file to module, the file should have passed the checker.
+     *
+     * @param module built module.
+     * @param err first construct which can't be lowered, if any.
+     * @return 0 if succeed, -1 if failed.
+     */
+    int Build(Module* module, string* err);
+
+    /**
+     * @brief SetBounds makes indexes bounds proved in range go unchecked, bounds should have
+     * analyzed the file and live until Build returns.
+     */
+    void SetBounds(const check::Bounds* bounds) { bounds_ = bounds; }
+private:
+    // Var is the home of a variable.
+    struct Var {
+        enum Kind {
+            Global,
+            Vreg,
+            Slot,
+        };
+
+        Kind kind;
+        // id is index of the global, the vreg or index of the slot.
+        int id;
+        bool is_char;
+        // dims of an array, row major, empty for scalars.
+        vector<int> dims;
+        // is_const is set for consts of a known value.
+        bool is_const;
+        int32_t const_value;
+    };
+
+    void BuildVarDecl(ast::DeclNode* decl);
+    void BuildSingleVarDecl(ast::SingleVarDeclNode* decl);
+    // ZeroSlot clears a local array.
+    void ZeroSlot(int slot, int size);
+    // CopySlot sets a local array to values, e.g. those of a packed literal.
+    void CopySlot(int slot, const vector<int32_t>& values);
+    void BuildGlobalVarDecl(ast::SingleVarDeclNode* decl, Var* var, int size);
+    void BuildFuncDecl(ast::FuncDeclNode* decl, int index);
+
+    void VisitBadStmt(ast::BadStmtNode* stmt);
+    void VisitDeclStmt(ast::DeclStmtNode* stmt);
+    void VisitEmptyStmt(ast::EmptyStmtNode*) {}
+    void VisitExprStmt(ast::ExprStmtNode* stmt);
+    void VisitAssignStmt(ast::AssignStmtNode* stmt);
+    void VisitReturnStmt(ast::ReturnStmtNode* stmt);
+    void VisitBlockStmt(ast::BlockStmtNode* stmt);
+    void VisitIfStmt(ast::IfStmtNode* stmt);
+    void VisitSwitchStmt(ast::SwitchStmtNode* stmt);
+    void VisitForStmt(ast::ForStmtNode* stmt);
+    void VisitWhileStmt(ast::WhileStmtNode* stmt);
+    void VisitScanStmt(ast::ScanStmtNode* stmt);
+    void VisitPrintfStmt(ast::PrintfStmtNode* stmt);
+    void VisitOtherStmt(ast::StmtNode* stmt);
+
+    // Expr handlers return the value of expr, it may be the home of a
+    // local variable, which must not be written.
+    Value VisitIdent(ast::IdentNode* expr);
+    Value VisitBasicLit(ast::BasicLitNode* expr);
+    Value VisitParenExpr(ast::ParenExprNode* expr);
+    Value VisitIndexExpr(ast::IndexExprNode* expr);
+    Value VisitCallExpr(ast::CallExprNode* expr);
+    Value VisitUnaryExpr(ast::UnaryExprNode* expr);
+    Value VisitBinaryExpr(ast::BinaryExprNode* expr);
+    Value VisitOtherExpr(ast::ExprNode* expr);
+
+    Value BuildExpr(ast::ExprNode* expr) { return VisitExpr(expr); }
+
+    // BuildCond jumps to on_true if cond holds, otherwise to on_false.
+    void BuildCond(ast::ExprNode* cond, int on_true, int on_false);
+
+    /**
+     * @brief BuildElem builds the flat index of an array element, every index is checked
+     * unless it is constant or bounds proved it in range.
+     *
+     * @param expr index expr, e.g. 'a[i][j]'.
+     * @param var array of the element.
+     * @return false if failed.
+     */
+    bool BuildElem(ast::IndexExprNode* expr, const Var** var, Value* index);
+
+    // AssignVreg assigns value to home, the last instr is retargeted if it made value.
+    void AssignVreg(int home, const Value& value);
+
+    /**
+     * @brief ConstEval evaluates a constant expr, e.g. '-1', 'N * 2' with N a const.
+     *
+     * @return false if expr isn't constant.
+     */
+    bool ConstEval(ast::ExprNode* expr, int32_t* value) const;
+
+    // IsCharExpr reports whether value of expr is printed as a char.
+    bool IsCharExpr(ast::ExprNode* expr) const;
+
+    // AddVar adds a var to current code block, var is its home.
+    void AddVar(ast::IdentNode* name, ast::TypeNode* type, bool is_const, const Var& var);
+
+    // LookupVar returns home of the innermost variable named by ident, nullptr if none.
+    const Var* LookupVar(ast::IdentNode* ident) const;
+
+    // LookupFunc returns index of function named by ident, -1 if none.
+    int LookupFunc(ast::IdentNode* ident, ast::FuncDeclNode** decl) const;
+
+    // NewBlock appends an empty block to current function, returns its index.
+    int NewBlock();
+
+    // NewVreg allocates a temporary of current function.
+    int NewVreg() { return func_->NewVreg(); }
+
+    // Emit appends instr to current block, code after a terminator goes to a new block.
+    void Emit(const Instr& instr);
+    Value EmitOp(Opcode op, const Value& a, const Value& b = Value());
+    void EmitJump(int target);
+    void EmitBranch(Opcode cond, const Value& a, const Value& b, int on_true, int on_false);
+
+    // Fail records the first error, building goes on but the result is dropped.
+    void Fail(const ast::Node* node, const string& msg);
+private:
+    shared_ptr<ast::FileNode> ast_file_;
+    const check::Bounds* bounds_;
+    Module* module_;
+    string error_;
+
+    VarTable var_table_;
+    // vars_[unique id in var table] is home of the var.
+    vector<Var> vars_;
+    unordered_map<const ast::FuncDeclNode*, int> func_index_;
+
+    // func_ is the function being built, nullptr for globals.
+    Function* func_;
+    int cur_block_;
+    // is_home_[vreg] is set for vregs of variables.
+    vector<bool> is_home_;
+};
+
+}// namespace ir
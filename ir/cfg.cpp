@@ -0,0 +1,170 @@
+#include <algorithm>
+
+#include "ir/cfg.h"
+
+namespace ir {
+
+Cfg::Cfg(const Function& func) {
+    int n = static_cast<int>(func.blocks.size());
+    preds.resize(n);
+    succs.resize(n);
+    for (int b = 0; b < n; b++) {
+        int succ[2];
+        int num_succ = Successors(func.blocks[b].instrs.back(), succ);
+        for (int i = 0; i < num_succ; i++) {
+            succs[b].push_back(succ[i]);
+            preds[succ[i]].push_back(b);
+        }
+        sort(succs[b].begin(), succs[b].end());
+    }
+    for (auto& pred : preds) {
+        sort(pred.begin(), pred.end());
+    }
+
+    // post order by an explicit stack, the cfg of a long function is deep.
+    vector<int> order(n, -1);
+    vector<pair<int, size_t>> stack{{0, 0}};
+    vector<bool> seen(n, false);
+    seen[0] = true;
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        if (top.second < succs[top.first].size()) {
+            int succ = succs[top.first][top.second++];
+            if (!seen[succ]) {
+                seen[succ] = true;
+                stack.emplace_back(succ, 0);
+            }
+            continue;
+        }
+        rpo.push_back(top.first);
+        stack.pop_back();
+    }
+    reverse(rpo.begin(), rpo.end());
+    for (size_t i = 0; i < rpo.size(); i++) {
+        order[rpo[i]] = static_cast<int>(i);
+    }
+
+    // iterative dominators of Cooper, Harvey and Kennedy.
+    idom.assign(n, -1);
+    idom[0] = 0;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 1; i < rpo.size(); i++) {
+            int b = rpo[i];
+            int dom = -1;
+            for (int pred : preds[b]) {
+                if (idom[pred] < 0) {
+                    continue;
+                }
+                if (dom < 0) {
+                    dom = pred;
+                    continue;
+                }
+
+                int x = pred;
+                while (x != dom) {
+                    while (order[x] > order[dom]) {
+                        x = idom[x];
+                    }
+                    while (order[dom] > order[x]) {
+                        dom = idom[dom];
+                    }
+                }
+            }
+            if (dom != idom[b]) {
+                idom[b] = dom;
+                changed = true;
+            }
+        }
+    }
+
+    dom_children.resize(n);
+    for (int b : rpo) {
+        if (b != 0) {
+            dom_children[idom[b]].push_back(b);
+        }
+    }
+
+    pre_.assign(n, 0);
+    post_.assign(n, 0);
+    int clock = 0;
+    vector<pair<int, size_t>> walk{{0, 0}};
+    pre_[0] = clock++;
+    while (!walk.empty()) {
+        auto& top = walk.back();
+        if (top.second < dom_children[top.first].size()) {
+            int child = dom_children[top.first][top.second++];
+            pre_[child] = clock++;
+            walk.emplace_back(child, 0);
+            continue;
+        }
+        post_[top.first] = clock++;
+        walk.pop_back();
+    }
+}
+
+void Cfg::Frontiers(vector<vector<int>>* frontiers) const {
+    frontiers->assign(preds.size(), vector<int>());
+    for (size_t b = 0; b < preds.size(); b++) {
+        if (preds[b].size() < 2) {
+            continue;
+        }
+        for (int pred : preds[b]) {
+            for (int x = pred; x != idom[b]; x = idom[x]) {
+                auto& frontier = (*frontiers)[x];
+                if (frontier.empty() || frontier.back() != static_cast<int>(b)) {
+                    frontier.push_back(static_cast<int>(b));
+                }
+            }
+        }
+    }
+}
+
+void FindLoops(const Cfg& cfg, vector<Loop>* loops) {
+    int n = static_cast<int>(cfg.preds.size());
+    vector<int> order(n);
+    for (size_t i = 0; i < cfg.rpo.size(); i++) {
+        order[cfg.rpo[i]] = static_cast<int>(i);
+    }
+
+    for (int header : cfg.rpo) {
+        vector<int> work;
+        for (int pred : cfg.preds[header]) {
+            if (cfg.Dominates(header, pred)) {
+                work.push_back(pred);
+            }
+        }
+        if (work.empty()) {
+            continue;
+        }
+
+        // walk back from the latches until the header.
+        vector<bool> in_loop(n, false);
+        in_loop[header] = true;
+        Loop loop;
+        loop.header = header;
+        loop.blocks.push_back(header);
+        while (!work.empty()) {
+            int b = work.back();
+            work.pop_back();
+            if (in_loop[b]) {
+                continue;
+            }
+            in_loop[b] = true;
+            loop.blocks.push_back(b);
+            for (int pred : cfg.preds[b]) {
+                work.push_back(pred);
+            }
+        }
+
+        sort(loop.blocks.begin(), loop.blocks.end(), [&order](int x, int y) { return order[x] < order[y]; });
+        loops->push_back(move(loop));
+    }
+
+    // an inner loop is smaller than the loops around it.
+    stable_sort(loops->begin(), loops->end(), [](const Loop& x, const Loop& y) {
+        return x.blocks.size() < y.blocks.size();
+    });
+}
+
+}// namespace ir
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+#include "ir/ir.h"
+
+using namespace std;
+
+namespace ir {
+
+// Cfg is the control flow graph and dominator tree of a function, it gets
+// stale once jumps of the function change. All blocks must be reachable.
+class Cfg {
+public:
+    explicit Cfg(const Function& func);
+
+    /**
+     * @brief Dominates reports whether every path from the entry to b goes through a.
+     */
+    bool Dominates(int a, int b) const {
+        return pre_[a] <= pre_[b] && post_[b] <= post_[a];
+    }
+
+    /**
+     * @brief Frontiers computes dominance frontiers, blocks where the dominance of a block ends.
+     */
+    void Frontiers(vector<vector<int>>* frontiers) const;
+
+    // preds and succs are distinct, in increasing order.
+    vector<vector<int>> preds;
+    vector<vector<int>> succs;
+    // rpo is the blocks in reverse post order.
+    vector<int> rpo;
+    // idom is the immediate dominator, the entry is its own.
+    vector<int> idom;
+    // dom_children are the children in the dominator tree.
+    vector<vector<int>> dom_children;
+private:
+    // pre_ and post_ number blocks in a walk of the dominator tree.
+    vector<int> pre_;
+    vector<int> post_;
+};
+
+// Loop is a natural loop, header dominates all the blocks.
+class Loop {
+public:
+    int header;
+    // blocks of the loop, the header included, in reverse post order.
+    vector<int> blocks;
+};
+
+/**
+ * @brief FindLoops finds natural loops of the back edges of cfg, loops of one header
+ * are merged. Inner loops come before the loops they are nested in.
+ */
+void FindLoops(const Cfg& cfg, vector<Loop>* loops);
+
+}// namespace ir
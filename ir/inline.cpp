@@ -0,0 +1,203 @@
+#include <functional>
+
+#include "ir/opt.h"
+
+namespace ir {
+
+// kMaxCalleeSize is the most instrs a callee may have to be inlined, params not counted.
+static const int kMaxCalleeSize = 40;
+// kMaxCallerSize stops inlining into a function which has grown this large.
+static const int kMaxCallerSize = 4000;
+
+static int Size(const Function& func) {
+    int size = 0;
+    for (const auto& block : func.blocks) {
+        for (const auto& instr : block.instrs) {
+            size += instr.op != Opcode::Param;
+        }
+    }
+    return size;
+}
+
+static bool HasCalls(const Function& func) {
+    for (const auto& block : func.blocks) {
+        for (const auto& instr : block.instrs) {
+            if (instr.op == Opcode::Call) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static bool CanInline(const Function& callee) {
+    const auto& entry = callee.blocks[0].instrs;
+    for (const auto& instr : entry) {
+        if (instr.op == Opcode::Phi) {
+            return false;
+        }
+    }
+    return !HasCalls(callee) && Size(callee) <= kMaxCalleeSize;
+}
+
+static void OffsetReg(int offset, Value* value) {
+    if (value->IsReg()) {
+        value->v += offset;
+    }
+}
+
+// InlineCall replaces the call at instrs[index] of block b by a copy of callee.
+// The rest of the block moves to a new block at the end which the copied
+// returns jump to, the returned value is merged by a phi there.
+static void InlineCall(Function* func, int b, size_t index, const Function& callee) {
+    Instr call = func->blocks[b].instrs[index];
+
+    int cont = static_cast<int>(func->blocks.size());
+    func->blocks.emplace_back();
+    {
+        auto& instrs = func->blocks[b].instrs;
+        func->blocks[cont].instrs.assign(instrs.begin() + static_cast<long>(index) + 1, instrs.end());
+        instrs.erase(instrs.begin() + static_cast<long>(index), instrs.end());
+    }
+
+    // successors of the moved terminator are now entered from the new block.
+    int succ[2];
+    int n = Successors(func->blocks[cont].instrs.back(), succ);
+    for (int i = 0; i < n; i++) {
+        for (auto& instr : func->blocks[succ[i]].instrs) {
+            if (instr.op != Opcode::Phi) {
+                break;
+            }
+            for (auto& pred : instr.phi_blocks) {
+                if (pred == b) {
+                    pred = cont;
+                }
+            }
+        }
+    }
+
+    int base = static_cast<int>(func->blocks.size());
+    int reg_offset = func->num_vregs;
+    int slot_offset = static_cast<int>(func->slots.size());
+    func->num_vregs += callee.num_vregs;
+    func->slots.insert(func->slots.end(), callee.slots.begin(), callee.slots.end());
+
+    Instr phi(Opcode::Phi);
+    phi.dst = call.dst;
+    for (size_t i = 0; i < callee.blocks.size(); i++) {
+        Block block = callee.blocks[i];
+        for (auto& instr : block.instrs) {
+            if (instr.dst >= 0) {
+                instr.dst += reg_offset;
+            }
+            OffsetReg(reg_offset, &instr.a);
+            OffsetReg(reg_offset, &instr.b);
+            for (auto& arg : instr.args) {
+                OffsetReg(reg_offset, &arg);
+            }
+            if (instr.target >= 0) {
+                instr.target += base;
+            }
+            if (instr.other >= 0) {
+                instr.other += base;
+            }
+            for (auto& pred : instr.phi_blocks) {
+                pred += base;
+            }
+
+            switch (instr.op) {
+                case Opcode::LoadSlot:
+                case Opcode::StoreSlot:
+                    instr.sym += slot_offset;
+                    break;
+                case Opcode::Param:
+                    instr.op = Opcode::Copy;
+                    instr.a = call.args[instr.sym];
+                    instr.sym = -1;
+                    break;
+                case Opcode::Return:
+                    if (call.dst >= 0) {
+                        phi.args.push_back(instr.a);
+                        phi.phi_blocks.push_back(base + static_cast<int>(i));
+                    }
+                    instr = Instr(Opcode::Jump);
+                    instr.target = cont;
+                    break;
+                default:
+                    break;
+            }
+        }
+        func->blocks.push_back(move(block));
+    }
+
+    if (call.dst >= 0) {
+        auto& instrs = func->blocks[cont].instrs;
+        if (phi.args.size() == 1) {
+            Instr copy(Opcode::Copy);
+            copy.dst = call.dst;
+            copy.a = phi.args[0];
+            instrs.insert(instrs.begin(), copy);
+        } else {
+            instrs.insert(instrs.begin(), phi);
+        }
+    }
+
+    Instr jump(Opcode::Jump);
+    jump.target = base;
+    func->blocks[b].instrs.push_back(jump);
+}
+
+static bool InlineInto(Module* module, Function* func) {
+    bool changed = false;
+    int size = Size(*func);
+    // blocks split off and copied are appended, so they are visited too.
+    for (int b = 0; b < static_cast<int>(func->blocks.size()) && size < kMaxCallerSize; b++) {
+        const auto& instrs = func->blocks[b].instrs;
+        for (size_t i = 0; i < instrs.size(); i++) {
+            if (instrs[i].op != Opcode::Call) {
+                continue;
+            }
+            const Function& callee = module->funcs[instrs[i].sym];
+            if (&callee == func || !CanInline(callee)) {
+                continue;
+            }
+            size += Size(callee);
+            InlineCall(func, b, i, callee);
+            changed = true;
+            break;
+        }
+    }
+    return changed;
+}
+
+bool InlineCalls(Module* module) {
+    int n = static_cast<int>(module->funcs.size());
+
+    // callees come before their callers, a cycle is broken where it is entered.
+    vector<int> order;
+    vector<bool> visited(n, false);
+    function<void(int)> visit = [&](int f) {
+        visited[f] = true;
+        for (const auto& block : module->funcs[f].blocks) {
+            for (const auto& instr : block.instrs) {
+                if (instr.op == Opcode::Call && !visited[instr.sym]) {
+                    visit(instr.sym);
+                }
+            }
+        }
+        order.push_back(f);
+    };
+    for (int f = 0; f < n; f++) {
+        if (!visited[f]) {
+            visit(f);
+        }
+    }
+
+    bool changed = false;
+    for (int f : order) {
+        changed |= InlineInto(module, &module->funcs[f]);
+    }
+    return changed;
+}
+
+}// namespace ir
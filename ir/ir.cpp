@@ -0,0 +1,342 @@
+#include <algorithm>
+
+#include "ir/ir.h"
+
+namespace ir {
+
+static const char* const opcode_names[] = {
+    "copy",
+    "neg",
+    "add",
+    "sub",
+    "mul",
+    "div",
+    "lss",
+    "leq",
+    "gre",
+    "geq",
+    "eql",
+    "neq",
+    "param",
+    "load_global",
+    "store_global",
+    "load_slot",
+    "store_slot",
+    "check_index",
+    "call",
+    "read",
+    "print",
+    "print_str",
+    "print_line",
+    "jump",
+    "branch",
+    "return",
+    "phi",
+};
+
+const char* OpcodeName(Opcode op) {
+    return opcode_names[static_cast<int>(op)];
+}
+
+static void UseValue(const Value& value, vector<int>* regs) {
+    if (value.IsReg()) {
+        regs->push_back(value.v);
+    }
+}
+
+void Uses(const Instr& instr, vector<int>* regs) {
+    UseValue(instr.a, regs);
+    UseValue(instr.b, regs);
+    for (const auto& arg : instr.args) {
+        UseValue(arg, regs);
+    }
+}
+
+int Successors(const Instr& instr, int succ[2]) {
+    switch (instr.op) {
+        case Opcode::Jump:
+            succ[0] = instr.target;
+            return 1;
+        case Opcode::Branch:
+            succ[0] = instr.target;
+            succ[1] = instr.other;
+            return instr.target == instr.other ? 1 : 2;
+        default:
+            return 0;
+    }
+}
+
+void RemoveUnreachableBlocks(Function* func) {
+    vector<int> index(func->blocks.size(), -1);
+    vector<int> work{0};
+    index[0] = 0;
+    while (!work.empty()) {
+        int block = work.back();
+        work.pop_back();
+
+        const auto& instrs = func->blocks[block].instrs;
+        int succ[2];
+        int n = instrs.empty() ? 0 : Successors(instrs.back(), succ);
+        for (int i = 0; i < n; i++) {
+            if (index[succ[i]] < 0) {
+                index[succ[i]] = 0;
+                work.push_back(succ[i]);
+            }
+        }
+    }
+
+    vector<Block> blocks;
+    for (size_t i = 0; i < func->blocks.size(); i++) {
+        if (index[i] >= 0) {
+            index[i] = static_cast<int>(blocks.size());
+            blocks.push_back(move(func->blocks[i]));
+        }
+    }
+
+    for (auto& block : blocks) {
+        for (auto& instr : block.instrs) {
+            if (instr.op != Opcode::Phi) {
+                break;
+            }
+
+            // drop args of removed predecessors.
+            size_t kept = 0;
+            for (size_t i = 0; i < instr.phi_blocks.size(); i++) {
+                if (index[instr.phi_blocks[i]] >= 0) {
+                    instr.phi_blocks[kept] = index[instr.phi_blocks[i]];
+                    instr.args[kept] = instr.args[i];
+                    kept++;
+                }
+            }
+            instr.phi_blocks.resize(kept);
+            instr.args.resize(kept);
+        }
+
+        if (!block.instrs.empty()) {
+            Instr& term = block.instrs.back();
+            if (term.target >= 0) {
+                term.target = index[term.target];
+            }
+            if (term.other >= 0) {
+                term.other = index[term.other];
+            }
+        }
+    }
+    func->blocks.swap(blocks);
+}
+
+void InsertBlock(Function* func, int pos) {
+    auto renumber = [pos](int* block) {
+        if (*block >= pos) {
+            (*block)++;
+        }
+    };
+
+    for (auto& block : func->blocks) {
+        for (auto& instr : block.instrs) {
+            for (auto& phi_block : instr.phi_blocks) {
+                renumber(&phi_block);
+            }
+            if (instr.IsTerminator()) {
+                renumber(&instr.target);
+                renumber(&instr.other);
+            }
+        }
+    }
+    func->blocks.insert(func->blocks.begin() + pos, Block());
+}
+
+int Verify(const Function& func, bool ssa, string* err) {
+    int num_blocks = static_cast<int>(func.blocks.size());
+    vector<vector<int>> preds(num_blocks);
+    for (int b = 0; b < num_blocks; b++) {
+        const auto& instrs = func.blocks[b].instrs;
+        if (instrs.empty() || !instrs.back().IsTerminator()) {
+            *err = "block b" + to_string(b) + " doesn't end with a terminator";
+            return -1;
+        }
+
+        int succ[2];
+        int n = Successors(instrs.back(), succ);
+        for (int i = 0; i < n; i++) {
+            if (succ[i] < 0 || succ[i] >= num_blocks) {
+                *err = "block b" + to_string(b) + " jumps out of the function";
+                return -1;
+            }
+            preds[succ[i]].push_back(b);
+        }
+    }
+
+    vector<bool> defined(func.num_vregs, false);
+    vector<int> regs;
+    for (int b = 0; b < num_blocks; b++) {
+        const auto& instrs = func.blocks[b].instrs;
+        sort(preds[b].begin(), preds[b].end());
+        bool in_head = true;
+        for (size_t i = 0; i < instrs.size(); i++) {
+            const Instr& instr = instrs[i];
+            string where = " in block b" + to_string(b);
+            if (instr.IsTerminator() && i + 1 != instrs.size()) {
+                *err = "terminator in the middle" + where;
+                return -1;
+            }
+
+            if (instr.op == Opcode::Phi) {
+                vector<int> phi_blocks = instr.phi_blocks;
+                sort(phi_blocks.begin(), phi_blocks.end());
+                if (!in_head) {
+                    *err = "phi after other instrs" + where;
+                    return -1;
+                }
+                if (phi_blocks != preds[b] || instr.args.size() != phi_blocks.size()) {
+                    *err = "phi args don't match predecessors" + where;
+                    return -1;
+                }
+            } else {
+                in_head = false;
+            }
+
+            regs.clear();
+            Uses(instr, &regs);
+            if (instr.dst >= 0) {
+                regs.push_back(instr.dst);
+            }
+            for (int reg : regs) {
+                if (reg >= func.num_vregs) {
+                    *err = "vreg %" + to_string(reg) + " out of range" + where;
+                    return -1;
+                }
+            }
+
+            if (ssa && instr.dst >= 0) {
+                if (defined[instr.dst]) {
+                    *err = "vreg %" + to_string(instr.dst) + " defined twice";
+                    return -1;
+                }
+                defined[instr.dst] = true;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void PrintValue(const Value& value, ostream& out) {
+    if (value.IsReg()) {
+        out << "%" << value.v;
+    } else if (value.IsImm()) {
+        out << value.v;
+    } else {
+        out << "_";
+    }
+}
+
+static void PrintInstr(const Module& module, const Instr& instr, ostream& out) {
+    out << "  ";
+    if (instr.dst >= 0) {
+        out << "%" << instr.dst << " = ";
+    }
+
+    switch (instr.op) {
+        case Opcode::Param:
+            out << "param " << instr.sym;
+            break;
+        case Opcode::LoadGlobal:
+        case Opcode::LoadSlot:
+        case Opcode::StoreGlobal:
+        case Opcode::StoreSlot:
+            out << OpcodeName(instr.op) << " ";
+            if (instr.op == Opcode::LoadGlobal || instr.op == Opcode::StoreGlobal) {
+                out << "@" << module.globals[instr.sym].name;
+            } else {
+                out << "$" << instr.sym;
+            }
+            out << "[";
+            PrintValue(instr.a, out);
+            out << "]";
+            if (!instr.b.IsNone()) {
+                out << ", ";
+                PrintValue(instr.b, out);
+            }
+            break;
+        case Opcode::Call:
+            out << "call " << module.funcs[instr.sym].name << "(";
+            for (size_t i = 0; i < instr.args.size(); i++) {
+                out << (i > 0 ? ", " : "");
+                PrintValue(instr.args[i], out);
+            }
+            out << ")";
+            break;
+        case Opcode::PrintStr:
+            out << "print_str \"" << module.strings[instr.sym] << "\"";
+            break;
+        case Opcode::Jump:
+            out << "jump b" << instr.target;
+            break;
+        case Opcode::Phi:
+            out << "phi ";
+            for (size_t i = 0; i < instr.args.size(); i++) {
+                out << (i > 0 ? ", [" : "[");
+                PrintValue(instr.args[i], out);
+                out << ", b" << instr.phi_blocks[i] << "]";
+            }
+            break;
+        case Opcode::Branch:
+            out << "branch " << OpcodeName(instr.cond) << " ";
+            PrintValue(instr.a, out);
+            out << ", ";
+            PrintValue(instr.b, out);
+            out << " ? b" << instr.target << " : b" << instr.other;
+            break;
+        default:
+            out << OpcodeName(instr.op);
+            if (instr.is_char) {
+                out << ".char";
+            }
+            if (!instr.a.IsNone()) {
+                out << " ";
+                PrintValue(instr.a, out);
+            }
+            if (!instr.b.IsNone()) {
+                out << ", ";
+                PrintValue(instr.b, out);
+            }
+            break;
+    }
+    out << "\n";
+}
+
+void Print(const Module& module, ostream& out) {
+    for (const auto& global : module.globals) {
+        out << "global @" << global.name;
+        if (global.is_array) {
+            out << "[" << global.size << "]";
+        }
+        if (!global.init.empty()) {
+            out << " = {";
+            for (size_t i = 0; i < global.init.size(); i++) {
+                out << (i > 0 ? ", " : "") << global.init[i];
+            }
+            out << "}";
+        }
+        out << "\n";
+    }
+
+    for (const auto& func : module.funcs) {
+        out << "\nfunc " << func.name << "(" << func.num_params << ")"
+            << (func.returns_value ? " value" : "") << ", vregs " << func.num_vregs;
+        for (size_t i = 0; i < func.slots.size(); i++) {
+            out << ", $" << i << "[" << func.slots[i] << "]";
+        }
+        out << "\n";
+
+        for (size_t i = 0; i < func.blocks.size(); i++) {
+            out << "b" << i << ":\n";
+            for (const auto& instr : func.blocks[i].instrs) {
+                PrintInstr(module, instr, out);
+            }
+        }
+    }
+}
+
+}// namespace ir
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace ir {
+
+// Opcode is the operation of a three address instruction.
+// dst is a virtual register, a and b are values, sym names a global, a slot,
+// a function or a string depending on the opcode.
+enum class Opcode : uint8_t {
+    Copy,        // dst = a
+    Neg,         // dst = -a
+    Add,         // dst = a + b
+    Sub,         // dst = a - b
+    Mul,         // dst = a * b
+    Div,         // dst = a / b
+    Lss,         // dst = a < b
+    Leq,         // dst = a <= b
+    Gre,         // dst = a > b
+    Geq,         // dst = a >= b
+    Eql,         // dst = a == b
+    Neq,         // dst = a != b
+    Param,       // dst = param sym of the function
+    LoadGlobal,  // dst = globals[sym][a]
+    StoreGlobal, // globals[sym][a] = b
+    LoadSlot,    // dst = slots[sym][a], slots are local arrays
+    StoreSlot,   // slots[sym][a] = b
+    CheckIndex,  // fail unless 0 <= a < b
+    Call,        // dst = funcs[sym](args), dst is -1 if the value is unused
+    Read,        // dst = scanned int, or char if is_char
+    Print,       // print a as int, or char if is_char
+    PrintStr,    // print strings[sym]
+    PrintLine,   // print a new line
+    Jump,        // goto target
+    Branch,      // if (a cond b) goto target else goto other
+    Return,      // return a, a is none for void
+    Phi,         // dst = args[i] if entered from block phi_blocks[i], only in ssa form
+};
+
+/**
+ * @brief OpcodeName returns name of op.
+ *
+ * @return string, e.g. "add" for Opcode::Add
+ */
+const char* OpcodeName(Opcode op);
+
+// Value is an operand, a virtual register or an immediate.
+class Value {
+public:
+    enum Kind : uint8_t {
+        None,
+        Reg,
+        Imm,
+    };
+
+    Value() : kind(None), v(0) {}
+    static Value Vreg(int reg) { return Value(Reg, reg); }
+    static Value Const(int32_t imm) { return Value(Imm, imm); }
+
+    bool IsNone() const { return kind == None; }
+    bool IsReg() const { return kind == Reg; }
+    bool IsImm() const { return kind == Imm; }
+
+    bool operator==(const Value& other) const { return kind == other.kind && v == other.v; }
+    bool operator!=(const Value& other) const { return !(*this == other); }
+
+    Kind kind;
+    // v is the register number or the immediate.
+    int32_t v;
+private:
+    Value(Kind kind, int32_t v) : kind(kind), v(v) {}
+};
+
+// Instr is a three address instruction.
+class Instr {
+public:
+    explicit Instr(Opcode op) : op(op) {}
+
+    // IsTerminator reports whether instr ends a block.
+    bool IsTerminator() const { return op == Opcode::Jump || op == Opcode::Branch || op == Opcode::Return; }
+
+    Opcode op;
+    // cond is the compare of a branch, one of Lss ... Neq.
+    Opcode cond = Opcode::Neq;
+    int dst = -1;
+    Value a, b;
+    int sym = -1;
+    bool is_char = false;
+    vector<Value> args;
+    // target and other are block indexes of jumps.
+    int target = -1;
+    int other = -1;
+    // phi_blocks are the predecessors args of a phi come from.
+    vector<int> phi_blocks;
+};
+
+// Block is a basic block, only its last instruction is a terminator and
+// phis are at its head.
+class Block {
+public:
+    vector<Instr> instrs;
+};
+
+// Function is a function of virtual registers, blocks[0] is the entry.
+// Params are defined by Param instrs at the head of the entry.
+class Function {
+public:
+    int NewVreg() { return num_vregs++; }
+
+    string name;
+    int num_params = 0;
+    bool returns_value = false;
+    vector<Block> blocks;
+    int num_vregs = 0;
+    // slots[i] is the size of local array i, in words.
+    vector<int> slots;
+};
+
+// Global is a global variable or array, init is all zero if empty.
+class Global {
+public:
+    string name;
+    int size = 1;
+    bool is_array = false;
+    vector<int32_t> init;
+};
+
+// Module is the ir of a file.
+class Module {
+public:
+    vector<Global> globals;
+    vector<Function> funcs;
+    // strings are printf literals, with escapes already decoded.
+    vector<string> strings;
+    int main = -1;
+};
+
+/**
+ * @brief Uses appends virtual registers read by instr to regs.
+ */
+void Uses(const Instr& instr, vector<int>* regs);
+
+/**
+ * @brief Successors returns count of blocks instr may jump to, they are stored in succ.
+ */
+int Successors(const Instr& instr, int succ[2]);
+
+/**
+ * @brief RemoveUnreachableBlocks drops blocks not reachable from the entry,
+ * the rest keep their order, jumps and phis are renumbered.
+ */
+void RemoveUnreachableBlocks(Function* func);
+
+/**
+ * @brief InsertBlock inserts an empty block at index pos, blocks from pos on
+ * move up by one and jumps and phis are renumbered.
+ */
+void InsertBlock(Function* func, int pos);
+
+/**
+ * @brief Verify checks func is well formed: blocks end with their only terminator,
+ * jumps are in range, phis are at block heads with one arg per predecessor.
+ *
+ * @param ssa also check every vreg is defined once.
+ * @param err description of the first violation.
+ * @return 0 if func is well formed, -1 if not.
+ */
+int Verify(const Function& func, bool ssa, string* err);
+
+/**
+ * @brief Print writes a listing of module to out.
+ * e.g. '  %3 = add %1, 4'
+ */
+void Print(const Module& module, ostream& out);
+
+}// namespace ir
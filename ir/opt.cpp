@@ -0,0 +1,794 @@
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+
+#include "ir/bitset.h"
+#include "ir/cfg.h"
+#include "ir/opt.h"
+#include "ir/ssa.h"
+#include "prof/prof.h"
+
+namespace ir {
+
+static bool IsBinary(Opcode op) {
+    return op >= Opcode::Add && op <= Opcode::Neq;
+}
+
+static bool IsCommutative(Opcode op) {
+    return op == Opcode::Add || op == Opcode::Mul || op == Opcode::Eql || op == Opcode::Neq;
+}
+
+// IsPure reports whether instr only computes its dst, it may still trap if it is a division.
+static bool IsPure(const Instr& instr) {
+    return instr.op == Opcode::Copy || instr.op == Opcode::Neg || IsBinary(instr.op);
+}
+
+// CanTrap reports whether instr is a division which may fail.
+static bool CanTrap(const Instr& instr) {
+    return instr.op == Opcode::Div && !(instr.b.IsImm() && instr.b.v != 0);
+}
+
+static bool HasEffects(const Instr& instr) {
+    switch (instr.op) {
+        case Opcode::StoreGlobal:
+        case Opcode::StoreSlot:
+        case Opcode::CheckIndex:
+        case Opcode::Call:
+        case Opcode::Read:
+        case Opcode::Print:
+        case Opcode::PrintStr:
+        case Opcode::PrintLine:
+        case Opcode::Jump:
+        case Opcode::Branch:
+        case Opcode::Return:
+            return true;
+        default:
+            return CanTrap(instr);
+    }
+}
+
+// Fold computes op of constants with the wrapping of the vm, false for a division by zero.
+static bool Fold(Opcode op, int32_t a, int32_t b, int32_t* result) {
+    uint32_t ua = static_cast<uint32_t>(a), ub = static_cast<uint32_t>(b);
+    switch (op) {
+        case Opcode::Add: *result = static_cast<int32_t>(ua + ub); return true;
+        case Opcode::Sub: *result = static_cast<int32_t>(ua - ub); return true;
+        case Opcode::Mul: *result = static_cast<int32_t>(ua * ub); return true;
+        case Opcode::Div:
+            if (b == 0) {
+                return false;
+            }
+            *result = a == INT_MIN && b == -1 ? INT_MIN : a / b;
+            return true;
+        case Opcode::Lss: *result = a < b; return true;
+        case Opcode::Leq: *result = a <= b; return true;
+        case Opcode::Gre: *result = a > b; return true;
+        case Opcode::Geq: *result = a >= b; return true;
+        case Opcode::Eql: *result = a == b; return true;
+        case Opcode::Neq: *result = a != b; return true;
+        default: return false;
+    }
+}
+
+// SimplifyBinary returns the value of a binary instr if it is known without computing it.
+static bool SimplifyBinary(const Instr& instr, Value* value) {
+    const Value& a = instr.a;
+    const Value& b = instr.b;
+    int32_t result;
+    if (a.IsImm() && b.IsImm() && Fold(instr.op, a.v, b.v, &result)) {
+        *value = Value::Const(result);
+        return true;
+    }
+
+    bool same = a.IsReg() && a == b;
+    switch (instr.op) {
+        case Opcode::Add:
+            if (b == Value::Const(0)) {
+                *value = a;
+                return true;
+            }
+            break;
+        case Opcode::Sub:
+            if (b == Value::Const(0)) {
+                *value = a;
+                return true;
+            }
+            if (same) {
+                *value = Value::Const(0);
+                return true;
+            }
+            break;
+        case Opcode::Mul:
+            if (b == Value::Const(1)) {
+                *value = a;
+                return true;
+            }
+            if (b == Value::Const(0)) {
+                *value = Value::Const(0);
+                return true;
+            }
+            break;
+        case Opcode::Div:
+            if (b == Value::Const(1)) {
+                *value = a;
+                return true;
+            }
+            break;
+        case Opcode::Lss:
+        case Opcode::Gre:
+        case Opcode::Neq:
+            if (same) {
+                *value = Value::Const(0);
+                return true;
+            }
+            break;
+        case Opcode::Leq:
+        case Opcode::Geq:
+        case Opcode::Eql:
+            if (same) {
+                *value = Value::Const(1);
+                return true;
+            }
+            break;
+        default:
+            break;
+    }
+    return false;
+}
+
+// Replacements maps vregs to the values which replace them.
+class Replacements {
+public:
+    explicit Replacements(int n) : values_(n) {}
+
+    void Set(int reg, const Value& value) { values_[reg] = value; }
+
+    // Apply rewrites value to its final replacement, returns whether it changed.
+    bool Apply(Value* value) {
+        Value cur = *value;
+        while (cur.IsReg() && !values_[cur.v].IsNone()) {
+            cur = values_[cur.v];
+        }
+        if (cur == *value) {
+            return false;
+        }
+
+        // shorten the chain for the next lookups.
+        if (value->IsReg()) {
+            values_[value->v] = cur;
+        }
+        *value = cur;
+        return true;
+    }
+
+    bool ApplyAll(Instr* instr) {
+        bool changed = Apply(&instr->a);
+        changed |= Apply(&instr->b);
+        for (auto& arg : instr->args) {
+            changed |= Apply(&arg);
+        }
+        return changed;
+    }
+private:
+    vector<Value> values_;
+};
+
+// DropPhiArg drops args of phis of block which come from pred.
+static void DropPhiArg(Block* block, int pred) {
+    for (auto& phi : block->instrs) {
+        if (phi.op != Opcode::Phi) {
+            break;
+        }
+        for (size_t i = 0; i < phi.phi_blocks.size(); i++) {
+            if (phi.phi_blocks[i] == pred) {
+                phi.phi_blocks.erase(phi.phi_blocks.begin() + i);
+                phi.args.erase(phi.args.begin() + i);
+                break;
+            }
+        }
+    }
+}
+
+bool Simplify(Function* func) {
+    Replacements repl(func->num_vregs);
+    bool changed_any = false;
+    for (bool changed = true; changed;) {
+        changed = false;
+        bool cfg_changed = false;
+        for (size_t b = 0; b < func->blocks.size(); b++) {
+            auto& instrs = func->blocks[b].instrs;
+            size_t kept = 0;
+            for (size_t i = 0; i < instrs.size(); i++) {
+                Instr& instr = instrs[i];
+                changed |= repl.ApplyAll(&instr);
+
+                Value value;
+                bool replaced = false;
+                switch (instr.op) {
+                    case Opcode::Copy:
+                        value = instr.a;
+                        replaced = true;
+                        break;
+                    case Opcode::Phi: {
+                        // a phi whose args are itself or one value is that value.
+                        bool trivial = true;
+                        for (const auto& arg : instr.args) {
+                            if (arg == Value::Vreg(instr.dst) || arg == value) {
+                                continue;
+                            }
+                            trivial = value.IsNone();
+                            value = arg;
+                            if (!trivial) {
+                                break;
+                            }
+                        }
+                        replaced = trivial;
+                        if (replaced && value.IsNone()) {
+                            value = Value::Const(0);
+                        }
+                        break;
+                    }
+                    case Opcode::Neg:
+                        if (instr.a.IsImm()) {
+                            value = Value::Const(static_cast<int32_t>(0u - static_cast<uint32_t>(instr.a.v)));
+                            replaced = true;
+                        }
+                        break;
+                    case Opcode::CheckIndex:
+                        if (instr.a.IsImm() && instr.a.v >= 0 && instr.a.v < instr.b.v) {
+                            changed = true;
+                            continue;
+                        }
+                        break;
+                    case Opcode::Branch: {
+                        int32_t taken;
+                        int dropped = -1;
+                        if (instr.target == instr.other) {
+                            dropped = instr.other;
+                        } else if (instr.a.IsImm() && instr.b.IsImm() && Fold(instr.cond, instr.a.v, instr.b.v, &taken)) {
+                            if (!taken) {
+                                swap(instr.target, instr.other);
+                            }
+                            dropped = instr.other;
+                            DropPhiArg(&func->blocks[dropped], static_cast<int>(b));
+                        }
+                        if (dropped >= 0) {
+                            instr.op = Opcode::Jump;
+                            instr.a = instr.b = Value();
+                            instr.other = -1;
+                            changed = cfg_changed = true;
+                        }
+                        break;
+                    }
+                    default:
+                        if (IsBinary(instr.op)) {
+                            replaced = SimplifyBinary(instr, &value);
+                            if (!replaced && IsCommutative(instr.op) && instr.a.IsImm() && instr.b.IsReg()) {
+                                // constants go right, for immediates of targets and for cse.
+                                swap(instr.a, instr.b);
+                                changed = true;
+                            }
+                        }
+                        break;
+                }
+
+                if (replaced) {
+                    repl.Set(instr.dst, value);
+                    changed = true;
+                    continue;
+                }
+                if (kept != i) {
+                    instrs[kept] = move(instr);
+                }
+                kept++;
+            }
+            instrs.erase(instrs.begin() + kept, instrs.end());
+        }
+
+        if (cfg_changed) {
+            RemoveUnreachableBlocks(func);
+        }
+        changed_any |= changed;
+    }
+    return changed_any;
+}
+
+bool EliminateDeadCode(Function* func) {
+    int n = func->num_vregs;
+    vector<const Instr*> def(n, nullptr);
+    for (const auto& block : func->blocks) {
+        for (const auto& instr : block.instrs) {
+            if (instr.dst >= 0) {
+                def[instr.dst] = &instr;
+            }
+        }
+    }
+
+    BitSet live(n);
+    vector<int> work, regs;
+    auto mark = [&](const Instr& instr) {
+        regs.clear();
+        Uses(instr, &regs);
+        for (int reg : regs) {
+            if (!live.Has(reg)) {
+                live.Add(reg);
+                work.push_back(reg);
+            }
+        }
+    };
+    for (const auto& block : func->blocks) {
+        for (const auto& instr : block.instrs) {
+            if (HasEffects(instr)) {
+                mark(instr);
+            }
+        }
+    }
+    while (!work.empty()) {
+        int reg = work.back();
+        work.pop_back();
+        if (def[reg] != nullptr) {
+            mark(*def[reg]);
+        }
+    }
+
+    bool changed = false;
+    for (auto& block : func->blocks) {
+        size_t kept = 0;
+        for (size_t i = 0; i < block.instrs.size(); i++) {
+            Instr& instr = block.instrs[i];
+            if (instr.dst >= 0 && !live.Has(instr.dst)) {
+                if (!HasEffects(instr)) {
+                    changed = true;
+                    continue;
+                }
+                if (instr.op == Opcode::Call) {
+                    instr.dst = -1;
+                    changed = true;
+                }
+            }
+            if (kept != i) {
+                block.instrs[kept] = move(instr);
+            }
+            kept++;
+        }
+        block.instrs.erase(block.instrs.begin() + kept, block.instrs.end());
+    }
+    return changed;
+}
+
+// ExprKey identifies the value of an instr for cse, epoch tells apart loads
+// separated by a store or a call.
+struct ExprKey {
+    Opcode op;
+    Value a, b;
+    int sym;
+    bool is_char;
+    int epoch;
+
+    bool operator==(const ExprKey& other) const {
+        return op == other.op && a == other.a && b == other.b && sym == other.sym &&
+            is_char == other.is_char && epoch == other.epoch;
+    }
+};
+
+struct ExprKeyHash {
+    size_t operator()(const ExprKey& key) const {
+        size_t h = static_cast<size_t>(key.op);
+        for (int part : {static_cast<int>(key.a.kind), key.a.v, static_cast<int>(key.b.kind), key.b.v, key.sym, key.epoch}) {
+            h = h * 1000003u ^ static_cast<size_t>(part);
+        }
+        return h;
+    }
+};
+
+bool EliminateCommonSubexprs(Function* func) {
+    Cfg cfg(*func);
+    Replacements repl(func->num_vregs);
+    unordered_map<ExprKey, int, ExprKeyHash> available;
+    vector<ExprKey> scope;
+    vector<size_t> marks(func->blocks.size());
+    bool changed = false;
+    int epochs = 0;
+
+    // a negative entry is the exit of the block ~entry.
+    vector<int> walk{0};
+    while (!walk.empty()) {
+        int b = walk.back();
+        walk.pop_back();
+        if (b < 0) {
+            for (size_t i = marks[~b]; i < scope.size(); i++) {
+                available.erase(scope[i]);
+            }
+            scope.resize(marks[~b]);
+            continue;
+        }
+
+        marks[b] = scope.size();
+        int epoch = ++epochs;
+        auto& instrs = func->blocks[b].instrs;
+        size_t kept = 0;
+        for (size_t i = 0; i < instrs.size(); i++) {
+            Instr& instr = instrs[i];
+            changed |= repl.ApplyAll(&instr);
+
+            bool is_load = instr.op == Opcode::LoadGlobal || instr.op == Opcode::LoadSlot;
+            if (instr.op == Opcode::StoreGlobal || instr.op == Opcode::StoreSlot || instr.op == Opcode::Call) {
+                epoch = ++epochs;
+            }
+
+            if ((IsPure(instr) && instr.op != Opcode::Copy) || is_load || instr.op == Opcode::CheckIndex) {
+                ExprKey key{instr.op, instr.a, instr.b, instr.sym, instr.is_char, is_load ? epoch : 0};
+                if (IsCommutative(instr.op) && (key.b.kind < key.a.kind || (key.a.kind == key.b.kind && key.b.v < key.a.v))) {
+                    swap(key.a, key.b);
+                }
+
+                auto it = available.find(key);
+                if (it != available.end()) {
+                    if (instr.dst >= 0) {
+                        repl.Set(instr.dst, Value::Vreg(it->second));
+                    }
+                    changed = true;
+                    continue;
+                }
+                available.emplace(key, instr.dst);
+                scope.push_back(key);
+            }
+
+            if (kept != i) {
+                instrs[kept] = move(instr);
+            }
+            kept++;
+        }
+        instrs.erase(instrs.begin() + kept, instrs.end());
+
+        walk.push_back(~b);
+        for (auto it = cfg.dom_children[b].rbegin(); it != cfg.dom_children[b].rend(); ++it) {
+            walk.push_back(*it);
+        }
+    }
+
+    // phis may read values replaced later in the walk.
+    for (auto& block : func->blocks) {
+        for (auto& instr : block.instrs) {
+            changed |= repl.ApplyAll(&instr);
+        }
+    }
+    return changed;
+}
+
+// AddPreheader makes sure the header of loop has one predecessor outside the
+// loop which only jumps to it. It returns true if a block was inserted.
+static bool AddPreheader(Function* func, const Cfg& cfg, const Loop& loop) {
+    int header = loop.header;
+    vector<int> outside;
+    for (int pred : cfg.preds[header]) {
+        if (find(loop.blocks.begin(), loop.blocks.end(), pred) == loop.blocks.end()) {
+            outside.push_back(pred);
+        }
+    }
+    if (header == 0 || (outside.size() == 1 && cfg.succs[outside[0]].size() == 1)) {
+        return false;
+    }
+
+    // the preheader goes right before the header, so it falls through.
+    InsertBlock(func, header);
+    int pre = header++;
+    for (auto& pred : outside) {
+        if (pred >= pre) {
+            pred++;
+        }
+        Instr& term = func->blocks[pred].instrs.back();
+        if (term.target == header) {
+            term.target = pre;
+        }
+        if (term.other == header) {
+            term.other = pre;
+        }
+    }
+
+    auto& pre_instrs = func->blocks[pre].instrs;
+    for (auto& phi : func->blocks[header].instrs) {
+        if (phi.op != Opcode::Phi) {
+            break;
+        }
+
+        // args from outside move to a phi of the preheader.
+        Instr merge(Opcode::Phi);
+        size_t kept = 0;
+        for (size_t i = 0; i < phi.phi_blocks.size(); i++) {
+            if (find(outside.begin(), outside.end(), phi.phi_blocks[i]) != outside.end()) {
+                merge.phi_blocks.push_back(phi.phi_blocks[i]);
+                merge.args.push_back(phi.args[i]);
+            } else {
+                phi.phi_blocks[kept] = phi.phi_blocks[i];
+                phi.args[kept] = phi.args[i];
+                kept++;
+            }
+        }
+        phi.phi_blocks.resize(kept);
+        phi.args.resize(kept);
+
+        phi.phi_blocks.push_back(pre);
+        if (merge.args.size() == 1) {
+            phi.args.push_back(merge.args[0]);
+        } else {
+            merge.dst = func->NewVreg();
+            phi.args.push_back(Value::Vreg(merge.dst));
+            pre_instrs.push_back(merge);
+        }
+    }
+
+    Instr jump(Opcode::Jump);
+    jump.target = header;
+    pre_instrs.push_back(jump);
+    return true;
+}
+
+bool HoistLoopInvariants(Function* func) {
+    bool changed = false;
+    for (bool inserted = true; inserted;) {
+        inserted = false;
+        Cfg cfg(*func);
+        vector<Loop> loops;
+        FindLoops(cfg, &loops);
+        for (const auto& loop : loops) {
+            if (AddPreheader(func, cfg, loop)) {
+                // blocks are renumbered, start over.
+                inserted = changed = true;
+                break;
+            }
+        }
+    }
+
+    Cfg cfg(*func);
+    vector<Loop> loops;
+    FindLoops(cfg, &loops);
+
+    vector<int> def_block(func->num_vregs, -1);
+    for (size_t b = 0; b < func->blocks.size(); b++) {
+        for (const auto& instr : func->blocks[b].instrs) {
+            if (instr.dst >= 0) {
+                def_block[instr.dst] = static_cast<int>(b);
+            }
+        }
+    }
+
+    vector<int> regs;
+    for (const auto& loop : loops) {
+        if (loop.header == 0) {
+            continue;
+        }
+
+        int pre = -1;
+        for (int pred : cfg.preds[loop.header]) {
+            if (find(loop.blocks.begin(), loop.blocks.end(), pred) == loop.blocks.end()) {
+                pre = pred;
+            }
+        }
+
+        vector<bool> in_loop(func->blocks.size(), false);
+        for (int b : loop.blocks) {
+            in_loop[b] = true;
+        }
+
+        for (int b : loop.blocks) {
+            auto& instrs = func->blocks[b].instrs;
+            size_t kept = 0;
+            for (size_t i = 0; i < instrs.size(); i++) {
+                Instr& instr = instrs[i];
+                bool invariant = IsPure(instr) && !CanTrap(instr);
+                if (invariant) {
+                    regs.clear();
+                    Uses(instr, &regs);
+                    for (int reg : regs) {
+                        invariant &= def_block[reg] < 0 || !in_loop[def_block[reg]];
+                    }
+                }
+
+                if (invariant) {
+                    auto& pre_instrs = func->blocks[pre].instrs;
+                    def_block[instr.dst] = pre;
+                    pre_instrs.insert(pre_instrs.end() - 1, move(instr));
+                    changed = true;
+                    continue;
+                }
+                if (kept != i) {
+                    instrs[kept] = move(instr);
+                }
+                kept++;
+            }
+            instrs.erase(instrs.begin() + kept, instrs.end());
+        }
+    }
+    return changed;
+}
+
+// RenamePhiPred makes phis of block take the args from pred as from new_pred.
+static void RenamePhiPred(Block* block, int pred, int new_pred) {
+    for (auto& phi : block->instrs) {
+        if (phi.op != Opcode::Phi) {
+            break;
+        }
+        for (auto& phi_block : phi.phi_blocks) {
+            if (phi_block == pred) {
+                phi_block = new_pred;
+            }
+        }
+    }
+}
+
+bool SimplifyCfg(Function* func) {
+    bool changed = false;
+    int num_blocks = static_cast<int>(func->blocks.size());
+
+    // skip blocks of a lone jump, unless phis of the target tell the paths apart.
+    for (int b = 1; b < num_blocks; b++) {
+        const auto& instrs = func->blocks[b].instrs;
+        if (instrs.size() != 1 || instrs[0].op != Opcode::Jump || instrs[0].target == b ||
+            func->blocks[instrs[0].target].instrs[0].op == Opcode::Phi) {
+            continue;
+        }
+
+        int target = instrs[0].target;
+        for (auto& block : func->blocks) {
+            Instr& term = block.instrs.back();
+            if (&term == &instrs[0]) {
+                continue;
+            }
+            if (term.op == Opcode::Jump || term.op == Opcode::Branch) {
+                if (term.target == b) {
+                    term.target = target;
+                    changed = true;
+                }
+                if (term.other == b) {
+                    term.other = target;
+                    changed = true;
+                }
+                if (term.op == Opcode::Branch && term.target == term.other) {
+                    term.op = Opcode::Jump;
+                    term.a = term.b = Value();
+                    term.other = -1;
+                }
+            }
+        }
+    }
+    if (changed) {
+        RemoveUnreachableBlocks(func);
+        num_blocks = static_cast<int>(func->blocks.size());
+    }
+
+    // merge a block into its predecessor if it is the only one and jumps to it.
+    Cfg cfg(*func);
+    vector<bool> merged(num_blocks, false);
+    for (int b = 0; b < num_blocks; b++) {
+        if (merged[b]) {
+            continue;
+        }
+        auto& instrs = func->blocks[b].instrs;
+        while (instrs.back().op == Opcode::Jump) {
+            int next = instrs.back().target;
+            if (next == 0 || next == b || cfg.preds[next].size() != 1 || func->blocks[next].instrs[0].op == Opcode::Phi) {
+                break;
+            }
+
+            auto& next_instrs = func->blocks[next].instrs;
+            instrs.pop_back();
+            instrs.insert(instrs.end(), next_instrs.begin(), next_instrs.end());
+            // next may have absorbed blocks already, so its successors are read from the code.
+            int succ[2];
+            int num_succs = Successors(instrs.back(), succ);
+            for (int i = 0; i < num_succs; i++) {
+                RenamePhiPred(&func->blocks[succ[i]], next, b);
+            }
+            // a merged block is unreachable, keep it well formed until it is removed.
+            next_instrs.clear();
+            next_instrs.emplace_back(Opcode::Return);
+            merged[next] = true;
+            changed = true;
+        }
+    }
+    if (changed) {
+        RemoveUnreachableBlocks(func);
+    }
+    return changed;
+}
+
+static bool ToSSA(Function* func) {
+    ConstructSSA(func);
+    return true;
+}
+
+static bool FromSSA(Function* func) {
+    DestructSSA(func);
+    return true;
+}
+
+bool PropagateConstGlobals(Module* module) {
+    vector<bool> stored(module->globals.size(), false);
+    for (const auto& func : module->funcs) {
+        for (const auto& block : func.blocks) {
+            for (const auto& instr : block.instrs) {
+                if (instr.op == Opcode::StoreGlobal) {
+                    stored[instr.sym] = true;
+                }
+            }
+        }
+    }
+
+    bool changed = false;
+    for (auto& func : module->funcs) {
+        for (auto& block : func.blocks) {
+            for (auto& instr : block.instrs) {
+                if (instr.op != Opcode::LoadGlobal || stored[instr.sym] || !instr.a.IsImm()) {
+                    continue;
+                }
+
+                // an index out of range is left to its check.
+                const Global& global = module->globals[instr.sym];
+                if (instr.a.v < 0 || instr.a.v >= global.size) {
+                    continue;
+                }
+                instr.op = Opcode::Copy;
+                instr.a = Value::Const(global.init.empty() ? 0 : global.init[instr.a.v]);
+                instr.sym = -1;
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+PassManager::PassManager(int level) {
+    if (level <= 0) {
+        return;
+    }
+
+    Add("ssa", ToSSA, true);
+    AddModulePass("const-globals", PropagateConstGlobals);
+    Add("simplify", Simplify, true);
+    if (level >= 2) {
+        AddModulePass("inline", InlineCalls);
+        Add("simplify", Simplify, true);
+        Add("simplify-cfg", SimplifyCfg, true);
+        Add("cse", EliminateCommonSubexprs, true);
+        Add("licm", HoistLoopInvariants, true);
+        Add("simplify", Simplify, true);
+        Add("cse", EliminateCommonSubexprs, true);
+    }
+    Add("dce", EliminateDeadCode, true);
+    Add("simplify-cfg", SimplifyCfg, true);
+    Add("out-of-ssa", FromSSA, false);
+}
+
+void PassManager::Add(const char* name, Pass pass, bool ssa) {
+    passes_.push_back(Entry{name, pass, nullptr, ssa});
+}
+
+void PassManager::AddModulePass(const char* name, ModulePass pass) {
+    bool ssa = !passes_.empty() && passes_.back().ssa;
+    passes_.push_back(Entry{name, nullptr, pass, ssa});
+}
+
+int PassManager::Run(Module* module, string* err) const {
+    prof::ScopedPhase phase(prof::Optimize);
+    for (const auto& entry : passes_) {
+        if (entry.module_pass != nullptr) {
+            entry.module_pass(module);
+        } else {
+            for (auto& func : module->funcs) {
+                entry.pass(&func);
+            }
+        }
+
+        for (const auto& func : module->funcs) {
+            string violation;
+            if (Verify(func, entry.ssa, &violation) != 0) {
+                *err = "ir of " + func.name + " is broken after " + entry.name + ": " + violation;
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+}// namespace ir
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ir/ir.h"
+
+using namespace std;
+
+namespace ir {
+
+// Pass transforms a function, it returns whether anything changed.
+typedef bool (*Pass)(Function* func);
+
+// ModulePass transforms functions of a module together, it returns whether anything changed.
+typedef bool (*ModulePass)(Module* module);
+
+/**
+ * @brief Simplify folds constants, propagates copies and constants, drops trivial
+ * phis and checks of constant indexes and folds branches of known conditions.
+ * func must be in ssa form.
+ */
+bool Simplify(Function* func);
+
+/**
+ * @brief EliminateDeadCode drops instrs whose results are never used and which
+ * have no effects. func must be in ssa form.
+ */
+bool EliminateDeadCode(Function* func);
+
+/**
+ * @brief EliminateCommonSubexprs reuses a value computed in a dominating block instead of
+ * computing it again, index checks included. Loads are only reused within a block up
+ * to the next store or call. func must be in ssa form.
+ */
+bool EliminateCommonSubexprs(Function* func);
+
+/**
+ * @brief HoistLoopInvariants moves computations whose operands don't change in a loop
+ * to a preheader in front of it. Loads and checks stay, the loop may not run at all.
+ * func must be in ssa form.
+ */
+bool HoistLoopInvariants(Function* func);
+
+/**
+ * @brief SimplifyCfg merges a block into its only predecessor and skips blocks which only jump.
+ */
+bool SimplifyCfg(Function* func);
+
+/**
+ * @brief PropagateConstGlobals replaces loads of a constant index from globals which are
+ * never stored, consts among them, with the initial values.
+ */
+bool PropagateConstGlobals(Module* module);
+
+/**
+ * @brief InlineCalls replaces calls of small functions without calls by their bodies.
+ * Callees are inlined into their callers bottom up, so a function whose calls were all
+ * inlined may be inlined itself. Functions must be in ssa form.
+ */
+bool InlineCalls(Module* module);
+
+// PassManager runs a pipeline of passes, a function pass runs on every
+// function, and verifies all functions after each pass.
+class PassManager {
+public:
+    /**
+     * @brief PassManager makes the pipeline of an optimization level.
+     * 0 runs nothing, 1 folds constants and drops dead code, 2 adds inlining,
+     * common subexpressions and loop invariant code motion.
+     */
+    explicit PassManager(int level);
+
+    /**
+     * @brief Add appends a pass to the pipeline.
+     *
+     * @param ssa whether functions are in ssa form after the pass.
+     */
+    void Add(const char* name, Pass pass, bool ssa);
+
+    /**
+     * @brief AddModulePass appends a module pass to the pipeline, it keeps the form of functions.
+     */
+    void AddModulePass(const char* name, ModulePass pass);
+
+    /**
+     * @brief Run optimizes all functions of module.
+     *
+     * @param err pass and violation if a pass broke a function.
+     * @return 0 if succeed, -1 if failed.
+     */
+    int Run(Module* module, string* err) const;
+private:
+    // Entry is a pass, one of pass and module_pass is set.
+    struct Entry {
+        const char* name;
+        Pass pass;
+        ModulePass module_pass;
+        bool ssa;
+    };
+
+    vector<Entry> passes_;
+};
+
+}// namespace ir
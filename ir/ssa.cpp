@@ -0,0 +1,407 @@
+#include <algorithm>
+#include <numeric>
+
+#include "ir/bitset.h"
+#include "ir/cfg.h"
+#include "ir/ssa.h"
+
+namespace ir {
+
+// RenameUse replaces a use of a vreg by its current ssa name, 0 if it has none.
+static void RenameUse(const vector<vector<int>>& stacks, Value* value) {
+    if (value->IsReg()) {
+        const auto& stack = stacks[value->v];
+        *value = stack.empty() ? Value::Const(0) : Value::Vreg(stack.back());
+    }
+}
+
+void ConstructSSA(Function* func) {
+    Cfg cfg(*func);
+    int n = func->num_vregs;
+    int num_blocks = static_cast<int>(func->blocks.size());
+
+    // only vregs read before written in some block need phis, the semi-pruned form of Briggs.
+    BitSet non_local(n);
+    vector<vector<int>> def_blocks(n);
+    vector<int> regs;
+    for (int b = 0; b < num_blocks; b++) {
+        BitSet killed(n);
+        for (const auto& instr : func->blocks[b].instrs) {
+            regs.clear();
+            Uses(instr, &regs);
+            for (int reg : regs) {
+                if (!killed.Has(reg)) {
+                    non_local.Add(reg);
+                }
+            }
+            if (instr.dst >= 0) {
+                killed.Add(instr.dst);
+                if (def_blocks[instr.dst].empty() || def_blocks[instr.dst].back() != b) {
+                    def_blocks[instr.dst].push_back(b);
+                }
+            }
+        }
+    }
+
+    vector<vector<int>> frontiers;
+    cfg.Frontiers(&frontiers);
+
+    // sym of a phi is its vreg until renaming is done.
+    vector<vector<Instr>> phis(num_blocks);
+    vector<int> has_phi(num_blocks, -1), queued(num_blocks, -1);
+    non_local.ForEach([&](int reg) {
+        vector<int> work = def_blocks[reg];
+        for (int b : work) {
+            queued[b] = reg;
+        }
+        while (!work.empty()) {
+            int b = work.back();
+            work.pop_back();
+            for (int join : frontiers[b]) {
+                if (has_phi[join] == reg) {
+                    continue;
+                }
+                has_phi[join] = reg;
+
+                Instr phi(Opcode::Phi);
+                phi.dst = reg;
+                phi.sym = reg;
+                phi.phi_blocks = cfg.preds[join];
+                phi.args.assign(phi.phi_blocks.size(), Value::Const(0));
+                phis[join].push_back(move(phi));
+
+                if (queued[join] != reg) {
+                    queued[join] = reg;
+                    work.push_back(join);
+                }
+            }
+        }
+    });
+    for (int b = 0; b < num_blocks; b++) {
+        auto& instrs = func->blocks[b].instrs;
+        instrs.insert(instrs.begin(), phis[b].begin(), phis[b].end());
+    }
+
+    // rename along the dominator tree, stacks[vreg] are the names of vreg in scope.
+    vector<vector<int>> stacks(n);
+    vector<int> pushed;
+    int num_vregs = 0;
+    // a negative entry is the exit of the block ~entry.
+    vector<int> walk{0};
+    vector<size_t> marks(num_blocks);
+    while (!walk.empty()) {
+        int b = walk.back();
+        walk.pop_back();
+        if (b < 0) {
+            for (size_t i = marks[~b]; i < pushed.size(); i++) {
+                stacks[pushed[i]].pop_back();
+            }
+            pushed.resize(marks[~b]);
+            continue;
+        }
+
+        marks[b] = pushed.size();
+        for (auto& instr : func->blocks[b].instrs) {
+            if (instr.op != Opcode::Phi) {
+                RenameUse(stacks, &instr.a);
+                RenameUse(stacks, &instr.b);
+                for (auto& arg : instr.args) {
+                    RenameUse(stacks, &arg);
+                }
+            }
+            if (instr.dst >= 0) {
+                int reg = instr.op == Opcode::Phi ? instr.sym : instr.dst;
+                instr.dst = num_vregs++;
+                stacks[reg].push_back(instr.dst);
+                pushed.push_back(reg);
+            }
+        }
+
+        for (int succ : cfg.succs[b]) {
+            for (auto& phi : func->blocks[succ].instrs) {
+                if (phi.op != Opcode::Phi) {
+                    break;
+                }
+                size_t i = find(phi.phi_blocks.begin(), phi.phi_blocks.end(), b) - phi.phi_blocks.begin();
+                phi.args[i] = Value::Vreg(phi.sym);
+                RenameUse(stacks, &phi.args[i]);
+            }
+        }
+
+        walk.push_back(~b);
+        for (auto it = cfg.dom_children[b].rbegin(); it != cfg.dom_children[b].rend(); ++it) {
+            walk.push_back(*it);
+        }
+    }
+
+    for (auto& block : func->blocks) {
+        for (auto& instr : block.instrs) {
+            if (instr.op != Opcode::Phi) {
+                break;
+            }
+            instr.sym = -1;
+        }
+    }
+    func->num_vregs = num_vregs;
+}
+
+// Interference answers whether two ssa values are live at once. A value is
+// live at the definition of another if its definition dominates that one and
+// it is still live after it.
+class Interference {
+public:
+    explicit Interference(const Function& func) : func_(func), cfg_(func) {
+        int n = func.num_vregs;
+        def_block_.assign(n, -1);
+        def_index_.assign(n, -1);
+        uses_.resize(n);
+
+        int num_blocks = static_cast<int>(func.blocks.size());
+        vector<BitSet> use(num_blocks, BitSet(n)), def(num_blocks, BitSet(n));
+        vector<BitSet> phi_use(num_blocks, BitSet(n));
+        live_in_.assign(num_blocks, BitSet(n));
+        live_out_.assign(num_blocks, BitSet(n));
+
+        vector<int> regs;
+        for (int b = 0; b < num_blocks; b++) {
+            const auto& instrs = func.blocks[b].instrs;
+            for (size_t i = 0; i < instrs.size(); i++) {
+                const Instr& instr = instrs[i];
+                if (instr.op == Opcode::Phi) {
+                    // phi args are read at the end of the predecessors.
+                    for (size_t k = 0; k < instr.args.size(); k++) {
+                        if (instr.args[k].IsReg()) {
+                            phi_use[instr.phi_blocks[k]].Add(instr.args[k].v);
+                        }
+                    }
+                } else {
+                    regs.clear();
+                    Uses(instr, &regs);
+                    for (int reg : regs) {
+                        uses_[reg].emplace_back(b, static_cast<int>(i));
+                        if (!def[b].Has(reg)) {
+                            use[b].Add(reg);
+                        }
+                    }
+                }
+
+                if (instr.dst >= 0) {
+                    def[b].Add(instr.dst);
+                    def_block_[instr.dst] = b;
+                    def_index_[instr.dst] = static_cast<int>(i);
+                }
+            }
+        }
+
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (auto it = cfg_.rpo.rbegin(); it != cfg_.rpo.rend(); ++it) {
+                int b = *it;
+                changed |= live_out_[b].Union(phi_use[b]);
+                for (int succ : cfg_.succs[b]) {
+                    changed |= live_out_[b].Union(live_in_[succ]);
+                }
+                changed |= live_in_[b].Union(use[b]);
+                changed |= live_in_[b].UnionMinus(live_out_[b], def[b]);
+            }
+        }
+    }
+
+    bool Interfere(int x, int y) const {
+        if (x == y || def_block_[x] < 0 || def_block_[y] < 0) {
+            return false;
+        }
+        if (DefDominates(y, x)) {
+            swap(x, y);
+        } else if (!DefDominates(x, y)) {
+            return false;
+        }
+
+        // x is defined first, is it live at the definition of y?
+        int b = def_block_[y];
+        if (IsPhi(y)) {
+            return IsPhi(x) ? def_block_[x] == b : live_in_[b].Has(x);
+        }
+        if (live_out_[b].Has(x)) {
+            return true;
+        }
+        for (const auto& use : uses_[x]) {
+            if (use.first == b && use.second > def_index_[y]) {
+                return true;
+            }
+        }
+        return false;
+    }
+private:
+    bool IsPhi(int reg) const {
+        return func_.blocks[def_block_[reg]].instrs[def_index_[reg]].op == Opcode::Phi;
+    }
+
+    bool DefDominates(int x, int y) const {
+        if (def_block_[x] == def_block_[y]) {
+            return def_index_[x] < def_index_[y];
+        }
+        return cfg_.Dominates(def_block_[x], def_block_[y]);
+    }
+
+    const Function& func_;
+    Cfg cfg_;
+    vector<int> def_block_;
+    vector<int> def_index_;
+    // uses_[vreg] are (block, index) of instrs other than phis reading vreg.
+    vector<vector<pair<int, int>>> uses_;
+    vector<BitSet> live_in_;
+    vector<BitSet> live_out_;
+};
+
+// IsolatePhis puts a copy in front of every phi arg and after every phi, as in
+// method I of Sreedhar, so vregs of a phi web are never live at once.
+static void IsolatePhis(Function* func) {
+    for (size_t b = 0; b < func->blocks.size(); b++) {
+        // copies are made first, a loop may be its own predecessor.
+        vector<pair<int, Instr>> arg_copies;
+        vector<Instr> copies;
+        for (auto& phi : func->blocks[b].instrs) {
+            if (phi.op != Opcode::Phi) {
+                break;
+            }
+
+            for (size_t i = 0; i < phi.args.size(); i++) {
+                Instr copy(Opcode::Copy);
+                copy.dst = func->NewVreg();
+                copy.a = phi.args[i];
+                phi.args[i] = Value::Vreg(copy.dst);
+                arg_copies.emplace_back(phi.phi_blocks[i], copy);
+            }
+
+            Instr copy(Opcode::Copy);
+            copy.dst = phi.dst;
+            phi.dst = func->NewVreg();
+            copy.a = Value::Vreg(phi.dst);
+            copies.push_back(copy);
+        }
+
+        auto& instrs = func->blocks[b].instrs;
+        auto head = instrs.begin();
+        while (head->op == Opcode::Phi) {
+            ++head;
+        }
+        instrs.insert(head, copies.begin(), copies.end());
+
+        for (const auto& arg_copy : arg_copies) {
+            auto& pred = func->blocks[arg_copy.first].instrs;
+            pred.insert(pred.end() - 1, arg_copy.second);
+        }
+    }
+}
+
+void DestructSSA(Function* func) {
+    IsolatePhis(func);
+
+    int n = func->num_vregs;
+    vector<int> parent(n);
+    iota(parent.begin(), parent.end(), 0);
+    vector<vector<int>> members(n);
+    for (int i = 0; i < n; i++) {
+        members[i].push_back(i);
+    }
+    auto find_class = [&parent](int reg) {
+        while (parent[reg] != reg) {
+            reg = parent[reg] = parent[parent[reg]];
+        }
+        return reg;
+    };
+    auto join = [&](int x, int y) {
+        x = find_class(x);
+        y = find_class(y);
+        if (x == y) {
+            return;
+        }
+        if (members[x].size() < members[y].size()) {
+            swap(x, y);
+        }
+        parent[y] = x;
+        members[x].insert(members[x].end(), members[y].begin(), members[y].end());
+        members[y].clear();
+    };
+
+    for (const auto& block : func->blocks) {
+        for (const auto& phi : block.instrs) {
+            if (phi.op != Opcode::Phi) {
+                break;
+            }
+            for (const auto& arg : phi.args) {
+                join(phi.dst, arg.v);
+            }
+        }
+    }
+
+    // coalesce copies whose classes don't interfere.
+    Interference interference(*func);
+    for (const auto& block : func->blocks) {
+        for (const auto& copy : block.instrs) {
+            if (copy.op != Opcode::Copy || !copy.a.IsReg()) {
+                continue;
+            }
+
+            int x = find_class(copy.dst);
+            int y = find_class(copy.a.v);
+            if (x == y) {
+                continue;
+            }
+
+            bool interfere = false;
+            for (size_t i = 0; i < members[x].size() && !interfere; i++) {
+                for (size_t j = 0; j < members[y].size() && !interfere; j++) {
+                    interfere = interference.Interfere(members[x][i], members[y][j]);
+                }
+            }
+            if (!interfere) {
+                join(x, y);
+            }
+        }
+    }
+
+    // a class is a single vreg now, number them densely.
+    vector<int> index(n, -1);
+    int num_vregs = 0;
+    auto rename = [&](int reg) {
+        int rep = find_class(reg);
+        if (index[rep] < 0) {
+            index[rep] = num_vregs++;
+        }
+        return index[rep];
+    };
+    auto rename_value = [&](Value* value) {
+        if (value->IsReg()) {
+            value->v = rename(value->v);
+        }
+    };
+
+    for (auto& block : func->blocks) {
+        vector<Instr> instrs;
+        instrs.reserve(block.instrs.size());
+        for (auto& instr : block.instrs) {
+            if (instr.op == Opcode::Phi) {
+                continue;
+            }
+
+            rename_value(&instr.a);
+            rename_value(&instr.b);
+            for (auto& arg : instr.args) {
+                rename_value(&arg);
+            }
+            if (instr.dst >= 0) {
+                instr.dst = rename(instr.dst);
+            }
+            if (instr.op == Opcode::Copy && instr.a.IsReg() && instr.a.v == instr.dst) {
+                continue;
+            }
+            instrs.push_back(move(instr));
+        }
+        block.instrs.swap(instrs);
+    }
+    func->num_vregs = num_vregs;
+}
+
+}// namespace ir
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "ir/ir.h"
+
+namespace ir {
+
+/**
+ * @brief ConstructSSA renames vregs of func so each is defined once, phis merge
+ * the values of a vreg where control flow joins. A read with no reaching definition
+ * reads 0. All blocks must be reachable.
+ */
+void ConstructSSA(Function* func);
+
+/**
+ * @brief DestructSSA replaces phis of func with copies. Phi webs and copies whose values
+ * don't interfere share one vreg, so most copies disappear.
+ */
+void DestructSSA(Function* func);
+
+}// namespace ir
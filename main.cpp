@@ -1,11 +1,24 @@
 #include <iostream>
 #include <fstream>
-#include <sstream>
+#include <thread>
 
 #include "scanner/scanner.h"
 #include "parser/parser.h"
 #include "error.h"
 #include "check/check.h"
+#include "check/bounds.h"
+#include "input/source_buffer.h"
+#include "driver/driver.h"
+#include "cache/cache.h"
+#include "vm/compiler.h"
+#include "vm/vm.h"
+#include "ir/builder.h"
+#include "ir/opt.h"
+#include "codegen/mips.h"
+#include "codegen/x86.h"
+#include "prof/prof.h"
+#include "runtime/io.h"
+#include "server/server.h"
 
 using namespace std;
 
@@ -17,21 +30,37 @@ public:
     }
 };
 
-string GetInputFile(const string& filename) {
-    ifstream fin;
-    fin.open(filename, ios::in);
-    if (!fin.is_open()) {
+shared_ptr<input::SourceBuffer> GetInputFile(const string& filename) {
+    shared_ptr<input::SourceBuffer> src;
+    if (input::SourceBuffer::Open(filename, &src) != 0) {
         cout << "input file not found!" << endl;
         exit(EXIT_FAILURE);
     }
 
-    stringstream buf;
-    buf << fin.rdbuf();
-    string raw_input = buf.str();
+    return src;
+}
+
+// kPipelineMinSize is the size from which a file is scanned on its own thread,
+// smaller ones are parsed before the thread would pay for itself.
+const static int kPipelineMinSize = 256 << 10;
+
+// MaybePipeline starts the scanner thread of parser, if src is large and there is a core for it.
+void MaybePipeline(Parser* parser, const shared_ptr<input::SourceBuffer>& src) {
+    if (src->size() >= kPipelineMinSize && thread::hardware_concurrency() > 1) {
+        parser->StartPipeline();
+    }
+}
 
-    fin.close();
+// kConcurrentCheckMinDecls is the count of top level decls from which function bodies
+// are checked on all cores.
+const static size_t kConcurrentCheckMinDecls = 256;
 
-    return raw_input;
+// MaybeConcurrent makes checker check on all cores, if file has many decls and there are cores for it.
+void MaybeConcurrent(check::Checker* checker, const ast::FileNode& file) {
+    unsigned cores = thread::hardware_concurrency();
+    if (file.decl_.size() >= kConcurrentCheckMinDecls && cores > 1) {
+        checker->SetJobs(static_cast<int>(cores));
+    }
 }
 
 /**
@@ -40,8 +69,8 @@ string GetInputFile(const string& filename) {
 void LexicalAnalysisMain() {
     auto test_file = make_shared<token::File>();
     test_file->name = "testfile.txt";
-    string txt = GetInputFile(test_file->name);
-    test_file->size = (int)txt.size();
+    auto txt = GetInputFile(test_file->name);
+    test_file->size = txt->size();
 
 
     auto err_handler = make_shared<StdErrHandler>();
@@ -49,91 +78,340 @@ void LexicalAnalysisMain() {
 
     ofstream f_out;
     f_out.open("output.txt", ios::out);
+    // tokens are buffered and written by blocks, not flushed one per line.
+    runtime::Writer out(f_out);
 
     while (true) {
-        int pos;
-        token::Token tok;
-        string lit;
-        scanner.Scan(&pos, &tok, &lit);
+        TokenRecord rec{};
+        scanner.Scan(&rec);
 
-        if (tok == token::Token::END_OF_FILE) {
+        if (rec.tok == token::Token::END_OF_FILE) {
             break;
         }
 
-        string token_name = GetTokenName(tok);
-        if (tok == token::Token::STRCON || tok == token::Token::CHARCON) {
-            f_out << token_name << " " << lit.substr(1, lit.size() - 2) << endl;
-            continue;
+        out.Write(GetTokenName(rec.tok));
+        out.Put(' ');
+        if (rec.tok == token::Token::STRCON || rec.tok == token::Token::CHARCON) {
+            // strip quotes, an unterminated literal may only have the opening one.
+            out.Write(scanner.Text(rec) + 1, rec.length >= 2 ? rec.length - 2 : 0);
+        } else {
+            out.Write(scanner.Text(rec), rec.length);
         }
-
-        f_out << token_name << " " << lit << endl;
+        out.Put('\n');
     }
 
+    out.Flush();
     f_out.close();
 }
 
-void ParsingMain() {
+/**
+ * @brief AstMain parses filename and writes its ast to stdout, a parse error is reported
+ * to stderr and nothing is written to stdout. The ast isn't checked.
+ *
+ * @param json write compact json instead of the xml layout.
+ * @return process exit code.
+ */
+int AstMain(const string& filename, bool json) {
     auto test_file = make_shared<token::File>();
-    test_file->name = "testfile.txt";
-    string txt = GetInputFile(test_file->name);
-    test_file->size = (int)txt.size();
+    test_file->name = filename;
+    shared_ptr<input::SourceBuffer> txt;
+    if (input::SourceBuffer::Open(filename, &txt) != 0) {
+        cerr << "input file not found!" << endl;
+        return EXIT_FAILURE;
+    }
+    test_file->size = txt->size();
 
     auto err_handler = make_shared<StdErrHandler>();
     auto error_reporter = make_shared<ec::ErrorReminder>(true, cerr);
 
     Parser parser(test_file, txt, err_handler, error_reporter);
-    auto ast_file = parser.Parse();
-
-    cout << ast_file->ToString() << endl;
+    parser.SetThrowOnError(true);
+    MaybePipeline(&parser, txt);
+    shared_ptr<ast::FileNode> ast_file;
+    try {
+        ast_file = parser.Parse();
+    } catch (const ParserError&) {
+        error_reporter->Flush();
+        return EXIT_FAILURE;
+    }
 
-    parser.ReportErrors();
+    prof::ScopedPhase phase(prof::Emit);
+    if (json) {
+        ast::JsonWriter writer(cout);
+        ast_file->Write(&writer);
+    } else {
+        ast::XmlWriter writer(cout);
+        ast_file->Write(&writer);
+    }
+    cout << endl;
+    return EXIT_SUCCESS;
 }
 
 void ErrorMain() {
     auto test_file = make_shared<token::File>();
     test_file->name = "testfile.txt";
-    string txt = GetInputFile(test_file->name);
-    test_file->size = (int)txt.size();
+    auto txt = GetInputFile(test_file->name);
+    test_file->size = txt->size();
 
     ofstream out_file("error.txt");
 
+    // errors are written to error.txt once, sorted, at most one per line.
     auto err_handler = make_shared<StdErrHandler>();
-    auto error_reporter = make_shared<ec::ErrorReminder>(true, out_file);
+    auto error_reporter = make_shared<ec::ErrorReminder>(true, out_file, true);
 
     Parser parser(test_file, txt, err_handler, error_reporter);
+    MaybePipeline(&parser, txt);
 
-    check::Checker c(parser.Parse(), error_reporter);
+    auto ast_file = parser.Parse();
+    check::Checker c(ast_file, error_reporter);
+    MaybeConcurrent(&c, *ast_file);
 
     c.Check();
 
-    out_file.close();
+    prof::ScopedPhase phase(prof::Emit);
+    error_reporter->Flush();
+}
+
+/**
+ * @brief ParseAndCheck parses and checks filename, errors are reported to stderr and
+ * nothing is written to stdout.
+ * The ast of a clean file is cached in the directory named by SIMPLE_LANG_CACHE, if it is set.
+ *
+ * @param ast_file ast of the file.
+ * @return 0 if the file is clean, -1 if not.
+ */
+int ParseAndCheck(const string& filename, shared_ptr<ast::FileNode>* ast_file) {
+    auto test_file = make_shared<token::File>();
+    test_file->name = filename;
+    // stdout is the output of the program or the assembly, errors go to stderr only.
+    shared_ptr<input::SourceBuffer> txt;
+    if (input::SourceBuffer::Open(filename, &txt) != 0) {
+        cerr << "input file not found!" << endl;
+        return -1;
+    }
+    test_file->size = txt->size();
+
+    // only clean files are taken from the cache, others run again to report their errors.
+    auto cache = cache::Cache::FromEnv();
+    cache::Key key;
+    if (cache != nullptr) {
+        key = cache::HashSource(txt->data(), static_cast<size_t>(txt->size()));
+        cache::Artifact artifact;
+        if (cache->Load(key, filename, &artifact) == 0 && artifact.ok && artifact.errors.empty() &&
+            artifact.File(filename, ast_file) == 0) {
+            return 0;
+        }
+    }
+
+    auto err_handler = make_shared<StdErrHandler>();
+    auto error_reporter = make_shared<ec::ErrorReminder>(true, cerr);
 
-    ifstream pos_process_f_in("error.txt");
+    // a parse error is reported to stderr, not written to stdout, and the file fails.
+    Parser parser(test_file, txt, err_handler, error_reporter);
+    parser.SetThrowOnError(true);
+    MaybePipeline(&parser, txt);
+    try {
+        *ast_file = parser.Parse();
+    } catch (const ParserError&) {
+        error_reporter->Flush();
+        return -1;
+    }
 
-    string output_full_text;
+    check::Checker c(*ast_file, error_reporter);
+    MaybeConcurrent(&c, **ast_file);
+    c.Check();
+    if (!error_reporter->Empty()) {
+        return -1;
+    }
 
-    string pre_line = "asdfzxvoihcxhsdf";
-    string line;
-    while (getline(pos_process_f_in, line)) {
-        if (line.substr(0, 2) == pre_line.substr(0, 2)) {
-            continue;
-        }
+    if (cache != nullptr) {
+        cache->Store(key, true, vector<ec::Error>(), ast_file->get());
+    }
+    return 0;
+}
+
+/**
+ * @brief AnalyzeBounds proves indexes of a checked file in range, a constant index out of
+ * range is warned about on stderr, the program still compiles and fails when it runs there.
+ */
+void AnalyzeBounds(check::Bounds* bounds) {
+    vector<ec::Error> warnings;
+    bounds->Analyze(&warnings);
+    for (const auto& warning : warnings) {
+        cerr << "warning " << warning.ToString() << endl;
+    }
+}
+
+/**
+ * @brief RunMain compiles filename to bytecode and runs it on stdin and stdout.
+ *
+ * @param dump write the bytecode to stdout instead of running it.
+ * @param jit run tiered, compiling hot functions to native code.
+ * @return process exit code, 0 if the program is clean and halts.
+ */
+int RunMain(const string& filename, bool dump, bool jit) {
+    shared_ptr<ast::FileNode> ast_file;
+    if (ParseAndCheck(filename, &ast_file) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    check::Bounds bounds(ast_file);
+    AnalyzeBounds(&bounds);
 
-        output_full_text += line + "\n";
+    vm::Program prog;
+    string err;
+    vm::Compiler compiler(ast_file);
+    compiler.SetBounds(&bounds);
+    if (compiler.Compile(&prog, &err) != 0) {
+        cerr << err << endl;
+        return EXIT_FAILURE;
     }
 
-    pos_process_f_in.close();
+    if (dump) {
+        prof::ScopedPhase phase(prof::Emit);
+        vm::Dump(prog, cout);
+        return EXIT_SUCCESS;
+    }
+
+    prof::ScopedPhase phase(prof::Run);
+    vm::VM machine(prog, cin, cout);
+    machine.SetJit(jit);
+    if (machine.Run(&err) != 0) {
+        cerr << err << endl;
+        return EXIT_FAILURE;
+    }
 
-    ofstream pos_process_f_out("error.txt");
-    pos_process_f_out << output_full_text;
-    pos_process_f_out.close();
-    
-    // cout << ast_file.ToString() << endl;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief EmitMain lowers filename to ir and writes it, or assembly generated from it, to stdout.
+ *
+ * @param mode one of "--ir", "--mips" and "--x86-64".
+ * @param level optimization level, 0 to 2.
+ * @return process exit code.
+ */
+int EmitMain(const string& filename, const string& mode, int level) {
+    shared_ptr<ast::FileNode> ast_file;
+    if (ParseAndCheck(filename, &ast_file) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    check::Bounds bounds(ast_file);
+    AnalyzeBounds(&bounds);
+
+    ir::Module module;
+    string err;
+    ir::Builder builder(ast_file);
+    builder.SetBounds(&bounds);
+    if (builder.Build(&module, &err) != 0) {
+        cerr << err << endl;
+        return EXIT_FAILURE;
+    }
+    if (ir::PassManager(level).Run(&module, &err) != 0) {
+        cerr << err << endl;
+        return EXIT_FAILURE;
+    }
+
+    prof::ScopedPhase phase(prof::Emit);
+    if (mode == "--ir") {
+        ir::Print(module, cout);
+    } else if (mode == "--mips") {
+        codegen::EmitMips(module, cout);
+    } else {
+        codegen::EmitX86(module, cout);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief TakeProfileFlags removes '--time-report' and '--trace=file' from argv, profiling
+ * is turned on if any of them is given.
+ *
+ * @param time_report set if '--time-report' is given.
+ * @param trace_path file to write the trace to, empty if not given.
+ * @return count of the arguments left.
+ */
+int TakeProfileFlags(int argc, char** argv, bool* time_report, string* trace_path) {
+    const string trace_flag = "--trace=";
+    int n = 1;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--time-report") {
+            *time_report = true;
+        } else if (arg.compare(0, trace_flag.size(), trace_flag) == 0) {
+            *trace_path = arg.substr(trace_flag.size());
+        } else {
+            argv[n++] = argv[i];
+        }
+    }
+    argv[n] = nullptr;
 
-    // parser.ReportErrors();
+    if (*time_report || !trace_path->empty()) {
+        prof::Enable(!trace_path->empty());
+    }
+    return n;
 }
 
-int main() {
+/**
+ * @brief Main dispatches to the main function of the mode given by the arguments.
+ *
+ * @return process exit code.
+ */
+int Main(int argc, char** argv) {
+    // '--lsp' serves open files to an editor as a language server on stdin and stdout.
+    if (argc == 2 && string(argv[1]) == "--lsp") {
+        return server::Server(cin, cout).Run();
+    }
+
+    // '--run file' executes a program, '--jit file' executes it with hot functions
+    // compiled to native code, '--bytecode file' lists its bytecode.
+    if (argc == 3 && (string(argv[1]) == "--run" || string(argv[1]) == "--jit" || string(argv[1]) == "--bytecode")) {
+        return RunMain(argv[2], string(argv[1]) == "--bytecode", string(argv[1]) == "--jit");
+    }
+
+    // '--ast file' and '--ast-json file' write the ast of a program as xml or compact json.
+    if (argc == 3 && (string(argv[1]) == "--ast" || string(argv[1]) == "--ast-json")) {
+        return AstMain(argv[2], string(argv[1]) == "--ast-json");
+    }
+
+    // '--ir [-On] file', '--mips [-On] file' and '--x86-64 [-On] file' write the ir or
+    // assembly of a program, optimized at level n, 0 by default.
+    if ((argc == 3 || argc == 4) && (string(argv[1]) == "--ir" || string(argv[1]) == "--mips" || string(argv[1]) == "--x86-64")) {
+        int level = 0;
+        if (argc == 4) {
+            string opt = argv[2];
+            if (opt.size() != 3 || opt.compare(0, 2, "-O") != 0 || opt[2] < '0' || opt[2] > '2') {
+                cerr << "unknown option " << opt << ", expect -O0, -O1 or -O2" << endl;
+                return EXIT_FAILURE;
+            }
+            level = opt[2] - '0';
+        }
+        return EmitMain(argv[argc - 1], argv[1], level);
+    }
+
+    // with paths given, compile all of them, otherwise run the lab on testfile.txt.
+    if (argc > 1) {
+        return driver::DriverMain(argc, argv);
+    }
+
     ErrorMain();
     return 0;
 }
+
+int main(int argc, char** argv) {
+    // '--time-report' writes time, allocations and counters of the phases to stderr on exit,
+    // '--trace=file' writes the phases to file as chrome trace events.
+    bool time_report = false;
+    string trace_path;
+    argc = TakeProfileFlags(argc, argv, &time_report, &trace_path);
+
+    int code = Main(argc, argv);
+    if (time_report) {
+        prof::Report(cerr);
+    }
+    if (!trace_path.empty() && prof::WriteTrace(trace_path) != 0) {
+        cerr << "can't write trace to " << trace_path << endl;
+    }
+    return code;
+}
@@ -1,43 +1,66 @@
+#include <cstdlib>
 #include <memory>
 #include <iostream>
 #include <stack>
 #include "parser/parser.h"
 #include "ast/ast.h"
+#include "ast/util.h"
 #include "token/token.h"
+#include "prof/prof.h"
+
+// kMaxStmtErrors is how many errors are reported per statement while recovering.
+const static int kMaxStmtErrors = 3;
+// kMaxErrors is how many errors are reported per file while recovering, then the rest is skipped.
+const static int kMaxErrors = 100;
+// kMaxNesting is how deep statements and expressions may nest, deeper ones would
+// overflow the stack of the parser or the checker.
+const static int kMaxNesting = 512;
+
+// SyncError unwinds a recovering parser to the statement or decl it syncs at.
+class SyncError {};
+
+// Nesting counts the statement or expression being parsed into depth until it's done.
+class Nesting {
+public:
+    explicit Nesting(int* depth) : depth_(depth) { (*depth_)++; }
+    ~Nesting() { (*depth_)--; }
+private:
+    int* depth_;
+};
 
 // Helper function to parse ast.
 
 // NewBasicTypeNode is called for return basic type node.
-shared_ptr<ast::TypeNode> NewBasicTypeNode(const token::Position& pos, token::Token tok) {
+ast::TypeNode* NewBasicTypeNode(ast::Arena* arena, const token::Position& pos, token::Token tok) {
     if (tok == token::Token::CHARTK) {
-        return make_shared<ast::CharTypeNode>(pos);
+        return arena->New<ast::CharTypeNode>(pos);
     } else if (tok == token::Token::INTTK) {
-        return make_shared<ast::IntTypeNode>(pos);
+        return arena->New<ast::IntTypeNode>(pos);
     } else if (tok == token::Token::VOIDTK) {
-        return make_shared<ast::VoidTypeNode>(pos);
+        return arena->New<ast::VoidTypeNode>(pos);
     } else {
-        return make_shared<ast::BadTypeNode>(pos);
+        return arena->New<ast::BadTypeNode>(pos);
     }
 }
 
 // NewArrayTypeNode is called for return array type node.
-shared_ptr<ast::TypeNode> NewArrayTypeNode(const token::Position& pos, token::Token tok, const vector<int>& dimesions) {
+ast::TypeNode* NewArrayTypeNode(ast::Arena* arena, const token::Position& pos, token::Token tok, const vector<int>& dimesions) {
     if (dimesions.empty() || (tok != token::CHARTK && tok != token::INTTK)) {
-        return make_shared<ast::BadTypeNode>(pos);
+        return arena->New<ast::BadTypeNode>(pos);
     }
 
-    vector<shared_ptr<ast::ArrayTypeNode>> array_type_nodes;
+    vector<ast::ArrayTypeNode*> array_type_nodes;
     for (const auto& dimension : dimesions) {
-        auto array_type_node = make_shared<ast::ArrayTypeNode>(pos);
+        auto array_type_node = arena->New<ast::ArrayTypeNode>(pos);
         array_type_node->size_ = dimension;
         array_type_nodes.push_back(array_type_node);
     }
 
-    for (size_t i = 0; i < (dimesions.size() - 1); i--) {
+    for (size_t i = 0; i + 1 < dimesions.size(); i++) {
         array_type_nodes[i]->item_ = array_type_nodes[i + 1];
     }
 
-    array_type_nodes.back()->item_ = NewBasicTypeNode(pos, tok);
+    array_type_nodes.back()->item_ = NewBasicTypeNode(arena, pos, tok);
 
     return array_type_nodes.front();
 }
@@ -45,41 +68,126 @@ shared_ptr<ast::TypeNode> NewArrayTypeNode(const token::Position& pos, token::To
 
 Parser::Parser(
     const shared_ptr<token::File> &file,
-    const string &src,
+    const shared_ptr<input::SourceBuffer> &src,
     const shared_ptr<ErrorHandler> &err,
     const shared_ptr<ec::ErrorReminder>& errors
 ) {
     scanner_ = make_shared<Scanner>(file, src, err);
     errors_ = errors;
     file_ = file;
+    throw_on_error_ = false;
+    recover_ = false;
+    partial_ = false;
+    error_count_ = 0;
+    stmt_errors_ = 0;
+    last_error_offset_ = -1;
+    depth_ = 0;
+    arena_ = nullptr;
+    symbols_ = nullptr;
     Next();
 }
 
 // Parse the source code and return the corresponding ast file tree.
 shared_ptr<ast::FileNode> Parser::Parse() {
-    vector<shared_ptr<ast::DeclNode>> decls;
+    prof::ScopedPhase phase(prof::Parse);
+    auto ast_file_node = make_shared<ast::FileNode>();
+    arena_ = &ast_file_node->arena_;
+    symbols_ = &ast_file_node->symbols_;
     while (tok_ != token::END_OF_FILE) {
-        decls.push_back(ParseDecl());
+        ast_file_node->decl_.push_back(ParseDecl());
     }
-
-    auto ast_file_node = make_shared<ast::FileNode>();
-    ast_file_node->decl_.insert(ast_file_node->decl_.begin(), decls.begin(), decls.end());
+    arena_ = nullptr;
+    symbols_ = nullptr;
 
     return ast_file_node;
 }
 
+void Parser::StartPipeline() {
+    if (pipe_ == nullptr) {
+        pipe_.reset(new TokenPipe(scanner_, file_));
+    }
+}
+
+void Parser::Reset(int offset) {
+    pipe_.reset();
+    last_error_offset_ = -1;
+    scanner_->Reset(offset);
+    Next();
+}
+
+ast::DeclNode* Parser::ParseNextDecl(ast::FileNode* file) {
+    prof::ScopedPhase phase(prof::Parse);
+    arena_ = &file->arena_;
+    symbols_ = &file->symbols_;
+    auto decl = ParseDecl();
+    arena_ = nullptr;
+    symbols_ = nullptr;
+
+    return decl;
+}
+
+// NewIdent create an ident node with its name interned.
+ast::IdentNode* Parser::NewIdent(const token::Position& pos, const string& name) {
+    return arena_->New<ast::IdentNode>(pos, name, symbols_->Intern(name));
+}
+
 /**
  * Error reports that the current token is unexpected.
  */
 void Parser::Error(const token::Position& pos, ec::Type error_type, const string& msg) {
-    errors_->Add(pos, ec::Error(pos, error_type, msg));
+    if (recover_) {
+        Report(pos, error_type, msg);
+        throw SyncError();
+    }
+    // the lab lists the parse error at an illegal token too.
+    if (!throw_on_error_ || pos.offset != last_error_offset_) {
+        errors_->Add(pos, ec::Error(pos, error_type, msg));
+    }
+    if (throw_on_error_) {
+        throw ParserError(pos, msg);
+    }
+    // stop the scanner thread and write the buffered errors before the process exits.
+    pipe_.reset();
+    errors_->Flush();
     exit(EXIT_SUCCESS);
 }
 
+void Parser::Report(const token::Position& pos, ec::Type error_type, const string& msg) {
+    error_count_++;
+    if (error_count_ >= kMaxErrors) {
+        if (error_count_ == kMaxErrors) {
+            errors_->Add(pos, ec::Error(pos, ec::Type::NotInHomeWork, "too many errors, the rest of the file is skipped"));
+        }
+        throw SyncError();
+    }
+
+    // the rest of a statement with many errors is likely garbage.
+    if (++stmt_errors_ > kMaxStmtErrors) {
+        throw SyncError();
+    }
+    // one error per token, the first is the cause, the others follow from recovering.
+    if (pos.offset == last_error_offset_) {
+        return;
+    }
+    last_error_offset_ = pos.offset;
+    errors_->Add(pos, ec::Error(pos, error_type, msg));
+}
+
 void Parser::Expect(token::Token tok) {
     if (tok_ != tok) {
         string msg = "expect " + token::GetTokenName(tok) + ", but get " + token::GetTokenName(tok_);
-        cout << "Expect: " << token::GetTokenName(tok) << endl;
+        if (recover_ && (tok == token::Token::SEMICN || tok == token::Token::RPARENT || tok == token::Token::RBRACK)) {
+            // a forgotten closing token is the common error, parsing goes on as if it's there.
+            Report(pos_, (
+                (tok == token::Token::SEMICN) ? ec::Type::SEMICNExpected :
+                (tok == token::Token::RBRACK) ? ec::Type::RBRACKExpected :
+                ec::Type::RPARENTExpected
+            ), msg);
+            return;
+        }
+        if (!throw_on_error_ && !recover_) {
+            cout << "Expect: " << token::GetTokenName(tok) << endl;
+        }
         ec::Type error_type = (
             (tok == token::Token::SEMICN) ? ec::Type::SEMICNExpected :
             (tok == token::Token::RBRACK) ? ec::Type::RBRACKExpected :
@@ -96,14 +204,106 @@ void Parser::Expect(token::Token tok) {
 
 // Next advance to the next token.
 void Parser::Next() {
-    int after_next_pos;
-    scanner_->Scan(&after_next_pos, &tok_, &lit_);
-    pos_ = file_->GetPositionByOffset(after_next_pos);
+    if (pipe_ != nullptr) {
+        // the file name of pos_ stays the one set when scanning synchronously.
+        PipedToken piped;
+        pipe_->Pop(&piped);
+        rec_ = piped.rec;
+        tok_ = rec_.tok;
+        pos_.offset = rec_.offset;
+        pos_.line = piped.line;
+        pos_.column = piped.column;
+    } else {
+        scanner_->Scan(&rec_);
+        tok_ = rec_.tok;
+        pos_ = file_->GetPositionByOffset(rec_.offset);
+    }
+
+    if (tok_ == token::Token::ILLEGAL) {
+        last_error_offset_ = rec_.offset;
+    }
+}
+
+void Parser::SyncStmt(int start) {
+    partial_ = true;
+    bool give_up = error_count_ >= kMaxErrors;
+    // a statement with an error at its first token is skipped by it at least, a '{' is counted below.
+    if (Offset() == start && tok_ != token::Token::LBRACE && tok_ != token::Token::RBRACE && tok_ != token::END_OF_FILE) {
+        Next();
+    }
+
+    int depth = 0;
+    while (tok_ != token::END_OF_FILE) {
+        if (!give_up) {
+            if (tok_ == token::Token::RBRACE) {
+                if (depth == 0) {
+                    return;
+                }
+                if (--depth == 0) {
+                    Next();
+                    return;
+                }
+            } else if (depth == 0 && tok_ == token::Token::SEMICN) {
+                Next();
+                return;
+            } else if (depth == 0 && (tok_ == token::Token::CASETK || tok_ == token::Token::DEFAULTTK)) {
+                return;
+            } else if (tok_ == token::Token::LBRACE) {
+                depth++;
+            }
+        }
+        Next();
+    }
+}
+
+void Parser::SyncDecl(int start) {
+    partial_ = true;
+    bool give_up = error_count_ >= kMaxErrors;
+    // the token of the error may start the next decl, unless it is the first of this one.
+    bool at_decl = Offset() != start;
+
+    int depth = 0;
+    while (tok_ != token::END_OF_FILE) {
+        if (!give_up) {
+            if (at_decl && depth == 0 && (tok_ == token::Token::CONSTTK || tok_ == token::Token::INTTK ||
+                tok_ == token::Token::CHARTK || tok_ == token::Token::VOIDTK)) {
+                return;
+            }
+            // a decl follows a ';' or '}', other 'int's are likely of params.
+            at_decl = tok_ == token::Token::SEMICN || tok_ == token::Token::RBRACE;
+            if (tok_ == token::Token::LBRACE) {
+                depth++;
+            } else if (tok_ == token::Token::RBRACE && depth > 0) {
+                depth--;
+            }
+        }
+        Next();
+    }
+}
+
+void Parser::Nest() {
+    if (depth_ > kMaxNesting) {
+        Error(pos_, ec::Type::NotInHomeWork, "statements or expressions nest too deep");
+    }
+}
+
+// ParseDecl parses a top level decl, while recovering, one with an error is synced
+// and returned as BadDeclNode.
+ast::DeclNode* Parser::ParseDecl() {
+    auto pos = pos_;
+    int start = Offset();
+    stmt_errors_ = 0;
+    try {
+        return ParseDeclUnsynced();
+    } catch (const SyncError&) {
+        SyncDecl(start);
+        return arena_->New<ast::BadDeclNode>(pos);
+    }
 }
 
 // ParserDecl is called for parse decl.
 // e.g. 'int a', 'int a = 1', 'int a, b, c', 'int main() { ... }';
-shared_ptr<ast::DeclNode> Parser::ParseDecl() {
+ast::DeclNode* Parser::ParseDeclUnsynced() {
     auto decl_pos = pos_;
     bool is_const = false;
     if (tok_ == token::Token::CONSTTK) {
@@ -115,21 +315,21 @@ shared_ptr<ast::DeclNode> Parser::ParseDecl() {
     Next();
     if (decl_type != token::Token::INTTK && decl_type != token::Token::CHARTK && decl_type != token::Token::VOIDTK) {
         Error(pos_, ec::Type::NotInHomeWork, "for begin of a declear, expect int, char, or void");
-        return make_shared<ast::BadDeclNode>(pos_);
+        return arena_->New<ast::BadDeclNode>(pos_);
     }
 
     auto name_pos = pos_;
-    string name = lit_;
+    string name = Lit();
     if (tok_ != token::Token::MAINTK && tok_ != token::Token::IDENFR) {
         Error(pos_, ec::Type::NotInHomeWork, "for decl, expect <int/char/void> name");
-        return make_shared<ast::BadDeclNode>(pos_);
+        return arena_->New<ast::BadDeclNode>(pos_);
     }
     Next();
 
     if (tok_ == token::Token::LPARENT) {
         if (is_const) {
             Error(pos_, ec::Type::NotInHomeWork, "const function result type not supported");
-            return make_shared<ast::BadDeclNode>(pos_);
+            return arena_->New<ast::BadDeclNode>(pos_);
         }
         return ParseFuncDecl(decl_pos, decl_type, name_pos, name);
     } 
@@ -139,14 +339,14 @@ shared_ptr<ast::DeclNode> Parser::ParseDecl() {
 
 // ParseFuncDecl is called for parse function decl.
 // e.g. 'int main() { ... }';
-shared_ptr<ast::DeclNode> Parser::ParseFuncDecl(
+ast::DeclNode* Parser::ParseFuncDecl(
     const token::Position& decl_pos,
     token::Token decl_type,
     const token::Position& name_pos,
     const string& name
 ) {
-    auto func_type = NewBasicTypeNode(decl_pos, decl_type);
-    auto func_name = make_shared<ast::IdentNode>(name_pos, name);
+    auto func_type = NewBasicTypeNode(arena_, decl_pos, decl_type);
+    auto func_name = NewIdent(name_pos, name);
 
     // Parse func param list.
     auto func_params = ParseFieldList();
@@ -156,15 +356,15 @@ shared_ptr<ast::DeclNode> Parser::ParseFuncDecl(
     auto func_body = ParseBlockStmt();
     Expect(token::Token::RBRACE);
 
-    return make_shared<ast::FuncDeclNode>(decl_pos, func_type, func_name, func_params, func_body);
+    return arena_->New<ast::FuncDeclNode>(decl_pos, func_type, func_name, func_params, func_body);
 }
 
 // ParseFieldList e.g. (int a, char b, int c) for a function decl.
 // When calling this function, tok_ should be '('.
 // After calling this function, tok_ will be ')'.
 // return nullptr for badFiledListNode.
-shared_ptr<ast::FieldListNode> Parser::ParseFieldList() {
-    auto fields = make_shared<ast::FieldListNode>(pos_);
+ast::FieldListNode* Parser::ParseFieldList() {
+    auto fields = arena_->New<ast::FieldListNode>(pos_);
 
     Expect(token::Token::LPARENT);
     if (tok_ == token::Token::RPARENT) {
@@ -176,14 +376,14 @@ shared_ptr<ast::FieldListNode> Parser::ParseFieldList() {
         if (tok_ != token::Token::INTTK && tok_ != token::Token::CHARTK) {
             Error(pos_, ec::Type::NotInHomeWork, "for paramlist, expect <int/char> indetifier");
         }
-        auto param_type = NewBasicTypeNode(pos_, tok_);
+        auto param_type = NewBasicTypeNode(arena_, pos_, tok_);
         Next();
 
         // Get param name.
-        auto param_name = make_shared<ast::IdentNode>(pos_, lit_);
+        auto param_name = NewIdent(pos_, Lit());
         Expect(token::Token::IDENFR);
 
-        fields->fields_.push_back(make_shared<ast::FieldNode>(param_type->Pos(), param_type, param_name));
+        fields->fields_.push_back(arena_->New<ast::FieldNode>(param_type->Pos(), param_type, param_name));
 
         // for not comma, break.
         if (tok_ != token::Token::COMMA) {
@@ -201,14 +401,14 @@ shared_ptr<ast::FieldListNode> Parser::ParseFieldList() {
 // When Calling this function, tok_ should be next token of identifre.
 // After Calling this function, tok_ should be next token of ';'.
 // e.g. 'int a', 'int a = 1', 'int a, b, c';
-shared_ptr<ast::DeclNode> Parser::ParseVarDecl(
+ast::DeclNode* Parser::ParseVarDecl(
     const token::Position& decl_pos,
     bool is_const,
     token::Token decl_type,
     const token::Position& name_pos,
     const string& name
 ) {
-    auto var_decl_node = make_shared<ast::VarDeclNode>(decl_pos);
+    auto var_decl_node = arena_->New<ast::VarDeclNode>(decl_pos);
 
     auto cur_name_pos = name_pos;
     auto cur_name = name;
@@ -224,7 +424,7 @@ shared_ptr<ast::DeclNode> Parser::ParseVarDecl(
         // current tok_ is ',' :=> get next identfire's name.
         Expect(token::Token::COMMA);
         cur_name_pos = pos_;
-        cur_name = lit_;
+        cur_name = Lit();
         Expect(token::Token::IDENFR);
     }
 
@@ -234,25 +434,46 @@ shared_ptr<ast::DeclNode> Parser::ParseVarDecl(
 }
 
 
-shared_ptr<ast::StmtNode> Parser::ParseBlockStmt() {
-    auto stmt_list = make_shared<ast::BlockStmtNode>(pos_);
+ast::StmtNode* Parser::ParseBlockStmt() {
+    auto stmt_list = arena_->New<ast::BlockStmtNode>(pos_);
 
     Expect(token::Token::LBRACE);
 
-    while(tok_ != token::Token::RBRACE) {
+    while(tok_ != token::Token::RBRACE && tok_ != token::END_OF_FILE) {
         stmt_list->stmts_.push_back(ParseStmt());
     }
 
     return stmt_list;
 }
 
-shared_ptr<ast::StmtNode> Parser::ParseStmt() {
-    shared_ptr<ast::StmtNode> stmt_node;
+// ParseStmt parses a statement, while recovering, one with an error is synced
+// and returned as BadStmtNode. Errors of nested statements are their own.
+ast::StmtNode* Parser::ParseStmt() {
+    Nesting nesting(&depth_);
+    auto pos = pos_;
+    int start = Offset();
+    int outer_errors = stmt_errors_;
+    stmt_errors_ = 0;
+
+    ast::StmtNode* stmt_node = nullptr;
+    try {
+        Nest();
+        stmt_node = ParseStmtUnsynced();
+    } catch (const SyncError&) {
+        SyncStmt(start);
+        stmt_node = arena_->New<ast::BadStmtNode>(pos);
+    }
+    stmt_errors_ = outer_errors;
+    return stmt_node;
+}
+
+ast::StmtNode* Parser::ParseStmtUnsynced() {
+    ast::StmtNode* stmt_node = nullptr;
     switch (tok_) {
         case token::Token::CONSTTK:
         case token::Token::INTTK:
         case token::Token::CHARTK:
-            return make_shared<ast::DeclStmtNode>(pos_, ParseVarDecl());
+            return arena_->New<ast::DeclStmtNode>(pos_, ParseVarDecl());
         case token::Token::IDENFR:
             stmt_node = ParseSimpleStmt();
             Expect(token::Token::SEMICN);
@@ -262,7 +483,7 @@ shared_ptr<ast::StmtNode> Parser::ParseStmt() {
         case token::Token::WHILETK:
             return ParseWhileStmt();
         case token::Token::SEMICN:
-            stmt_node = make_shared<ast::EmptyStmtNode>(pos_);
+            stmt_node = arena_->New<ast::EmptyStmtNode>(pos_);
             Next();
             return stmt_node;
         case token::Token::FORTK:
@@ -280,48 +501,50 @@ shared_ptr<ast::StmtNode> Parser::ParseStmt() {
         case token::Token::RETURNTK:
             return ParseReturnStmt();
         default:
-            return make_shared<ast::BadStmtNode>(pos_);
+            // nothing is consumed, so a statement list would never end.
+            Error(pos_, ec::Type::NotInHomeWork, "for stmt, unexpected " + token::GetTokenName(tok_));
+            return arena_->New<ast::BadStmtNode>(pos_);
     }
 }
 
 /**
  * @brief ParseSimpleStmt is called for parse simple stmt.
  * After process, tok_ should be ';'.
- * @return shared_ptr<ast::StmtNode> 
+ * @return ast::StmtNode* 
  */
-shared_ptr<ast::StmtNode> Parser::ParseSimpleStmt() {
+ast::StmtNode* Parser::ParseSimpleStmt() {
     auto x = ParseExpr();
 
-    shared_ptr<ast::ExprNode> y;
+    ast::ExprNode* y = nullptr;
     switch (tok_) {
         case token::Token::ASSIGN:
             Next();
             y = ParseExpr();
-            return make_shared<ast::AssignStmtNode>(x->Pos(), x, y);
+            return arena_->New<ast::AssignStmtNode>(x->Pos(), x, y);
         case token::Token::SEMICN:
-            return make_shared<ast::ExprStmtNode>(x->Pos(), x);
+            return arena_->New<ast::ExprStmtNode>(x->Pos(), x);
         default:
             Error(pos_, ec::Type::NotInHomeWork, "for simple stmt, after first expression, expect '=' or ';'");
-            return make_shared<ast::BadStmtNode>(x->Pos());
+            return arena_->New<ast::BadStmtNode>(x->Pos());
     }
 }
 
 /**
  * @brief ParseScanStmt is called for parse scan stmt.
  * 
- * @return shared_ptr<ast::StmtNode> 
+ * @return ast::StmtNode* 
  */
-shared_ptr<ast::StmtNode> Parser::ParseScanStmt() {
-    auto scanf_stmt = make_shared<ast::ScanStmtNode>(pos_);
+ast::StmtNode* Parser::ParseScanStmt() {
+    auto scanf_stmt = arena_->New<ast::ScanStmtNode>(pos_);
 
     Expect(token::Token::SCANFTK);
     Expect(token::Token::LPARENT);
 
     if (tok_ != token::Token::IDENFR) {
         Error(pos_, ec::Type::NotInHomeWork, "for expr of scanf stmt, expect indetifier");
-        scanf_stmt->var_ = make_shared<ast::BadExprNode>(pos_);
+        scanf_stmt->var_ = arena_->New<ast::BadExprNode>(pos_);
     } else {
-        scanf_stmt->var_ = make_shared<ast::IdentNode>(pos_, lit_);
+        scanf_stmt->var_ = NewIdent(pos_, Lit());
     }
     Next();
 
@@ -334,10 +557,10 @@ shared_ptr<ast::StmtNode> Parser::ParseScanStmt() {
 /**
  * @brief ParsePrintfStmt is called for parse printf stmt.
  * 
- * @return shared_ptr<ast::StmtNode> 
+ * @return ast::StmtNode* 
  */
-shared_ptr<ast::StmtNode> Parser::ParsePrintfStmt() {
-    auto printf_stmt = make_shared<ast::PrintfStmtNode>(pos_);
+ast::StmtNode* Parser::ParsePrintfStmt() {
+    auto printf_stmt = arena_->New<ast::PrintfStmtNode>(pos_);
 
     Expect(token::Token::PRINTFTK);
     Expect(token::Token::LPARENT);
@@ -361,10 +584,10 @@ shared_ptr<ast::StmtNode> Parser::ParsePrintfStmt() {
 /**
  * @brief ParseReturnStmt is called for parse return stmt.
  * 
- * @return shared_ptr<ast::StmtNode> 
+ * @return ast::StmtNode* 
  */
-shared_ptr<ast::StmtNode> Parser::ParseReturnStmt() {
-    auto return_stmt = make_shared<ast::ReturnStmtNode>(pos_);
+ast::StmtNode* Parser::ParseReturnStmt() {
+    auto return_stmt = arena_->New<ast::ReturnStmtNode>(pos_);
 
     Expect(token::Token::RETURNTK);
 
@@ -379,10 +602,10 @@ shared_ptr<ast::StmtNode> Parser::ParseReturnStmt() {
 /**
  * @brief ParseSwitchStmt is called for parse switch stmt.
  * 
- * @return shared_ptr<ast::StmtNode> 
+ * @return ast::StmtNode* 
  */
-shared_ptr<ast::StmtNode> Parser::ParseSwitchStmt() {
-    auto switch_stmt = make_shared<ast::SwitchStmtNode>(pos_);
+ast::StmtNode* Parser::ParseSwitchStmt() {
+    auto switch_stmt = arena_->New<ast::SwitchStmtNode>(pos_);
 
     Expect(token::Token::SWITCHTK);
     Expect(token::Token::LPARENT);
@@ -404,10 +627,10 @@ shared_ptr<ast::StmtNode> Parser::ParseSwitchStmt() {
 /**
  * @brief ParseCaseStmt is called for parse case stmt.
  * 
- * @return shared_ptr<ast::StmtNode> 
+ * @return ast::StmtNode* 
  */
-shared_ptr<ast::StmtNode> Parser::ParseCaseStmt() {
-    auto case_stmt_node = make_shared<ast::CaseStmtNode>(pos_);
+ast::StmtNode* Parser::ParseCaseStmt() {
+    auto case_stmt_node = arena_->New<ast::CaseStmtNode>(pos_);
 
     if (tok_ == token::Token::CASETK) {
         Next();
@@ -422,7 +645,7 @@ shared_ptr<ast::StmtNode> Parser::ParseCaseStmt() {
 
     Expect(token::Token::COLON);
 
-    while (tok_ != token::Token::CASETK && tok_ != token::Token::DEFAULTTK && tok_ != token::RBRACE) {
+    while (tok_ != token::Token::CASETK && tok_ != token::Token::DEFAULTTK && tok_ != token::RBRACE && tok_ != token::END_OF_FILE) {
         case_stmt_node->body_.push_back(ParseStmt());
     }
 
@@ -432,7 +655,7 @@ shared_ptr<ast::StmtNode> Parser::ParseCaseStmt() {
 // ParseVarDecl is called for parse variable decl.
 // In this function, we start from token 'const' or 'int / char'.
 // e.g. 'int a', 'int a = 1', 'int a, b, c';
-shared_ptr<ast::DeclNode> Parser::ParseVarDecl() {
+ast::DeclNode* Parser::ParseVarDecl() {
     auto decl_pos = pos_;
     bool is_const = false;
     if (tok_ == token::Token::CONSTTK) {
@@ -443,12 +666,12 @@ shared_ptr<ast::DeclNode> Parser::ParseVarDecl() {
     token::Token decl_type = tok_;
     if (decl_type != token::Token::CHARTK && decl_type != token::Token::INTTK) {
         Error(pos_, ec::Type::NotInHomeWork, "for begin of a declear, expect int or char");
-        return make_shared<ast::BadDeclNode>(pos_);
+        return arena_->New<ast::BadDeclNode>(pos_);
     }
     Next();
 
     auto name_pos = pos_;
-    string name = lit_;
+    string name = Lit();
 
     Expect(token::Token::IDENFR);
     
@@ -458,17 +681,17 @@ shared_ptr<ast::DeclNode> Parser::ParseVarDecl() {
 // ParseSingleVarDecl parse single var.
 // When Calling this function, tok_ is next of IDENFR.
 // After Calling this function, tok_ is ',' or ';'. 
-shared_ptr<ast::DeclNode> Parser::ParseSingleVarDecl(
+ast::DeclNode* Parser::ParseSingleVarDecl(
     const token::Position& decl_pos,
     int is_const,
     token::Token decl_type,
     const token::Position& name_pos,
     const string& name
 ) {
-    auto single_decl_node = make_shared<ast::SingleVarDeclNode>(name_pos);
+    auto single_decl_node = arena_->New<ast::SingleVarDeclNode>(name_pos);
 
-    single_decl_node->type_ = NewBasicTypeNode(decl_pos, decl_type);
-    single_decl_node->name_ = make_shared<ast::IdentNode>(name_pos, name);
+    single_decl_node->type_ = NewBasicTypeNode(arena_, decl_pos, decl_type);
+    single_decl_node->name_ = NewIdent(name_pos, name);
     single_decl_node->is_const_ = is_const;
 
     // get_array_dimension is called for parse array dimension.
@@ -480,7 +703,7 @@ shared_ptr<ast::DeclNode> Parser::ParseSingleVarDecl(
         while (tok_ == token::Token::LBRACK) {
             Next();
             if (tok_ == token::Token::INTCON) {
-                dimesions.push_back(atoi(lit_.c_str()));
+                dimesions.push_back(atoi(Lit().c_str()));
                 Next();
             } else {
                 Error(pos_, ec::Type::NotInHomeWork, "for array dimension, expect [int]");
@@ -502,9 +725,9 @@ shared_ptr<ast::DeclNode> Parser::ParseSingleVarDecl(
     if (tok_ == token::Token::LBRACK) {
         vector<int> dimesions;
         if (get_array_dimension(dimesions) != 0) {
-            return make_shared<ast::BadDeclNode>(name_pos);
+            return arena_->New<ast::BadDeclNode>(name_pos);
         }
-        single_decl_node->type_ = NewArrayTypeNode(name_pos, decl_type, dimesions);
+        single_decl_node->type_ = NewArrayTypeNode(arena_, name_pos, decl_type, dimesions);
         
         if (tok_ == token::Token::SEMICN || tok_ == token::Token::COMMA) {
             return single_decl_node;
@@ -527,43 +750,122 @@ shared_ptr<ast::DeclNode> Parser::ParseSingleVarDecl(
 // ParseCompositeLit is called for parse composite literal.
 // @param decl_type: INTTK or CHARTK.
 // e.g. '{ 1, 2, 3 }', '{{1,2,3}, {4,5,6}}';
-shared_ptr<ast::ExprNode> Parser::ParseCompositeLit(token::Token decl_type) {
-    auto composite_lit_node = make_shared<ast::CompositeLitNode>(pos_);
-    stack<shared_ptr<ast::CompositeLitNode>> composite_lit_stack;
-    composite_lit_stack.push(composite_lit_node);
-    auto current_composite_lit_node = composite_lit_node;
-    shared_ptr<ast::UnaryExprNode> unary_expr_node;
-    shared_ptr<ast::CompositeLitNode> sub_composite_lit_node;
+ast::ExprNode* Parser::ParseCompositeLit(token::Token decl_type) {
+    token::Position lit_pos = pos_;
     Expect(token::Token::LBRACE);
-    auto get_item = [&]() -> shared_ptr<ast::ExprNode> {
-        if (tok_ == token::Token::INTCON || tok_ == token::Token::CHARCON) {
-            return make_shared<ast::BasicLitNode>(pos_, tok_, lit_);
+
+    // braces, int or char literals and signed int literals are recorded instead of made
+    // into nodes, until the literal ends, which is packed then, or another token comes.
+    lit_events_.clear();
+    int depth = 1;
+    // sign is the '+' or '-' just read if it isn't followed by an int literal.
+    bool has_sign = false;
+    LitEvent sign{};
+    while (depth > 0) {
+        if (tok_ == token::Token::LBRACE || tok_ == token::Token::RBRACE ||
+            tok_ == token::Token::INTCON || tok_ == token::Token::CHARCON) {
+            lit_events_.push_back(LitEvent{rec_, pos_.line, pos_.column});
+            depth += (tok_ == token::Token::LBRACE) ? 1 : (tok_ == token::Token::RBRACE) ? -1 : 0;
+        } else if (tok_ == token::Token::PLUS || tok_ == token::Token::MINU) {
+            sign = LitEvent{rec_, pos_.line, pos_.column};
+            Next();
+            if (tok_ != token::Token::INTCON) {
+                has_sign = true;
+                break;
+            }
+            lit_events_.push_back(sign);
+            continue;
+        } else if (tok_ != token::Token::COMMA) {
+            break;
         }
+        Next();
+    }
+    if (depth == 0) {
+        auto packed = PackCompositeLit(lit_pos);
+        if (packed != nullptr) {
+            return packed;
+        }
+    }
 
+    auto composite_lit_node = arena_->New<ast::CompositeLitNode>(lit_pos);
+    stack<ast::CompositeLitNode*> composite_lit_stack;
+    composite_lit_stack.push(composite_lit_node);
+    auto current_composite_lit_node = composite_lit_node;
+    ast::UnaryExprNode* unary_expr_node = nullptr;
+    ast::CompositeLitNode* sub_composite_lit_node = nullptr;
+
+    // get_signed_item makes the item a sign is applied to, tok_ is the token after the sign.
+    auto get_signed_item = [&](ast::UnaryExprNode* unary) -> ast::ExprNode* {
+        if (tok_ == token::Token::INTCON) {
+            unary->x_ = arena_->New<ast::BasicLitNode>(pos_, tok_, Lit());
+            return unary;
+        }
         if (tok_ == token::Token::IDENFR) {
-            return make_shared<ast::IdentNode>(pos_, lit_);
+            unary->x_ = NewIdent(pos_, Lit());
+            return unary;
         }
 
-        if (tok_ != token::Token::PLUS && tok_ != token::Token::MINU) {
-            return make_shared<ast::BadExprNode>(pos_);
+        Error(pos_, ec::Type::NotInHomeWork, "for unary expr, expect <int/char>");
+        return arena_->New<ast::BadExprNode>(pos_);
+    };
+
+    // recorded tokens are made into nodes as the loop below would.
+    for (const auto& event : lit_events_) {
+        token::Position pos{pos_.filename, event.rec.offset, event.line, event.column};
+        switch (event.rec.tok) {
+            case token::Token::PLUS:
+            case token::Token::MINU:
+                unary_expr_node = arena_->New<ast::UnaryExprNode>(pos, event.rec.tok, nullptr);
+                current_composite_lit_node->items_.push_back(unary_expr_node);
+                break;
+            case token::Token::LBRACE:
+                sub_composite_lit_node = arena_->New<ast::CompositeLitNode>(pos);
+                current_composite_lit_node->items_.push_back(sub_composite_lit_node);
+                composite_lit_stack.push(current_composite_lit_node);
+                current_composite_lit_node = sub_composite_lit_node;
+                break;
+            case token::Token::RBRACE:
+                composite_lit_stack.pop();
+                if (!composite_lit_stack.empty()) {
+                    current_composite_lit_node = composite_lit_stack.top();
+                }
+                break;
+            default: {
+                auto lit = arena_->New<ast::BasicLitNode>(pos, event.rec.tok, scanner_->Literal(event.rec));
+                if (unary_expr_node != nullptr) {
+                    unary_expr_node->x_ = lit;
+                    unary_expr_node = nullptr;
+                } else {
+                    current_composite_lit_node->items_.push_back(lit);
+                }
+                break;
+            }
         }
-        
-        // get signed lit.
-        unary_expr_node = make_shared<ast::UnaryExprNode>(pos_, tok_, nullptr);
+    }
+    if (has_sign) {
+        auto unary = arena_->New<ast::UnaryExprNode>(
+            token::Position{pos_.filename, sign.rec.offset, sign.line, sign.column}, sign.rec.tok, nullptr);
+        current_composite_lit_node->items_.push_back(get_signed_item(unary));
         Next();
+    }
 
-        if (tok_ == token::Token::INTCON) {
-            unary_expr_node->x_ = make_shared<ast::BasicLitNode>(pos_, tok_, lit_);
-            return unary_expr_node;
+    auto get_item = [&]() -> ast::ExprNode* {
+        if (tok_ == token::Token::INTCON || tok_ == token::Token::CHARCON) {
+            return arena_->New<ast::BasicLitNode>(pos_, tok_, Lit());
         }
+
         if (tok_ == token::Token::IDENFR) {
-            unary_expr_node->x_ = make_shared<ast::IdentNode>(pos_, lit_);
-            return unary_expr_node;
+            return NewIdent(pos_, Lit());
         }
 
-
-        Error(pos_, ec::Type::NotInHomeWork, "for unary expr, expect <int/char>");
-        return make_shared<ast::BadExprNode>(pos_);
+        if (tok_ != token::Token::PLUS && tok_ != token::Token::MINU) {
+            return arena_->New<ast::BadExprNode>(pos_);
+        }
+        
+        // get signed lit.
+        unary_expr_node = arena_->New<ast::UnaryExprNode>(pos_, tok_, nullptr);
+        Next();
+        return get_signed_item(unary_expr_node);
     };
     while (!composite_lit_stack.empty()) {
         switch (tok_) {
@@ -578,7 +880,7 @@ shared_ptr<ast::ExprNode> Parser::ParseCompositeLit(token::Token decl_type) {
             case token::Token::COMMA:
                 break;
             case token::LBRACE:
-                sub_composite_lit_node = make_shared<ast::CompositeLitNode>(pos_);
+                sub_composite_lit_node = arena_->New<ast::CompositeLitNode>(pos_);
                 current_composite_lit_node->items_.push_back(sub_composite_lit_node);
                 composite_lit_stack.push(current_composite_lit_node);
                 current_composite_lit_node = sub_composite_lit_node;
@@ -591,7 +893,7 @@ shared_ptr<ast::ExprNode> Parser::ParseCompositeLit(token::Token decl_type) {
                 break;
             default:
                 Error(pos_, ec::Type::NotInHomeWork, "array define should be <int/char> ident = <int/char/identfr>;");
-                return make_shared<ast::BadExprNode>(pos_);
+                return arena_->New<ast::BadExprNode>(pos_);
         }
         // Point to next token.
         Next();
@@ -600,11 +902,81 @@ shared_ptr<ast::ExprNode> Parser::ParseCompositeLit(token::Token decl_type) {
     return composite_lit_node;
 }
 
+ast::CompositeLitNode* Parser::PackCompositeLit(const token::Position& pos) {
+    // rows counts the lists in the literal, row_size is the size of the first one and
+    // count the size of the current one, leaf_depth is the depth of the first literal.
+    int depth = 1, leaf_depth = 0;
+    int rows = 0, row_size = -1, count = 0;
+    bool negate = false;
+    token::Token tok = token::Token::ILLEGAL;
+    vector<int32_t> values;
+    values.reserve(lit_events_.size());
+    for (const auto& event : lit_events_) {
+        switch (event.rec.tok) {
+            case token::Token::LBRACE:
+                if (++depth > 2 || leaf_depth == 1) {
+                    return nullptr;
+                }
+                rows++;
+                count = 0;
+                break;
+            case token::Token::RBRACE:
+                if (depth-- == 2) {
+                    if (row_size >= 0 && row_size != count) {
+                        return nullptr;
+                    }
+                    row_size = count;
+                }
+                break;
+            case token::Token::PLUS:
+            case token::Token::MINU:
+                // a sign is always followed by the int literal it's folded into.
+                negate = event.rec.tok == token::Token::MINU;
+                break;
+            default: {
+                if ((tok != token::Token::ILLEGAL && tok != event.rec.tok) || (leaf_depth != 0 && leaf_depth != depth)) {
+                    return nullptr;
+                }
+                tok = event.rec.tok;
+                leaf_depth = depth;
+                count++;
+
+                // values are the ones the backends give the literals.
+                const char* text = scanner_->Text(event.rec);
+                if (tok == token::Token::INTCON) {
+                    long long value = strtoll(text, nullptr, 10);
+                    values.push_back(static_cast<int32_t>(negate ? -value : value));
+                    negate = false;
+                } else {
+                    values.push_back(ast::CharLitValue(string(text, event.rec.length)));
+                }
+                break;
+            }
+        }
+    }
+
+    // a literal without items, or with lists and items side by side, isn't regular.
+    if (tok == token::Token::ILLEGAL || (leaf_depth == 1 && rows > 0)) {
+        return nullptr;
+    }
+
+    auto lit = arena_->New<ast::CompositeLitNode>(pos);
+    lit->tok_ = tok;
+    if (leaf_depth == 1) {
+        lit->dims_.push_back(static_cast<int>(values.size()));
+    } else {
+        lit->dims_.push_back(rows);
+        lit->dims_.push_back(row_size);
+    }
+    lit->values_ = move(values);
+    return lit;
+}
+
 // ParseIfStmt is called for parse if statement.
 // When Calling this function, tok_ should be IFTK.
 // After Calling this function, tok_ will be next token of '}'.
-shared_ptr<ast::StmtNode> Parser::ParseIfStmt() {
-    auto ret_if_stmt_node = make_shared<ast::IfStmtNode>(pos_);
+ast::StmtNode* Parser::ParseIfStmt() {
+    auto ret_if_stmt_node = arena_->New<ast::IfStmtNode>(pos_);
 
     Expect(token::Token::IFTK);
     Expect(token::Token::LPARENT);
@@ -623,8 +995,8 @@ shared_ptr<ast::StmtNode> Parser::ParseIfStmt() {
     return ret_if_stmt_node;
 }
 
-shared_ptr<ast::StmtNode> Parser::ParseWhileStmt() {
-    auto ret_while_stmt_node = make_shared<ast::WhileStmtNode>(pos_);
+ast::StmtNode* Parser::ParseWhileStmt() {
+    auto ret_while_stmt_node = arena_->New<ast::WhileStmtNode>(pos_);
 
     Expect(token::Token::WHILETK);
     Expect(token::Token::LPARENT);
@@ -638,8 +1010,8 @@ shared_ptr<ast::StmtNode> Parser::ParseWhileStmt() {
     return ret_while_stmt_node;
 }
 
-shared_ptr<ast::StmtNode> Parser::ParseForStmt() {
-    auto ret_for_stmt_node = make_shared<ast::ForStmtNode>(pos_);
+ast::StmtNode* Parser::ParseForStmt() {
+    auto ret_for_stmt_node = arena_->New<ast::ForStmtNode>(pos_);
 
     Expect(token::Token::FORTK);
     Expect(token::Token::LPARENT);
@@ -671,7 +1043,7 @@ shared_ptr<ast::StmtNode> Parser::ParseForStmt() {
 // After Calling tok_ e.g.
 //  - if (expr == expr')  :=> '=='
 //  - fake = foo + bar;   :=> ';'
-shared_ptr<ast::ExprNode> Parser::ParseExpr() {
+ast::ExprNode* Parser::ParseExpr() {
     return ParseBinaryExpr(token::kLowestPrecedence + 1);
 }
 
@@ -681,9 +1053,9 @@ shared_ptr<ast::ExprNode> Parser::ParseExpr() {
  * After Calling this function, tok_ will be next token of binary expression.
  * 
  * @param prec is prec of current token.
- * @return shared_ptr<ast::ExprNode> BinaryExprNode for success, BadExprNode for fail.
+ * @return ast::ExprNode* BinaryExprNode for success, BadExprNode for fail.
  */
-shared_ptr<ast::ExprNode> Parser::ParseBinaryExpr(int prec) {
+ast::ExprNode* Parser::ParseBinaryExpr(int prec) {
     auto left_expr_node = ParseUnaryExpr();
 
     while (true) {
@@ -696,7 +1068,7 @@ shared_ptr<ast::ExprNode> Parser::ParseBinaryExpr(int prec) {
         Next();
 
         auto right_expr_node = ParseBinaryExpr(tok_prec + 1);
-        left_expr_node = make_shared<ast::BinaryExprNode>(left_expr_node->Pos(), op_token, left_expr_node, right_expr_node);
+        left_expr_node = arena_->New<ast::BinaryExprNode>(left_expr_node->Pos(), op_token, left_expr_node, right_expr_node);
     }
 }
 
@@ -705,14 +1077,16 @@ shared_ptr<ast::ExprNode> Parser::ParseBinaryExpr(int prec) {
  * When Calling this function, tok_ should be first token of unary expression.
  * After Calling this function, tok_ will be next token of unary expression.
  * 
- * @return shared_ptr<ast::ExprNode> UnaryExprNode for success, BadExprNode for fail.
+ * @return ast::ExprNode* UnaryExprNode for success, BadExprNode for fail.
  */
-shared_ptr<ast::ExprNode> Parser::ParseUnaryExpr() {
+ast::ExprNode* Parser::ParseUnaryExpr() {
+    Nesting nesting(&depth_);
+    Nest();
     if (tok_ == token::Token::PLUS || tok_ == token::Token::MINU) {
         auto op_position = pos_;
         token::Token op = tok_;
         Next();
-        return make_shared<ast::UnaryExprNode>(op_position, op, ParseUnaryExpr());
+        return arena_->New<ast::UnaryExprNode>(op_position, op, ParseUnaryExpr());
     }
 
     return ParsePrimaryExpr();
@@ -723,9 +1097,9 @@ shared_ptr<ast::ExprNode> Parser::ParseUnaryExpr() {
  * When Calling this function, tok_ should be first token of primary expression.
  * After Calling this function, tok_ will be next token of primary expression.
  * 
- * @return shared_ptr<ast::ExprNode> <BaiscLitNode/IdentNode/CallExprNode> for success, BadExprNode for fail.
+ * @return ast::ExprNode* <BaiscLitNode/IdentNode/CallExprNode> for success, BadExprNode for fail.
  */
-shared_ptr<ast::ExprNode> Parser::ParsePrimaryExpr() {
+ast::ExprNode* Parser::ParsePrimaryExpr() {
     auto x = ParseOperand();
 
     // '(' function call.
@@ -750,29 +1124,29 @@ shared_ptr<ast::ExprNode> Parser::ParsePrimaryExpr() {
  *  - 1 + 2       => after call token is : '+'
  *  - ident + 1   => after call token is : '+'
  * 
- * @return shared_ptr<ast::ExprNode> 
+ * @return ast::ExprNode* 
  */
-shared_ptr<ast::ExprNode> Parser::ParseOperand() {
-    shared_ptr<ast::ExprNode> ret; 
+ast::ExprNode* Parser::ParseOperand() {
+    ast::ExprNode* ret = nullptr;
     switch (tok_) {
         case token::Token::IDENFR:
-            ret = make_shared<ast::IdentNode>(pos_, lit_);
+            ret = NewIdent(pos_, Lit());
             Next();
             return ret;
         case token::Token::INTCON:
         case token::Token::CHARCON:
         case token::Token::STRCON:
-            ret = make_shared<ast::BasicLitNode>(pos_, tok_, lit_);
+            ret = arena_->New<ast::BasicLitNode>(pos_, tok_, Lit());
             Next();
             return ret;
         case token::Token::LPARENT:
             Next();
-            ret = make_shared<ast::ParenExprNode>(pos_, ParseExpr());
+            ret = arena_->New<ast::ParenExprNode>(pos_, ParseExpr());
             Expect(token::Token::RPARENT);
             return ret;
         default:
             Error(pos_, ec::Type::NotInHomeWork, "in operand, expect <int/char/idenfr/string/'('>");
-            return make_shared<ast::BadExprNode>(pos_);
+            return arena_->New<ast::BadExprNode>(pos_);
     }
 }
 
@@ -782,8 +1156,8 @@ shared_ptr<ast::ExprNode> Parser::ParseOperand() {
 // e.g.
 //   start calling (arg1, arg2, arg3)  :=> tok_ is '('
 //   end calling (arg1, arg2, arg3)    :=> tok_ is ')'
-shared_ptr<ast::ExprNode> Parser::ParseCallExpr(const shared_ptr<ast::ExprNode>& func_name) {
-    auto func_call_expr_node = make_shared<ast::CallExprNode>(pos_);
+ast::ExprNode* Parser::ParseCallExpr(ast::ExprNode* func_name) {
+    auto func_call_expr_node = arena_->New<ast::CallExprNode>(pos_);
     Expect(token::Token::LPARENT);
 
     func_call_expr_node->fun_ = func_name;
@@ -811,12 +1185,12 @@ shared_ptr<ast::ExprNode> Parser::ParseCallExpr(const shared_ptr<ast::ExprNode>&
  *  - x[1][3] + 2 => after call token is : '+'
  * 
  * @param array_name expect IdentNode for array name.
- * @return shared_ptr<ast::ExprNode> IndexExprNode for success, BadExprNode for fail.
+ * @return ast::ExprNode* IndexExprNode for success, BadExprNode for fail.
  */
-shared_ptr<ast::ExprNode> Parser::ParseIndexExpr(const shared_ptr<ast::ExprNode>& array_name) {
+ast::ExprNode* Parser::ParseIndexExpr(ast::ExprNode* array_name) {
     Expect(token::Token::LBRACK);
 
-    vector<shared_ptr<ast::ExprNode>> index_expr_nodes;
+    vector<ast::ExprNode*> index_expr_nodes;
     while (true) {
         index_expr_nodes.push_back(ParseExpr());
         Expect(token::Token::RBRACK);
@@ -827,9 +1201,9 @@ shared_ptr<ast::ExprNode> Parser::ParseIndexExpr(const shared_ptr<ast::ExprNode>
         Next();
     }
 
-    shared_ptr<ast::ExprNode> current_node = array_name;
+    ast::ExprNode* current_node = array_name;
     for (auto& index_expr_node : index_expr_nodes) {
-        current_node = make_shared<ast::IndexExprNode>(current_node->Pos(), current_node, index_expr_node);
+        current_node = arena_->New<ast::IndexExprNode>(current_node->Pos(), current_node, index_expr_node);
     }
 
     return current_node;
@@ -3,6 +3,7 @@
 #include "error.h"
 #include "token/position.h"
 #include "scanner/scanner.h"
+#include "scanner/token_pipe.h"
 #include "ast/ast.h"
 #include <vector>
 
@@ -22,7 +23,7 @@ class Parser {
 public:
     Parser(
         const shared_ptr<token::File> &file,
-        const string &src,
+        const shared_ptr<input::SourceBuffer> &src,
         const shared_ptr<ErrorHandler> &err,
         const shared_ptr<ec::ErrorReminder>& errors
     );
@@ -30,28 +31,106 @@ public:
     // Report all parse errors.
     void ReportErrors();
 
+    // By default the first parse error exits the process, as the single file mains
+    // expect. With throw_on_error, ParserError is thrown instead, so a driver
+    // compiling many files can drop only the failed one.
+    void SetThrowOnError(bool throw_on_error) { throw_on_error_ = throw_on_error; }
+
+    /**
+     * @brief SetRecover makes parse errors recoverable, it takes precedence over
+     * throw_on_error. A missing ';', ')' or ']' is reported and taken as present, other
+     * errors skip the rest of the statement or top level decl, which becomes a bad node.
+     * At most kMaxStmtErrors are reported per statement and kMaxErrors per file, then
+     * the rest is skipped, so the time of a parse is linear in the size of any input.
+     */
+    void SetRecover(bool recover) { recover_ = recover; }
+
+    // ErrorCount returns the count of parse errors found while recovering.
+    int ErrorCount() const { return error_count_; }
+
+    // Partial reports whether tokens were skipped, so the ast has bad nodes and
+    // shouldn't be checked. Without it, the ast is complete even if there are errors.
+    bool Partial() const { return partial_; }
+
+    /**
+     * @brief StartPipeline makes the rest of the tokens scanned on another thread ahead
+     * of parsing, which pays for large files on multi core machines. Reset scans synchronously again.
+     */
+    void StartPipeline();
+
     // Parse the source code and return the corresponding ast file tree.
     shared_ptr<ast::FileNode> Parse();
+
+    /**
+     * @brief Reset continues parsing from offset, which must start a top level decl
+     * or the white spaces before it.
+     */
+    void Reset(int offset);
+
+    /**
+     * @brief ParseNextDecl parses the top level decl at current token, nodes are created
+     * in the arena of file and names are interned to its symbols. It is not added to file.
+     */
+    ast::DeclNode* ParseNextDecl(ast::FileNode* file);
+
+    // Offset returns offset of current token, e.g. the start of the next decl.
+    int Offset() const { return rec_.offset; }
+
+    // AtEnd reports whether all tokens are parsed.
+    bool AtEnd() const { return tok_ == token::END_OF_FILE; }
 private:
     /**
      * Next advance to the next token.
      */
     void Next();
 
+    /**
+     * Lit returns a copy of current token's literal.
+     */
+    string Lit() const { return scanner_->Literal(rec_); }
+
     /**
      * Error reports that the current token is unexpected.
      */
     void Error(const token::Position& pos, ec::Type error_type, const string& msg);
 
+    /**
+     * Report adds an error of a recovering parser, unless a limit is reached.
+     */
+    void Report(const token::Position& pos, ec::Type error_type, const string& msg);
+
     void Expect(token::Token tok);
 
+    /**
+     * @brief SyncStmt skips the rest of a statement with an error: to after the next ';',
+     * or after a whole '{...}' block, or to a '}', 'case' or 'default' ending it.
+     * @param start offset of the first token of the statement.
+     */
+    void SyncStmt(int start);
+
+    /**
+     * @brief SyncDecl skips the rest of a top level decl with an error, to the next
+     * 'const', 'int', 'char' or 'void' outside of braces, after a ';' or '}'.
+     * @param start offset of the first token of the decl.
+     */
+    void SyncDecl(int start);
+
+    // Nest enters a statement or an expression, too deep nesting is an error.
+    void Nest();
+
+    /**
+     * NewIdent create an ident node in arena_, name is interned to symbols_.
+     */
+    ast::IdentNode* NewIdent(const token::Position& pos, const string& name);
+
     // ParserDecl is called for parse decl.
     // e.g. 'int a', 'int a = 1', 'int a, b, c', 'int main() { ... }';
-    shared_ptr<ast::DeclNode> ParseDecl();
-    
+    ast::DeclNode* ParseDecl();
+    ast::DeclNode* ParseDeclUnsynced();
+
     // ParseFuncDecl is called for parse function decl.
     // e.g. 'int main() { ... }';
-    shared_ptr<ast::DeclNode> ParseFuncDecl(
+    ast::DeclNode* ParseFuncDecl(
         const token::Position& decl_pos,
         token::Token decl_type,
         const token::Position& name_pos,
@@ -61,12 +140,12 @@ private:
     // ParseVarDecl is called for parse variable decl.
     // In this function, we start from token 'const' or 'int / char'.
     // e.g. 'int a', 'int a = 1', 'int a, b, c';
-    shared_ptr<ast::DeclNode> ParseVarDecl();
+    ast::DeclNode* ParseVarDecl();
 
     // ParseVarDecl is called for parse variable decl.
     // In this function, const, decl_type and name are all parsed.
     // e.g. 'int a', 'int a = 1', 'int a, b, c';
-    shared_ptr<ast::DeclNode> ParseVarDecl(
+    ast::DeclNode* ParseVarDecl(
         const token::Position& decl_pos,
         bool is_const,
         token::Token decl_type,
@@ -76,7 +155,7 @@ private:
 
     // ParseSingleVarDecl Get Single Var Decl.
     // Var may be 'int', 'char', 'array' type.
-    shared_ptr<ast::DeclNode> ParseSingleVarDecl(
+    ast::DeclNode* ParseSingleVarDecl(
         const token::Position& decl_pos,
         int is_const,
         token::Token decl_type,
@@ -87,34 +166,44 @@ private:
     // ParseCompositeLit is called for parse composite literal.
     // @param decl_type: INTTK or CHARTK.
     // e.g. '{ 1, 2, 3 }', '{{1,2,3}, {4,5,6}}';
-    shared_ptr<ast::ExprNode> ParseCompositeLit(token::Token decl_type);
+    ast::ExprNode* ParseCompositeLit(token::Token decl_type);
+
+    /**
+     * @brief PackCompositeLit packs the literal recorded in lit_events_, see CompositeLitNode.
+     * Only literals nested at most twice are packed, deeper ones keep the node form.
+     *
+     * @param pos position of the '{' of the literal.
+     * @return the packed literal, nullptr if it isn't regular.
+     */
+    ast::CompositeLitNode* PackCompositeLit(const token::Position& pos);
 
     // ParseBlockStmt is called for parse statement list.
-    shared_ptr<ast::StmtNode> ParseBlockStmt();
+    ast::StmtNode* ParseBlockStmt();
 
     // ParseFieldList is called for parse field list.
     // e.g. (int a, char b)
-    shared_ptr<ast::FieldListNode> ParseFieldList();
+    ast::FieldListNode* ParseFieldList();
 
     // ParseSimpleStmt is called for parse simple statement.
-    shared_ptr<ast::StmtNode> ParseSimpleStmt();
+    ast::StmtNode* ParseSimpleStmt();
 
     // ParseStmt is called for parse statement.
-    shared_ptr<ast::StmtNode> ParseStmt();
-    shared_ptr<ast::StmtNode> ParseIfStmt();
-    shared_ptr<ast::StmtNode> ParseWhileStmt();
-    shared_ptr<ast::StmtNode> ParseForStmt();
-    shared_ptr<ast::StmtNode> ParseScanStmt();
-    shared_ptr<ast::StmtNode> ParsePrintfStmt();
-    shared_ptr<ast::StmtNode> ParseReturnStmt();
-    shared_ptr<ast::StmtNode> ParseSwitchStmt();
-    shared_ptr<ast::StmtNode> ParseCaseStmt();
-
-    shared_ptr<ast::ExprNode> ParseExpr();
-    shared_ptr<ast::ExprNode> ParseBinaryExpr(int prec);
-    shared_ptr<ast::ExprNode> ParseUnaryExpr();
-    shared_ptr<ast::ExprNode> ParsePrimaryExpr();
-    shared_ptr<ast::ExprNode> ParseOperand();
+    ast::StmtNode* ParseStmt();
+    ast::StmtNode* ParseStmtUnsynced();
+    ast::StmtNode* ParseIfStmt();
+    ast::StmtNode* ParseWhileStmt();
+    ast::StmtNode* ParseForStmt();
+    ast::StmtNode* ParseScanStmt();
+    ast::StmtNode* ParsePrintfStmt();
+    ast::StmtNode* ParseReturnStmt();
+    ast::StmtNode* ParseSwitchStmt();
+    ast::StmtNode* ParseCaseStmt();
+
+    ast::ExprNode* ParseExpr();
+    ast::ExprNode* ParseBinaryExpr(int prec);
+    ast::ExprNode* ParseUnaryExpr();
+    ast::ExprNode* ParsePrimaryExpr();
+    ast::ExprNode* ParseOperand();
 
     // ParseCallExpr is called for parse function call expression.
     // When Calling this function, tok_ should be '(' of function call.
@@ -122,7 +211,7 @@ private:
     // e.g.
     //   start calling (arg1, arg2, arg3)  :=> tok_ is '('
     //   end calling (arg1, arg2, arg3)    :=> tok_ is ')'
-    shared_ptr<ast::ExprNode> ParseCallExpr(const shared_ptr<ast::ExprNode>& func_name);
+    ast::ExprNode* ParseCallExpr(ast::ExprNode* func_name);
 
     /**
      * @brief ParseIndexExpr is called for parse index expression.
@@ -133,18 +222,49 @@ private:
      *  - x[1][3] + 2 => after call token is : '+'
      * 
      * @param array_name expect IdentNode for array name.
-     * @return shared_ptr<ast::ExprNode> IndexExprNode for success, BadExprNode for fail.
+     * @return ast::ExprNode* IndexExprNode for success, BadExprNode for fail.
      */
-    shared_ptr<ast::ExprNode> ParseIndexExpr(const shared_ptr<ast::ExprNode>& array_name);
+    ast::ExprNode* ParseIndexExpr(ast::ExprNode* array_name);
+
+    // LitEvent is a '{', '}', int or char literal token of a composite literal, or
+    // the '+' or '-' of a signed int literal, which is the next event.
+    struct LitEvent {
+        TokenRecord rec;
+        int line;
+        int column;
+    };
 
     // Datas.
 
     // Next token.
     token::Token tok_;
-    string lit_;
+    TokenRecord rec_;
     token::Position pos_;
     
+    bool throw_on_error_;
+
+    // State of recovering from errors.
+    bool recover_;
+    bool partial_;
+    int error_count_;
+    int stmt_errors_;
+    // last_error_offset_ is offset of the last token with an error, an illegal token is
+    // reported by the scanner, parse errors at it follow from that one.
+    int last_error_offset_;
+    // Count of statements and expressions being parsed.
+    int depth_;
+
+    // lit_events_ are tokens of the composite literal being parsed, reused by all of them.
+    vector<LitEvent> lit_events_;
+
+    // Arena of the file being parsed, all nodes are allocated from it.
+    ast::Arena* arena_;
+    // Symbols of the file being parsed.
+    token::Interner* symbols_;
+
     shared_ptr<Scanner> scanner_;
+    // pipe_ scans ahead of the parser, if the pipeline is started.
+    unique_ptr<TokenPipe> pipe_;
     shared_ptr<token::File> file_;
     shared_ptr<ec::ErrorReminder> errors_;
 };
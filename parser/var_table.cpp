@@ -1,74 +1,134 @@
 #include "var_table.h"
+#include "prof/prof.h"
 
 VarTable::VarTable() {
     cur_unique_id_ = 0;
-    code_block_ident_stack_.push(map<string, shared_ptr<Identifier>>());
+    code_block_marks_.push_back(0);
+    funcs_ = 0;
+    globals_ = nullptr;
+    mark_ = Mark{0, 0};
+    journal_ = nullptr;
+}
+
+VarTable::VarTable(const VarTable* globals) : VarTable() {
+    globals_ = globals;
+    cur_unique_id_ = globals->cur_unique_id_;
 }
 
 VarTable::~VarTable() = default;
 
 void VarTable::DestroyCodeBlock() {
-    for (auto& ident : code_block_ident_stack_.top()) {
-        id_to_ident_.erase(ident.second->unique_id);
-        name_to_ident_.at(ident.first).pop();
+    int mark = code_block_marks_.back();
+    code_block_marks_.pop_back();
+
+    while (static_cast<int>(entries_.size()) > mark) {
+        const Entry& entry = entries_.back();
+        innermost_[entry.ident.symbol] = entry.shadowed;
+        entries_.pop_back();
     }
-    code_block_ident_stack_.pop();
 }
 
 void VarTable::CreateCodeBlock() {
-    code_block_ident_stack_.push(map<string, shared_ptr<Identifier>>());
+    code_block_marks_.push_back(static_cast<int>(entries_.size()));
 }
 
-void VarTable::AddVar(const string &name, const shared_ptr<ast::TypeNode> &type, bool is_const) {
+void VarTable::AddVar(int symbol, ast::TypeNode* type, bool is_const) {
     cur_unique_id_ ++;
 
-    auto ident = make_shared<Identifier>(Identifier(cur_unique_id_, name, type, is_const));
+    if (symbol >= static_cast<int>(innermost_.size())) {
+        innermost_.resize(symbol + 1, -1);
+    }
+
+    entries_.push_back(Entry{Identifier(cur_unique_id_, symbol, type, is_const), innermost_[symbol]});
+    innermost_[symbol] = static_cast<int>(entries_.size()) - 1;
 
-    id_to_ident_[cur_unique_id_] = ident;
-    name_to_ident_[name].push(ident);
-    code_block_ident_stack_.top()[name] = ident;
+    if (journal_ != nullptr && code_block_marks_.size() == 1) {
+        journal_->defined.push_back(Global{symbol, type, is_const, nullptr});
+    }
 }
 
-int VarTable::GetVar(const string &name, VarTable::Identifier *ident) {
-    auto get_idents_iter = name_to_ident_.find(name);
-    if (get_idents_iter == name_to_ident_.end() || get_idents_iter->second.empty()) {
-        return -1;
+int VarTable::GlobalVar(int symbol, const Mark& mark) const {
+    // a frozen global scope has no code blocks, entries of symbol are redefined globals.
+    int i = Innermost(symbol);
+    while (i >= mark.vars) {
+        i = entries_[i].shadowed;
     }
+    return i;
+}
 
-    *ident = *(get_idents_iter->second.top());
+ast::FuncDeclNode* VarTable::GlobalFunc(int symbol, const Mark& mark) const {
+    if (symbol < 0 || symbol >= static_cast<int>(func_table_.size()) || func_order_[symbol] >= mark.funcs) {
+        return nullptr;
+    }
+    return func_table_[symbol];
+}
+
+int VarTable::GetVar(int symbol, const VarTable::Identifier** ident) const {
+    prof::Count(prof::VarTableLookups);
+    Use(symbol);
+    int i = Innermost(symbol);
+    if (i < 0) {
+        if (globals_ == nullptr || (i = globals_->GlobalVar(symbol, mark_)) < 0) {
+            return -1;
+        }
+        *ident = &globals_->entries_[i].ident;
+        return 0;
+    }
+
+    *ident = &entries_[i].ident;
 
     return 0;
 }
 
-bool VarTable::IsVarExistedInCurrentCodeBlock(const string &name) {
-    if (func_table_.find(name) != func_table_.end()) {
+bool VarTable::IsVarExistedInCurrentCodeBlock(int symbol) const {
+    prof::Count(prof::VarTableLookups);
+    Use(symbol);
+    if (symbol >= 0 && symbol < static_cast<int>(func_table_.size()) && func_table_[symbol] != nullptr) {
         return true;
     }
-
-    if (code_block_ident_stack_.top().find(name) != code_block_ident_stack_.top().end()) {
-        return true;
+    if (globals_ != nullptr) {
+        if (globals_->GlobalFunc(symbol, mark_) != nullptr) {
+            return true;
+        }
+        // out of code blocks, the current one of a view is the global scope.
+        if (code_block_marks_.size() == 1 && globals_->GlobalVar(symbol, mark_) >= 0) {
+            return true;
+        }
     }
 
-    return false;
+    return Innermost(symbol) >= code_block_marks_.back();
 }
 
 // AddFunc add a function.
-void VarTable::AddFunc(const string& name, const shared_ptr<ast::FuncDeclNode>& func_decl) {
-    func_table_[name] = func_decl;
+void VarTable::AddFunc(int symbol, ast::FuncDeclNode* func_decl) {
+    if (symbol >= static_cast<int>(func_table_.size())) {
+        func_table_.resize(symbol + 1, nullptr);
+        func_order_.resize(symbol + 1, 0);
+    }
+    func_table_[symbol] = func_decl;
+    func_order_[symbol] = funcs_++;
+
+    if (journal_ != nullptr) {
+        journal_->defined.push_back(Global{symbol, nullptr, false, func_decl});
+    }
 }
 
 // AddFunc add a function.
-int VarTable::GetFunc(const string& name, shared_ptr<ast::FuncDeclNode>* func_decl) {
-    auto get_func_iter = func_table_.find(name);
-    if (get_func_iter == func_table_.end()) {
-        return -1;
+int VarTable::GetFunc(int symbol, ast::FuncDeclNode** func_decl) const {
+    prof::Count(prof::VarTableLookups);
+    Use(symbol);
+    if (symbol < 0 || symbol >= static_cast<int>(func_table_.size()) || func_table_[symbol] == nullptr) {
+        if (globals_ == nullptr || (*func_decl = globals_->GlobalFunc(symbol, mark_)) == nullptr) {
+            return -1;
+        }
+        return 0;
     }
 
-    *func_decl = get_func_iter->second;
+    *func_decl = func_table_[symbol];
     return 0;
 }
 
-VarTable::Identifier::Identifier(int unique_id, const string &name, const shared_ptr<ast::TypeNode> &type,
-                                 bool is_const) : unique_id(unique_id), name(name), type(type), is_const(is_const) {}
+VarTable::Identifier::Identifier(int unique_id, int symbol, ast::TypeNode* type,
+                                 bool is_const) : unique_id(unique_id), symbol(symbol), type(type), is_const(is_const) {}
 
-VarTable::Identifier::Identifier() = default;
+VarTable::Identifier::Identifier() : unique_id(0), symbol(-1), type(nullptr), is_const(false) {}
@@ -2,56 +2,133 @@
 
 #include "ast/ast.h"
 
-#include <map>
-#include <string>
-#include <stack>
+#include <vector>
 
 using namespace std;
 
 // VarTable is a class used to store all variables.
+// Variables are keyed by the interned symbol of their name. Every AddVar
+// appends an entry to a flat vector, entries of a code block are the tail
+// after the block's mark, and each symbol indexes its innermost entry.
+// A table may be a view of a frozen global scope, so function bodies could be
+// checked on many threads, each with its own local code blocks.
 class VarTable {
 public:
     class Identifier {
     public:
         Identifier();
-        Identifier(int unique_id, const string& name, const shared_ptr<ast::TypeNode>& type, bool is_const=false);
+        Identifier(int unique_id, int symbol, ast::TypeNode* type, bool is_const=false);
         int unique_id;
-        string name;
-        shared_ptr<ast::TypeNode> type;
+        int symbol;
+        ast::TypeNode* type;
         bool is_const;
     };
+
+    // Global is a variable or a function added to the global scope, func is nullptr for variables.
+    class Global {
+    public:
+        int symbol;
+        ast::TypeNode* type;
+        bool is_const;
+        ast::FuncDeclNode* func;
+    };
+
+    // Journal records how the global scope is used while it is attached, see SetJournal.
+    class Journal {
+    public:
+        // defined are globals added, in order.
+        vector<Global> defined;
+        // used are symbols looked up in any scope, found or not, with repeats.
+        vector<int> used;
+    };
+
+    // Mark is the size of a global scope at a point, see GlobalMark.
+    class Mark {
+    public:
+        int vars;
+        int funcs;
+    };
 public:
     VarTable();
     ~VarTable();
 
+    /**
+     * @brief VarTable makes a view of globals, which must not change while the view is used.
+     * Globals are seen as they were at the mark set by SetGlobalMark, code blocks are its own.
+     */
+    explicit VarTable(const VarTable* globals);
+
+    // GlobalMark returns the size of the global scope so far, it's taken out of code blocks.
+    Mark GlobalMark() const { return Mark{static_cast<int>(entries_.size()), funcs_}; }
+
+    // SetGlobalMark makes a view see globals added before mark only.
+    void SetGlobalMark(const Mark& mark) { mark_ = mark; }
+
     // CreateCodeBlock create a code block.
     void CreateCodeBlock();
 
-    // DestroyCodeBlock destroy a code block.
+    // DestroyCodeBlock destroy a code block, variables of it are dropped.
     void DestroyCodeBlock();
 
     // AddFunc add a function.
-    void AddFunc(const string& name, const shared_ptr<ast::FuncDeclNode>& func_decl);
+    void AddFunc(int symbol, ast::FuncDeclNode* func_decl);
 
     // GetFunc get a function node.
-    int GetFunc(const string& name, shared_ptr<ast::FuncDeclNode>* func_decl);
+    int GetFunc(int symbol, ast::FuncDeclNode** func_decl) const;
 
     // AddVar add a variable to current code block.
-    void AddVar(const string& name, const shared_ptr<ast::TypeNode>& type, bool is_const=false);
+    void AddVar(int symbol, ast::TypeNode* type, bool is_const=false);
 
-    // GetVar get a variable from current code block.
-    int GetVar(const string& name, Identifier* ident);
+    // GetVar get the innermost variable of symbol, ident is valid until next AddVar.
+    int GetVar(int symbol, const Identifier** ident) const;
 
     // IsVarExistInCurrentCodeBlock check if a variable is existed in current code block.
-    bool IsVarExistedInCurrentCodeBlock(const string& name);
+    bool IsVarExistedInCurrentCodeBlock(int symbol) const;
+
+    // SetJournal attaches journal to record globals added and symbols looked up, nullptr detaches it.
+    void SetJournal(Journal* journal) { journal_ = journal; }
 private:
+    // Use records a look up of symbol to the journal.
+    void Use(int symbol) const {
+        if (journal_ != nullptr) {
+            journal_->used.push_back(symbol);
+        }
+    }
+
+    // Entry is a variable and the entry of the same symbol it shadows, -1 if none.
+    struct Entry {
+        Identifier ident;
+        int shadowed;
+    };
+
+    // Innermost returns index of innermost entry of symbol, -1 if none.
+    int Innermost(int symbol) const {
+        return (symbol >= 0 && symbol < static_cast<int>(innermost_.size())) ? innermost_[symbol] : -1;
+    }
+
+    // GlobalVar returns index of the entry of symbol among the first mark.vars ones, -1 if none.
+    int GlobalVar(int symbol, const Mark& mark) const;
+
+    // GlobalFunc returns the function of symbol among the first mark.funcs ones, nullptr if none.
+    ast::FuncDeclNode* GlobalFunc(int symbol, const Mark& mark) const;
 
     int cur_unique_id_;
 
-    map<string, shared_ptr<ast::FuncDeclNode>> func_table_;
+    // func_table_[symbol] is the function named by symbol, or nullptr.
+    vector<ast::FuncDeclNode*> func_table_;
+    // func_order_[symbol] is the count of functions added before the one of symbol.
+    vector<int> func_order_;
+    int funcs_;
+
+    // globals_ is the global scope of a view, nullptr for a table of its own.
+    const VarTable* globals_;
+    Mark mark_;
+
+    vector<Entry> entries_;
+    vector<int> innermost_;
 
-    map<string, stack<shared_ptr<Identifier>>> name_to_ident_;
-    map<int, shared_ptr<Identifier>> id_to_ident_;
+    // code_block_marks_ holds size of entries_ when each code block is created.
+    vector<int> code_block_marks_;
 
-    stack<map<string, shared_ptr<Identifier>>> code_block_ident_stack_;
-};
\ No newline at end of file
+    Journal* journal_;
+};
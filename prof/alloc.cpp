@@ -0,0 +1,151 @@
+#include <cstdlib>
+#include <new>
+
+#include "prof/prof.h"
+
+// The global operator new and delete of a binary which links this file are replaced,
+// allocations are counted by prof::CountAlloc and charged to the phase of the allocating
+// thread. The whole family is replaced, so any form of new is freed by the delete which
+// matches it. It's linked into the binaries which report allocations only, not the library.
+
+// Allocate is malloc with the new_handler loop of the default operator new.
+static void* Allocate(size_t size) {
+    prof::CountAlloc(size);
+    if (size == 0) {
+        size = 1;
+    }
+    while (true) {
+        void* p = malloc(size);
+        if (p != nullptr) {
+            return p;
+        }
+        new_handler handler = get_new_handler();
+        if (handler == nullptr) {
+            throw bad_alloc();
+        }
+        handler();
+    }
+}
+
+static void* AllocateNothrow(size_t size) noexcept {
+    try {
+        return Allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new(size_t size) {
+    return Allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return Allocate(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    return AllocateNothrow(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    return AllocateNothrow(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, const nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, const nothrow_t&) noexcept {
+    free(p);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+#endif
+
+#if defined(__cpp_aligned_new)
+// AllocateAligned is Allocate for alignments larger than malloc gives.
+static void* AllocateAligned(size_t size, align_val_t align) {
+    prof::CountAlloc(size);
+    if (size == 0) {
+        size = 1;
+    }
+    size_t alignment = static_cast<size_t>(align);
+    if (alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+    while (true) {
+        void* p = nullptr;
+        if (posix_memalign(&p, alignment, size) == 0) {
+            return p;
+        }
+        new_handler handler = get_new_handler();
+        if (handler == nullptr) {
+            throw bad_alloc();
+        }
+        handler();
+    }
+}
+
+static void* AllocateAlignedNothrow(size_t size, align_val_t align) noexcept {
+    try {
+        return AllocateAligned(size, align);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new(size_t size, align_val_t align) {
+    return AllocateAligned(size, align);
+}
+
+void* operator new[](size_t size, align_val_t align) {
+    return AllocateAligned(size, align);
+}
+
+void* operator new(size_t size, align_val_t align, const nothrow_t&) noexcept {
+    return AllocateAlignedNothrow(size, align);
+}
+
+void* operator new[](size_t size, align_val_t align, const nothrow_t&) noexcept {
+    return AllocateAlignedNothrow(size, align);
+}
+
+void operator delete(void* p, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, align_val_t, const nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, align_val_t, const nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t, align_val_t) noexcept {
+    free(p);
+}
+#endif
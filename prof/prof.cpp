@@ -0,0 +1,280 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include <time.h>
+
+#include "ast/ast.h"
+#include "prof/prof.h"
+
+namespace prof {
+
+namespace internal {
+bool enabled = false;
+atomic<uint64_t> counters[counter_end];
+atomic<uint64_t> nodes[kMaxNodeTypes];
+}// namespace internal
+
+// Totals are summed over threads, in nanoseconds.
+static atomic<int64_t> wall_ns[phase_end];
+static atomic<int64_t> cpu_ns[phase_end];
+static atomic<uint64_t> allocs[phase_end];
+static atomic<uint64_t> alloc_bytes[phase_end];
+
+static bool trace_enabled = false;
+static int64_t enabled_at_ns = 0;
+static atomic<int> next_tid(1);
+
+// Event is a phase run by a thread, for the trace.
+struct Event {
+    Phase phase;
+    int tid;
+    int64_t start_us;
+    int64_t dur_us;
+};
+static mutex events_mu;
+static vector<Event>* events = nullptr;
+
+// ThreadState is the phase a thread is in and when it was charged last, it is
+// plain data so operator new may touch it at any time.
+struct ThreadState {
+    Phase current;
+    int tid;
+    int64_t wall_at_ns;
+    int64_t cpu_at_ns;
+};
+static thread_local ThreadState state = {Other, 0, 0, 0};
+
+static const char* const kPhaseNames[phase_end] = {
+    "other", "read", "scan", "parse", "check", "cache", "lower", "optimize", "emit", "run",
+};
+
+static const char* const kCounterNames[counter_end] = {
+    "tokens scanned", "var table lookups", "position lookups", "functions jitted",
+};
+
+static int64_t WallNs() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t CpuNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Start makes the thread start counting time in Other, on its first phase.
+static void Start(ThreadState* t) {
+    if (t->tid == 0) {
+        t->tid = next_tid.fetch_add(1);
+        t->wall_at_ns = WallNs();
+        t->cpu_at_ns = CpuNs();
+    }
+}
+
+void internal::ChargeAlloc(size_t size) {
+    allocs[state.current].fetch_add(1, memory_order_relaxed);
+    alloc_bytes[state.current].fetch_add(size, memory_order_relaxed);
+}
+
+void Enable(bool trace) {
+    internal::enabled = true;
+    trace_enabled = trace;
+    if (trace && events == nullptr) {
+        events = new vector<Event>();
+    }
+    enabled_at_ns = WallNs();
+    Start(&state);
+}
+
+void ScopedPhase::Enter(Phase phase) {
+    Start(&state);
+    int64_t wall = WallNs(), cpu = CpuNs();
+    wall_ns[state.current].fetch_add(wall - state.wall_at_ns, memory_order_relaxed);
+    cpu_ns[state.current].fetch_add(cpu - state.cpu_at_ns, memory_order_relaxed);
+    state.wall_at_ns = wall;
+    state.cpu_at_ns = cpu;
+
+    entered_ = true;
+    prev_ = state.current;
+    start_us_ = wall / 1000;
+    state.current = phase;
+}
+
+void ScopedPhase::Exit() {
+    int64_t wall = WallNs(), cpu = CpuNs();
+    Phase phase = state.current;
+    wall_ns[phase].fetch_add(wall - state.wall_at_ns, memory_order_relaxed);
+    cpu_ns[phase].fetch_add(cpu - state.cpu_at_ns, memory_order_relaxed);
+    state.wall_at_ns = wall;
+    state.cpu_at_ns = cpu;
+    state.current = prev_;
+
+    if (trace_enabled) {
+        lock_guard<mutex> lock(events_mu);
+        events->push_back(Event{phase, state.tid, start_us_, wall / 1000 - start_us_});
+    }
+}
+
+void ScopedFinePhase::Enter(Phase phase) {
+    Start(&state);
+    int64_t wall = WallNs();
+    wall_ns[state.current].fetch_add(wall - state.wall_at_ns, memory_order_relaxed);
+    state.wall_at_ns = wall;
+
+    entered_ = true;
+    prev_ = state.current;
+    state.current = phase;
+}
+
+void ScopedFinePhase::Exit() {
+    int64_t wall = WallNs();
+    wall_ns[state.current].fetch_add(wall - state.wall_at_ns, memory_order_relaxed);
+    state.wall_at_ns = wall;
+    state.current = prev_;
+}
+
+// NodeTypeName returns the name of an ast::NodeType.
+static const char* NodeTypeName(int type) {
+    switch (type) {
+        case ast::Expr: return "Expr";
+        case ast::Stmt: return "Stmt";
+        case ast::Decl: return "Decl";
+        case ast::Type: return "Type";
+        case ast::Literal: return "Literal";
+        case ast::BadType: return "BadType";
+        case ast::CharType: return "CharType";
+        case ast::IntType: return "IntType";
+        case ast::StringType: return "StringType";
+        case ast::ArrayType: return "ArrayType";
+        case ast::VoidType: return "VoidType";
+        case ast::BadExpr: return "BadExpr";
+        case ast::Ident: return "Ident";
+        case ast::BasicLit: return "BasicLit";
+        case ast::CompositeLit: return "CompositeLit";
+        case ast::ParenExpr: return "ParenExpr";
+        case ast::IndexExpr: return "IndexExpr";
+        case ast::CallExpr: return "CallExpr";
+        case ast::UnaryExpr: return "UnaryExpr";
+        case ast::BinaryExpr: return "BinaryExpr";
+        case ast::BadStmt: return "BadStmt";
+        case ast::DeclStmt: return "DeclStmt";
+        case ast::EmptyStmt: return "EmptyStmt";
+        case ast::ExprStmt: return "ExprStmt";
+        case ast::AssignStmt: return "AssignStmt";
+        case ast::ReturnStmt: return "ReturnStmt";
+        case ast::BranchStmt: return "BranchStmt";
+        case ast::BlockStmt: return "BlockStmt";
+        case ast::IfStmt: return "IfStmt";
+        case ast::CaseStmt: return "CaseStmt";
+        case ast::SwitchStmt: return "SwitchStmt";
+        case ast::ForStmt: return "ForStmt";
+        case ast::WhileStmt: return "WhileStmt";
+        case ast::ScanStmt: return "ScanStmt";
+        case ast::PrintfStmt: return "PrintfStmt";
+        case ast::BadDecl: return "BadDecl";
+        case ast::VarDecl: return "VarDecl";
+        case ast::SingleVarDecl: return "SingleVarDecl";
+        case ast::FuncDecl: return "FuncDecl";
+        case ast::Field: return "Field";
+        case ast::FieldList: return "FieldList";
+        default: return "?";
+    }
+}
+
+void Allocated(uint64_t* count, uint64_t* bytes) {
+    *count = *bytes = 0;
+    for (int i = 0; i < phase_end; i++) {
+        *count += allocs[i].load(memory_order_relaxed);
+        *bytes += alloc_bytes[i].load(memory_order_relaxed);
+    }
+}
+
+void Report(ostream& out) {
+    // time since the last switch is charged to the phase the thread is in.
+    int64_t wall_now = WallNs(), cpu_now = CpuNs();
+    wall_ns[state.current].fetch_add(wall_now - state.wall_at_ns, memory_order_relaxed);
+    cpu_ns[state.current].fetch_add(cpu_now - state.cpu_at_ns, memory_order_relaxed);
+    state.wall_at_ns = wall_now;
+    state.cpu_at_ns = cpu_now;
+
+    char line[128];
+    snprintf(line, sizeof(line), "%-18s %10s %10s %10s %12s\n", "phase", "wall ms", "cpu ms", "allocs", "alloc KB");
+    out << line;
+    int64_t total_wall = 0, total_cpu = 0;
+    uint64_t total_allocs = 0, total_bytes = 0;
+    for (int i = 0; i < phase_end; i++) {
+        int64_t wall = wall_ns[i].load(), cpu = cpu_ns[i].load();
+        uint64_t n = allocs[i].load(), bytes = alloc_bytes[i].load();
+        if (wall == 0 && n == 0) {
+            continue;
+        }
+        total_wall += wall;
+        total_cpu += cpu;
+        total_allocs += n;
+        total_bytes += bytes;
+        snprintf(line, sizeof(line), "%-18s %10.3f %10.3f %10llu %12.1f\n", kPhaseNames[i], wall / 1e6, cpu / 1e6,
+            static_cast<unsigned long long>(n), bytes / 1024.0);
+        out << line;
+    }
+    snprintf(line, sizeof(line), "%-18s %10.3f %10.3f %10llu %12.1f\n", "total", total_wall / 1e6, total_cpu / 1e6,
+        static_cast<unsigned long long>(total_allocs), total_bytes / 1024.0);
+    out << line;
+    snprintf(line, sizeof(line), "elapsed %.3f ms, scan cpu time is charged to its caller\n", (wall_now - enabled_at_ns) / 1e6);
+    out << line;
+
+    out << "\n";
+    for (int i = 0; i < counter_end; i++) {
+        snprintf(line, sizeof(line), "%-18s %10llu\n", kCounterNames[i],
+            static_cast<unsigned long long>(internal::counters[i].load()));
+        out << line;
+    }
+
+    uint64_t total_nodes = 0;
+    for (int i = 0; i < kMaxNodeTypes; i++) {
+        total_nodes += internal::nodes[i].load();
+    }
+    snprintf(line, sizeof(line), "%-18s %10llu\n", "ast nodes", static_cast<unsigned long long>(total_nodes));
+    out << line;
+    for (int i = 0; i < kMaxNodeTypes; i++) {
+        uint64_t n = internal::nodes[i].load();
+        if (n != 0) {
+            snprintf(line, sizeof(line), "  %-16s %10llu\n", NodeTypeName(i), static_cast<unsigned long long>(n));
+            out << line;
+        }
+    }
+    out.flush();
+}
+
+int WriteTrace(const string& path) {
+    ofstream f(path);
+    if (!f) {
+        return -1;
+    }
+
+    f << "{\"traceEvents\":[";
+    bool first = true;
+    {
+        lock_guard<mutex> lock(events_mu);
+        if (events != nullptr) {
+            for (const auto& e : *events) {
+                f << (first ? "\n" : ",\n");
+                first = false;
+                f << "{\"name\":\"" << kPhaseNames[e.phase] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.tid
+                  << ",\"ts\":" << e.start_us << ",\"dur\":" << e.dur_us << "}";
+            }
+        }
+    }
+    f << "\n],\"otherData\":{";
+    for (int i = 0; i < counter_end; i++) {
+        f << (i == 0 ? "" : ",") << "\"" << kCounterNames[i] << "\":\"" << internal::counters[i].load() << "\"";
+    }
+    f << "}}\n";
+
+    return f.good() ? 0 : -1;
+}
+
+}// namespace prof
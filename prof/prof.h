@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+namespace prof {
+
+// Phase is a part of the compilation that time and allocations are charged to.
+enum Phase {
+    // Other is the time in no phase, e.g. argument parsing and writing reports.
+    Other,
+    Read,
+    Scan,
+    Parse,
+    Check,
+    // Cache is looking up and storing artifacts of the on-disk cache.
+    Cache,
+    // Lower makes bytecode or ir from the ast.
+    Lower,
+    Optimize,
+    Emit,
+    // Run is execution of a program by the vm.
+    Run,
+    phase_end,
+};
+
+// Counter counts events on hot paths.
+enum Counter {
+    TokensScanned,
+    VarTableLookups,
+    PositionLookups,
+    // FunctionsJitted counts functions the vm compiled to native code.
+    FunctionsJitted,
+    counter_end,
+};
+
+// kMaxNodeTypes bounds ast::NodeType, nodes are counted per type.
+const int kMaxNodeTypes = 64;
+
+namespace internal {
+extern bool enabled;
+extern atomic<uint64_t> counters[counter_end];
+extern atomic<uint64_t> nodes[kMaxNodeTypes];
+
+// ChargeAlloc charges an allocation of size bytes to the phase of the current thread.
+void ChargeAlloc(size_t size);
+}// namespace internal
+
+/**
+ * @brief Enable turns profiling on, it must be called before any thread is started.
+ * Instrumented code costs a branch when profiling is off.
+ *
+ * @param trace record phases as trace events, see WriteTrace.
+ */
+void Enable(bool trace);
+
+inline bool Enabled() { return internal::enabled; }
+
+inline void Count(Counter counter, uint64_t n = 1) {
+    if (internal::enabled) {
+        internal::counters[counter].fetch_add(n, memory_order_relaxed);
+    }
+}
+
+// CountAlloc counts an allocation of size bytes, it's called by the operator new
+// replacement of prof/alloc.cpp.
+inline void CountAlloc(size_t size) {
+    if (internal::enabled) {
+        internal::ChargeAlloc(size);
+    }
+}
+
+// CountNode counts an ast node of type, which is an ast::NodeType.
+inline void CountNode(int type) {
+    internal::nodes[type].fetch_add(1, memory_order_relaxed);
+}
+
+/**
+ * @brief ScopedPhase charges wall time, cpu time and allocations of the current
+ * thread to phase until it is destroyed, phases nest and time is exclusive: an
+ * inner phase is not charged to the outer one.
+ */
+class ScopedPhase {
+public:
+    explicit ScopedPhase(Phase phase) {
+        if (internal::enabled) {
+            Enter(phase);
+        }
+    }
+    ~ScopedPhase() {
+        if (entered_) {
+            Exit();
+        }
+    }
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+private:
+    void Enter(Phase phase);
+    void Exit();
+
+    bool entered_ = false;
+    Phase prev_ = Other;
+    int64_t start_us_ = 0;
+};
+
+/**
+ * @brief ScopedFinePhase is a ScopedPhase for code entered once per token, e.g. the
+ * scanner. Only wall time is charged to it, reading cpu time of a thread costs a
+ * system call, its cpu time stays with the enclosing phase. No trace event is recorded.
+ */
+class ScopedFinePhase {
+public:
+    explicit ScopedFinePhase(Phase phase) {
+        if (internal::enabled) {
+            Enter(phase);
+        }
+    }
+    ~ScopedFinePhase() {
+        if (entered_) {
+            Exit();
+        }
+    }
+    ScopedFinePhase(const ScopedFinePhase&) = delete;
+    ScopedFinePhase& operator=(const ScopedFinePhase&) = delete;
+private:
+    void Enter(Phase phase);
+    void Exit();
+
+    bool entered_ = false;
+    Phase prev_ = Other;
+};
+
+/**
+ * @brief Allocated returns the count and bytes of allocations of all phases and threads,
+ * only allocations since Enable are counted. Allocations are counted only in binaries
+ * which link prof/alloc.cpp, it's 0 in others.
+ */
+void Allocated(uint64_t* count, uint64_t* bytes);
+
+/**
+ * @brief Report writes time, allocations and counters of all phases to out.
+ * Times of phases are summed over threads.
+ */
+void Report(ostream& out);
+
+/**
+ * @brief WriteTrace writes phases as chrome trace events, which chrome://tracing
+ * and perfetto load, counters are added as metadata.
+ *
+ * @return 0 for success, -1 if the file can't be written.
+ */
+int WriteTrace(const string& path);
+
+}// namespace prof
@@ -0,0 +1,116 @@
+#include <cstring>
+
+#include "runtime/io.h"
+
+namespace runtime {
+
+// IsBlank reports whether ch is skipped before a value, as isspace in the C locale.
+static inline bool IsBlank(int ch) {
+    return ch == ' ' || (ch >= '\t' && ch <= '\r');
+}
+
+bool Reader::Fill() {
+    streamsize n = in_->sgetn(buf_.data(), static_cast<streamsize>(buf_.size()));
+    pos_ = 0;
+    end_ = n > 0 ? static_cast<size_t>(n) : 0;
+    return end_ > 0;
+}
+
+int Reader::NextNotBlank() {
+    int ch = Next();
+    while (IsBlank(ch)) {
+        ch = Next();
+    }
+    return ch;
+}
+
+bool Reader::ReadInt(int64_t* value) {
+    if (failed_) {
+        return false;
+    }
+
+    int ch = NextNotBlank();
+    bool negative = ch == '-';
+    if (ch == '-' || ch == '+') {
+        ch = Next();
+    }
+    if (ch < '0' || ch > '9') {
+        failed_ = true;
+        return false;
+    }
+
+    // the magnitude may reach 2^63 for a negative int.
+    const uint64_t limit = static_cast<uint64_t>(INT64_MAX) + (negative ? 1 : 0);
+    uint64_t magnitude = 0;
+    for (; ch >= '0' && ch <= '9'; ch = Next()) {
+        uint64_t digit = static_cast<uint64_t>(ch - '0');
+        if (magnitude > (limit - digit) / 10) {
+            failed_ = true;
+            return false;
+        }
+        magnitude = magnitude * 10 + digit;
+    }
+    // the byte after the int stays for the next scan, it is still in the buffer.
+    if (ch >= 0) {
+        pos_--;
+    }
+
+    *value = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+    return true;
+}
+
+bool Reader::ReadChar(char* ch) {
+    if (failed_) {
+        return false;
+    }
+
+    int next = NextNotBlank();
+    if (next < 0) {
+        failed_ = true;
+        return false;
+    }
+    *ch = static_cast<char>(next);
+    return true;
+}
+
+void Writer::Write(const char* data, size_t size) {
+    if (size > buf_.size() - pos_) {
+        Drain();
+        // what doesn't fit an empty buffer is written as it is.
+        if (size > buf_.size()) {
+            out_.write(data, static_cast<streamsize>(size));
+            return;
+        }
+    }
+    memcpy(buf_.data() + pos_, data, size);
+    pos_ += size;
+}
+
+void Writer::WriteInt(int64_t value) {
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    uint64_t n = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    do {
+        *--p = static_cast<char>('0' + n % 10);
+        n /= 10;
+    } while (n != 0);
+    if (value < 0) {
+        *--p = '-';
+    }
+    Write(p, static_cast<size_t>(end - p));
+}
+
+void Writer::Drain() {
+    if (pos_ > 0) {
+        out_.write(buf_.data(), static_cast<streamsize>(pos_));
+        pos_ = 0;
+    }
+}
+
+void Writer::Flush() {
+    Drain();
+    out_.flush();
+}
+
+}// namespace runtime
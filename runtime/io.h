@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace runtime {
+
+// BufferSize is the size of the buffer of a reader or a writer.
+const size_t BufferSize = 1 << 16;
+
+// Reader scans ints and chars of an input stream. Input is taken from the stream buffer
+// a block at a time and scanned by hand, without the locale and formatting of iostreams.
+// As with an istream, once a scan fails every later scan fails too.
+class Reader {
+public:
+    explicit Reader(istream& in) : in_(in.rdbuf()), buf_(BufferSize) {}
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    /**
+     * @brief ReadInt scans a decimal int after blanks, with an optional sign, as 'in >> value' does.
+     *
+     * @return false if there is no int, or it doesn't fit in 64 bits.
+     */
+    bool ReadInt(int64_t* value);
+
+    // ReadChar scans the next char which isn't blank, returns false at the end of input.
+    bool ReadChar(char* ch);
+private:
+    // Next returns the next byte, -1 at the end of input.
+    int Next() { return pos_ < end_ || Fill() ? static_cast<unsigned char>(buf_[pos_++]) : -1; }
+
+    // Fill reads the next block, returns false at the end of input.
+    bool Fill();
+
+    // NextNotBlank returns the next byte which isn't blank, -1 at the end of input.
+    int NextNotBlank();
+
+    streambuf* in_;
+    vector<char> buf_;
+    size_t pos_ = 0;
+    size_t end_ = 0;
+    bool failed_ = false;
+};
+
+// Writer buffers output to a stream, which is written only when the buffer fills and on
+// Flush, ints are formatted by hand.
+class Writer {
+public:
+    explicit Writer(ostream& out) : out_(out), buf_(BufferSize) {}
+    ~Writer() { Flush(); }
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    void Put(char ch) {
+        if (pos_ == buf_.size()) {
+            Drain();
+        }
+        buf_[pos_++] = ch;
+    }
+
+    void Write(const char* data, size_t size);
+    void Write(const string& text) { Write(text.data(), text.size()); }
+
+    // WriteInt writes value as a decimal.
+    void WriteInt(int64_t value);
+
+    // Flush writes the buffered output and flushes the stream.
+    void Flush();
+private:
+    // Drain writes the buffered output to the stream.
+    void Drain();
+
+    ostream& out_;
+    vector<char> buf_;
+    size_t pos_ = 0;
+};
+
+}// namespace runtime
@@ -1,6 +1,9 @@
 #include "scanner.h"
+#include "prof/prof.h"
 
-#include <iostream>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
@@ -19,13 +22,135 @@ inline bool IsDigit(const char& c) {
     return '0' <= c && c <= '9';
 }
 
+// IsWhiteSpace 判断是否是空白字符
+inline bool IsWhiteSpace(const char& c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// IsPlainStringChar 判断是否是字符串中无需特殊处理的字符
+// quote, escape, newline, NUL and non-ascii chars (negative) are special.
+inline bool IsPlainStringChar(const char& c) {
+    return c > 0 && c != '"' && c != '\\' && c != '\n';
+}
+
+// Char classes used by SkipRun, Mask returns a bit for each char of the
+// 16 bytes block which belongs to the class.
+struct IdentifierClass {
+    static bool Is(char c) { return IsLetter(c) || IsDigit(c); }
+#if defined(__SSE2__)
+    static int Mask(__m128i block) {
+        // c | 0x20 maps upper letters to lower ones, and no other char into 'a'-'z'.
+        __m128i lower = _mm_sub_epi8(_mm_or_si128(block, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+        __m128i is_letter = _mm_cmpeq_epi8(_mm_max_epu8(lower, _mm_set1_epi8(25)), _mm_set1_epi8(25));
+        __m128i digit = _mm_sub_epi8(block, _mm_set1_epi8('0'));
+        __m128i is_digit = _mm_cmpeq_epi8(_mm_max_epu8(digit, _mm_set1_epi8(9)), _mm_set1_epi8(9));
+        __m128i is_underline = _mm_cmpeq_epi8(block, _mm_set1_epi8('_'));
+        return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(is_letter, is_digit), is_underline));
+    }
+#endif
+};
+
+struct DigitClass {
+    static bool Is(char c) { return IsDigit(c); }
+#if defined(__SSE2__)
+    static int Mask(__m128i block) {
+        __m128i digit = _mm_sub_epi8(block, _mm_set1_epi8('0'));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(digit, _mm_set1_epi8(9)), _mm_set1_epi8(9)));
+    }
+#endif
+};
+
+struct PlainStringClass {
+    static bool Is(char c) { return IsPlainStringChar(c); }
+#if defined(__SSE2__)
+    static int Mask(__m128i block) {
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\\'))),
+            _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(block, _mm_setzero_si128()))
+        );
+        // high bit is set for non-ascii chars.
+        return ~(_mm_movemask_epi8(special) | _mm_movemask_epi8(block)) & 0xFFFF;
+    }
+#endif
+};
+
+struct WhiteSpaceClass {
+    static bool Is(char c) { return IsWhiteSpace(c); }
+#if defined(__SSE2__)
+    static int Mask(__m128i block) {
+        __m128i is_white_space = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\r')))
+        );
+        return _mm_movemask_epi8(is_white_space);
+    }
+
+    static int NewLineMask(__m128i block) {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+    }
+#endif
+};
+
+// kShortRunLength is the length of runs which are read char by char, most runs
+// in source (white spaces, names) are shorter than it.
+const static int kShortRunLength = 8;
+
+// LikelyLongRun guess if the run of CharClass starting at offs is long, by checking
+// the char after kShortRunLength chars. Short runs are cheaper to read char by char.
+template <typename CharClass>
+inline bool LikelyLongRun(const char* src, int offs, int size) {
+    int peek = offs + kShortRunLength;
+    return peek < size && CharClass::Is(src[peek]);
+}
+
+// SkipRun returns the first offset in [offs, size) whose char is not in CharClass,
+// or size if all chars are in CharClass. 16 chars are classified at once if SSE2
+// is available, the tail of src is checked char by char.
+// If lines is not nullptr, offset after each '\n' in the run is appended to it.
+template <typename CharClass>
+int SkipRun(const char* src, int offs, int size, vector<int>* lines) {
+#if defined(__SSE2__)
+    while (offs + 16 <= size) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(src + offs));
+        unsigned int stop = ~(unsigned int)CharClass::Mask(block) & 0xFFFF;
+        int run = (stop == 0) ? 16 : __builtin_ctz(stop);
+
+        if (lines != nullptr) {
+            unsigned int new_lines = (unsigned int)WhiteSpaceClass::NewLineMask(block) & ((1u << run) - 1);
+            while (new_lines != 0) {
+                lines->push_back(offs + __builtin_ctz(new_lines) + 1);
+                new_lines &= new_lines - 1;
+            }
+        }
+
+        if (stop != 0) {
+            return offs + run;
+        }
+        offs += 16;
+    }
+#endif
+    while (offs < size && CharClass::Is(src[offs])) {
+        if (lines != nullptr && src[offs] == '\n') {
+            lines->push_back(offs + 1);
+        }
+        offs++;
+    }
+    return offs;
+}
 
 // Impl.
-Scanner::Scanner(const shared_ptr<token::File> &file, const string &src, const shared_ptr<ErrorHandler> &err) {
+Scanner::Scanner(
+    const shared_ptr<token::File> &file,
+    const shared_ptr<input::SourceBuffer> &src,
+    const shared_ptr<ErrorHandler> &err
+) {
     error_count = 0;
 
-    src_.assign(src);
+    buf_ = src;
+    src_ = src->data();
+    src_size_ = src->size();
     file_ = file;
+    err_ = err;
 
     ch_ = ' ';
     offset_ = 0;
@@ -34,143 +159,128 @@ Scanner::Scanner(const shared_ptr<token::File> &file, const string &src, const s
     Next();
 }
 
-void Scanner::Scan(int *pos, token::Token *tok, string *lit) {
+void Scanner::Scan(TokenRecord *rec) {
+    prof::ScopedFinePhase phase(prof::Scan);
+    prof::Count(prof::TokensScanned);
     SkipWhiteSpace();
 
     // current token start
-    *pos = offset_;
+    rec->offset = offset_;
 
     char ch = ch_;
     if (IsLetter(ch)) {
-        lit->assign(ScanIdentifier());
-        *tok = token::LookUp(*lit);
+        ScanIdentifier();
+        rec->length = offset_ - rec->offset;
+        rec->tok = token::LookUp(Text(*rec), rec->length);
         return;
     }
 
     if (IsDigit(ch)) {
-        lit->assign(ScanNumber());
-        *tok = token::Token::INTCON;
+        ScanNumber();
+        rec->tok = token::Token::INTCON;
+        rec->length = offset_ - rec->offset;
         return;
     }
 
     Next(); // always make progress
     switch (ch) {
         case -1:
-            *tok = token::Token::END_OF_FILE;
+            rec->tok = token::Token::END_OF_FILE;
             break;
         case '"':
-            *tok = token::Token::STRCON;
-            lit->assign(ScanString());
+            rec->tok = token::Token::STRCON;
+            ScanString();
             break;
         case '\'':
-            *tok = token::Token::CHARCON;
-            lit->assign(ScanChar());
+            rec->tok = token::Token::CHARCON;
+            ScanChar();
             break;
         case ':':
-            *tok = token::Token::COLON;
-            lit->assign(":");
+            rec->tok = token::Token::COLON;
             break;
         case ',':
-            *tok = token::Token::COMMA;
-            lit->assign(",");
+            rec->tok = token::Token::COMMA;
             break;
         case ';':
-            *tok = token::Token::SEMICN;
-            lit->assign(";");
+            rec->tok = token::Token::SEMICN;
             break;
         case '(':
-            *tok = token::Token::LPARENT;
-            lit->assign("(");
+            rec->tok = token::Token::LPARENT;
             break;
         case ')':
-            *tok = token::Token::RPARENT;
-            lit->assign(")");
+            rec->tok = token::Token::RPARENT;
             break;
         case '[':
-            *tok = token::Token::LBRACK;
-            lit->assign("[");
+            rec->tok = token::Token::LBRACK;
             break;
         case ']':
-            *tok = token::Token::RBRACK;
-            lit->assign("]");
+            rec->tok = token::Token::RBRACK;
             break;
         case '{':
-            *tok = token::Token::LBRACE;
-            lit->assign("{");
+            rec->tok = token::Token::LBRACE;
             break;
         case '}':
-            *tok = token::Token::RBRACE;
-            lit->assign("}");
+            rec->tok = token::Token::RBRACE;
             break;
         case '+':
-            *tok = token::Token::PLUS;
-            lit->assign("+");
+            rec->tok = token::Token::PLUS;
             break;
         case '-':
-            *tok = token::Token::MINU;
-            lit->assign("-");
+            rec->tok = token::Token::MINU;
             break;
         case '*':
-            *tok = token::Token::MULT;
-            lit->assign("*");
+            rec->tok = token::Token::MULT;
             break;
         case '/':
-            *tok = token::Token::DIV;
-            lit->assign("/");
+            rec->tok = token::Token::DIV;
             break;
         case '<':
             if (ch_ == '=') {
                 Next();
-                *tok = token::Token::LEQ;
-                lit->assign("<=");
+                rec->tok = token::Token::LEQ;
             } else {
-                *tok = token::Token::LSS;
-                lit->assign("<");
+                rec->tok = token::Token::LSS;
             }
             break;
         case '>':
             if (ch_ == '=') {
                 Next();
-                *tok = token::Token::GEQ;
-                lit->assign(">=");
+                rec->tok = token::Token::GEQ;
             } else {
-                *tok = token::Token::GRE;
-                lit->assign(">");
+                rec->tok = token::Token::GRE;
             }
             break;
         case '=':
             if (ch_ == '=') {
                 Next();
-                *tok = token::Token::EQL;
-                lit->assign("==");
+                rec->tok = token::Token::EQL;
             } else {
-                *tok = token::Token::ASSIGN;
-                lit->assign("=");
+                rec->tok = token::Token::ASSIGN;
             }
             break;
         case '!':
             if (ch_ == '=') {
                 Next();
-                *tok = token::Token::NEQ;
-                lit->assign("!=");
+                rec->tok = token::Token::NEQ;
             } else {
-                Error(*pos, "unknown token");
+                Error(rec->offset, "unknown token");
+                rec->tok = token::Token::ILLEGAL;
             }
             break;
         default:
             // next reports unexpected BOMs - don't repeat
-            Error(*pos, "illegal character");
-            *tok = token::Token::ILLEGAL;
-            string new_lit;
-            new_lit.push_back(ch);
-            lit->assign(new_lit);
+            Error(rec->offset, "illegal character");
+            rec->tok = token::Token::ILLEGAL;
             break;
     }
+
+    // literal ends at the first char which is not consumed.
+    rec->length = offset_ - rec->offset;
 }
 
 void Scanner::Next() {
-    if (read_offset_ >= (int)src_.size()) {
-        offset_ = (int)src_.size();
+    if (read_offset_ >= src_size_) {
+        offset_ = src_size_;
         if (ch_ == '\n') {
             file_->AddLine(offset_);
         }
@@ -193,42 +303,78 @@ void Scanner::Next() {
 }
 
 void Scanner::Error(int offs, const string &msg) {
-    auto pos = file_->GetPositionByOffset(offs);
-
-    cerr << "pos (" << pos.line << ", " << pos.column << ")err: " << offs << " => " << msg << endl;
-    //err_->Report(file_->GetPositionByOffset(offs), msg);
+    err_->Report(file_->GetPositionByOffset(offs), msg);
     error_count ++;
 }
 
+void Scanner::Reset(int offs) {
+    if (offs <= 0) {
+        ch_ = ' ';
+        read_offset_ = 0;
+        Next();
+        return;
+    }
+    Seek(offs);
+}
+
+void Scanner::Seek(int offs) {
+    // let Next() read the char at offs as if src[offs - 1] was just read.
+    ch_ = src_[offs - 1];
+    read_offset_ = offs;
+    Next();
+}
+
+// kept out of line so the short run loop in SkipWhiteSpace stays small.
+__attribute__((noinline)) void Scanner::SkipLongWhiteSpace() {
+    line_buf_.clear();
+    int end = SkipRun<WhiteSpaceClass>(src_, offset_, src_size_, &line_buf_);
+    file_->AddLines(line_buf_.data(), (int)line_buf_.size());
+    Seek(end);
+}
+
 void Scanner::SkipWhiteSpace() {
-    while (ch_ == ' ' || ch_ == '\t' || ch_ == '\n' || ch_ == '\r') {
+    // most runs are short, only classify blocks for those likely to be long.
+    if (IsWhiteSpace(ch_) && LikelyLongRun<WhiteSpaceClass>(src_, offset_, src_size_)) {
+        SkipLongWhiteSpace();
+        return;
+    }
+
+    while (IsWhiteSpace(ch_)) {
         Next();
     }
 }
 
-string Scanner::ScanIdentifier() {
-    int offs = offset_;
+void Scanner::ScanIdentifier() {
+    if (LikelyLongRun<IdentifierClass>(src_, offset_, src_size_)) {
+        Seek(SkipRun<IdentifierClass>(src_, offset_, src_size_, nullptr));
+        return;
+    }
+
     while (IsLetter(ch_) || IsDigit(ch_)) {
         Next();
     }
-    return src_.substr(offs, offset_ - offs);
 }
 
-string Scanner::ScanNumber() {
-    int offs = offset_;
+void Scanner::ScanNumber() {
+    if (LikelyLongRun<DigitClass>(src_, offset_, src_size_)) {
+        Seek(SkipRun<DigitClass>(src_, offset_, src_size_, nullptr));
+        return;
+    }
 
     while (IsDigit(ch_)) {
         Next();
     }
-
-    return src_.substr(offs, offset_ - offs);
 }
 
-string Scanner::ScanString() {
+void Scanner::ScanString() {
     // '"' opening already consumed
     int offs = offset_ - 1;
 
     while(true) {
+        if (IsPlainStringChar(ch_) && LikelyLongRun<PlainStringClass>(src_, offset_, src_size_)) {
+            Seek(SkipRun<PlainStringClass>(src_, offset_, src_size_, nullptr));
+        }
+
         char ch = ch_;
         if (ch == '\n' || ch < 0) {
             Error(offs, "string literal not terminated");
@@ -243,11 +389,9 @@ string Scanner::ScanString() {
             Next();
         }
     }
-
-    return src_.substr(offs, offset_ - offs);
 }
 
-string Scanner::ScanChar() {
+void Scanner::ScanChar() {
     // '\'' opening already consumed
     int offs = offset_ - 1;
 
@@ -273,6 +417,4 @@ string Scanner::ScanChar() {
     if (n != 1) {
         Error(offs, "illegal rune literal");
     }
-
-    return src_.substr(offs, offset_ - offs);
 }
@@ -1,14 +1,17 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <memory> // shared_ptr
 #include "token/token.h"
 #include "token/position.h"
+#include "input/source_buffer.h"
 
 using namespace std;
 
 /**
- * @brief ErrorHandler report error.
+ * @brief ErrorHandler report error. Scan errors are reported on the thread which scans,
+ * that is the scanner thread of a pipelined parser.
  */
 class ErrorHandler {
 public:
@@ -16,22 +19,48 @@ public:
     virtual void Report(const token::Position& pos, const string& msg) = 0;
 };
 
+/**
+ * @brief TokenRecord is a scanned token, its literal is src[offset, offset + length).
+ */
+struct TokenRecord {
+    token::Token tok;
+    int offset;
+    int length;
+};
+
 /**
  * @brief Scanner scan given text and split it into tokens.
+ * Scanner reads the source buffer directly, literals are never copied.
  */
 class Scanner {
 public:
-    Scanner(const shared_ptr<token::File>& file, const string& src,const shared_ptr<ErrorHandler>& err);
+    Scanner(
+        const shared_ptr<token::File>& file,
+        const shared_ptr<input::SourceBuffer>& src,
+        const shared_ptr<ErrorHandler>& err
+    );
 
     /**
      * @brief Scan the next token.
-     * @param pos begin of the next token's literal
-     * @token Token
-     * @lit next token's literal
+     * @param rec next token's kind and the range of its literal in source.
      */
-    void Scan(int* pos, token::Token* tok, string* lit);
+    void Scan(TokenRecord* rec);
 
+    /**
+     * @brief Text returns the first char of token's literal in source.
+     */
+    const char* Text(const TokenRecord& rec) const { return src_ + rec.offset; }
+
+    /**
+     * @brief Literal returns a copy of token's literal.
+     */
+    string Literal(const TokenRecord& rec) const { return string(Text(rec), rec.length); }
 
+    /**
+     * @brief Reset makes the scanner continue from offs, which must start a token or
+     * white spaces. Lines before offs must have been added to the file.
+     */
+    void Reset(int offs);
 
     int error_count{};
 
@@ -41,40 +70,54 @@ private:
      */
     void Next();
 
+    /**
+     * @brief Seek read the char at offs into ch_, chars in [offset_, offs) are consumed,
+     * offs must be larger than offset_ and lines in the chars must have been added.
+     */
+    void Seek(int offs);
+
     /**
      * @brief SkipWhiteSpace skip chars like space, enter, tabs.
      */
     void SkipWhiteSpace();
 
     /**
-     * @brief returns the next identifier.
+     * @brief SkipLongWhiteSpace skip a long white space run by 16 bytes blocks,
+     * newlines in the run are added to file_ together.
      */
-    string ScanIdentifier();
+    void SkipLongWhiteSpace();
 
     /**
-     * @brief Scan and returns the next Number.
+     * @brief Skip chars of the next identifier.
      */
-    string ScanNumber();
+    void ScanIdentifier();
 
     /**
-     * @brief Scan and returns the next identifier.
+     * @brief Skip chars of the next Number.
      */
-    string ScanString();
+    void ScanNumber();
 
     /**
-     * @brief Scan and returns the next identifier.
+     * @brief Skip chars of the next string, opening '"' already consumed.
      */
-    string ScanChar();
+    void ScanString();
 
     /**
-     * @brief Error report error info.
+     * @brief Skip chars of the next char, opening '\'' already consumed.
+     */
+    void ScanChar();
+
+    /**
+     * @brief Error report error info to the error handler.
      * @offs offset
      * @msg error message
      */
     void Error(int offs, const string& msg);
 
     // immutable state
-    string src_;
+    shared_ptr<input::SourceBuffer> buf_;
+    const char* src_;
+    int src_size_;
     shared_ptr<token::File> file_;
 
     // scanning state
@@ -82,6 +125,9 @@ private:
     int offset_{};
     int read_offset_{};
 
+    // line offsets found when skipping white spaces.
+    vector<int> line_buf_{};
+
     // error handler.
     shared_ptr<ErrorHandler> err_;
 };
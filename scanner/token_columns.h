@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "scanner/scanner.h"
+
+using namespace std;
+
+/**
+ * @brief TokenColumns is a scanned token stream as parallel arrays of kind, offset and length.
+ * A pass looking at kinds only, e.g. one counting or skipping tokens, reads one byte a token.
+ */
+class TokenColumns {
+public:
+    int Size() const { return static_cast<int>(kind_.size()); }
+
+    void Append(const TokenRecord& rec) {
+        kind_.push_back(static_cast<uint8_t>(rec.tok));
+        offset_.push_back(rec.offset);
+        length_.push_back(rec.length);
+    }
+
+    // Get returns the i-th token as a record, e.g. for Scanner::Text.
+    TokenRecord Get(int i) const { return TokenRecord{static_cast<token::Token>(kind_[i]), offset_[i], length_[i]}; }
+
+    /**
+     * @brief ScanAll appends the tokens scanner has left, END_OF_FILE is the last one appended.
+     */
+    void ScanAll(Scanner* scanner) {
+        TokenRecord rec{};
+        do {
+            scanner->Scan(&rec);
+            Append(rec);
+        } while (rec.tok != token::END_OF_FILE);
+    }
+
+    vector<uint8_t> kind_;
+    vector<int32_t> offset_;
+    vector<int32_t> length_;
+};
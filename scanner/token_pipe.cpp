@@ -0,0 +1,73 @@
+#include "scanner/token_pipe.h"
+#include "prof/prof.h"
+
+// kSpins is how many times a side polls the other before yielding its cpu.
+const static int kSpins = 256;
+
+// Backoff is called by a side waiting for the other, it polls a while then yields.
+static void Backoff(int* spins) {
+    if (++*spins < kSpins) {
+        return;
+    }
+    this_thread::yield();
+}
+
+TokenPipe::TokenPipe(const shared_ptr<Scanner>& scanner, const shared_ptr<token::File>& file)
+    : scanner_(scanner), file_(file), ring_(new PipedToken[kSize]), head_(0), tail_(0), stop_(false),
+      read_(0), avail_(0) {
+    thread_ = thread(&TokenPipe::Produce, this);
+}
+
+TokenPipe::~TokenPipe() {
+    stop_.store(true, memory_order_relaxed);
+    thread_.join();
+}
+
+void TokenPipe::Produce() {
+    prof::ScopedPhase phase(prof::Scan);
+    // the scanner owns slots in [write, room_end), others are not released by the reader yet.
+    size_t write = 0, room_end = kSize, published = 0;
+    while (true) {
+        if (write == room_end) {
+            head_.store(write, memory_order_release);
+            published = write;
+
+            int spins = 0;
+            size_t tail;
+            while ((tail = tail_.load(memory_order_acquire)) + kSize == write) {
+                if (stop_.load(memory_order_relaxed)) {
+                    return;
+                }
+                Backoff(&spins);
+            }
+            room_end = tail + kSize;
+        }
+
+        PipedToken& tok = ring_[write & kMask];
+        scanner_->Scan(&tok.rec);
+        file_->GetLineColumn(tok.rec.offset, &tok.line, &tok.column);
+        write++;
+
+        if (tok.rec.tok == token::END_OF_FILE) {
+            head_.store(write, memory_order_release);
+            return;
+        }
+        if (write - published >= kBatch) {
+            head_.store(write, memory_order_release);
+            published = write;
+            if (stop_.load(memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+}
+
+void TokenPipe::Refill() {
+    // the scanner may be waiting for room, give back all tokens popped.
+    tail_.store(read_, memory_order_release);
+
+    int spins = 0;
+    while ((avail_ = head_.load(memory_order_acquire)) == read_) {
+        Backoff(&spins);
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+#include "scanner/scanner.h"
+#include "token/position.h"
+
+using namespace std;
+
+/**
+ * @brief PipedToken is a scanned token with its line and column resolved.
+ */
+struct PipedToken {
+    TokenRecord rec;
+    int line;
+    int column;
+};
+
+/**
+ * @brief TokenPipe runs a scanner ahead of its reader on another thread.
+ * Tokens are passed through a single producer single consumer ring without locks,
+ * each side publishes its index once per batch of tokens, so the cache lines of the
+ * indexes move between cores rarely. Until the pipe is destroyed, the scanner must
+ * only be used for Text and Literal, which read the immutable source.
+ */
+class TokenPipe {
+public:
+    TokenPipe(const shared_ptr<Scanner>& scanner, const shared_ptr<token::File>& file);
+    // ~TokenPipe stops the scanner thread, tokens not popped are dropped.
+    ~TokenPipe();
+    TokenPipe(const TokenPipe&) = delete;
+    TokenPipe& operator=(const TokenPipe&) = delete;
+
+    /**
+     * @brief Pop takes the next token, waiting for the scanner if it is behind.
+     * END_OF_FILE is never taken out, so it is popped again and again as Scanner::Scan does.
+     */
+    void Pop(PipedToken* tok) {
+        if (read_ == avail_) {
+            Refill();
+        }
+        *tok = ring_[read_ & kMask];
+        if (tok->rec.tok == token::END_OF_FILE) {
+            return;
+        }
+        if ((++read_ & (kBatch - 1)) == 0) {
+            tail_.store(read_, memory_order_release);
+        }
+    }
+private:
+    // kSize is the count of tokens in the ring, a power of 2.
+    static const size_t kSize = 1 << 12;
+    static const size_t kMask = kSize - 1;
+    // kBatch is how many tokens a side handles before publishing its index.
+    static const size_t kBatch = 64;
+    static const size_t kCacheLine = 64;
+
+    // Produce scans tokens into the ring until END_OF_FILE or stop_, on the scanner thread.
+    void Produce();
+
+    // Refill waits until the scanner published tokens after read_.
+    void Refill();
+
+    shared_ptr<Scanner> scanner_;
+    shared_ptr<token::File> file_;
+    unique_ptr<PipedToken[]> ring_;
+
+    // head_ is the count of tokens published by the scanner, tail_ is the count
+    // released by the reader, each is written by one side only.
+    char pad0_[kCacheLine];
+    atomic<size_t> head_;
+    char pad1_[kCacheLine - sizeof(atomic<size_t>)];
+    atomic<size_t> tail_;
+    char pad2_[kCacheLine - sizeof(atomic<size_t>)];
+    atomic<bool> stop_;
+
+    // Reader only, read_ is the next token to pop, tokens before avail_ are published.
+    size_t read_;
+    size_t avail_;
+
+    thread thread_;
+};
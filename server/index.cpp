@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include "ast/visitor.h"
+#include "parser/var_table.h"
+#include "server/index.h"
+
+namespace server {
+
+// TypeDecl writes a decl of name typed type as source, e.g. 'int a[2][3]'.
+static string TypeDecl(const ast::TypeNode* type, const string& name, bool is_const) {
+    string dims;
+    while (type != nullptr && type->Type() == ast::ArrayType) {
+        auto arr = static_cast<const ast::ArrayTypeNode*>(type);
+        dims += "[" + to_string(arr->size_) + "]";
+        type = arr->item_;
+    }
+
+    string base = "?";
+    if (type != nullptr) {
+        switch (type->Type()) {
+            case ast::IntType: base = "int"; break;
+            case ast::CharType: base = "char"; break;
+            case ast::VoidType: base = "void"; break;
+            case ast::StringType: base = "string"; break;
+            default: break;
+        }
+    }
+    return (is_const ? "const " : "") + base + " " + name + dims;
+}
+
+// Resolver binds names of a file to symbols of an index, walking it as the checker does.
+// A duplicate decl is a symbol of its own, but names after it stay bound to the first one.
+class Resolver : private ast::StmtVisitor<Resolver>, private ast::ExprVisitor<Resolver> {
+    friend class ast::StmtVisitor<Resolver>;
+    friend class ast::ExprVisitor<Resolver>;
+public:
+    explicit Resolver(Index* index) : index_(index) {}
+
+    void Resolve(const ast::FileNode& file) {
+        for (auto decl : file.decl_) {
+            if (decl == nullptr) {
+                continue;
+            }
+            if (decl->Type() == ast::VarDecl) {
+                ResolveVarDecl(static_cast<ast::VarDeclNode*>(decl));
+            } else if (decl->Type() == ast::FuncDecl) {
+                ResolveFuncDecl(static_cast<ast::FuncDeclNode*>(decl));
+            }
+        }
+    }
+private:
+    // NewSymbol adds a symbol named by name and a ref of the name, returns index of the symbol.
+    int NewSymbol(const ast::IdentNode* name, const string& detail) {
+        int symbol = static_cast<int>(index_->symbols_.size());
+        int length = static_cast<int>(name->name_.size());
+        index_->symbols_.push_back(Index::Symbol{name->pos_.offset, length, detail});
+        AddRef(name, symbol);
+        return symbol;
+    }
+
+    void AddRef(const ast::IdentNode* name, int symbol) {
+        index_->refs_.push_back(Index::Ref{name->pos_.offset, static_cast<int>(name->name_.size()), symbol});
+    }
+
+    // DeclareVar adds a var named by name to current code block, unless it is there already.
+    void DeclareVar(ast::IdentNode* name, ast::TypeNode* type, bool is_const, const string& detail) {
+        int symbol = NewSymbol(name, detail);
+        if (name->symbol_ < 0 || var_table_.IsVarExistedInCurrentCodeBlock(name->symbol_)) {
+            return;
+        }
+
+        var_table_.AddVar(name->symbol_, type, is_const);
+        const VarTable::Identifier* ident = nullptr;
+        var_table_.GetVar(name->symbol_, &ident);
+        if (ident->unique_id >= static_cast<int>(vars_.size())) {
+            vars_.resize(ident->unique_id + 1, -1);
+        }
+        vars_[ident->unique_id] = symbol;
+    }
+
+    void ResolveVarDecl(ast::VarDeclNode* decl) {
+        for (auto single : decl->decls_) {
+            if (single == nullptr || single->Type() != ast::SingleVarDecl) {
+                continue;
+            }
+
+            auto var = static_cast<ast::SingleVarDeclNode*>(single);
+            if (var->name_ != nullptr) {
+                DeclareVar(var->name_, var->type_, var->is_const_, TypeDecl(var->type_, var->name_->name_, var->is_const_));
+            }
+            ResolveExpr(var->val_);
+        }
+    }
+
+    void ResolveFuncDecl(ast::FuncDeclNode* decl) {
+        if (decl->name_ == nullptr) {
+            return;
+        }
+
+        string detail = TypeDecl(decl->type_, decl->name_->name_, false) + "(";
+        if (decl->params_ != nullptr) {
+            for (size_t i = 0; i < decl->params_->fields_.size(); i++) {
+                auto field = decl->params_->fields_[i];
+                detail += (i > 0 ? ", " : "");
+                detail += (field != nullptr && field->name_ != nullptr) ? TypeDecl(field->type_, field->name_->name_, false) : "?";
+            }
+        }
+        detail += ")";
+
+        // a function may not be named as a global var, as in Checker::DeclareFunc.
+        int symbol = NewSymbol(decl->name_, detail);
+        if (decl->name_->symbol_ >= 0 && !var_table_.IsVarExistedInCurrentCodeBlock(decl->name_->symbol_)) {
+            var_table_.AddFunc(decl->name_->symbol_, decl);
+            funcs_[decl] = symbol;
+        }
+
+        // params and the stmts of the body share one code block.
+        var_table_.CreateCodeBlock();
+        if (decl->params_ != nullptr) {
+            for (auto field : decl->params_->fields_) {
+                if (field != nullptr && field->name_ != nullptr) {
+                    DeclareVar(field->name_, field->type_, false, TypeDecl(field->type_, field->name_->name_, false));
+                }
+            }
+        }
+        if (decl->body_ != nullptr && decl->body_->Type() == ast::BlockStmt) {
+            ResolveStmts(static_cast<ast::BlockStmtNode*>(decl->body_)->stmts_);
+        }
+        var_table_.DestroyCodeBlock();
+    }
+
+    void ResolveStmt(ast::StmtNode* stmt) {
+        if (stmt != nullptr) {
+            VisitStmt(stmt);
+        }
+    }
+
+    void ResolveStmts(const vector<ast::StmtNode*>& stmts) {
+        for (auto stmt : stmts) {
+            ResolveStmt(stmt);
+        }
+    }
+
+    void ResolveExpr(ast::ExprNode* expr) {
+        if (expr != nullptr) {
+            VisitExpr(expr);
+        }
+    }
+
+    void VisitDeclStmt(ast::DeclStmtNode* stmt) {
+        if (stmt->decl_ != nullptr && stmt->decl_->Type() == ast::VarDecl) {
+            ResolveVarDecl(static_cast<ast::VarDeclNode*>(stmt->decl_));
+        }
+    }
+    void VisitExprStmt(ast::ExprStmtNode* stmt) { ResolveExpr(stmt->expr_); }
+    void VisitAssignStmt(ast::AssignStmtNode* stmt) {
+        ResolveExpr(stmt->lhs_);
+        ResolveExpr(stmt->rhs_);
+    }
+    void VisitReturnStmt(ast::ReturnStmtNode* stmt) { ResolveExpr(stmt->results_); }
+    void VisitBlockStmt(ast::BlockStmtNode* stmt) {
+        var_table_.CreateCodeBlock();
+        ResolveStmts(stmt->stmts_);
+        var_table_.DestroyCodeBlock();
+    }
+    void VisitIfStmt(ast::IfStmtNode* stmt) {
+        ResolveExpr(stmt->cond_);
+        ResolveStmt(stmt->body_);
+        ResolveStmt(stmt->else_);
+    }
+    void VisitCaseStmt(ast::CaseStmtNode* stmt) {
+        ResolveExpr(stmt->cond_);
+        ResolveStmts(stmt->body_);
+    }
+    void VisitSwitchStmt(ast::SwitchStmtNode* stmt) {
+        ResolveExpr(stmt->cond_);
+        ResolveStmts(stmt->cases_);
+    }
+    // vars of the init of a for stmt are in the enclosing code block, as in the checker.
+    void VisitForStmt(ast::ForStmtNode* stmt) {
+        ResolveStmt(stmt->init_);
+        ResolveStmt(stmt->cond_);
+        ResolveStmt(stmt->step_);
+        ResolveStmt(stmt->body_);
+    }
+    void VisitWhileStmt(ast::WhileStmtNode* stmt) {
+        ResolveExpr(stmt->cond_);
+        ResolveStmt(stmt->body_);
+    }
+    void VisitScanStmt(ast::ScanStmtNode* stmt) { ResolveExpr(stmt->var_); }
+    void VisitPrintfStmt(ast::PrintfStmtNode* stmt) {
+        for (auto arg : stmt->args_) {
+            ResolveExpr(arg);
+        }
+    }
+
+    void VisitIdent(ast::IdentNode* expr) {
+        const VarTable::Identifier* ident = nullptr;
+        if (var_table_.GetVar(expr->symbol_, &ident) == 0 && ident->unique_id < static_cast<int>(vars_.size()) &&
+            vars_[ident->unique_id] >= 0) {
+            AddRef(expr, vars_[ident->unique_id]);
+        }
+    }
+    void VisitCompositeLit(ast::CompositeLitNode* expr) {
+        for (auto item : expr->items_) {
+            ResolveExpr(item);
+        }
+    }
+    void VisitParenExpr(ast::ParenExprNode* expr) { ResolveExpr(expr->expr_); }
+    void VisitIndexExpr(ast::IndexExprNode* expr) {
+        ResolveExpr(expr->x_);
+        ResolveExpr(expr->index_);
+    }
+    void VisitCallExpr(ast::CallExprNode* expr) {
+        if (expr->fun_ != nullptr && expr->fun_->Type() == ast::Ident) {
+            auto name = static_cast<ast::IdentNode*>(expr->fun_);
+            ast::FuncDeclNode* func = nullptr;
+            if (var_table_.GetFunc(name->symbol_, &func) == 0) {
+                auto it = funcs_.find(func);
+                if (it != funcs_.end()) {
+                    AddRef(name, it->second);
+                }
+            }
+        }
+        for (auto arg : expr->args_) {
+            ResolveExpr(arg);
+        }
+    }
+    void VisitUnaryExpr(ast::UnaryExprNode* expr) { ResolveExpr(expr->x_); }
+    void VisitBinaryExpr(ast::BinaryExprNode* expr) {
+        ResolveExpr(expr->x_);
+        ResolveExpr(expr->y_);
+    }
+private:
+    Index* index_;
+    VarTable var_table_;
+    // vars_[unique id in var table] is the symbol of the var, -1 for none.
+    vector<int> vars_;
+    unordered_map<const ast::FuncDeclNode*, int> funcs_;
+};
+
+void Index::Build(const ast::FileNode& file) {
+    symbols_.clear();
+    refs_.clear();
+    Resolver(this).Resolve(file);
+
+    sort(refs_.begin(), refs_.end(), [](const Ref& a, const Ref& b) { return a.offset < b.offset; });
+}
+
+const Index::Symbol* Index::Find(int offset, const Ref** ref) const {
+    // the last ref starting at or before offset is the only one which may cover it.
+    auto it = upper_bound(refs_.begin(), refs_.end(), offset, [](int off, const Ref& r) { return off < r.offset; });
+    if (it == refs_.begin()) {
+        return nullptr;
+    }
+    --it;
+    if (offset > it->offset + it->length) {
+        return nullptr;
+    }
+
+    if (ref != nullptr) {
+        *ref = &*it;
+    }
+    return &symbols_[it->symbol];
+}
+
+}// namespace server
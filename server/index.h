@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ast/ast.h"
+
+using namespace std;
+
+namespace server {
+
+// Index maps names in a file to the decls they refer to, names are resolved by the
+// scoping rules of the checker, so each one is bound to the same var or function.
+class Index {
+public:
+    // Symbol is a declared var, param or function.
+    class Symbol {
+    public:
+        // offset and length of the name in the decl.
+        int offset;
+        int length;
+        // detail is the decl written as source, e.g. 'const int n', 'int f(int a, char b)'.
+        string detail;
+    };
+
+    // Ref is a name in the text bound to symbols_[symbol], names in decls are refs too.
+    class Ref {
+    public:
+        int offset;
+        int length;
+        int symbol;
+    };
+
+    /**
+     * @brief Build indexes file, the index is cleared first.
+     */
+    void Build(const ast::FileNode& file);
+
+    /**
+     * @brief Find returns the symbol named at offset, nullptr if no bound name covers it.
+     * An offset just after a name finds it too, as editors place the cursor there.
+     *
+     * @param ref the name at offset.
+     */
+    const Symbol* Find(int offset, const Ref** ref = nullptr) const;
+
+    const vector<Symbol>& Symbols() const { return symbols_; }
+private:
+    friend class Resolver;
+
+    vector<Symbol> symbols_;
+    // refs_ are sorted by offset, names never overlap.
+    vector<Ref> refs_;
+};
+
+}// namespace server
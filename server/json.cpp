@@ -0,0 +1,337 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "server/json.h"
+
+namespace server {
+
+// kMaxDepth bounds nesting of arrays and objects, so malformed input can't exhaust the stack.
+const static int kMaxDepth = 256;
+
+const Json& Json::Get(const string& key) const {
+    static const Json null;
+    for (const auto& member : members_) {
+        if (member.first == key) {
+            return member.second;
+        }
+    }
+    return null;
+}
+
+Json& Json::Set(const string& key, Json value) {
+    kind_ = Object;
+    for (auto& member : members_) {
+        if (member.first == key) {
+            member.second = move(value);
+            return *this;
+        }
+    }
+    members_.emplace_back(key, move(value));
+    return *this;
+}
+
+static void WriteString(const string& s, string* out) {
+    out->push_back('"');
+    for (char c : s) {
+        switch (c) {
+            case '"': *out += "\\\""; break;
+            case '\\': *out += "\\\\"; break;
+            case '\n': *out += "\\n"; break;
+            case '\r': *out += "\\r"; break;
+            case '\t': *out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    *out += buf;
+                } else {
+                    out->push_back(c);
+                }
+        }
+    }
+    out->push_back('"');
+}
+
+void Json::Write(string* out) const {
+    switch (kind_) {
+        case Null:
+            *out += "null";
+            return;
+        case Bool:
+            *out += bool_ ? "true" : "false";
+            return;
+        case Number: {
+            char buf[32];
+            if (number_ == floor(number_) && fabs(number_) < 1e15) {
+                snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(number_));
+            } else {
+                snprintf(buf, sizeof(buf), "%.17g", number_);
+            }
+            *out += buf;
+            return;
+        }
+        case String:
+            WriteString(string_, out);
+            return;
+        case Array:
+            out->push_back('[');
+            for (size_t i = 0; i < items_.size(); i++) {
+                if (i > 0) {
+                    out->push_back(',');
+                }
+                items_[i].Write(out);
+            }
+            out->push_back(']');
+            return;
+        case Object:
+            out->push_back('{');
+            for (size_t i = 0; i < members_.size(); i++) {
+                if (i > 0) {
+                    out->push_back(',');
+                }
+                WriteString(members_[i].first, out);
+                out->push_back(':');
+                members_[i].second.Write(out);
+            }
+            out->push_back('}');
+            return;
+    }
+}
+
+// JsonParser reads a value from text by recursive descent, each method returns 0 or -1.
+class JsonParser {
+public:
+    explicit JsonParser(const string& text) : text_(text) {}
+
+    int ParseAll(Json* value) {
+        if (ParseValue(value, 0) != 0) {
+            return -1;
+        }
+        SkipSpace();
+        return pos_ == text_.size() ? 0 : -1;
+    }
+private:
+    void SkipSpace() {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r')) {
+            pos_++;
+        }
+    }
+
+    bool Consume(const char* word) {
+        size_t n = char_traits<char>::length(word);
+        if (text_.compare(pos_, n, word) != 0) {
+            return false;
+        }
+        pos_ += n;
+        return true;
+    }
+
+    int ParseValue(Json* value, int depth) {
+        if (depth > kMaxDepth) {
+            return -1;
+        }
+
+        SkipSpace();
+        if (pos_ >= text_.size()) {
+            return -1;
+        }
+        switch (text_[pos_]) {
+            case '{':
+                return ParseObject(value, depth);
+            case '[':
+                return ParseArray(value, depth);
+            case '"':
+                *value = Json(Json::String);
+                return ParseString(&value->string_);
+            case 't':
+                *value = Json(true);
+                return Consume("true") ? 0 : -1;
+            case 'f':
+                *value = Json(false);
+                return Consume("false") ? 0 : -1;
+            case 'n':
+                *value = Json();
+                return Consume("null") ? 0 : -1;
+            default:
+                return ParseNumber(value);
+        }
+    }
+
+    int ParseObject(Json* value, int depth) {
+        *value = Json(Json::Object);
+        pos_++;
+        SkipSpace();
+        if (pos_ < text_.size() && text_[pos_] == '}') {
+            pos_++;
+            return 0;
+        }
+
+        while (true) {
+            SkipSpace();
+            string key;
+            if (pos_ >= text_.size() || text_[pos_] != '"' || ParseString(&key) != 0) {
+                return -1;
+            }
+            SkipSpace();
+            if (pos_ >= text_.size() || text_[pos_] != ':') {
+                return -1;
+            }
+            pos_++;
+
+            Json member;
+            if (ParseValue(&member, depth + 1) != 0) {
+                return -1;
+            }
+            value->Set(key, move(member));
+
+            SkipSpace();
+            if (pos_ < text_.size() && text_[pos_] == ',') {
+                pos_++;
+            } else if (pos_ < text_.size() && text_[pos_] == '}') {
+                pos_++;
+                return 0;
+            } else {
+                return -1;
+            }
+        }
+    }
+
+    int ParseArray(Json* value, int depth) {
+        *value = Json(Json::Array);
+        pos_++;
+        SkipSpace();
+        if (pos_ < text_.size() && text_[pos_] == ']') {
+            pos_++;
+            return 0;
+        }
+
+        while (true) {
+            Json item;
+            if (ParseValue(&item, depth + 1) != 0) {
+                return -1;
+            }
+            value->items_.push_back(move(item));
+
+            SkipSpace();
+            if (pos_ < text_.size() && text_[pos_] == ',') {
+                pos_++;
+            } else if (pos_ < text_.size() && text_[pos_] == ']') {
+                pos_++;
+                return 0;
+            } else {
+                return -1;
+            }
+        }
+    }
+
+    // ParseHex4 reads the 4 hex digits of a \u escape.
+    int ParseHex4(unsigned* code) {
+        if (pos_ + 4 > text_.size()) {
+            return -1;
+        }
+        *code = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = text_[pos_++];
+            *code <<= 4;
+            if (c >= '0' && c <= '9') {
+                *code |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                *code |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                *code |= c - 'A' + 10;
+            } else {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    static void AppendUtf8(unsigned code, string* out) {
+        if (code < 0x80) {
+            out->push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            out->push_back(static_cast<char>(0xC0 | (code >> 6)));
+            out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            out->push_back(static_cast<char>(0xE0 | (code >> 12)));
+            out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            out->push_back(static_cast<char>(0xF0 | (code >> 18)));
+            out->push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+
+    int ParseString(string* out) {
+        pos_++;
+        while (pos_ < text_.size()) {
+            char c = text_[pos_++];
+            if (c == '"') {
+                return 0;
+            }
+            if (c != '\\') {
+                out->push_back(c);
+                continue;
+            }
+
+            if (pos_ >= text_.size()) {
+                return -1;
+            }
+            char esc = text_[pos_++];
+            switch (esc) {
+                case '"': out->push_back('"'); break;
+                case '\\': out->push_back('\\'); break;
+                case '/': out->push_back('/'); break;
+                case 'b': out->push_back('\b'); break;
+                case 'f': out->push_back('\f'); break;
+                case 'n': out->push_back('\n'); break;
+                case 'r': out->push_back('\r'); break;
+                case 't': out->push_back('\t'); break;
+                case 'u': {
+                    unsigned code = 0;
+                    if (ParseHex4(&code) != 0) {
+                        return -1;
+                    }
+                    // a high surrogate is joined with the low one after it.
+                    unsigned low = 0;
+                    if (code >= 0xD800 && code < 0xDC00 && Consume("\\u") && ParseHex4(&low) == 0 &&
+                        low >= 0xDC00 && low < 0xE000) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    AppendUtf8(code, out);
+                    break;
+                }
+                default:
+                    return -1;
+            }
+        }
+        return -1;
+    }
+
+    int ParseNumber(Json* value) {
+        const char* begin = text_.c_str() + pos_;
+        if (!((*begin >= '0' && *begin <= '9') || *begin == '-')) {
+            return -1;
+        }
+        char* end = nullptr;
+        double n = strtod(begin, &end);
+        if (end == begin) {
+            return -1;
+        }
+        pos_ += end - begin;
+        *value = Json(n);
+        return 0;
+    }
+private:
+    const string& text_;
+    size_t pos_ = 0;
+};
+
+int Json::Parse(const string& text, Json* value) {
+    return JsonParser(text).ParseAll(value);
+}
+
+}// namespace server
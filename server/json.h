@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace server {
+
+// Json is a JSON value, members of an object are kept in the order they are set.
+class Json {
+public:
+    enum Kind {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+
+    Json() = default;
+    Json(bool b) : kind_(Bool), bool_(b) {}
+    Json(int n) : kind_(Number), number_(n) {}
+    Json(double n) : kind_(Number), number_(n) {}
+    Json(const string& s) : kind_(String), string_(s) {}
+    Json(const char* s) : kind_(String), string_(s) {}
+
+    static Json MakeArray() { return Json(Array); }
+    static Json MakeObject() { return Json(Object); }
+
+    Kind kind() const { return kind_; }
+    bool IsNull() const { return kind_ == Null; }
+
+    // As* return the value, or the zero value if it is of another kind.
+    bool AsBool() const { return kind_ == Bool && bool_; }
+    double AsNumber() const { return kind_ == Number ? number_ : 0; }
+    int AsInt() const { return static_cast<int>(AsNumber()); }
+    const string& AsString() const { return string_; }
+
+    // Size returns count of items of an array, 0 for other kinds.
+    size_t Size() const { return items_.size(); }
+    const Json& At(size_t i) const { return items_[i]; }
+    void Push(Json item) { items_.push_back(move(item)); }
+
+    /**
+     * @brief Get returns the member key of an object, a null value if there is none.
+     */
+    const Json& Get(const string& key) const;
+
+    /**
+     * @brief Set sets the member key of an object, which is added if it is not set yet.
+     * @return this, so members may be chained.
+     */
+    Json& Set(const string& key, Json value);
+
+    /**
+     * @brief Write appends the value in compact text to out.
+     */
+    void Write(string* out) const;
+
+    string ToString() const {
+        string out;
+        Write(&out);
+        return out;
+    }
+
+    /**
+     * @brief Parse reads a value from the whole text, whitespace around it is allowed.
+     * @return 0 for success, -1 if text is malformed or nests too deep.
+     */
+    static int Parse(const string& text, Json* value);
+private:
+    explicit Json(Kind kind) : kind_(kind) {}
+
+    Kind kind_ = Null;
+    bool bool_ = false;
+    double number_ = 0;
+    string string_;
+    vector<Json> items_;
+    vector<pair<string, Json>> members_;
+
+    friend class JsonParser;
+};
+
+}// namespace server
@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+#include "server/server.h"
+
+namespace server {
+
+// JSON-RPC error codes.
+const static int kParseError = -32700;
+const static int kInvalidRequest = -32600;
+const static int kMethodNotFound = -32601;
+
+// LSP text document sync kind, edits are sent as ranges.
+const static int kSyncIncremental = 2;
+// LSP diagnostic severity.
+const static int kSeverityError = 1;
+
+int Server::Run() {
+    string body;
+    while (ReadMessage(&body) == 0) {
+        Json msg;
+        if (Json::Parse(body, &msg) != 0) {
+            ReplyError(Json(), kParseError, "malformed json");
+            continue;
+        }
+        if (!Handle(msg)) {
+            break;
+        }
+    }
+
+    return shutdown_ ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int Server::ReadMessage(string* body) {
+    const string length_header = "content-length:";
+    long length = -1;
+    string line;
+    while (getline(in_, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            break;
+        }
+
+        // header names are case insensitive, other headers are ignored.
+        string name = line.substr(0, length_header.size());
+        transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if (name == length_header) {
+            length = strtol(line.c_str() + length_header.size(), nullptr, 10);
+        }
+    }
+    if (!in_ || length < 0) {
+        return -1;
+    }
+
+    // the body is read by chunks, so a bogus length takes no more memory than the input.
+    body->clear();
+    char chunk[64 << 10];
+    while (length > 0) {
+        in_.read(chunk, min(length, static_cast<long>(sizeof(chunk))));
+        if (in_.gcount() == 0) {
+            return -1;
+        }
+        body->append(chunk, static_cast<size_t>(in_.gcount()));
+        length -= in_.gcount();
+    }
+    return 0;
+}
+
+void Server::Send(const Json& msg) {
+    string body = msg.ToString();
+    out_ << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+    out_.flush();
+}
+
+void Server::Reply(const Json& id, const Json& result) {
+    Send(Json::MakeObject().Set("jsonrpc", "2.0").Set("id", id).Set("result", result));
+}
+
+void Server::ReplyError(const Json& id, int code, const string& msg) {
+    Json error = Json::MakeObject().Set("code", code).Set("message", msg);
+    Send(Json::MakeObject().Set("jsonrpc", "2.0").Set("id", id).Set("error", error));
+}
+
+bool Server::Handle(const Json& msg) {
+    const string& method = msg.Get("method").AsString();
+    const Json& id = msg.Get("id");
+    const Json& params = msg.Get("params");
+    // requests have an id and are replied, notifications have none.
+    bool request = !id.IsNull();
+
+    if (method == "exit") {
+        return false;
+    }
+
+    if (method == "initialize") {
+        Reply(id, Initialize(params));
+    } else if (method == "shutdown") {
+        shutdown_ = true;
+        Reply(id, Json());
+    } else if (method == "textDocument/didOpen") {
+        DidOpen(params);
+    } else if (method == "textDocument/didChange") {
+        DidChange(params);
+    } else if (method == "textDocument/didClose") {
+        DidClose(params);
+    } else if (method == "textDocument/definition") {
+        Reply(id, Definition(params));
+    } else if (method == "textDocument/hover") {
+        Reply(id, Hover(params));
+    } else if (method.empty() && request) {
+        ReplyError(id, kInvalidRequest, "method is required");
+    } else if (request) {
+        ReplyError(id, kMethodNotFound, "unknown method " + method);
+    }
+    return true;
+}
+
+Json Server::Initialize(const Json& params) {
+    Json sync = Json::MakeObject().Set("openClose", true).Set("change", kSyncIncremental);
+    Json capabilities = Json::MakeObject()
+        .Set("textDocumentSync", sync)
+        .Set("definitionProvider", true)
+        .Set("hoverProvider", true);
+
+    // characters are counted in bytes, which is what a client offering utf-8 expects,
+    // and the same as utf-16 for the ascii sources of the language.
+    const Json& encodings = params.Get("capabilities").Get("general").Get("positionEncodings");
+    for (size_t i = 0; i < encodings.Size(); i++) {
+        if (encodings.At(i).AsString() == "utf-8") {
+            capabilities.Set("positionEncoding", "utf-8");
+        }
+    }
+
+    return Json::MakeObject()
+        .Set("capabilities", capabilities)
+        .Set("serverInfo", Json::MakeObject().Set("name", "simple_lang"));
+}
+
+void Server::DidOpen(const Json& params) {
+    const Json& doc = params.Get("textDocument");
+    const string& uri = doc.Get("uri").AsString();
+
+    auto& file = files_[uri];
+    file.reset(new OpenFile(uri));
+    file->doc.Open(doc.Get("text").AsString());
+    Loaded(file.get());
+    PublishDiagnostics(uri, *file);
+}
+
+void Server::DidChange(const Json& params) {
+    OpenFile* file = Find(params);
+    if (file == nullptr) {
+        return;
+    }
+
+    // changes apply in order, a range is in the text left by the changes before it.
+    const Json& changes = params.Get("contentChanges");
+    for (size_t i = 0; i < changes.Size(); i++) {
+        const Json& change = changes.At(i);
+        const Json& range = change.Get("range");
+        if (range.IsNull()) {
+            file->doc.Open(change.Get("text").AsString());
+        } else {
+            incremental::Edit edit;
+            edit.offset = Offset(*file, range.Get("start"));
+            edit.length = max(0, Offset(*file, range.Get("end")) - edit.offset);
+            edit.text = change.Get("text").AsString();
+            file->doc.Update(edit);
+        }
+        Loaded(file);
+    }
+    PublishDiagnostics(params.Get("textDocument").Get("uri").AsString(), *file);
+}
+
+void Server::DidClose(const Json& params) {
+    const string& uri = params.Get("textDocument").Get("uri").AsString();
+    if (files_.erase(uri) == 0) {
+        return;
+    }
+
+    // diagnostics of a closed file are cleared.
+    Json notification = Json::MakeObject()
+        .Set("jsonrpc", "2.0")
+        .Set("method", "textDocument/publishDiagnostics")
+        .Set("params", Json::MakeObject().Set("uri", uri).Set("diagnostics", Json::MakeArray()));
+    Send(notification);
+}
+
+Json Server::Definition(const Json& params) {
+    OpenFile* file = Find(params);
+    if (file == nullptr) {
+        return Json();
+    }
+
+    const Index::Ref* ref = nullptr;
+    auto symbol = Lookup(file, params, &ref);
+    if (symbol == nullptr) {
+        return Json();
+    }
+    return Json::MakeObject()
+        .Set("uri", params.Get("textDocument").Get("uri"))
+        .Set("range", Range(*file, symbol->offset, symbol->length));
+}
+
+Json Server::Hover(const Json& params) {
+    OpenFile* file = Find(params);
+    if (file == nullptr) {
+        return Json();
+    }
+
+    const Index::Ref* ref = nullptr;
+    auto symbol = Lookup(file, params, &ref);
+    if (symbol == nullptr) {
+        return Json();
+    }
+    return Json::MakeObject()
+        .Set("contents", Json::MakeObject().Set("kind", "plaintext").Set("value", symbol->detail))
+        .Set("range", Range(*file, ref->offset, ref->length));
+}
+
+void Server::Loaded(OpenFile* file) {
+    const string& text = file->doc.Text();
+    file->lines.assign(1, 0);
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '\n') {
+            file->lines.push_back(static_cast<int>(i + 1));
+        }
+    }
+    file->indexed = false;
+}
+
+void Server::PublishDiagnostics(const string& uri, const OpenFile& file) {
+    vector<ec::Error> errors;
+    file.doc.Errors(&errors);
+
+    const string& text = file.doc.Text();
+    Json diagnostics = Json::MakeArray();
+    for (const auto& err : errors) {
+        // an error covers the word at its position, npos errors are put at the start of the file.
+        int begin = max(0, err.pos_.offset);
+        int end = begin;
+        while (end < static_cast<int>(text.size()) && (isalnum(static_cast<unsigned char>(text[end])) || text[end] == '_')) {
+            end++;
+        }
+        end = max(end, min(begin + 1, static_cast<int>(text.size())));
+
+        // members are set one by one, so the whole diagnostic is moved to the array.
+        Json diagnostic = Json::MakeObject();
+        diagnostic.Set("range", Range(file, begin, end - begin));
+        diagnostic.Set("severity", kSeverityError);
+        diagnostic.Set("code", string(1, static_cast<char>('a' + err.type_)));
+        diagnostic.Set("source", "simple_lang");
+        diagnostic.Set("message", err.msg_);
+        diagnostics.Push(move(diagnostic));
+    }
+
+    Json params = Json::MakeObject();
+    params.Set("uri", uri);
+    params.Set("diagnostics", move(diagnostics));
+    Json notification = Json::MakeObject();
+    notification.Set("jsonrpc", "2.0");
+    notification.Set("method", "textDocument/publishDiagnostics");
+    notification.Set("params", move(params));
+    Send(notification);
+}
+
+Server::OpenFile* Server::Find(const Json& params) {
+    auto it = files_.find(params.Get("textDocument").Get("uri").AsString());
+    return it == files_.end() ? nullptr : it->second.get();
+}
+
+const Index::Symbol* Server::Lookup(OpenFile* file, const Json& params, const Index::Ref** ref) {
+    if (!file->indexed) {
+        file->index = Index();
+        if (file->doc.Ok()) {
+            file->index.Build(*file->doc.File());
+        }
+        file->indexed = true;
+    }
+    return file->index.Find(Offset(*file, params.Get("position")), ref);
+}
+
+int Server::Offset(const OpenFile& file, const Json& pos) const {
+    int line = pos.Get("line").AsInt();
+    if (line < 0) {
+        return 0;
+    }
+    int text_size = static_cast<int>(file.doc.Text().size());
+    if (line >= static_cast<int>(file.lines.size())) {
+        return text_size;
+    }
+
+    // the end of a line is before its '\n'.
+    int begin = file.lines[line];
+    int end = (line + 1 < static_cast<int>(file.lines.size())) ? file.lines[line + 1] - 1 : text_size;
+    return begin + max(0, min(pos.Get("character").AsInt(), end - begin));
+}
+
+Json Server::Position(const OpenFile& file, int offset) const {
+    auto it = upper_bound(file.lines.begin(), file.lines.end(), offset);
+    int line = static_cast<int>(it - file.lines.begin()) - 1;
+    return Json::MakeObject().Set("line", line).Set("character", offset - file.lines[line]);
+}
+
+Json Server::Range(const OpenFile& file, int offset, int length) const {
+    return Json::MakeObject().Set("start", Position(file, offset)).Set("end", Position(file, offset + length));
+}
+
+}// namespace server
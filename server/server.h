@@ -0,0 +1,90 @@
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "incremental/document.h"
+#include "server/index.h"
+#include "server/json.h"
+
+using namespace std;
+
+namespace server {
+
+// Server is a language server speaking LSP, JSON-RPC messages framed by Content-Length
+// headers, on a pair of streams. It serves diagnostics, go to definition and hover.
+// Every open file stays resident as an incremental document, so an edit re-parses and
+// re-checks the decls it touches only, and diagnostics are published after each one.
+// The name index of a file is built by the first definition or hover after an edit.
+class Server {
+public:
+    Server(istream& in, ostream& out) : in_(in), out_(out) {}
+
+    /**
+     * @brief Run serves messages until the exit notification, or the end of input.
+     *
+     * @return process exit code, 0 if exit comes after shutdown.
+     */
+    int Run();
+private:
+    // OpenFile is the state kept for an open file.
+    class OpenFile {
+    public:
+        explicit OpenFile(const string& uri) : doc(uri) {}
+
+        incremental::Document doc;
+        // lines[i] is offset of the first byte of line i, from 0 as in LSP.
+        vector<int> lines;
+        Index index;
+        // indexed is false if index is older than doc.
+        bool indexed = false;
+    };
+
+    /**
+     * @brief ReadMessage reads the body of the next message.
+     *
+     * @return 0 for success, -1 on the end of input or a malformed header.
+     */
+    int ReadMessage(string* body);
+
+    void Send(const Json& msg);
+    void Reply(const Json& id, const Json& result);
+    void ReplyError(const Json& id, int code, const string& msg);
+
+    // Handle serves msg, it returns false once the server should exit.
+    bool Handle(const Json& msg);
+
+    Json Initialize(const Json& params);
+    void DidOpen(const Json& params);
+    void DidChange(const Json& params);
+    void DidClose(const Json& params);
+    Json Definition(const Json& params);
+    Json Hover(const Json& params);
+
+    // Loaded updates lines and drops the index of file after its text changed.
+    void Loaded(OpenFile* file);
+
+    void PublishDiagnostics(const string& uri, const OpenFile& file);
+
+    // Find returns the open file of params.textDocument, nullptr if it's not open.
+    OpenFile* Find(const Json& params);
+
+    // Lookup returns the symbol at params.position, the index of file is built if needed.
+    const Index::Symbol* Lookup(OpenFile* file, const Json& params, const Index::Ref** ref);
+
+    // Offset converts an LSP position of file to an offset, characters are bytes and clamped to the line.
+    int Offset(const OpenFile& file, const Json& pos) const;
+    Json Position(const OpenFile& file, int offset) const;
+    Json Range(const OpenFile& file, int offset, int length) const;
+private:
+    istream& in_;
+    ostream& out_;
+
+    map<string, unique_ptr<OpenFile>> files_;
+    bool shutdown_ = false;
+};
+
+}// namespace server
@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ast/writer.h"
+#include "bench/gen.h"
+#include "check/check.h"
+#include "error.h"
+#include "input/source_buffer.h"
+#include "parser/parser.h"
+#include "prof/prof.h"
+#include "scanner/scanner.h"
+
+using namespace std;
+
+namespace stress {
+
+// CountingErrorHandler counts scan errors, broken inputs have plenty.
+class CountingErrorHandler: public ErrorHandler {
+public:
+    ~CountingErrorHandler() override = default;
+    void Report(const token::Position&, const string&) override { count++; }
+    int count = 0;
+};
+
+// Options are the command line of the harness.
+class Options {
+public:
+    // size is the largest input, each step before it is half as big.
+    size_t size = 1 << 20;
+    int steps = 4;
+    int reps = 3;
+    uint32_t seed = 1;
+    // fuzz is the count of small mutated inputs which only have to go through without crashing.
+    int fuzz = 200;
+    // max_time_slope and max_alloc_slope are the budgets, exponents of the size the
+    // cost may grow with, 1 is linear. Time is noisy, so it gets more slack.
+    double max_time_slope = 1.3;
+    double max_alloc_slope = 1.15;
+    // max_ms caps a run, a case with a longer one is over budget and its bigger inputs
+    // are skipped, so a front end gone quadratic fails fast.
+    int max_ms = 5000;
+    string filter;
+};
+
+// Rng is xorshift32, as the generator of bench, so inputs are the same on all platforms.
+class Rng {
+public:
+    explicit Rng(uint32_t seed) : state_(seed == 0 ? 0x9E3779B9u : seed) {}
+
+    uint32_t Next() {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 17;
+        state_ ^= state_ << 5;
+        return state_;
+    }
+
+    // Below returns a number in [0, n).
+    size_t Below(size_t n) { return Next() % n; }
+private:
+    uint32_t state_;
+};
+
+// Case makes inputs of a kind, make returns an input of about size bytes.
+class Case {
+public:
+    string name;
+    function<string(size_t size, uint32_t seed)> make;
+};
+
+// Point is the cost of one run of the front end on an input of bytes.
+class Point {
+public:
+    double bytes = 0;
+    double ms = 0;
+    double alloc_bytes = 0;
+    double allocs = 0;
+};
+
+// sink keeps results of the front end alive, so it isn't optimized out.
+static volatile long sink = 0;
+
+/**
+ * @brief FrontEnd runs src through the lab pipeline: the parse recovers from errors, the
+ * ast is written as xml, a complete ast is checked and errors are written one per line.
+ */
+static void FrontEnd(const string& src) {
+    auto file = make_shared<token::File>();
+    file->name = "stress.txt";
+    file->size = static_cast<int>(src.size());
+
+    ostringstream out;
+    auto errors = make_shared<ec::ErrorReminder>(true, out, true);
+    Parser parser(file, input::SourceBuffer::FromString(src), make_shared<CountingErrorHandler>(), errors);
+    parser.SetRecover(true);
+    auto ast_file = parser.Parse();
+
+    ast::XmlWriter writer(out);
+    ast_file->Write(&writer);
+    if (!parser.Partial()) {
+        check::Checker checker(ast_file, errors);
+        checker.Check();
+    }
+    errors->Flush();
+    sink += static_cast<long>(out.tellp());
+}
+
+// Time returns the least wall time of reps runs of the front end on src in ms, it
+// stops after a run longer than max_ms.
+static double Time(const string& src, int reps, int max_ms) {
+    double best = 0;
+    for (int i = 0; i < reps; i++) {
+        auto start = chrono::steady_clock::now();
+        FrontEnd(src);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        best = i == 0 ? ms : min(best, ms);
+        if (ms > max_ms) {
+            break;
+        }
+    }
+    return best;
+}
+
+// Slope fits cost = c * bytes^k to the points by least squares on logs and returns k.
+static double Slope(const vector<Point>& points, double Point::* cost) {
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (const auto& p : points) {
+        double x = log(p.bytes), y = log(max(p.*cost, 1e-9));
+        n++;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double d = n * sxx - sx * sx;
+    return d > 0 ? (n * sxy - sx * sy) / d : 0;
+}
+
+// Lines joins lines of a program, each is made by line(i), until it has size bytes.
+static string Lines(size_t size, const string& head, const string& tail, const function<string(int)>& line) {
+    string out = head;
+    for (int i = 0; out.size() < size; i++) {
+        out += line(i);
+    }
+    return out + tail;
+}
+
+// kNestDepth is how deep a nested stmt or expr goes, below the limit of the parser.
+const static int kNestDepth = 256;
+
+static string DeepBlocks(size_t size, uint32_t) {
+    return Lines(size, "int g;\n", "void main() {\n}\n", [](int i) {
+        string f = "void d" + to_string(i) + "(int a) {\n";
+        for (int d = 0; d < kNestDepth; d++) {
+            f += "if (a < " + to_string(d) + ") {\n";
+        }
+        f += "g = a;\n";
+        for (int d = 0; d < kNestDepth; d++) {
+            f += d % 2 == 0 ? "}\n" : "} else { g = 0; }\n";
+        }
+        return f + "}\n";
+    });
+}
+
+static string DeepParens(size_t size, uint32_t) {
+    return Lines(size, "int g;\nvoid main() {\n", "}\n", [](int i) {
+        return "g = " + string(kNestDepth, '(') + to_string(i) + string(kNestDepth, ')') + ";\n";
+    });
+}
+
+// TooDeep is a single block nested far beyond the limit of the parser, which gives up on it.
+static string TooDeep(size_t size, uint32_t) {
+    size_t depth = size / 2;
+    return "void main() " + string(depth, '{') + string(depth, '}') + "\n";
+}
+
+static string HugeSwitch(size_t size, uint32_t) {
+    string head = "int g;\nvoid main() {\n    int a;\n    scanf(a);\n    switch (a) {\n";
+    return Lines(size, head, "        default: g = 0;\n    }\n}\n", [](int i) {
+        return "        case " + to_string(i) + ": g = a + " + to_string(i) + ";\n";
+    });
+}
+
+// OneLine is a generated program on a single line, so every position is far into it.
+static string OneLine(size_t size, uint32_t seed) {
+    string src = bench::Generate(bench::Mixed, size, seed);
+    replace(src.begin(), src.end(), '\n', ' ');
+    return src;
+}
+
+// ManyErrors has functions which are parsed fine but have a few errors each for the checker.
+static string ManyErrors(size_t size, uint32_t) {
+    return Lines(size, "int g;\n", "void main() {\n    g = 0;\n}\n", [](int i) {
+        string name = "e" + to_string(i);
+        return "void " + name + "(int p) {\n"
+            "    int x;\n"
+            "    char c;\n"
+            "    int x;\n"
+            "    y" + to_string(i) + " = p;\n"
+            "    " + name + "(1, 2);\n"
+            "    " + name + "('a');\n"
+            "}\n";
+    });
+}
+
+// SyntaxErrors has a scan error and a missing ';' on every line, the parser gives up after a few.
+static string SyntaxErrors(size_t size, uint32_t) {
+    return Lines(size, "int g;\nvoid main() {\n", "}\n", [](int i) {
+        return "    g = " + to_string(i) + " # 1\n";
+    });
+}
+
+// Mutate applies about one edit per 256 bytes of src: bytes are dropped, put in or a
+// run of them is repeated, so brackets and literals end up unbalanced.
+static string Mutate(string src, uint32_t seed) {
+    static const char kBytes[] = "{}()[];,=+-*/<>!'\"\\#@ \n\taz09_";
+    Rng rng(seed);
+    size_t edits = src.size() / 256 + 1;
+    for (size_t i = 0; i < edits && !src.empty(); i++) {
+        size_t at = rng.Below(src.size());
+        switch (rng.Below(3)) {
+            case 0:
+                src.erase(at, 1 + rng.Below(8));
+                break;
+            case 1:
+                src.insert(at, 1, kBytes[rng.Below(sizeof(kBytes) - 1)]);
+                break;
+            default: {
+                size_t len = min(src.size() - at, 1 + rng.Below(64));
+                src.insert(at, src.substr(at, len));
+                break;
+            }
+        }
+    }
+    return src;
+}
+
+static vector<Case> Cases() {
+    vector<Case> cases;
+    for (int s = 0; s < bench::shape_end; s++) {
+        auto shape = static_cast<bench::Shape>(s);
+        cases.push_back(Case{string("program/") + bench::ShapeName(shape), [shape](size_t size, uint32_t seed) {
+            return bench::Generate(shape, size, seed);
+        }});
+    }
+    cases.push_back(Case{"one-line", OneLine});
+    cases.push_back(Case{"deep-blocks", DeepBlocks});
+    cases.push_back(Case{"deep-parens", DeepParens});
+    cases.push_back(Case{"too-deep", TooDeep});
+    cases.push_back(Case{"huge-switch", HugeSwitch});
+    cases.push_back(Case{"many-errors", ManyErrors});
+    cases.push_back(Case{"syntax-errors", SyntaxErrors});
+    cases.push_back(Case{"mutated/mixed", [](size_t size, uint32_t seed) {
+        return Mutate(bench::Generate(bench::Mixed, size, seed), seed);
+    }});
+    return cases;
+}
+
+static bool Selected(const Options& opts, const string& name) {
+    return opts.filter.empty() || name.find(opts.filter) != string::npos;
+}
+
+static void Print(const string& name, const Point& p) {
+    char line[160];
+    snprintf(line, sizeof(line), "%-22s %10.0f %10.3f %8.1f %10.1f %8.1f %8.2f",
+        name.c_str(), p.bytes, p.ms, p.ms * 1e6 / p.bytes, p.alloc_bytes / 1024, p.alloc_bytes / p.bytes, p.allocs / p.bytes);
+    cout << line << endl;
+}
+
+// Fuzz runs the front end on small mutated programs of every shape, it returns only if none crashed.
+static void Fuzz(const Options& opts) {
+    for (int i = 0; i < opts.fuzz; i++) {
+        auto shape = static_cast<bench::Shape>(i % bench::shape_end);
+        uint32_t seed = opts.seed + static_cast<uint32_t>(i);
+        FrontEnd(Mutate(bench::Generate(shape, 4096, seed), seed));
+    }
+    cout << "fuzz: " << opts.fuzz << " mutated programs went through" << endl;
+}
+
+static void Usage(const char* argv0) {
+    cerr << "usage: " << argv0 << " [--size bytes] [--steps n] [--reps n] [--seed n] [--fuzz n]\n"
+         << "       [--max-time-slope k] [--max-alloc-slope k] [--max-ms ms] [--filter name]" << endl;
+}
+
+int StressMain(int argc, char** argv) {
+    Options opts;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        string val = argv[++i];
+        if (arg == "--size") {
+            opts.size = strtoul(val.c_str(), nullptr, 10);
+        } else if (arg == "--steps") {
+            opts.steps = max(2, atoi(val.c_str()));
+        } else if (arg == "--reps") {
+            opts.reps = max(1, atoi(val.c_str()));
+        } else if (arg == "--seed") {
+            opts.seed = static_cast<uint32_t>(strtoul(val.c_str(), nullptr, 10));
+        } else if (arg == "--fuzz") {
+            opts.fuzz = atoi(val.c_str());
+        } else if (arg == "--max-time-slope") {
+            opts.max_time_slope = atof(val.c_str());
+        } else if (arg == "--max-alloc-slope") {
+            opts.max_alloc_slope = atof(val.c_str());
+        } else if (arg == "--max-ms") {
+            opts.max_ms = atoi(val.c_str());
+        } else if (arg == "--filter") {
+            opts.filter = val;
+        } else {
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Fuzz(opts);
+
+    // inputs of all sizes are made first, then all are timed, then profiling is turned on
+    // to count their allocations, as it can't be turned off and would slow the timed runs.
+    vector<Case> cases = Cases();
+    vector<vector<string>> inputs(cases.size());
+    vector<vector<Point>> curves(cases.size());
+    vector<bool> too_slow(cases.size(), false);
+    for (size_t c = 0; c < cases.size(); c++) {
+        if (!Selected(opts, cases[c].name)) {
+            continue;
+        }
+        for (int s = opts.steps - 1; s >= 0 && !too_slow[c]; s--) {
+            inputs[c].push_back(cases[c].make(opts.size >> s, opts.seed));
+            Point p;
+            p.bytes = static_cast<double>(inputs[c].back().size());
+            p.ms = Time(inputs[c].back(), opts.reps, opts.max_ms);
+            curves[c].push_back(p);
+            too_slow[c] = p.ms > opts.max_ms;
+        }
+    }
+
+    prof::Enable(false);
+    for (size_t c = 0; c < cases.size(); c++) {
+        for (size_t s = 0; s < inputs[c].size(); s++) {
+            uint64_t count0, bytes0, count1, bytes1;
+            prof::Allocated(&count0, &bytes0);
+            FrontEnd(inputs[c][s]);
+            prof::Allocated(&count1, &bytes1);
+            curves[c][s].allocs = static_cast<double>(count1 - count0);
+            curves[c][s].alloc_bytes = static_cast<double>(bytes1 - bytes0);
+        }
+    }
+
+    cout << "case                        bytes         ms     ns/B   alloc KB    B/B   allocs/B" << endl;
+    int failed = 0;
+    for (size_t c = 0; c < cases.size(); c++) {
+        if (curves[c].empty()) {
+            continue;
+        }
+        for (const auto& p : curves[c]) {
+            Print(cases[c].name, p);
+        }
+
+        double time_slope = Slope(curves[c], &Point::ms);
+        double alloc_slope = Slope(curves[c], &Point::alloc_bytes);
+        bool ok = !too_slow[c] && time_slope <= opts.max_time_slope && alloc_slope <= opts.max_alloc_slope;
+        char line[160];
+        snprintf(line, sizeof(line), "%-22s time ~ n^%.2f, alloc ~ n^%.2f  %s",
+            cases[c].name.c_str(), time_slope, alloc_slope, too_slow[c] ? "OVER TIME" : ok ? "ok" : "OVER BUDGET");
+        cout << line << endl;
+        if (!ok) {
+            failed++;
+        }
+    }
+
+    if (failed != 0) {
+        cerr << failed << " cases grow faster than the budget, time n^" << opts.max_time_slope
+             << ", alloc n^" << opts.max_alloc_slope << ", " << opts.max_ms << " ms a run" << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+}// namespace stress
+
+int main(int argc, char** argv) {
+    return stress::StressMain(argc, argv);
+}
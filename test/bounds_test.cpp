@@ -0,0 +1,114 @@
+#include "test/test.h"
+
+// Count returns how many times what is in text.
+static int Count(const string& text, const string& what) {
+    int n = 0;
+    for (size_t i = text.find(what); i != string::npos; i = text.find(what, i + what.size())) {
+        n++;
+    }
+    return n;
+}
+
+// ExpectIndexFails runs path by the vm, the jit and natively at -O0 and -O2, all of them
+// must write out and fail on an index out of range, index in the messages of the vm.
+static void ExpectIndexFails(const string& path, const string& out, int index) {
+    string msg = "runtime error: index " + to_string(index) + " out of range [0, 10)";
+    for (const char* mode : {"--run", "--jit"}) {
+        auto result = test::Run({mode, path});
+        EXPECT_EQ(result.code, 1);
+        EXPECT_EQ(result.out, out);
+        EXPECT(result.err.find(msg) != string::npos);
+    }
+    if (!test::HasNative()) {
+        return;
+    }
+    for (int level : {0, 2}) {
+        auto result = test::RunNative(path, level);
+        EXPECT_EQ(result.code, 1);
+        EXPECT_EQ(result.out, out);
+        EXPECT_EQ(result.err, "runtime error: index out of range\n");
+    }
+}
+
+// the indexes of loops proved in range, counting up and down, have no checks.
+TEST(BoundsProvedLoop) {
+    string path = test::TempFile("safe.txt",
+        "int a[10];\n"
+        "void main() {\n"
+        "    int i, s;\n"
+        "    s = 0;\n"
+        "    for (i = 0; i < 10; i = i + 1) {\n"
+        "        a[i] = i;\n"
+        "    }\n"
+        "    for (i = 9; i >= 0; i = i - 1) {\n"
+        "        s = s + a[i];\n"
+        "    }\n"
+        "    printf(s);\n"
+        "}\n");
+    auto result = test::Run({"--bytecode", path});
+    EXPECT_EQ(result.code, 0);
+    EXPECT_EQ(Count(result.out, "CheckIndex"), 0);
+    for (int level = 0; level <= 2; level++) {
+        result = test::Run({"--ir", "-O" + to_string(level), path});
+        EXPECT_EQ(result.code, 0);
+        EXPECT_EQ(Count(result.out, "check_index"), 0);
+    }
+
+    result = test::Run({"--run", path});
+    EXPECT_EQ(result.code, 0);
+    EXPECT_EQ(result.out, "45\n");
+    EXPECT_EQ(result.err, "");
+}
+
+// a loop counting down from the bound, an offset index and '<=' the size keep their
+// checks, and fail when they run out of range.
+TEST(BoundsUnsafeLoops) {
+    struct Case {
+        const char* name;
+        const char* loop;
+        const char* index;
+        int fails_at;
+    };
+    const Case cases[] = {
+        {"down.txt", "for (i = 9; i < 10; i = i - 1)", "a[i]", -1},
+        {"offset.txt", "for (i = 0; i < 10; i = i + 1)", "a[i + 5]", 10},
+        {"le.txt", "for (i = 0; i <= 10; i = i + 1)", "a[i]", 10},
+    };
+    for (const auto& c : cases) {
+        string path = test::TempFile(c.name, string() +
+            "int a[10];\n"
+            "void main() {\n"
+            "    int i;\n"
+            "    printf(\"start\");\n"
+            "    " + c.loop + " {\n"
+            "        " + c.index + " = i;\n"
+            "    }\n"
+            "    printf(\"unreachable\");\n"
+            "}\n");
+        auto result = test::Run({"--bytecode", path});
+        EXPECT_EQ(Count(result.out, "CheckIndex"), 1);
+        for (int level = 0; level <= 2; level++) {
+            result = test::Run({"--ir", "-O" + to_string(level), path});
+            EXPECT_EQ(Count(result.out, "check_index"), 1);
+        }
+        ExpectIndexFails(path, "start\n", c.fails_at);
+    }
+}
+
+// a constant index out of range is warned about, the program still compiles and fails there.
+TEST(BoundsConstantIndex) {
+    string path = test::TempFile("const.txt",
+        "int a[10];\n"
+        "void main() {\n"
+        "    printf(\"before\");\n"
+        "    a[10] = 1;\n"
+        "    printf(a[-1]);\n"
+        "}\n");
+    for (const char* mode : {"--run", "--bytecode", "--ir", "--x86-64"}) {
+        auto result = test::Run({mode, path});
+        EXPECT(result.err.find(
+            "warning [s] => (4, 7) :: for index expression, index 10 out of range [0, 10)\n"
+            "warning [s] => (5, 14) :: for index expression, index -1 out of range [0, 10)\n") == 0);
+    }
+    ExpectIndexFails(path, "before\n", 10);
+}
@@ -0,0 +1,28 @@
+#include "test/test.h"
+#include "cache/cache.h"
+
+// errors of every type are stored and loaded back, the last type too.
+TEST(CacheErrorTypes) {
+    string text = "void main() {\n}\n";
+    cache::Key key = cache::HashSource(text.data(), text.size());
+    // the artifact replaces this file, so it's removed with the temp files of the test.
+    string path = test::TempFile(key.Hex(), "");
+    cache::Cache cache(path.substr(0, path.rfind('/')));
+
+    vector<ec::Error> errors;
+    for (int type = 0; type < ec::type_end; type++) {
+        errors.emplace_back(token::Position{"a.txt", type, 1, type + 1}, static_cast<ec::Type>(type), "error " + to_string(type));
+    }
+    errors.emplace_back(token::npos, ec::NotInHomeWork, "no position");
+    cache.Store(key, false, errors, nullptr);
+
+    cache::Artifact artifact;
+    EXPECT_EQ(cache.Load(key, "a.txt", &artifact), 0);
+    EXPECT(!artifact.ok);
+    EXPECT_EQ(artifact.errors.size(), errors.size());
+    for (size_t i = 0; i < errors.size() && i < artifact.errors.size(); i++) {
+        EXPECT_EQ(artifact.errors[i].ToString(), errors[i].ToString());
+        EXPECT_EQ(artifact.errors[i].pos().filename, errors[i].pos().filename);
+        EXPECT_EQ(artifact.errors[i].pos().offset, errors[i].pos().offset);
+    }
+}
@@ -0,0 +1,117 @@
+#include <algorithm>
+
+#include "test/test.h"
+#include "incremental/document.h"
+
+// ErrorsOf returns errors of doc, one per line.
+static string ErrorsOf(const incremental::Document& doc) {
+    vector<ec::Error> errors;
+    doc.Errors(&errors);
+    string text;
+    for (const auto& error : errors) {
+        text += error.ToString() + "\n";
+    }
+    return text;
+}
+
+static incremental::Edit Replace(const string& text, const string& old, const string& with) {
+    incremental::Edit edit;
+    edit.offset = static_cast<int>(text.find(old));
+    edit.length = static_cast<int>(old.size());
+    edit.text = with;
+    return edit;
+}
+
+// kUnterminated parses, the scanner finds a string literal without its closing '"'.
+static const char* kUnterminated =
+    "int g;\n"
+    "void f() {\n"
+    "    printf(\"abc\n"
+    "    );\n"
+    "}\n"
+    "void main() {\n"
+    "    f();\n"
+    "    h = 2;\n"
+    "}\n";
+
+TEST(DocumentScanErrors) {
+    incremental::Document doc("doc.txt");
+    doc.Open(kUnterminated);
+    string want =
+        "[r] => (3, 12) :: string literal not terminated\n"
+        "[c] => (8, 5) :: for assign stmt, lhs identifier not defined\n";
+    EXPECT(doc.Ok());
+    EXPECT_EQ(ErrorsOf(doc), want);
+
+    // kept decls and their scan errors move with an edit before them.
+    EXPECT_EQ(doc.Update(Replace(doc.Text(), "int g;", "int g;\nint k;")), 0);
+    EXPECT_EQ(doc.Reparsed(), 2);
+    want =
+        "[r] => (4, 12) :: string literal not terminated\n"
+        "[c] => (9, 5) :: for assign stmt, lhs identifier not defined\n";
+    EXPECT_EQ(ErrorsOf(doc), want);
+
+    // the scan error goes once the decl with it is parsed again.
+    EXPECT_EQ(doc.Update(Replace(doc.Text(), "\"abc\n", "\"abc\"\n")), 0);
+    EXPECT_EQ(ErrorsOf(doc), "[c] => (9, 5) :: for assign stmt, lhs identifier not defined\n");
+}
+
+// an illegal character fails the parse, the scan error is the error of the text.
+TEST(DocumentIllegalCharacter) {
+    incremental::Document doc("doc.txt");
+    doc.Open("int g;\nvoid main() {\n    g = 1 # 2;\n}\n");
+    EXPECT(!doc.Ok());
+    EXPECT_EQ(ErrorsOf(doc), "[r] => (3, 11) :: illegal character\n");
+}
+
+// random edits, and undoing them, give the same ast and errors as parsing and checking the text from scratch.
+TEST(DocumentEditsMatchFullParse) {
+    const string pieces[] = {"int", " ", "\n", ";", "{", "}", "(", ")", "g", "h", "1", "=", "\"", "#", "'a'",
+                             "void f() {\n    g = 1;\n}\n", "int k;\n", "printf(\"x\");"};
+    string base = string(kUnterminated) + "int h;\nvoid k2(int a) {\n    g = a;\n}\n";
+    incremental::Document doc("doc.txt");
+    doc.Open(base);
+
+    uint32_t state = 7;
+    auto next = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+    int ok = 0;
+    auto update = [&doc, &ok](const incremental::Edit& edit) {
+        EXPECT_EQ(doc.Update(edit), 0);
+        incremental::Document fresh("doc.txt");
+        fresh.Open(doc.Text());
+        EXPECT_EQ(doc.Ok(), fresh.Ok());
+        EXPECT_EQ(ErrorsOf(doc), ErrorsOf(fresh));
+        if (doc.Ok() && fresh.Ok()) {
+            EXPECT_EQ(doc.File()->ToString(), fresh.File()->ToString());
+            ok++;
+        }
+    };
+    for (int i = 0; i < 500; i++) {
+        const string& text = doc.Text();
+        incremental::Edit edit;
+        edit.offset = static_cast<int>(next() % (text.size() + 1));
+        edit.length = min(static_cast<int>(next() % 4), static_cast<int>(text.size()) - edit.offset);
+        edit.text = pieces[next() % (sizeof(pieces) / sizeof(pieces[0]))];
+        if (text.size() > 2 * base.size()) {
+            edit.offset = 0;
+            edit.length = static_cast<int>(text.size());
+            edit.text = base;
+        }
+        incremental::Edit undo;
+        undo.offset = edit.offset;
+        undo.length = static_cast<int>(edit.text.size());
+        undo.text = text.substr(static_cast<size_t>(edit.offset), static_cast<size_t>(edit.length));
+
+        // an edit which breaks the parse is undone, so edits are mostly of texts which parse.
+        update(edit);
+        if (!doc.Ok() || next() % 2 == 0) {
+            update(undo);
+        }
+    }
+    EXPECT(ok > 500);
+}
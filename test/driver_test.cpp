@@ -0,0 +1,18 @@
+#include "test/test.h"
+
+// scan errors of files compiled in parallel are in the report of their file, in the order of files.
+TEST(DriverScanErrors) {
+    string a = test::TempFile("a.txt", "int a;\nvoid main() {\n    a = 1 # 2;\n}\n");
+    string b = test::TempFile("b.txt", "void main() {\n    printf(\"abc);\n}\n");
+    string want =
+        a + ": [r] => (3, 11) :: illegal character\n" +
+        b + ": [r] => (2, 12) :: string literal not terminated\n" +
+        b + ": [l] => (3, 1) :: expect RPARENT, but get RBRACE\n";
+
+    for (int i = 0; i < 8; i++) {
+        auto result = test::Run({"-j", "2", a, b});
+        EXPECT_EQ(result.code, 1);
+        EXPECT_EQ(result.out, want);
+        EXPECT_EQ(result.err, "2 files, 2 with errors\n");
+    }
+}
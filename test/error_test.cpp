@@ -0,0 +1,45 @@
+#include "test/test.h"
+#include "error.h"
+
+// collected errors keep the file, offset, line and column they are added at.
+TEST(ErrorReminderCollect) {
+    ec::ErrorReminder errors;
+    errors.Emplace(token::Position{"b.txt", 7, 2, 3}, ec::Type::Undefine, "b undefined");
+    errors.Emplace(token::Position{"a.txt", 9, 1, 10}, ec::Type::Redefine, "replaced");
+    errors.Add(token::npos, ec::Error(token::npos, ec::Type::NotInHomeWork, "no position"));
+    errors.Add(token::Position{"a.txt", 9, 1, 10}, ec::Error(token::Position{"a.txt", 9, 1, 10}, ec::Type::SEMICNExpected, "a semicn"));
+    errors.Emplace(token::Position{"b.txt", 0, 1, 1}, ec::Type::Undefine, "b first");
+    EXPECT_EQ(errors.Size(), 4u);
+
+    vector<ec::Error> collected;
+    errors.Collect(&collected);
+    EXPECT_EQ(collected.size(), 4u);
+    if (collected.size() != 4) {
+        return;
+    }
+    // files are ordered as they are first seen, offsets in a file.
+    EXPECT_EQ(collected[0].pos().filename, "b.txt");
+    EXPECT_EQ(collected[0].pos().offset, 0);
+    EXPECT_EQ(collected[0].msg(), "b first");
+    EXPECT_EQ(collected[1].pos().filename, "b.txt");
+    EXPECT_EQ(collected[1].pos().offset, 7);
+    EXPECT_EQ(collected[1].ToString(), "[c] => (2, 3) :: b undefined");
+    EXPECT_EQ(collected[2].pos().filename, "a.txt");
+    EXPECT_EQ(collected[2].pos().offset, 9);
+    EXPECT_EQ(collected[2].type(), ec::Type::SEMICNExpected);
+    EXPECT_EQ(collected[2].ToString(), "[k] => (1, 10) :: a semicn");
+    EXPECT_EQ(collected[3].pos().offset, token::npos.offset);
+    EXPECT_EQ(collected[3].msg(), "no position");
+}
+
+// one_per_line writes the first error of a line of each file.
+TEST(ErrorReminderFlushOnePerLine) {
+    ostringstream out;
+    {
+        ec::ErrorReminder errors(true, out, true);
+        errors.Emplace(token::Position{"a.txt", 4, 1, 5}, ec::Type::Undefine, "second");
+        errors.Emplace(token::Position{"a.txt", 0, 1, 1}, ec::Type::Redefine, "first");
+        errors.Emplace(token::Position{"b.txt", 2, 1, 3}, ec::Type::Undefine, "other file");
+    }
+    EXPECT_EQ(out.str(), "[b] => (1, 1) :: first\n[c] => (1, 3) :: other file\n");
+}
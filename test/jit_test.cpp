@@ -0,0 +1,144 @@
+#include <cstdlib>
+
+#include "test/test.h"
+
+// Jitted returns the count of functions jitted by a '--time-report --jit' run of path.
+static int Jitted(const string& path, const string& input) {
+    auto result = test::Run({"--time-report", "--jit", path}, input);
+    const string name = "functions jitted";
+    size_t at = result.err.find(name);
+    if (at == string::npos) {
+        test::Fail(__FILE__, __LINE__, "no '" + name + "' in the time report: " + result.err);
+        return 0;
+    }
+    return atoi(result.err.c_str() + at + name.size());
+}
+
+// ExpectSameAsRun runs path by the interpreter and tiered, both must exit with code and
+// write out and err, and at least jitted functions must be compiled.
+static void ExpectSameAsRun(const string& path, const string& input, int code, const string& out,
+                            const string& err, int jitted) {
+    for (const char* mode : {"--run", "--jit"}) {
+        auto result = test::Run({mode, path}, input);
+        EXPECT_EQ(result.code, code);
+        EXPECT_EQ(result.out, out);
+        EXPECT_EQ(result.err, err);
+    }
+    if (test::HasNative()) {
+        EXPECT(Jitted(path, input) >= jitted);
+    }
+}
+
+// kHotLoop is main only, its loops get hot and go on compiled from a back edge.
+static const char* kHotLoop =
+    "int a[100];\n"
+    "char c[26];\n"
+    "void main() {\n"
+    "    int i, j, n, s;\n"
+    "    scanf(n);\n"
+    "    s = 0;\n"
+    "    for (i = 0; i < 26; i = i + 1) {\n"
+    "        c[i] = 'a';\n"
+    "    }\n"
+    "    for (i = 0; i < 20000; i = i + 1) {\n"
+    "        j = i - i / 100 * 100;\n"
+    "        a[j] = a[j] + i / 7 - n;\n"
+    "        s = s + a[j] * 3 - (i - n) / 5;\n"
+    "        if (i - i / 4000 * 4000 == 0) {\n"
+    "            printf(\"i \", i);\n"
+    "        }\n"
+    "        if (i == 5000) {\n"
+    "            scanf(n);\n"
+    "        }\n"
+    "    }\n"
+    "    i = 0;\n"
+    "    while (i < 2600) {\n"
+    "        c[i / 100] = c[i / 100] + 0;\n"
+    "        i = i + 1;\n"
+    "    }\n"
+    "    printf(s);\n"
+    "    printf(c[25]);\n"
+    "    printf(a[99] - a[0]);\n"
+    "}\n";
+
+TEST(JitHotLoop) {
+    string path = test::TempFile("loop.txt", kHotLoop);
+    auto run = test::Run({"--run", path}, "3 -11\n");
+    EXPECT_EQ(run.code, 0);
+    EXPECT(run.out.find("i 0\ni 4000\ni 8000\ni 12000\ni 16000\n") == 0);
+    ExpectSameAsRun(path, "3 -11\n", 0, run.out, "", 1);
+}
+
+// kHotFunction calls leaf, recursive and void functions until they are compiled, compiled
+// code calls interpreted and compiled ones.
+static const char* kHotFunction =
+    "int total = 0;\n"
+    "int step(int x, int y) {\n"
+    "    return x * 31 + y / 3 - 7;\n"
+    "}\n"
+    "char letter(int x) {\n"
+    "    return 'a';\n"
+    "}\n"
+    "int fib(int n) {\n"
+    "    if (n < 2) {\n"
+    "        return n;\n"
+    "    }\n"
+    "    return fib(n - 1) + fib(n - 2);\n"
+    "}\n"
+    "void add(int x) {\n"
+    "    total = total + step(x, total - total / 1000 * 1000);\n"
+    "    if (x == 2999) {\n"
+    "        printf(\"last \", x);\n"
+    "    }\n"
+    "}\n"
+    "void main() {\n"
+    "    int i;\n"
+    "    for (i = 0; i < 3000; i = i + 1) {\n"
+    "        add(i);\n"
+    "    }\n"
+    "    printf(total);\n"
+    "    printf(fib(18));\n"
+    "    printf(letter(1));\n"
+    "}\n";
+
+TEST(JitHotFunction) {
+    string path = test::TempFile("func.txt", kHotFunction);
+    auto run = test::Run({"--run", path});
+    EXPECT_EQ(run.code, 0);
+    EXPECT(run.out.find("last 2999\n") == 0);
+    EXPECT(run.out.find("\n2584\na\n") != string::npos);
+    // add, step and fib at least, main switches at its loop too.
+    ExpectSameAsRun(path, "", 0, run.out, "", 3);
+}
+
+// a runtime error in compiled code ends the program as it does interpreted, after the
+// output written until then.
+TEST(JitRuntimeError) {
+    string index = test::TempFile("index.txt",
+        "int a[5];\n"
+        "void main() {\n"
+        "    int i;\n"
+        "    for (i = 0; i < 10000; i = i + 1) {\n"
+        "        if (i - i / 1000 * 1000 == 0) {\n"
+        "            printf(i);\n"
+        "        }\n"
+        "        a[i / 1000] = i;\n"
+        "    }\n"
+        "}\n");
+    ExpectSameAsRun(index, "", 1, "0\n1000\n2000\n3000\n4000\n5000\n",
+                    "runtime error: index 5 out of range [0, 5) in function main\n", 1);
+
+    string divide = test::TempFile("divide.txt",
+        "int f(int x) {\n"
+        "    return 100000 / (x - 3000);\n"
+        "}\n"
+        "void main() {\n"
+        "    int i, s;\n"
+        "    s = 0;\n"
+        "    for (i = 0; i < 5000; i = i + 1) {\n"
+        "        s = s + f(i);\n"
+        "    }\n"
+        "    printf(s);\n"
+        "}\n");
+    ExpectSameAsRun(divide, "", 1, "", "runtime error: division by zero in function f\n", 1);
+}
@@ -0,0 +1,84 @@
+#include "test/test.h"
+
+// kMissingRbrack is a program with a syntax error, its array size isn't closed.
+static const char* kMissingRbrack =
+    "int a[3;\n"
+    "void main() {\n"
+    "    printf(\"unreachable\");\n"
+    "}\n";
+
+// a syntax error fails a run, the diagnostic goes to stderr and nothing to stdout.
+TEST(MainRunSyntaxError) {
+    string path = test::TempFile("bad.txt", kMissingRbrack);
+    for (const char* mode : {"--run", "--jit", "--bytecode"}) {
+        auto result = test::Run({mode, path});
+        EXPECT(result.code != 0);
+        EXPECT_EQ(result.out, "");
+        EXPECT(result.err.find("expect RBRACK") != string::npos);
+    }
+}
+
+TEST(MainRunClean) {
+    string path = test::TempFile("ok.txt", "void main() {\n    printf(\"hi\");\n}\n");
+    auto result = test::Run({"--run", path});
+    EXPECT_EQ(result.code, 0);
+    EXPECT_EQ(result.out, "hi\n");
+}
+
+// signed int literals of an initializer are folded into its packed values.
+TEST(MainRunSignedInitializer) {
+    string path = test::TempFile("signed.txt",
+        "int a[2][2] = {{1, +2}, {-3, 4}};\n"
+        "void main() {\n"
+        "    int b[2] = {-1, 5};\n"
+        "    printf(a[1][0] + a[0][1] + b[0]);\n"
+        "}\n");
+    for (const char* mode : {"--run", "--jit"}) {
+        auto result = test::Run({mode, path});
+        EXPECT_EQ(result.code, 0);
+        EXPECT_EQ(result.err, "");
+        EXPECT_EQ(result.out, "-2\n");
+    }
+}
+
+// a syntax error fails the emit modes before anything is written where the assembly goes.
+TEST(MainEmitSyntaxError) {
+    string path = test::TempFile("bad.txt", kMissingRbrack);
+    for (const char* mode : {"--ir", "--mips", "--x86-64"}) {
+        auto result = test::Run({mode, "-O2", path});
+        EXPECT(result.code != 0);
+        EXPECT_EQ(result.out, "");
+        EXPECT(result.err.find("expect RBRACK") != string::npos);
+    }
+}
+
+TEST(MainEmitMissingFile) {
+    auto result = test::Run({"--x86-64", "missing.txt"});
+    EXPECT(result.code != 0);
+    EXPECT_EQ(result.out, "");
+}
+
+TEST(MainAst) {
+    string path = test::TempFile("ok.txt", "int a = -1;\n");
+    auto result = test::Run({"--ast-json", path});
+    EXPECT_EQ(result.code, 0);
+    EXPECT_EQ(result.err, "");
+    EXPECT(result.out.find("{\"node\":\"FileNode\"") == 0);
+    EXPECT(result.out.find("{\"node\":\"IdentNode\",\"pos\":[1,5],\"name\":\"a\"}") != string::npos);
+
+    result = test::Run({"--ast", path});
+    EXPECT_EQ(result.code, 0);
+    EXPECT(result.out.find("<FileNode>") == 0);
+    EXPECT(result.out.find("<IdentNode><pos>(1, 5)</pos><name>a</name></IdentNode>") != string::npos);
+}
+
+// a syntax error writes no ast, the diagnostic goes to stderr.
+TEST(MainAstSyntaxError) {
+    string path = test::TempFile("bad.txt", kMissingRbrack);
+    for (const char* mode : {"--ast", "--ast-json"}) {
+        auto result = test::Run({mode, path});
+        EXPECT(result.code != 0);
+        EXPECT_EQ(result.out, "");
+        EXPECT(result.err.find("expect RBRACK") != string::npos);
+    }
+}
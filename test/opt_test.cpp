@@ -0,0 +1,169 @@
+#include "test/test.h"
+
+// ExpectSameOutput runs path by the vm and natively at -O0, -O1 and -O2, all of them
+// must exit 0 and write expected.
+static void ExpectSameOutput(const string& path, const string& input, const string& expected) {
+    auto run = test::Run({"--run", path}, input);
+    EXPECT_EQ(run.code, 0);
+    EXPECT_EQ(run.out, expected);
+    if (!test::HasNative()) {
+        return;
+    }
+    for (int level = 0; level <= 2; level++) {
+        auto native = test::RunNative(path, level, input);
+        if (native.code != run.code || native.out != run.out) {
+            test::Fail(__FILE__, __LINE__, "-O" + to_string(level) + " exits " + to_string(native.code) +
+                       " and writes '" + native.out + "', --run exits " + to_string(run.code) +
+                       " and writes '" + run.out + "', " + native.err);
+        }
+    }
+}
+
+// IrOf returns the ir of path at level.
+static string IrOf(const string& path, int level) {
+    auto result = test::Run({"--ir", "-O" + to_string(level), path});
+    EXPECT_EQ(result.code, 0);
+    return result.out;
+}
+
+// FuncOf returns the ir of function name in ir, empty if there is none.
+static string FuncOf(const string& ir, const string& name) {
+    size_t begin = ir.find("func " + name + "(");
+    if (begin == string::npos) {
+        return "";
+    }
+    size_t end = ir.find("\nfunc ", begin);
+    return ir.substr(begin, end == string::npos ? string::npos : end - begin);
+}
+
+// BlockOf returns the instructions of block label of func.
+static string BlockOf(const string& func, const string& label) {
+    size_t begin = func.find("\n" + label + ":\n");
+    if (begin == string::npos) {
+        return "";
+    }
+    begin += label.size() + 3;
+    size_t end = func.find("\nb", begin);
+    return func.substr(begin, end == string::npos ? string::npos : end - begin);
+}
+
+// kLoops has nested for and while loops with invariant products and constant
+// index arithmetic.
+static const char* kLoops =
+    "int a[4][5];\n"
+    "void main() {\n"
+    "    int i, j, n, m, s;\n"
+    "    scanf(n);\n"
+    "    scanf(m);\n"
+    "    s = 0;\n"
+    "    for (i = 0; i < 4; i = i + 1) {\n"
+    "        for (j = 0; j < 5; j = j + 1) {\n"
+    "            a[i][j] = i * 5 + j + n * m;\n"
+    "        }\n"
+    "    }\n"
+    "    i = 0;\n"
+    "    while (i < 4) {\n"
+    "        s = s + a[i][4] * (2 + 3) + n * m;\n"
+    "        i = i + 1;\n"
+    "    }\n"
+    "    printf(\"sum \", s);\n"
+    "    printf(a[3][2] - a[0][0]);\n"
+    "}\n";
+
+TEST(OptLoops) {
+    string path = test::TempFile("loops.txt", kLoops);
+    ExpectSameOutput(path, "5 6\n", "sum 950\n17\n");
+    ExpectSameOutput(path, "-3 7\n", "sum -274\n17\n");
+
+    // n * m is hoisted out of the loops to the entry block, constants are folded.
+    string o0 = FuncOf(IrOf(path, 0), "main"), o2 = FuncOf(IrOf(path, 2), "main");
+    EXPECT(BlockOf(o0, "b0").find(" = mul ") == string::npos);
+    EXPECT(BlockOf(o2, "b0").find(" = mul ") != string::npos);
+    EXPECT(o0.find("add 2, 3") != string::npos);
+    EXPECT(o2.find("add 2, 3") == string::npos);
+    EXPECT(o2.find("mul 3, 5") == string::npos);
+}
+
+// kInline calls leaf functions, one of them through another and one with a side
+// effect on a global, in a loop, and a recursive function which isn't inlined.
+static const char* kInline =
+    "int calls = 0;\n"
+    "int add(int x, int y) {\n"
+    "    return x + y;\n"
+    "}\n"
+    "int twice(int x) {\n"
+    "    return add(x, x);\n"
+    "}\n"
+    "int bump() {\n"
+    "    calls = calls + 1;\n"
+    "    return calls;\n"
+    "}\n"
+    "int fib(int n) {\n"
+    "    if (n < 2) {\n"
+    "        return n;\n"
+    "    }\n"
+    "    return fib(n - 1) + fib(n - 2);\n"
+    "}\n"
+    "void show(int x) {\n"
+    "    printf(\"x \", x);\n"
+    "}\n"
+    "void main() {\n"
+    "    int i, s;\n"
+    "    s = 0;\n"
+    "    for (i = 0; i < 10; i = i + 1) {\n"
+    "        s = add(s, twice(i)) + bump();\n"
+    "    }\n"
+    "    show(s);\n"
+    "    printf(calls);\n"
+    "    printf(fib(10));\n"
+    "}\n";
+
+TEST(OptInline) {
+    string path = test::TempFile("inline.txt", kInline);
+    ExpectSameOutput(path, "", "x 145\n10\n55\n");
+
+    string o0 = FuncOf(IrOf(path, 0), "main"), o2 = FuncOf(IrOf(path, 2), "main");
+    for (const char* call : {"call add(", "call twice(", "call bump(", "call show("}) {
+        EXPECT(o0.find(call) != string::npos);
+        EXPECT(o2.find(call) == string::npos);
+    }
+    EXPECT(o2.find("call fib(") != string::npos);
+}
+
+// kConsts reads const globals of int and char, and a global it writes, which stays a load.
+static const char* kConsts =
+    "const int kScale = 3, kNeg = -7;\n"
+    "const char kC = 'a';\n"
+    "int g = 2;\n"
+    "void main() {\n"
+    "    const int kLocal = 4;\n"
+    "    int x;\n"
+    "    scanf(x);\n"
+    "    printf(x * kScale + kLocal);\n"
+    "    printf(kNeg / 2);\n"
+    "    printf(kNeg - kNeg / 2 * 2);\n"
+    "    printf(kC);\n"
+    "    printf(kC + 1);\n"
+    "    g = g + x;\n"
+    "    printf(g * kScale);\n"
+    "    switch (x * kScale) {\n"
+    "        case 15: printf(\"fifteen\");\n"
+    "        default: printf(\"other\");\n"
+    "    }\n"
+    "}\n";
+
+TEST(OptConstGlobals) {
+    string path = test::TempFile("consts.txt", kConsts);
+    ExpectSameOutput(path, "5\n", "19\n-3\n-1\na\n98\n21\nfifteen\n");
+    ExpectSameOutput(path, "4\n", "16\n-3\n-1\na\n98\n18\nother\n");
+
+    string o0 = FuncOf(IrOf(path, 0), "main");
+    EXPECT(o0.find("load_global @kScale") != string::npos);
+    for (int level = 1; level <= 2; level++) {
+        string main = FuncOf(IrOf(path, level), "main");
+        EXPECT(main.find("load_global @kScale") == string::npos);
+        EXPECT(main.find("load_global @kNeg") == string::npos);
+        EXPECT(main.find("load_global @kC") == string::npos);
+        EXPECT(main.find("load_global @g") != string::npos);
+    }
+}
@@ -0,0 +1,85 @@
+#include <sstream>
+
+#include "test/test.h"
+#include "server/server.h"
+
+// Frame frames msg as an LSP message.
+static string Frame(const server::Json& msg) {
+    string body = msg.ToString();
+    return "Content-Length: " + to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+static server::Json Notification(const string& method, const server::Json& params) {
+    return server::Json::MakeObject().Set("jsonrpc", "2.0").Set("method", method).Set("params", params);
+}
+
+// Diagnostics returns the diagnostics of each publishDiagnostics in out, in order.
+static vector<server::Json> Diagnostics(const string& out) {
+    vector<server::Json> published;
+    const string header = "Content-Length: ";
+    for (size_t at = out.find(header); at != string::npos; at = out.find(header, at)) {
+        size_t length = stoul(out.substr(at + header.size()));
+        size_t begin = out.find("\r\n\r\n", at) + 4;
+        server::Json msg;
+        if (server::Json::Parse(out.substr(begin, length), &msg) == 0 &&
+            msg.Get("method").AsString() == "textDocument/publishDiagnostics") {
+            published.push_back(msg.Get("params").Get("diagnostics"));
+        }
+        at = begin + length;
+    }
+    return published;
+}
+
+// lexical errors are published as diagnostics, and nothing is written to stderr.
+TEST(ServerLexicalDiagnostics) {
+    const string uri = "file:///doc.txt";
+    const string text =
+        "int g;\n"
+        "void main() {\n"
+        "    printf(\"abc\n"
+        "    );\n"
+        "}\n";
+    server::Json open = server::Json::MakeObject()
+        .Set("textDocument", server::Json::MakeObject().Set("uri", uri).Set("text", text));
+
+    // '#' is put after 'g' of line 0.
+    server::Json range = server::Json::MakeObject()
+        .Set("start", server::Json::MakeObject().Set("line", 0).Set("character", 5))
+        .Set("end", server::Json::MakeObject().Set("line", 0).Set("character", 5));
+    server::Json changes = server::Json::MakeArray();
+    changes.Push(server::Json::MakeObject().Set("range", range).Set("text", " #"));
+    server::Json change = server::Json::MakeObject()
+        .Set("textDocument", server::Json::MakeObject().Set("uri", uri))
+        .Set("contentChanges", changes);
+
+    stringstream in;
+    in << Frame(Notification("textDocument/didOpen", open))
+       << Frame(Notification("textDocument/didChange", change))
+       << Frame(Notification("exit", server::Json()));
+    ostringstream out, err;
+    streambuf* cerr_buf = cerr.rdbuf(err.rdbuf());
+    server::Server(in, out).Run();
+    cerr.rdbuf(cerr_buf);
+    EXPECT_EQ(err.str(), "");
+
+    auto published = Diagnostics(out.str());
+    EXPECT_EQ(published.size(), 2u);
+    if (published.size() != 2) {
+        return;
+    }
+
+    // the unterminated literal, the text still parses.
+    EXPECT_EQ(published[0].Size(), 1u);
+    const server::Json& literal = published[0].At(0);
+    EXPECT_EQ(literal.Get("message").AsString(), "string literal not terminated");
+    EXPECT_EQ(literal.Get("code").AsString(), "r");
+    EXPECT_EQ(literal.Get("range").Get("start").Get("line").AsInt(), 2);
+    EXPECT_EQ(literal.Get("range").Get("start").Get("character").AsInt(), 11);
+
+    // the illegal character fails the parse, it's the error of the text.
+    EXPECT_EQ(published[1].Size(), 1u);
+    const server::Json& illegal = published[1].At(0);
+    EXPECT_EQ(illegal.Get("message").AsString(), "illegal character");
+    EXPECT_EQ(illegal.Get("range").Get("start").Get("line").AsInt(), 0);
+    EXPECT_EQ(illegal.Get("range").Get("start").Get("character").AsInt(), 6);
+}
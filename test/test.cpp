@@ -0,0 +1,154 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "test/test.h"
+
+namespace test {
+
+// state of the test run, there is one test running at a time.
+static string temp_dir;
+static vector<string> temp_files;
+static bool failed = false;
+
+vector<Case>& Cases() {
+    static vector<Case> cases;
+    return cases;
+}
+
+void Fail(const char* file, int line, const string& msg) {
+    cerr << file << ":" << line << ": " << msg << endl;
+    failed = true;
+}
+
+// Quote quotes s for the shell.
+static string Quote(const string& s) {
+    string quoted = "'";
+    for (char c : s) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted.push_back(c);
+        }
+    }
+    return quoted + "'";
+}
+
+static string ReadFile(const string& path) {
+    ifstream in(path, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+string TempFile(const string& name, const string& text) {
+    string path = temp_dir + "/" + name;
+    ofstream out(path, ios::binary);
+    out << text;
+    temp_files.push_back(path);
+    return path;
+}
+
+// kCpuSeconds limits the cpu time of a process run by a test, one which loops forever,
+// e.g. by a miscompiled branch, is killed and fails its test instead of hanging the run.
+static const int kCpuSeconds = 20;
+
+// Exec runs the program argv[0] with argv on input, in the temp directory of the test run.
+static Result Exec(const vector<string>& argv, const string& input) {
+    string in = TempFile("run.in", input);
+    string out = temp_dir + "/run.out", err = temp_dir + "/run.err";
+    temp_files.push_back(out);
+    temp_files.push_back(err);
+
+    string cmd = "cd " + Quote(temp_dir) + " && ulimit -t " + to_string(kCpuSeconds) + " &&";
+    for (const auto& arg : argv) {
+        cmd += " " + Quote(arg);
+    }
+    cmd += " < " + Quote(in) + " > " + Quote(out) + " 2> " + Quote(err);
+
+    Result result;
+    int status = system(cmd.c_str());
+    result.code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    result.out = ReadFile(out);
+    result.err = ReadFile(err);
+    return result;
+}
+
+Result Run(const vector<string>& args, const string& input) {
+    vector<string> argv{SIMPLE_LANG_BIN};
+    argv.insert(argv.end(), args.begin(), args.end());
+    return Exec(argv, input);
+}
+
+bool HasNative() {
+#if defined(__x86_64__) && defined(__linux__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+Result RunNative(const string& path, int level, const string& input) {
+    Result result = Run({"--x86-64", "-O" + to_string(level), path});
+    if (result.code != 0) {
+        return result;
+    }
+
+    string asm_path = TempFile("native.s", result.out);
+    string bin_path = temp_dir + "/native";
+    temp_files.push_back(bin_path);
+    result = Exec({SIMPLE_LANG_CC, asm_path, "-o", bin_path}, "");
+    if (result.code != 0) {
+        result.err = "can't assemble: " + result.err;
+        result.code = -1;
+        return result;
+    }
+    return Exec({bin_path}, input);
+}
+
+}// namespace test
+
+/**
+ * @brief main runs the tests whose names start with argv[1], all if it's not given.
+ * Each test runs in a temp directory of its own.
+ *
+ * @return 0 if all of them pass.
+ */
+int main(int argc, char** argv) {
+    string prefix = argc > 1 ? argv[1] : "";
+    int run = 0, failed = 0;
+    for (const auto& c : test::Cases()) {
+        string name = c.name;
+        if (name.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+
+        char dir[] = "/tmp/simple_lang_test.XXXXXX";
+        if (mkdtemp(dir) == nullptr) {
+            cerr << "can't make temp dir" << endl;
+            return EXIT_FAILURE;
+        }
+        test::temp_dir = dir;
+        test::failed = false;
+
+        c.run();
+
+        for (const auto& path : test::temp_files) {
+            remove(path.c_str());
+        }
+        test::temp_files.clear();
+        rmdir(dir);
+
+        run++;
+        if (test::failed) {
+            failed++;
+        }
+        cout << (test::failed ? "FAIL " : "ok   ") << name << endl;
+    }
+
+    cout << run << " tests, " << failed << " failed" << endl;
+    return failed == 0 && run > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace test {
+
+// Case is a registered test, run returns normally if it passes.
+class Case {
+public:
+    const char* name;
+    void (*run)();
+};
+
+// Cases returns all registered tests, in the order they are registered.
+vector<Case>& Cases();
+
+// Register adds a test, it's called by TEST.
+class Register {
+public:
+    Register(const char* name, void (*run)()) { Cases().push_back(Case{name, run}); }
+};
+
+// Fail marks the running test as failed, it goes on to find more failures.
+void Fail(const char* file, int line, const string& msg);
+
+// Result is what a run of the simple_lang binary wrote and returned, code is -1 if it
+// was killed, e.g. for running out of its cpu time.
+class Result {
+public:
+    int code = 0;
+    string out;
+    string err;
+};
+
+/**
+ * @brief TempFile writes text to a new file in the temp directory of the test run.
+ *
+ * @param name file name in the directory, e.g. "bad.txt".
+ * @return path of the file.
+ */
+string TempFile(const string& name, const string& text);
+
+/**
+ * @brief Run runs the simple_lang binary with args on input, in the temp directory of the test run.
+ *
+ * @param args arguments, each is quoted for the shell.
+ */
+Result Run(const vector<string>& args, const string& input = "");
+
+// HasNative reports whether x86-64 assembly written by simple_lang runs on this machine.
+bool HasNative();
+
+/**
+ * @brief RunNative compiles path to x86-64 at level, assembles it with the c compiler and
+ * runs it on input. If simple_lang fails, its result is returned, -1 if the assembly doesn't
+ * assemble.
+ */
+Result RunNative(const string& path, int level, const string& input = "");
+
+}// namespace test
+
+// TEST defines and registers a test case.
+#define TEST(name) \
+    static void name(); \
+    static test::Register name##_register(#name, name); \
+    static void name()
+
+// EXPECT fails the test if cond is false, and goes on.
+#define EXPECT(cond) \
+    do { \
+        if (!(cond)) { \
+            test::Fail(__FILE__, __LINE__, "expect " #cond); \
+        } \
+    } while (0)
+
+// EXPECT_EQ fails the test if a != b, both are written to the failure.
+#define EXPECT_EQ(a, b) \
+    do { \
+        auto test_a = (a); \
+        auto test_b = (b); \
+        if (!(test_a == test_b)) { \
+            ostringstream test_msg; \
+            test_msg << "expect " #a " == " #b ", got '" << test_a << "' and '" << test_b << "'"; \
+            test::Fail(__FILE__, __LINE__, test_msg.str()); \
+        } \
+    } while (0)
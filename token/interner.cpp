@@ -0,0 +1,71 @@
+#include <cstring>
+
+#include "token/interner.h"
+
+namespace token {
+
+Interner::Interner() : slots_(64, 0) {}
+
+uint32_t Interner::Hash(const char* text, int length) {
+    // FNV-1a.
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash ^= static_cast<unsigned char>(text[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+size_t Interner::FindSlot(const char* text, int length, uint32_t hash) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        int slot = slots_[i];
+        if (slot == 0) {
+            return i;
+        }
+
+        const string& name = names_[slot - 1];
+        if (hashes_[slot - 1] == hash && name.size() == static_cast<size_t>(length)
+            && memcmp(name.data(), text, length) == 0) {
+            return i;
+        }
+    }
+}
+
+void Interner::Grow() {
+    vector<int> slots(slots_.size() * 2, 0);
+    size_t mask = slots.size() - 1;
+    for (int symbol = 0; symbol < Size(); symbol++) {
+        size_t i = hashes_[symbol] & mask;
+        while (slots[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = symbol + 1;
+    }
+    slots_.swap(slots);
+}
+
+int Interner::Intern(const char* text, int length) {
+    uint32_t hash = Hash(text, length);
+    size_t i = FindSlot(text, length, hash);
+    if (slots_[i] != 0) {
+        return slots_[i] - 1;
+    }
+
+    int symbol = Size();
+    names_.emplace_back(text, length);
+    hashes_.push_back(hash);
+    slots_[i] = symbol + 1;
+
+    if (slots_.size() < names_.size() * 2) {
+        Grow();
+    }
+
+    return symbol;
+}
+
+int Interner::Lookup(const char* text, int length) const {
+    return slots_[FindSlot(text, length, Hash(text, length))] - 1;
+}
+
+}// namespace token
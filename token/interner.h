@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace token {
+
+// Interner maps identifier text to dense integer symbols 0, 1, 2, ...
+// The same text always gets the same symbol, so later passes can compare
+// and index by symbol instead of hashing strings again.
+class Interner {
+public:
+    Interner();
+
+    /**
+     * @brief Intern returns the symbol of text, a new symbol is created on first sight.
+     */
+    int Intern(const char* text, int length);
+    int Intern(const string& text) { return Intern(text.data(), static_cast<int>(text.size())); }
+
+    /**
+     * @brief Lookup returns the symbol of text, or -1 if text is never interned.
+     */
+    int Lookup(const char* text, int length) const;
+
+    // Name returns the text of symbol.
+    const string& Name(int symbol) const { return names_[symbol]; }
+
+    // Size returns count of symbols.
+    int Size() const { return static_cast<int>(names_.size()); }
+private:
+    static uint32_t Hash(const char* text, int length);
+
+    // FindSlot returns the slot holding text, or the empty slot to put it in.
+    size_t FindSlot(const char* text, int length, uint32_t hash) const;
+
+    // Grow doubles slots_ and reinserts all symbols.
+    void Grow();
+
+    vector<string> names_;
+    // hashes_[symbol] is hash of names_[symbol].
+    vector<uint32_t> hashes_;
+    // slots_ is an open addressing table, linear probing, holds symbol + 1 and 0 for empty.
+    // size is a power of 2 and kept at least twice of symbols count.
+    vector<int> slots_;
+};
+
+}// namespace token
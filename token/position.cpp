@@ -4,44 +4,135 @@
 
 #include "token/position.h"
 #include "error.h"
+#include "prof/prof.h"
 
 namespace token{
 
+File::File() : line_count_(0), cursor_(0) {
+    for (auto& segment : segments_) {
+        segment.store(nullptr, memory_order_relaxed);
+    }
+}
+
+File::~File() {
+    for (auto& segment : segments_) {
+        delete[] segment.load(memory_order_relaxed);
+    }
+}
+
+int File::SegmentOf(int i, int* index_in_segment) {
+    // segment k starts at kFirstSegmentSize * (2^k - 1).
+    unsigned int block = ((unsigned int)i >> kFirstSegmentBits) + 1;
+    int segment = 31 - __builtin_clz(block);
+    *index_in_segment = i - kFirstSegmentSize * ((1 << segment) - 1);
+    return segment;
+}
+
+int File::LineAt(int i) const {
+    int index_in_segment;
+    int segment = SegmentOf(i, &index_in_segment);
+    // segment pointer is published before line_count_, which is loaded by acquire.
+    return segments_[segment].load(memory_order_relaxed)[index_in_segment];
+}
+
+bool File::StoreLine(int i, int offset) {
+    int index_in_segment;
+    int segment = SegmentOf(i, &index_in_segment);
+    if (segment >= kMaxSegments) {
+        return false;
+    }
+
+    int* lines = segments_[segment].load(memory_order_relaxed);
+    if (lines == nullptr) {
+        lines = new int[kFirstSegmentSize << segment];
+        segments_[segment].store(lines, memory_order_release);
+    }
+    lines[index_in_segment] = offset;
+
+    return true;
+}
+
 void File::AddLine(int offset) {
-    mux_.lock();
+    int line_number = line_count_.load(memory_order_relaxed);
+    if ((line_number != 0 && LineAt(line_number - 1) >= offset) || offset >= size) {
+        return;
+    }
 
-    int line_number = (int)lines_.size();
-    if ((line_number == 0 || lines_.back() < offset) && offset < size) {
-        lines_.push_back(offset);
+    if (StoreLine(line_number, offset)) {
+        line_count_.store(line_number + 1, memory_order_release);
+    }
+}
+
+void File::AddLines(const int* offsets, int n) {
+    if (n == 0) {
+        return;
+    }
+
+    int line_number = line_count_.load(memory_order_relaxed);
+    int last_offset = (line_number == 0) ? -1 : LineAt(line_number - 1);
+    for (int i = 0; i < n; i++) {
+        int offset = offsets[i];
+        if (offset <= last_offset || offset >= size) {
+            continue;
+        }
+
+        if (!StoreLine(line_number, offset)) {
+            break;
+        }
+        last_offset = offset;
+        line_number++;
     }
 
-    mux_.unlock();
+    line_count_.store(line_number, memory_order_release);
 }
 
-Position File::GetPositionByOffset(int offset) {
-    mux_.lock();
+int File::SearchLine(int offset, int line_count) const {
+    // lines [0, cursor) start at or before the last resolved offset, try it and
+    // its next line first.
+    int cursor = cursor_.load(memory_order_relaxed);
+    for (int guess = cursor; guess <= cursor + 1 && guess <= line_count; guess++) {
+        bool after_prev = (guess == 0 || LineAt(guess - 1) <= offset);
+        bool before_next = (guess == line_count || LineAt(guess) > offset);
+        if (after_prev && before_next) {
+            if (guess != cursor) {
+                cursor_.store(guess, memory_order_relaxed);
+            }
+            return guess;
+        }
+    }
 
-    int line_id = 0;
-    int line_offset = 0;
-    for(const int& current_line_offset: lines_) {
-        line_id ++;
-        if (current_line_offset <= offset) {
-            line_offset = current_line_offset;
+    // upper bound of offset in lines.
+    int lo = 0, hi = line_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (LineAt(mid) <= offset) {
+            lo = mid + 1;
         } else {
-            break;
+            hi = mid;
         }
     }
 
-    mux_.unlock();
+    cursor_.store(lo, memory_order_relaxed);
+    return lo;
+}
 
+Position File::GetPositionByOffset(int offset) const {
     Position pos;
 
     pos.filename = name;
     pos.offset = offset;
-    pos.line = line_id + 1;
-    pos.column = offset - line_offset + 1;
+    GetLineColumn(offset, &pos.line, &pos.column);
 
     return pos;
 }
 
-}// namespace token
\ No newline at end of file
+void File::GetLineColumn(int offset, int* line, int* column) const {
+    prof::Count(prof::PositionLookups);
+    int line_count = line_count_.load(memory_order_acquire);
+    int lines_before = SearchLine(offset, line_count);
+
+    *line = lines_before + 1;
+    *column = offset - (lines_before == 0 ? 0 : LineAt(lines_before - 1)) + 1;
+}
+
+}// namespace token
@@ -1,8 +1,7 @@
 #pragma once
 
 #include <string>
-#include <mutex>
-#include <vector>
+#include <atomic>
 
 using namespace std;
 
@@ -26,23 +25,72 @@ public:
 
 class File {
 public:
+    File();
+    ~File();
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
     /**
      * @brief AddLine adds the line offset for a new line.
      * The line offset must be larger than the offset for the previous line
      * and smaller than the file size; otherwise the line offset is ignored.
+     * AddLine should only be called by one writer (the scanner of the file),
+     * but it is safe to call GetPositionByOffset concurrently.
      */
     void AddLine(int offset);
 
+    /**
+     * @brief AddLines adds sorted line offsets, same as calling AddLine for each of them,
+     * but all of them are published to readers at once.
+     */
+    void AddLines(const int* offsets, int n);
+
     /**
      * @brief Position returns the Position value for the given file Position p.
+     * Lines are looked up by binary search, the last resolved line is cached,
+     * so monotonic queries (e.g. from parser) usually cost O(1).
+     */
+    Position GetPositionByOffset(int offset) const;
+
+    /**
+     * @brief GetLineColumn is GetPositionByOffset without copying the file name.
+     */
+    void GetLineColumn(int offset, int* line, int* column) const;
+
+    /**
+     * @brief LineCount returns the number of lines added by AddLine.
      */
-    Position GetPositionByOffset(int offset);
+    int LineCount() const { return line_count_.load(memory_order_acquire); }
 
     string name{};
     int size{};
 private:
-    vector<int> lines_{};
-    mutex mux_{};
+    // LineAt returns offset of the i-th added line, i must be less than LineCount().
+    int LineAt(int i) const;
+
+    // SegmentOf returns the segment which stores the i-th added line, and
+    // the index of the line in that segment.
+    static int SegmentOf(int i, int* index_in_segment);
+
+    // StoreLine writes offset of the i-th line without publishing it,
+    // returns false if there is no space for it.
+    bool StoreLine(int i, int offset);
+
+    // SearchLine returns the number of added lines which start at or before offset.
+    int SearchLine(int offset, int line_count) const;
+
+    // Line offsets are stored in append-only segments, the k-th segment holds
+    // kFirstSegmentSize << k offsets. A segment never moves after allocated,
+    // so readers could access all published lines without lock.
+    static const int kFirstSegmentBits = 10;
+    static const int kFirstSegmentSize = 1 << kFirstSegmentBits;
+    static const int kMaxSegments = 22;
+
+    atomic<int*> segments_[kMaxSegments];
+    atomic<int> line_count_;
+
+    // cursor_ caches the result of last SearchLine.
+    mutable atomic<int> cursor_;
 };
 
 const Position npos = Position{
@@ -1,145 +1,155 @@
 #include "token/token.h"
 #include <string>
-#include <map>
+#include <cstring>
 
 using namespace std;
 
 
 namespace token{
 
-const static map<Token, string> token_names{
-    {ILLEGAL,"ILLEGAL"}, // 无效token
+// token_names is indexed by Token, "" for the range markers.
+constexpr static const char* token_names[] = {
+    "ILLEGAL", // 无效token
 
-    {IDENFR,"IDENFR"},  // 标识符
-    {INTCON,"INTCON"},  // 整形常量
-    {CHARCON,"CHARCON"}, // 字符常量
-    {STRCON,"STRCON"},  // 字符串
+    "",         // literal_beg
+    "IDENFR",   // 标识符
+    "INTCON",   // 整形常量
+    "CHARCON",  // 字符常量
+    "STRCON",   // 字符串
+    "",         // literal_end
 
     // keywords.
-    {CONSTTK, "CONSTTK"},   // const
-    {INTTK, "INTTK"},     // int
-    {CHARTK, "CHARTK"},    // char
-    {VOIDTK, "VOIDTK"},    // void
-    {MAINTK, "MAINTK"},    // main
-    {IFTK, "IFTK"},      // if
-    {ELSETK, "ELSETK"},    // else
-    {SWITCHTK, "SWITCHTK"},  // switch
-    {CASETK, "CASETK"},    // case
-    {DEFAULTTK, "DEFAULTTK"}, // default
-    {WHILETK, "WHILETK"},   // while
-    {FORTK, "FORTK"},     // for
-    {SCANFTK, "SCANFTK"},   // scanf
-    {PRINTFTK, "PRINTFTK"},  // printf
-    {RETURNTK, "RETURNTK"},  // return
+    "",          // keyword_beg
+    "CONSTTK",   // const
+    "INTTK",     // int
+    "CHARTK",    // char
+    "VOIDTK",    // void
+    "MAINTK",    // main
+    "IFTK",      // if
+    "ELSETK",    // else
+    "SWITCHTK",  // switch
+    "CASETK",    // case
+    "DEFAULTTK", // default
+    "WHILETK",   // while
+    "FORTK",     // for
+    "SCANFTK",   // scanf
+    "PRINTFTK",  // printf
+    "RETURNTK",  // return
+    "",          // keyword_end
 
     // Operators and delimiters
-    {PLUS, "PLUS"},    // +
-    {MINU, "MINU"},    // -
-    {MULT, "MULT"},    // *
-    {DIV, "DIV"},     // /
-    {LSS, "LSS"},     // <
-    {LEQ, "LEQ"},     // <=
-    {GRE, "GRE"},     // >
-    {GEQ, "GEQ"},     // >=
-    {EQL, "EQL"},     // ==
-    {NEQ, "NEQ"},     // !=
-    {COLON, "COLON"},   // :
-    {ASSIGN, "ASSIGN"},  // =
-    {SEMICN, "SEMICN"},  // ;
-    {COMMA, "COMMA"},   // ,
-    {LPARENT, "LPARENT"}, // (
-    {RPARENT, "RPARENT"}, // )
-    {LBRACK, "LBRACK"},  // [
-    {RBRACK, "RBRACK"},  // ]
-    {LBRACE, "LBRACE"},  // {
-    {RBRACE, "RBRACE"},  // }
-
-    {END_OF_FILE, "END_OF_FILE"}, // end of file.
+    "",        // operator_beg
+    "PLUS",    // +
+    "MINU",    // -
+    "MULT",    // *
+    "DIV",     // /
+    "LSS",     // <
+    "LEQ",     // <=
+    "GRE",     // >
+    "GEQ",     // >=
+    "EQL",     // ==
+    "NEQ",     // !=
+    "COLON",   // :
+    "ASSIGN",  // =
+    "SEMICN",  // ;
+    "COMMA",   // ,
+    "LPARENT", // (
+    "RPARENT", // )
+    "LBRACK",  // [
+    "RBRACK",  // ]
+    "LBRACE",  // {
+    "RBRACE",  // }
+    "",        // operator_end
+
+    "END_OF_FILE", // end of file.
 };
 
-const static map<Token, string> tokens {
-    {ILLEGAL,"ILLEGAL"}, // 无效token
+// tokens is indexed by Token, it's the source text of each token.
+constexpr static const char* tokens[] = {
+    "ILLEGAL", // 无效token
 
 	//literal
-	{IDENFR,  "IDENFR"},
-	{INTCON,  "INTCON"},
-	{CHARCON, "CHARCON"},
-	{STRCON,  "STRCON"},
+	"",
+	"IDENFR",
+	"INTCON",
+	"CHARCON",
+	"STRCON",
+	"",
 
 	// keywords.
-	{CONSTTK,   "const"},
-	{INTTK,     "int"},
-	{CHARTK,    "char"},
-	{VOIDTK,    "void"},
-	{MAINTK,    "main"},
-	{IFTK,      "if"},
-	{ELSETK,    "else"},
-	{SWITCHTK,  "switch"},
-	{CASETK,    "case"},
-	{DEFAULTTK, "default"},
-	{WHILETK,   "while"},
-	{FORTK,     "for"},
-	{SCANFTK,   "scanf"},
-	{PRINTFTK,  "printf"},
-	{RETURNTK,  "return"},
+	"",
+	"const",
+	"int",
+	"char",
+	"void",
+	"main",
+	"if",
+	"else",
+	"switch",
+	"case",
+	"default",
+	"while",
+	"for",
+	"scanf",
+	"printf",
+	"return",
+	"",
 
 	// operators.
-	{PLUS,    "+"},
-	{MINU,    "-"},
-	{MULT,    "*"},
-	{DIV,     "/"},
-	{LSS,     "<"},
-	{LEQ,     "<="},
-	{GRE,     ">"},
-	{GEQ,     ">="},
-	{EQL,     "=="},
-	{NEQ,     "!="},
-	{COLON,   ":"},
-	{ASSIGN,  "="},
-	{SEMICN,  ";"},
-	{COMMA,   ","},
-	{LPARENT, "("},
-	{RPARENT, ")"},
-	{LBRACK,  "["},
-	{RBRACK,  "]"},
-	{LBRACE,  "{"},
-	{RBRACE,  "}"},
+	"",
+	"+",
+	"-",
+	"*",
+	"/",
+	"<",
+	"<=",
+	">",
+	">=",
+	"==",
+	"!=",
+	":",
+	"=",
+	";",
+	",",
+	"(",
+	")",
+	"[",
+	"]",
+	"{",
+	"}",
+	"",
 
 	// EOF is end of file.
-	{END_OF_FILE, "EOF"},
+	"EOF",
 };
 
-const static map<string, Token> key_words {
-    {"const", CONSTTK},
-    {"int", INTTK},
-    {"char", CHARTK},
-    {"void", VOIDTK},
-    {"main", MAINTK},
-    {"if", IFTK},
-    {"else", ELSETK},
-    {"switch", SWITCHTK},
-    {"case", CASETK},
-    {"default", DEFAULTTK},
-    {"while", WHILETK},
-    {"for", FORTK},
-    {"scanf", SCANFTK},
-    {"printf", PRINTFTK},
-    {"return", RETURNTK},
-};
+static_assert(sizeof(token_names) / sizeof(token_names[0]) == END_OF_FILE + 1, "token_names must cover all tokens");
+static_assert(sizeof(tokens) / sizeof(tokens[0]) == END_OF_FILE + 1, "tokens must cover all tokens");
 
 /**
  * @brief GetTokenName get token's raw name.
  * @param tok token enum
- * @param name token's name
- * @return true for found, false for notfound
+ * @return string, token name, "" for notfound
  */
 string GetTokenName(const Token& tok) {
-    auto get_token_name_iter = token_names.find(tok);
-    if (get_token_name_iter == token_names.end()) {
+    if (tok < ILLEGAL || tok > END_OF_FILE) {
+        return "";
+    }
+
+    return token_names[tok];
+}
+
+/**
+ * @brief GetTokenLiteral get token's source text.
+ * @param tok token enum
+ * @return string, e.g. "+" for PLUS, "" for notfound
+ */
+string GetTokenLiteral(const Token& tok) {
+    if (tok < ILLEGAL || tok > END_OF_FILE) {
         return "";
     }
 
-    return get_token_name_iter->second;
+    return tokens[tok];
 }
 
 /**
@@ -148,12 +158,64 @@ string GetTokenName(const Token& tok) {
  * @return identifier's keyword token
  */
 Token LookUp(const string& ident) {
-    auto get_keyword_token_iter = key_words.find(ident);
-    if (get_keyword_token_iter == key_words.end()) {
-        return Token::IDENFR;
+    return LookUp(ident.data(), (int)ident.size());
+}
+
+// MatchKeyword returns tok if ident is keyword, IDENFR for not.
+inline Token MatchKeyword(const char* ident, int len, const char* keyword, Token tok) {
+    return memcmp(ident, keyword, len) == 0 ? tok : Token::IDENFR;
+}
+
+/**
+ * Lookup maps an identifier to its keyword token or IDENT (if not a keyword)
+ * @param ident first char of identifier
+ * @param len length of identifier
+ * @return identifier's keyword token
+ */
+Token LookUp(const char* ident, int len) {
+    // keywords are distinguished by length and first char, except 'char' and 'case',
+    // so at most one compare is needed for each identifier.
+    switch (len) {
+        case 2:
+            if (ident[0] == 'i') return MatchKeyword(ident, len, "if", IFTK);
+            break;
+        case 3:
+            if (ident[0] == 'i') return MatchKeyword(ident, len, "int", INTTK);
+            if (ident[0] == 'f') return MatchKeyword(ident, len, "for", FORTK);
+            break;
+        case 4:
+            switch (ident[0]) {
+                case 'c':
+                    if (ident[1] == 'h') return MatchKeyword(ident, len, "char", CHARTK);
+                    return MatchKeyword(ident, len, "case", CASETK);
+                case 'v':
+                    return MatchKeyword(ident, len, "void", VOIDTK);
+                case 'm':
+                    return MatchKeyword(ident, len, "main", MAINTK);
+                case 'e':
+                    return MatchKeyword(ident, len, "else", ELSETK);
+                default:
+                    break;
+            }
+            break;
+        case 5:
+            if (ident[0] == 'c') return MatchKeyword(ident, len, "const", CONSTTK);
+            if (ident[0] == 'w') return MatchKeyword(ident, len, "while", WHILETK);
+            if (ident[0] == 's') return MatchKeyword(ident, len, "scanf", SCANFTK);
+            break;
+        case 6:
+            if (ident[0] == 's') return MatchKeyword(ident, len, "switch", SWITCHTK);
+            if (ident[0] == 'p') return MatchKeyword(ident, len, "printf", PRINTFTK);
+            if (ident[0] == 'r') return MatchKeyword(ident, len, "return", RETURNTK);
+            break;
+        case 7:
+            if (ident[0] == 'd') return MatchKeyword(ident, len, "default", DEFAULTTK);
+            break;
+        default:
+            break;
     }
 
-    return get_keyword_token_iter->second;
+    return Token::IDENFR;
 }
 
-}//namespace token
\ No newline at end of file
+}//namespace token
@@ -76,6 +76,13 @@ enum Token {
  */
 extern string GetTokenName(const Token& tok);
 
+/**
+ * @brief GetTokenLiteral get token's source text.
+ * @param tok token enum
+ * @return string, e.g. "+" for PLUS
+ */
+extern string GetTokenLiteral(const Token& tok);
+
 /**
  * Lookup maps an identifier to its keyword token or IDENT (if not a keyword)
  * @param ident identifier
@@ -83,6 +90,14 @@ extern string GetTokenName(const Token& tok);
  */
 extern Token LookUp(const string& ident);
 
+/**
+ * Lookup maps an identifier to its keyword token or IDENT (if not a keyword)
+ * @param ident first char of identifier
+ * @param len length of identifier
+ * @return identifier's keyword token
+ */
+extern Token LookUp(const char* ident, int len);
+
 /**
  * IsLiteral returns true for tokens corresponding to identifiers and basic type literals;
  * it returns false otherwise.
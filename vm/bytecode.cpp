@@ -0,0 +1,48 @@
+#include <iomanip>
+
+#include "vm/bytecode.h"
+
+namespace vm {
+
+static const char* const op_names[] = {
+#define VM_OP_NAME(name) #name,
+    VM_OPS(VM_OP_NAME)
+#undef VM_OP_NAME
+};
+
+const char* OpName(Op op) {
+    int i = static_cast<int>(op);
+    return i < OpCount ? op_names[i] : "Unknown";
+}
+
+void Dump(const Program& prog, ostream& out) {
+    // functions are laid out one after another, entry order is code order.
+    vector<const Function*> starts(prog.code.size() + 1, nullptr);
+    for (const auto& func : prog.funcs) {
+        starts[func.entry] = &func;
+    }
+
+    for (size_t pc = 0; pc < prog.code.size(); pc++) {
+        if (starts[pc] != nullptr) {
+            out << starts[pc]->name << ": params " << starts[pc]->num_params
+                << ", regs " << starts[pc]->num_regs << "\n";
+        }
+
+        const Instr& instr = prog.code[pc];
+        out << setw(6) << pc << "  " << left << setw(16) << OpName(instr.Opcode()) << right
+            << instr.a << ", " << instr.b << ", " << instr.c;
+        if (instr.Opcode() == Op::PrintStr && instr.b >= 0 && instr.b < static_cast<int>(prog.strings.size())) {
+            out << "  ; \"" << prog.strings[instr.b] << "\"";
+        } else if (instr.Opcode() == Op::Call && instr.b >= 0 && instr.b < static_cast<int>(prog.funcs.size())) {
+            out << "  ; " << prog.funcs[instr.b].name;
+        }
+        out << "\n";
+    }
+
+    for (const auto& block : prog.global_data) {
+        out << "data g[" << block.addr << ", " << block.addr + block.size << ") = data["
+            << block.begin << ", " << block.begin + block.size << ")\n";
+    }
+}
+
+}// namespace vm
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace vm {
+
+// VM_OPS lists every opcode once, the enum, the op names and the dispatch
+// table of the vm are all expanded from it so they can't get out of order.
+// r[x] is register x of the current frame, g[x] is global cell x.
+#define VM_OPS(X) \
+    X(Mov)               /* r[a] = r[b] */ \
+    X(LoadK)             /* r[a] = b */ \
+    X(LoadGlobal)        /* r[a] = g[b] */ \
+    X(StoreGlobal)       /* g[b] = r[a] */ \
+    X(LoadLocalElem)     /* r[a] = r[b + r[c]] */ \
+    X(StoreLocalElem)    /* r[b + r[c]] = r[a] */ \
+    X(LoadGlobalElem)    /* r[a] = g[b + r[c]] */ \
+    X(StoreGlobalElem)   /* g[b + r[c]] = r[a] */ \
+    X(LoadData)          /* r[a + i] = data[b + i], for i < c */ \
+    X(CheckIndex)        /* fail unless 0 <= r[a] < b */ \
+    X(Neg)               /* r[a] = -r[b] */ \
+    X(Add)               /* r[a] = r[b] + r[c] */ \
+    X(Sub)               /* r[a] = r[b] - r[c] */ \
+    X(Mul)               /* r[a] = r[b] * r[c] */ \
+    X(Div)               /* r[a] = r[b] / r[c], fail if r[c] is 0 */ \
+    X(Lss)               /* r[a] = r[b] < r[c] */ \
+    X(Leq)               /* r[a] = r[b] <= r[c] */ \
+    X(Gre)               /* r[a] = r[b] > r[c] */ \
+    X(Geq)               /* r[a] = r[b] >= r[c] */ \
+    X(Eql)               /* r[a] = r[b] == r[c] */ \
+    X(Neq)               /* r[a] = r[b] != r[c] */ \
+    X(Jmp)               /* goto b */ \
+    X(Loop)              /* goto b, the back edge of a loop */ \
+    X(Jz)                /* if r[a] == 0 goto b */ \
+    X(Jnz)               /* if r[a] != 0 goto b */ \
+    X(Call)              /* r[a] = func b(r[c], r[c + 1], ...) */ \
+    X(Ret)               /* return r[a] */ \
+    X(RetVoid)           /* return 0 */ \
+    X(ReadInt)           /* scan an int into r[a] */ \
+    X(ReadChar)          /* scan a not blank char into r[a] */ \
+    X(PrintInt)          /* print r[a] as a decimal */ \
+    X(PrintChar)         /* print r[a] as a char */ \
+    X(PrintStr)          /* print strings[b] */ \
+    X(PrintLine)         /* print a new line */ \
+    X(Halt)              /* stop the vm */
+
+// Op is the operation of an instruction.
+enum class Op : uint8_t {
+#define VM_OP_ENUM(name) name,
+    VM_OPS(VM_OP_ENUM)
+#undef VM_OP_ENUM
+};
+
+// OpCount is the number of opcodes.
+const int OpCount = static_cast<int>(Op::Halt) + 1;
+
+/**
+ * @brief OpName returns name of op.
+ *
+ * @return string, e.g. "Add" for Op::Add
+ */
+const char* OpName(Op op);
+
+// Instr is a single instruction, registers are relative to the frame of the
+// running function, jump targets are absolute indexes of Program::code.
+// op and a share a word, so an instruction is 12 bytes and a frame may still
+// hold 2^24 registers, local arrays live in registers too.
+class Instr {
+public:
+    Instr() : op(static_cast<uint32_t>(Op::Halt)), a(0), b(0), c(0) {}
+    Instr(Op op, int a, int b, int c) : op(static_cast<uint32_t>(op)), a(static_cast<uint32_t>(a)), b(b), c(c) {}
+
+    Op Opcode() const { return static_cast<Op>(op); }
+
+    uint32_t op : 8;
+    uint32_t a : 24;
+    int32_t b;
+    int32_t c;
+};
+
+// MaxRegs is the most registers a frame can hold.
+const int MaxRegs = 1 << 24;
+
+// Function is a compiled function.
+class Function {
+public:
+    string name;
+    // arguments are passed in the first num_params registers.
+    int num_params = 0;
+    // num_regs is the frame size, a callee frame starts right after it.
+    int num_regs = 0;
+    // entry is index of the first instruction in Program::code.
+    int entry = 0;
+};
+
+// GlobalData is a block of global cells set from the data of a program before it runs.
+class GlobalData {
+public:
+    // g[addr + i] = data[begin + i], for i < size.
+    int addr;
+    int begin;
+    int size;
+};
+
+// Program is the bytecode of a file, all functions share a single code vector.
+class Program {
+public:
+    vector<Instr> code;
+    vector<Function> funcs;
+    // strings are printf literals, with escapes already decoded.
+    vector<string> strings;
+    // data are items of packed composite literals, copied to arrays as a whole.
+    vector<int32_t> data;
+    vector<GlobalData> global_data;
+    int num_globals = 0;
+    // entry is the function which initializes globals then calls main.
+    int entry = 0;
+};
+
+/**
+ * @brief Dump writes a listing of prog to out, one instruction per line.
+ * e.g. '    12  Add        3, 1, 2'
+ */
+void Dump(const Program& prog, ostream& out);
+
+}// namespace vm
@@ -0,0 +1,654 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "vm/compiler.h"
+#include "ast/util.h"
+#include "prof/prof.h"
+
+namespace vm {
+
+// BinaryOp returns op of a binary operator, returns false if tok isn't one.
+static bool BinaryOp(token::Token tok, Op* op) {
+    switch (tok) {
+        case token::Token::PLUS: *op = Op::Add; return true;
+        case token::Token::MINU: *op = Op::Sub; return true;
+        case token::Token::MULT: *op = Op::Mul; return true;
+        case token::Token::DIV: *op = Op::Div; return true;
+        case token::Token::LSS: *op = Op::Lss; return true;
+        case token::Token::LEQ: *op = Op::Leq; return true;
+        case token::Token::GRE: *op = Op::Gre; return true;
+        case token::Token::GEQ: *op = Op::Geq; return true;
+        case token::Token::EQL: *op = Op::Eql; return true;
+        case token::Token::NEQ: *op = Op::Neq; return true;
+        default: return false;
+    }
+}
+
+Compiler::Compiler(const shared_ptr<ast::FileNode>& ast_file) :
+    ast_file_(ast_file), bounds_(nullptr), prog_(nullptr), cur_func_(0), next_reg_(0), max_reg_(0) {}
+
+int Compiler::Compile(Program* prog, string* err) {
+    prof::ScopedPhase phase(prof::Lower);
+    prog_ = prog;
+    *prog_ = Program();
+    error_.clear();
+
+    // function 0 initializes globals, then calls main.
+    prog_->funcs.emplace_back();
+    prog_->funcs[0].name = "<init>";
+    prog_->entry = 0;
+
+    // all functions are indexed first, so a call may refer to any of them.
+    int main_index = -1;
+    for (auto decl : ast_file_->decl_) {
+        if (decl->Type() != ast::NodeType::FuncDecl) {
+            continue;
+        }
+
+        auto func_decl = static_cast<ast::FuncDeclNode*>(decl);
+        int index = static_cast<int>(prog_->funcs.size());
+        prog_->funcs.emplace_back();
+        prog_->funcs[index].name = func_decl->name_->name_;
+        prog_->funcs[index].num_params = func_decl->params_ != nullptr ? static_cast<int>(func_decl->params_->fields_.size()) : 0;
+        func_index_[func_decl] = index;
+        var_table_.AddFunc(func_decl->name_->symbol_, func_decl);
+
+        if (func_decl->name_->name_ == "main") {
+            main_index = index;
+        }
+    }
+
+    cur_func_ = 0;
+    next_reg_ = max_reg_ = 0;
+    for (auto decl : ast_file_->decl_) {
+        if (decl->Type() != ast::NodeType::FuncDecl) {
+            CompileVarDecl(decl);
+        }
+    }
+
+    if (main_index < 0) {
+        Fail(nullptr, "main function not found");
+    } else {
+        Emit(Op::Call, NewReg(), main_index, next_reg_);
+    }
+    Emit(Op::Halt);
+    prog_->funcs[0].num_regs = max_reg_;
+
+    for (auto decl : ast_file_->decl_) {
+        if (decl->Type() == ast::NodeType::FuncDecl) {
+            auto func_decl = static_cast<ast::FuncDeclNode*>(decl);
+            CompileFuncDecl(func_decl, func_index_[func_decl]);
+        }
+    }
+
+    if (!error_.empty()) {
+        *err = error_;
+        return -1;
+    }
+
+    return 0;
+}
+
+void Compiler::CompileVarDecl(ast::DeclNode* decl) {
+    if (decl->Type() == ast::NodeType::SingleVarDecl) {
+        CompileSingleVarDecl(static_cast<ast::SingleVarDeclNode*>(decl));
+        return;
+    }
+
+    if (decl->Type() != ast::NodeType::VarDecl) {
+        Fail(decl, "bad declaration");
+        return;
+    }
+
+    for (auto single_decl : static_cast<ast::VarDeclNode*>(decl)->decls_) {
+        CompileVarDecl(single_decl);
+    }
+}
+
+void Compiler::CompileSingleVarDecl(ast::SingleVarDeclNode* decl) {
+    Var var{};
+    ast::TypeNode* item = decl->type_;
+    long long size = 1;
+    while (item != nullptr && item->Type() == ast::NodeType::ArrayType) {
+        auto array_type = static_cast<ast::ArrayTypeNode*>(item);
+        var.dims.push_back(array_type->size_);
+        size *= max(array_type->size_, 0);
+        item = array_type->item_;
+    }
+
+    if (item == nullptr || (item->Type() != ast::NodeType::IntType && item->Type() != ast::NodeType::CharType)) {
+        Fail(decl, "for var decl, expect int or char elements");
+        return;
+    }
+    if (size <= 0 || size > MaxRegs) {
+        Fail(decl, "for var decl, array size out of range");
+        return;
+    }
+
+    var.is_char = item->Type() == ast::NodeType::CharType;
+    // vars of the init function are the globals.
+    var.global = cur_func_ == 0;
+    if (var.global) {
+        var.addr = prog_->num_globals;
+        prog_->num_globals += static_cast<int>(size);
+    } else {
+        var.addr = NewReg(static_cast<int>(size));
+    }
+    AddVar(decl->name_, decl->type_, decl->is_const_, var);
+
+    if (decl->val_ == nullptr) {
+        return;
+    }
+
+    // a packed literal is copied from the data of the program at once.
+    if (decl->val_->Type() == ast::NodeType::CompositeLit && static_cast<ast::CompositeLitNode*>(decl->val_)->Packed()) {
+        const auto& values = static_cast<ast::CompositeLitNode*>(decl->val_)->values_;
+        if (static_cast<long long>(values.size()) != size) {
+            Fail(decl, "for var decl, initializer doesn't match the type");
+            return;
+        }
+
+        int begin = static_cast<int>(prog_->data.size());
+        prog_->data.insert(prog_->data.end(), values.begin(), values.end());
+        if (var.global) {
+            prog_->global_data.push_back(GlobalData{var.addr, begin, static_cast<int>(size)});
+        } else {
+            Emit(Op::LoadData, var.addr, begin, static_cast<int>(size));
+        }
+        return;
+    }
+
+    vector<ast::ExprNode*> items;
+    ast::FlattenCompositeLit(decl->val_, &items);
+    if (static_cast<long long>(items.size()) != size) {
+        Fail(decl, "for var decl, initializer doesn't match the type");
+        return;
+    }
+
+    int mark = next_reg_;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (var.global) {
+            Emit(Op::StoreGlobal, CompileExpr(items[i]), var.addr + static_cast<int>(i));
+        } else {
+            CompileExpr(items[i], var.addr + static_cast<int>(i));
+        }
+        next_reg_ = mark;
+    }
+}
+
+void Compiler::CompileFuncDecl(ast::FuncDeclNode* decl, int index) {
+    cur_func_ = index;
+    prog_->funcs[index].entry = static_cast<int>(prog_->code.size());
+    next_reg_ = max_reg_ = 0;
+
+    var_table_.CreateCodeBlock();
+    if (decl->params_ != nullptr) {
+        for (auto field : decl->params_->fields_) {
+            Var var{};
+            var.global = false;
+            var.addr = NewReg();
+            var.is_char = field->type_ != nullptr && field->type_->Type() == ast::NodeType::CharType;
+            AddVar(field->name_, field->type_, false, var);
+        }
+    }
+
+    CompileStmt(decl->body_);
+    // falling off the end returns 0, also for int and char functions.
+    Emit(Op::RetVoid);
+    var_table_.DestroyCodeBlock();
+
+    prog_->funcs[index].num_regs = max_reg_;
+}
+
+void Compiler::CompileStmt(ast::StmtNode* stmt) {
+    int mark = next_reg_;
+    VisitStmt(stmt);
+    // a decl stmt keeps its vars until end of the code block.
+    if (stmt->Type() != ast::NodeType::DeclStmt) {
+        next_reg_ = mark;
+    }
+}
+
+void Compiler::VisitBadStmt(ast::BadStmtNode* stmt) {
+    Fail(stmt, "bad statement");
+}
+
+void Compiler::VisitDeclStmt(ast::DeclStmtNode* stmt) {
+    CompileVarDecl(stmt->decl_);
+}
+
+void Compiler::VisitExprStmt(ast::ExprStmtNode* stmt) {
+    CompileExpr(stmt->expr_);
+}
+
+void Compiler::VisitAssignStmt(ast::AssignStmtNode* stmt) {
+    if (stmt->lhs_->Type() == ast::NodeType::IndexExpr) {
+        const Var* var = nullptr;
+        int index = CompileElem(static_cast<ast::IndexExprNode*>(stmt->lhs_), &var);
+        if (index < 0) {
+            return;
+        }
+        bool global = var->global;
+        int addr = var->addr;
+        Emit(global ? Op::StoreGlobalElem : Op::StoreLocalElem, CompileExpr(stmt->rhs_), addr, index);
+        return;
+    }
+
+    if (stmt->lhs_->Type() != ast::NodeType::Ident) {
+        Fail(stmt, "for assign stmt, expect ident or index expr on the left");
+        return;
+    }
+
+    const Var* var = LookupVar(static_cast<ast::IdentNode*>(stmt->lhs_));
+    if (var == nullptr || !var->dims.empty()) {
+        Fail(stmt, "for assign stmt, expect a scalar var on the left");
+        return;
+    }
+
+    bool global = var->global;
+    int addr = var->addr;
+    if (global) {
+        Emit(Op::StoreGlobal, CompileExpr(stmt->rhs_), addr);
+    } else {
+        CompileExpr(stmt->rhs_, addr);
+    }
+}
+
+void Compiler::VisitReturnStmt(ast::ReturnStmtNode* stmt) {
+    if (stmt->results_ == nullptr) {
+        Emit(Op::RetVoid);
+        return;
+    }
+
+    Emit(Op::Ret, CompileExpr(stmt->results_));
+}
+
+void Compiler::VisitBlockStmt(ast::BlockStmtNode* stmt) {
+    var_table_.CreateCodeBlock();
+    int mark = next_reg_;
+    for (auto sub_stmt : stmt->stmts_) {
+        CompileStmt(sub_stmt);
+    }
+    next_reg_ = mark;
+    var_table_.DestroyCodeBlock();
+}
+
+int Compiler::CompileCond(ast::ExprNode* cond) {
+    return Emit(Op::Jz, CompileExpr(cond));
+}
+
+void Compiler::VisitIfStmt(ast::IfStmtNode* stmt) {
+    int to_else = CompileCond(stmt->cond_);
+    CompileStmt(stmt->body_);
+    if (stmt->else_ == nullptr) {
+        Patch(to_else);
+        return;
+    }
+
+    int to_end = Emit(Op::Jmp);
+    Patch(to_else);
+    CompileStmt(stmt->else_);
+    Patch(to_end);
+}
+
+// switch is lowered to a chain of compares ahead of the case bodies, a case
+// body jumps to the end after it is done, there is no fall through.
+void Compiler::VisitSwitchStmt(ast::SwitchStmtNode* stmt) {
+    int value = CompileExpr(stmt->cond_);
+
+    vector<ast::CaseStmtNode*> cases;
+    for (auto case_stmt : stmt->cases_) {
+        if (case_stmt->Type() != ast::NodeType::CaseStmt) {
+            Fail(case_stmt, "for switch stmt, expect case stmt");
+            return;
+        }
+        cases.push_back(static_cast<ast::CaseStmtNode*>(case_stmt));
+    }
+
+    vector<int> to_case(cases.size(), -1);
+    int default_case = -1;
+    for (size_t i = 0; i < cases.size(); i++) {
+        if (cases[i]->cond_ == nullptr) {
+            default_case = static_cast<int>(i);
+            continue;
+        }
+
+        int mark = next_reg_;
+        int label = CompileExpr(cases[i]->cond_);
+        int equal = NewReg();
+        Emit(Op::Eql, equal, value, label);
+        to_case[i] = Emit(Op::Jnz, equal);
+        next_reg_ = mark;
+    }
+    int to_default = Emit(Op::Jmp);
+
+    vector<int> to_end;
+    for (size_t i = 0; i < cases.size(); i++) {
+        Patch(static_cast<int>(i) == default_case ? to_default : to_case[i]);
+        for (auto body_stmt : cases[i]->body_) {
+            CompileStmt(body_stmt);
+        }
+        to_end.push_back(Emit(Op::Jmp));
+    }
+
+    if (default_case < 0) {
+        Patch(to_default);
+    }
+    for (auto jump : to_end) {
+        Patch(jump);
+    }
+}
+
+void Compiler::VisitForStmt(ast::ForStmtNode* stmt) {
+    if (stmt->init_ != nullptr) {
+        CompileStmt(stmt->init_);
+    }
+
+    if (stmt->cond_ == nullptr || stmt->cond_->Type() != ast::NodeType::ExprStmt) {
+        Fail(stmt, "for for stmt, expect cond expr");
+        return;
+    }
+
+    int top = static_cast<int>(prog_->code.size());
+    int to_end = CompileCond(static_cast<ast::ExprStmtNode*>(stmt->cond_)->expr_);
+    CompileStmt(stmt->body_);
+    if (stmt->step_ != nullptr) {
+        CompileStmt(stmt->step_);
+    }
+    Emit(Op::Loop, 0, top);
+    Patch(to_end);
+}
+
+void Compiler::VisitWhileStmt(ast::WhileStmtNode* stmt) {
+    int top = static_cast<int>(prog_->code.size());
+    int to_end = CompileCond(stmt->cond_);
+    CompileStmt(stmt->body_);
+    Emit(Op::Loop, 0, top);
+    Patch(to_end);
+}
+
+void Compiler::VisitScanStmt(ast::ScanStmtNode* stmt) {
+    const Var* var = nullptr;
+    if (stmt->var_ != nullptr && stmt->var_->Type() == ast::NodeType::Ident) {
+        var = LookupVar(static_cast<ast::IdentNode*>(stmt->var_));
+    }
+    if (var == nullptr || !var->dims.empty()) {
+        Fail(stmt, "for scan stmt, expect a scalar var");
+        return;
+    }
+
+    Op op = var->is_char ? Op::ReadChar : Op::ReadInt;
+    if (!var->global) {
+        Emit(op, var->addr);
+        return;
+    }
+
+    int addr = var->addr;
+    int value = NewReg();
+    Emit(op, value);
+    Emit(Op::StoreGlobal, value, addr);
+}
+
+void Compiler::VisitPrintfStmt(ast::PrintfStmtNode* stmt) {
+    for (auto arg : stmt->args_) {
+        if (arg->Type() == ast::NodeType::BasicLit && static_cast<ast::BasicLitNode*>(arg)->tok_ == token::Token::STRCON) {
+            Emit(Op::PrintStr, 0, static_cast<int>(prog_->strings.size()));
+            prog_->strings.push_back(ast::DecodeStringLit(static_cast<ast::BasicLitNode*>(arg)->val_));
+            continue;
+        }
+
+        bool is_char = IsCharExpr(arg);
+        Emit(is_char ? Op::PrintChar : Op::PrintInt, CompileExpr(arg));
+    }
+    Emit(Op::PrintLine);
+}
+
+void Compiler::VisitOtherStmt(ast::StmtNode* stmt) {
+    Fail(stmt, "unexpected statement");
+}
+
+int Compiler::VisitIdent(ast::IdentNode* expr, int want) {
+    const Var* var = LookupVar(expr);
+    if (var == nullptr || !var->dims.empty()) {
+        Fail(expr, "for ident expr, expect a scalar var");
+        return Temp(want);
+    }
+
+    if (var->global) {
+        int addr = var->addr;
+        int reg = Temp(want);
+        Emit(Op::LoadGlobal, reg, addr);
+        return reg;
+    }
+
+    if (want >= 0 && want != var->addr) {
+        Emit(Op::Mov, want, var->addr);
+        return want;
+    }
+    return var->addr;
+}
+
+int Compiler::VisitBasicLit(ast::BasicLitNode* expr, int want) {
+    int32_t value = 0;
+    if (expr->tok_ == token::Token::INTCON) {
+        value = static_cast<int32_t>(strtoll(expr->val_.c_str(), nullptr, 10));
+    } else if (expr->tok_ == token::Token::CHARCON) {
+        value = ast::CharLitValue(expr->val_);
+    } else {
+        Fail(expr, "for basic lit, a string isn't a value");
+    }
+
+    int reg = Temp(want);
+    Emit(Op::LoadK, reg, value);
+    return reg;
+}
+
+int Compiler::VisitParenExpr(ast::ParenExprNode* expr, int want) {
+    return CompileExpr(expr->expr_, want);
+}
+
+int Compiler::VisitIndexExpr(ast::IndexExprNode* expr, int want) {
+    const Var* var = nullptr;
+    int index = CompileElem(expr, &var);
+    if (index < 0) {
+        return Temp(want);
+    }
+
+    bool global = var->global;
+    int addr = var->addr;
+    int reg = Temp(want);
+    Emit(global ? Op::LoadGlobalElem : Op::LoadLocalElem, reg, addr, index);
+    return reg;
+}
+
+int Compiler::VisitCallExpr(ast::CallExprNode* expr, int want) {
+    ast::FuncDeclNode* decl = nullptr;
+    int index = -1;
+    if (expr->fun_->Type() == ast::NodeType::Ident) {
+        index = LookupFunc(static_cast<ast::IdentNode*>(expr->fun_), &decl);
+    }
+    if (index < 0) {
+        Fail(expr, "for call expr, function not found");
+        return Temp(want);
+    }
+
+    int num_args = static_cast<int>(expr->args_.size());
+    if (num_args != prog_->funcs[index].num_params) {
+        Fail(expr, "for call expr, args count doesn't match params");
+        return Temp(want);
+    }
+
+    // args are evaluated into consecutive registers, above them for nested calls.
+    int base = NewReg(num_args);
+    for (int i = 0; i < num_args; i++) {
+        CompileExpr(expr->args_[i], base + i);
+    }
+
+    int reg = Temp(want);
+    Emit(Op::Call, reg, index, base);
+    return reg;
+}
+
+int Compiler::VisitUnaryExpr(ast::UnaryExprNode* expr, int want) {
+    if (expr->op_tok_ == token::Token::PLUS) {
+        return CompileExpr(expr->x_, want);
+    }
+
+    if (expr->op_tok_ != token::Token::MINU) {
+        Fail(expr, "for unary expr, expect '+' or '-'");
+        return Temp(want);
+    }
+
+    int x = CompileExpr(expr->x_);
+    int reg = Temp(want);
+    Emit(Op::Neg, reg, x);
+    return reg;
+}
+
+int Compiler::VisitBinaryExpr(ast::BinaryExprNode* expr, int want) {
+    Op op;
+    if (!BinaryOp(expr->op_tok_, &op)) {
+        Fail(expr, "for binary expr, unexpected operator");
+        return Temp(want);
+    }
+
+    // operands go to fresh registers or stay in homes, so writing want last is safe.
+    int x = CompileExpr(expr->x_);
+    int y = CompileExpr(expr->y_);
+    int reg = Temp(want);
+    Emit(op, reg, x, y);
+    return reg;
+}
+
+int Compiler::VisitOtherExpr(ast::ExprNode* expr, int want) {
+    Fail(expr, "unexpected expression");
+    return Temp(want);
+}
+
+int Compiler::CompileElem(ast::IndexExprNode* expr, const Var** var) {
+    vector<ast::ExprNode*> indexes;
+    ast::ExprNode* x = expr;
+    while (x->Type() == ast::NodeType::IndexExpr) {
+        indexes.push_back(static_cast<ast::IndexExprNode*>(x)->index_);
+        x = static_cast<ast::IndexExprNode*>(x)->x_;
+    }
+    reverse(indexes.begin(), indexes.end());
+
+    const Var* array = x->Type() == ast::NodeType::Ident ? LookupVar(static_cast<ast::IdentNode*>(x)) : nullptr;
+    if (array == nullptr || array->dims.size() != indexes.size()) {
+        Fail(expr, "for index expr, expect an array indexed by all dimensions");
+        return -1;
+    }
+    *var = array;
+
+    int flat = -1;
+    for (size_t i = 0; i < indexes.size(); i++) {
+        int index = CompileExpr(indexes[i]);
+        if (bounds_ == nullptr || !bounds_->InBounds(indexes[i])) {
+            Emit(Op::CheckIndex, index, array->dims[i]);
+        }
+        if (i == 0) {
+            flat = index;
+            continue;
+        }
+
+        int dim = NewReg();
+        int next = NewReg();
+        Emit(Op::LoadK, dim, array->dims[i]);
+        Emit(Op::Mul, next, flat, dim);
+        Emit(Op::Add, next, next, index);
+        flat = next;
+    }
+    return flat;
+}
+
+bool Compiler::IsCharExpr(ast::ExprNode* expr) const {
+    switch (expr->Type()) {
+        case ast::NodeType::BasicLit:
+            return static_cast<ast::BasicLitNode*>(expr)->tok_ == token::Token::CHARCON;
+        case ast::NodeType::Ident: {
+            const Var* var = LookupVar(static_cast<ast::IdentNode*>(expr));
+            return var != nullptr && var->is_char;
+        }
+        case ast::NodeType::IndexExpr: {
+            ast::ExprNode* x = expr;
+            while (x->Type() == ast::NodeType::IndexExpr) {
+                x = static_cast<ast::IndexExprNode*>(x)->x_;
+            }
+            return x->Type() == ast::NodeType::Ident && IsCharExpr(x);
+        }
+        case ast::NodeType::CallExpr: {
+            auto call = static_cast<ast::CallExprNode*>(expr);
+            ast::FuncDeclNode* decl = nullptr;
+            return call->fun_->Type() == ast::NodeType::Ident
+                && LookupFunc(static_cast<ast::IdentNode*>(call->fun_), &decl) >= 0
+                && decl->type_ != nullptr && decl->type_->Type() == ast::NodeType::CharType;
+        }
+        default:
+            // operators and parens make an int, e.g. '+c', '(c)'.
+            return false;
+    }
+}
+
+void Compiler::AddVar(ast::IdentNode* name, ast::TypeNode* type, bool is_const, const Var& var) {
+    var_table_.AddVar(name->symbol_, type, is_const);
+
+    const VarTable::Identifier* ident = nullptr;
+    var_table_.GetVar(name->symbol_, &ident);
+    if (ident->unique_id >= static_cast<int>(vars_.size())) {
+        vars_.resize(ident->unique_id + 1);
+    }
+    vars_[ident->unique_id] = var;
+}
+
+const Compiler::Var* Compiler::LookupVar(ast::IdentNode* ident) const {
+    const VarTable::Identifier* var = nullptr;
+    if (var_table_.GetVar(ident->symbol_, &var) != 0 || var->unique_id >= static_cast<int>(vars_.size())) {
+        return nullptr;
+    }
+    return &vars_[var->unique_id];
+}
+
+int Compiler::LookupFunc(ast::IdentNode* ident, ast::FuncDeclNode** decl) const {
+    if (var_table_.GetFunc(ident->symbol_, decl) != 0) {
+        return -1;
+    }
+
+    auto it = func_index_.find(*decl);
+    return it != func_index_.end() ? it->second : -1;
+}
+
+int Compiler::NewReg(int count) {
+    int reg = next_reg_;
+    if (next_reg_ > MaxRegs - count) {
+        Fail(nullptr, "too many registers in function " + prog_->funcs[cur_func_].name);
+        return reg;
+    }
+
+    next_reg_ += count;
+    max_reg_ = max(max_reg_, next_reg_);
+    return reg;
+}
+
+int Compiler::Emit(Op op, int a, int b, int c) {
+    prog_->code.emplace_back(op, a, b, c);
+    return static_cast<int>(prog_->code.size()) - 1;
+}
+
+void Compiler::Patch(int index) {
+    prog_->code[index].b = static_cast<int>(prog_->code.size());
+}
+
+void Compiler::Fail(const ast::Node* node, const string& msg) {
+    if (!error_.empty()) {
+        return;
+    }
+
+    if (node == nullptr) {
+        error_ = msg;
+        return;
+    }
+    error_ = "(" + to_string(node->Pos().line) + ", " + to_string(node->Pos().column) + ") :: " + msg;
+}
+
+}// namespace vm
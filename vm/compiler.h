@@ -0,0 +1,144 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast/ast.h"
+#include "ast/visitor.h"
+#include "check/bounds.h"
+#include "parser/var_table.h"
+#include "vm/bytecode.h"
+
+using namespace std;
+
+namespace vm {
+
+// Compiler lowers a checked ast file to bytecode.
+// Every variable gets a fixed home, locals and local arrays are registers of
+// the function frame, globals are cells of the global area. Temporaries are
+// registers above the locals, they are released after each statement.
+class Compiler : private ast::StmtVisitor<Compiler>, private ast::ExprVisitor<Compiler, int, int> {
+    friend class ast::StmtVisitor<Compiler>;
+    friend class ast::ExprVisitor<Compiler, int, int>;
+public:
+    explicit Compiler(const shared_ptr<ast::FileNode>& ast_file);
+
+    /**
+     * @brief Compile lowers the file to prog, the file should have passed the checker.
+     *
+     * @param prog compiled program.
+     * @param err first construct which can't be lowered, if any.
+     * @return 0 if succeed, -1 if failed.
+     */
+    int Compile(Program* prog, string* err);
+
+    /**
+     * @brief SetBounds makes indexes bounds proved in range go unchecked, bounds should have
+     * analyzed the file and live until Compile returns.
+     */
+    void SetBounds(const check::Bounds* bounds) { bounds_ = bounds; }
+private:
+    // Var is the home of a variable.
+    struct Var {
+        bool global;
+        // addr is global cell or frame register of the first element.
+        int addr;
+        bool is_char;
+        // dims of an array, row major, empty for scalars.
+        vector<int> dims;
+    };
+
+    void CompileVarDecl(ast::DeclNode* decl);
+    void CompileSingleVarDecl(ast::SingleVarDeclNode* decl);
+    void CompileFuncDecl(ast::FuncDeclNode* decl, int index);
+
+    void VisitBadStmt(ast::BadStmtNode* stmt);
+    void VisitDeclStmt(ast::DeclStmtNode* stmt);
+    void VisitEmptyStmt(ast::EmptyStmtNode*) {}
+    void VisitExprStmt(ast::ExprStmtNode* stmt);
+    void VisitAssignStmt(ast::AssignStmtNode* stmt);
+    void VisitReturnStmt(ast::ReturnStmtNode* stmt);
+    void VisitBlockStmt(ast::BlockStmtNode* stmt);
+    void VisitIfStmt(ast::IfStmtNode* stmt);
+    void VisitSwitchStmt(ast::SwitchStmtNode* stmt);
+    void VisitForStmt(ast::ForStmtNode* stmt);
+    void VisitWhileStmt(ast::WhileStmtNode* stmt);
+    void VisitScanStmt(ast::ScanStmtNode* stmt);
+    void VisitPrintfStmt(ast::PrintfStmtNode* stmt);
+    void VisitOtherStmt(ast::StmtNode* stmt);
+
+    // CompileStmt compiles stmt and releases its temporaries.
+    void CompileStmt(ast::StmtNode* stmt);
+
+    // Expr handlers return the register holding the value. It is want if
+    // want >= 0, otherwise it may be the home of a local variable, which
+    // must not be written.
+    int VisitIdent(ast::IdentNode* expr, int want);
+    int VisitBasicLit(ast::BasicLitNode* expr, int want);
+    int VisitParenExpr(ast::ParenExprNode* expr, int want);
+    int VisitIndexExpr(ast::IndexExprNode* expr, int want);
+    int VisitCallExpr(ast::CallExprNode* expr, int want);
+    int VisitUnaryExpr(ast::UnaryExprNode* expr, int want);
+    int VisitBinaryExpr(ast::BinaryExprNode* expr, int want);
+    int VisitOtherExpr(ast::ExprNode* expr, int want);
+
+    // CompileExpr compiles expr and returns register of the value, see handlers.
+    int CompileExpr(ast::ExprNode* expr, int want = -1) { return VisitExpr(expr, want); }
+
+    // CompileCond compiles cond and returns index of a jump taken if cond is false.
+    int CompileCond(ast::ExprNode* cond);
+
+    /**
+     * @brief CompileElem compiles the flat index of an array element, every index is
+     * checked unless bounds proved it in range.
+     *
+     * @param expr index expr, e.g. 'a[i][j]'.
+     * @param var array of the element.
+     * @return register of the flat index, -1 if failed.
+     */
+    int CompileElem(ast::IndexExprNode* expr, const Var** var);
+
+    // IsCharExpr reports whether value of expr is printed as a char.
+    bool IsCharExpr(ast::ExprNode* expr) const;
+
+    // AddVar adds a var to current code block, var is its home.
+    void AddVar(ast::IdentNode* name, ast::TypeNode* type, bool is_const, const Var& var);
+
+    // LookupVar returns home of the innermost variable named by ident, nullptr if none.
+    const Var* LookupVar(ast::IdentNode* ident) const;
+
+    // LookupFunc returns index of function named by ident, -1 if none.
+    int LookupFunc(ast::IdentNode* ident, ast::FuncDeclNode** decl) const;
+
+    // NewReg allocates a register of current frame.
+    int NewReg(int count = 1);
+    int Temp(int want) { return want >= 0 ? want : NewReg(); }
+
+    // Emit appends an instruction, returns its index.
+    int Emit(Op op, int a = 0, int b = 0, int c = 0);
+
+    // Patch sets target of jump at index to the next instruction.
+    void Patch(int index);
+
+    // Fail records the first error, compiling goes on but the result is dropped.
+    void Fail(const ast::Node* node, const string& msg);
+private:
+    shared_ptr<ast::FileNode> ast_file_;
+    const check::Bounds* bounds_;
+    Program* prog_;
+    string error_;
+
+    VarTable var_table_;
+    // vars_[unique id in var table] is home of the var.
+    vector<Var> vars_;
+    unordered_map<const ast::FuncDeclNode*, int> func_index_;
+
+    // cur_func_ is index of the function being compiled, 0 for globals.
+    int cur_func_;
+    int next_reg_;
+    int max_reg_;
+};
+
+}// namespace vm
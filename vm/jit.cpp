@@ -0,0 +1,432 @@
+#include <algorithm>
+#include <cstring>
+
+#include "vm/jit.h"
+#include "prof/prof.h"
+
+#if VM_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace vm {
+
+#if VM_JIT
+namespace {
+
+// Reg is an x86-64 register by its encoding.
+enum Reg { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7, R12 = 12, R13 = 13, R14 = 14 };
+
+// Cond is the condition code of a jcc or setcc.
+enum Cond { Below = 0x2, Equal = 0x4, NotEqual = 0x5, Less = 0xC, GreaterEqual = 0xD, LessEqual = 0xE, Greater = 0xF };
+
+// NoIndex is a memory operand without index register.
+const int NoIndex = -1;
+
+// Assembler encodes the few x86-64 instructions compiled code is made of. Memory operands
+// are [base + index * 4 + disp] with a 32 bit disp, ops are 32 bit unless wide.
+class Assembler {
+public:
+    size_t Size() const { return code_.size(); }
+    const vector<uint8_t>& Code() const { return code_; }
+
+    void Byte(uint8_t b) { code_.push_back(b); }
+
+    void Int32(int32_t value) {
+        uint8_t bytes[4];
+        memcpy(bytes, &value, sizeof(bytes));
+        code_.insert(code_.end(), bytes, bytes + sizeof(bytes));
+    }
+
+    void Int64(uint64_t value) {
+        uint8_t bytes[8];
+        memcpy(bytes, &value, sizeof(bytes));
+        code_.insert(code_.end(), bytes, bytes + sizeof(bytes));
+    }
+
+    // OpMem emits op reg, [base + index * 4 + disp], op of more than a byte is written high byte first.
+    void OpMem(bool wide, uint32_t op, int reg, int base, int index, int32_t disp) {
+        Rex(wide, reg, index, base);
+        Op(op);
+        if (index == NoIndex && (base & 7) != RSP) {
+            Byte(static_cast<uint8_t>(0x80 | ((reg & 7) << 3) | (base & 7)));
+        } else {
+            // base r12 needs a sib, which also encodes no index as rsp.
+            int scaled = index == NoIndex ? RSP : index;
+            Byte(static_cast<uint8_t>(0x80 | ((reg & 7) << 3) | RSP));
+            Byte(static_cast<uint8_t>(((index == NoIndex ? 0 : 2) << 6) | ((scaled & 7) << 3) | (base & 7)));
+        }
+        Int32(disp);
+    }
+
+    // OpReg emits op reg, rm with both operands registers.
+    void OpReg(bool wide, uint32_t op, int reg, int rm) {
+        Rex(wide, reg, NoIndex, rm);
+        Op(op);
+        Byte(static_cast<uint8_t>(0xC0 | ((reg & 7) << 3) | (rm & 7)));
+    }
+
+    void Load(int reg, int base, int index, int32_t disp) { OpMem(false, 0x8B, reg, base, index, disp); }
+    void Store(int base, int index, int32_t disp, int reg) { OpMem(false, 0x89, reg, base, index, disp); }
+    void Move64(int dst, int src) { OpReg(true, 0x89, src, dst); }
+
+    void MoveImm(int reg, int32_t value) {
+        Rex(false, 0, NoIndex, reg);
+        Byte(static_cast<uint8_t>(0xB8 + (reg & 7)));
+        Int32(value);
+    }
+
+    void Push(int reg) {
+        Rex(false, 0, NoIndex, reg);
+        Byte(static_cast<uint8_t>(0x50 + (reg & 7)));
+    }
+
+    void Pop(int reg) {
+        Rex(false, 0, NoIndex, reg);
+        Byte(static_cast<uint8_t>(0x58 + (reg & 7)));
+    }
+
+    // Call calls fn by its absolute address through rax.
+    void Call(const void* fn) {
+        Rex(true, 0, NoIndex, RAX);
+        Byte(0xB8);
+        Int64(reinterpret_cast<uint64_t>(fn));
+        Byte(0xFF);
+        Byte(0xD0);
+    }
+
+    // Jump emits a jmp, or a jcc if cond >= 0, and returns the fixup to bind it with.
+    size_t Jump(int cond = -1) {
+        if (cond < 0) {
+            Byte(0xE9);
+        } else {
+            Byte(0x0F);
+            Byte(static_cast<uint8_t>(0x80 | cond));
+        }
+        Int32(0);
+        return Size();
+    }
+
+    // Patch makes the jump of fixup go to offset target.
+    void Patch(size_t fixup, size_t target) {
+        int32_t rel = static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(fixup));
+        memcpy(&code_[fixup - 4], &rel, sizeof(rel));
+    }
+
+    void Bind(size_t fixup) { Patch(fixup, Size()); }
+private:
+    void Rex(bool wide, int reg, int index, int base) {
+        uint8_t rex = static_cast<uint8_t>(0x40 | (wide ? 8 : 0) | ((reg & 8) ? 4 : 0) |
+                                           ((index != NoIndex && (index & 8)) ? 2 : 0) | ((base & 8) ? 1 : 0));
+        if (rex != 0x40) {
+            Byte(rex);
+        }
+    }
+
+    void Op(uint32_t op) {
+        if (op > 0xFF) {
+            Byte(static_cast<uint8_t>(op >> 8));
+        }
+        Byte(static_cast<uint8_t>(op));
+    }
+
+    vector<uint8_t> code_;
+};
+
+// MaxDisp bounds cells addressed by a disp, 4 bytes each.
+const int MaxDisp = 1 << 29;
+
+// Disp returns the disp of cell x, e.g. register x of rbx.
+inline int32_t Disp(int x) { return x * 4; }
+
+}// namespace
+#endif
+
+Jit::Jit(const Program& prog, const JitHelpers& helpers) :
+    prog_(prog), helpers_(helpers), end_(prog.funcs.size(), static_cast<int>(prog.code.size())),
+    tried_(prog.funcs.size(), false), native_(prog.funcs.size(), nullptr), start_(prog.code.size(), nullptr) {
+    // the code of a function runs up to the entry of the next one.
+    vector<int> entries;
+    for (const auto& func : prog.funcs) {
+        entries.push_back(func.entry);
+    }
+    sort(entries.begin(), entries.end());
+    for (size_t i = 0; i < prog.funcs.size(); i++) {
+        auto next = upper_bound(entries.begin(), entries.end(), prog.funcs[i].entry);
+        if (next != entries.end()) {
+            end_[i] = *next;
+        }
+    }
+}
+
+Jit::~Jit() {
+#if VM_JIT
+    for (const auto& block : blocks_) {
+        munmap(block.first, block.second);
+    }
+#endif
+}
+
+#if VM_JIT
+int Jit::Compile(int func) {
+    if (tried_[func]) {
+        return Compiled(func) ? 0 : -1;
+    }
+    tried_[func] = true;
+
+    // rbx is the frame, r12 the globals, r13 ctx and r14 the register the frame starts at,
+    // the prologue saves them and jumps to the start given by the caller.
+    Assembler as;
+    as.Push(RBX);
+    as.Push(R12);
+    as.Push(R13);
+    as.Push(R14);
+    // sub rsp, 8 keeps calls 16 bytes aligned.
+    as.Byte(0x48), as.Byte(0x83), as.Byte(0xEC), as.Byte(0x08);
+    as.Move64(RBX, RSI);
+    as.Move64(R13, RDI);
+    as.OpMem(true, 0x8B, R12, R13, NoIndex, offsetof(JitContext, globals));
+    as.Move64(RAX, RBX);
+    as.OpMem(true, 0x2B, RAX, R13, NoIndex, offsetof(JitContext, stack));
+    // sar rax, 2
+    as.Byte(0x48), as.Byte(0xC1), as.Byte(0xF8), as.Byte(0x02);
+    as.OpReg(false, 0x89, RAX, R14);
+    // jmp rdx
+    as.Byte(0xFF), as.Byte(0xE2);
+
+    // a failed helper or check returns 0, rets return eax.
+    size_t fail_exit = as.Size();
+    as.OpReg(false, 0x31, RAX, RAX);
+    size_t exit = as.Size();
+    as.Byte(0x48), as.Byte(0x83), as.Byte(0xC4), as.Byte(0x08);
+    as.Pop(R14);
+    as.Pop(R13);
+    as.Pop(R12);
+    as.Pop(RBX);
+    as.Byte(0xC3);
+
+    auto helper_call = [&](const void* fn) {
+        as.Move64(RDI, R13);
+        as.Call(fn);
+    };
+    // fail records the error of instruction pc with value in eax, then returns.
+    auto fail = [&](int pc) {
+        as.OpReg(false, 0x89, RAX, RCX);
+        as.Move64(RDI, R13);
+        as.MoveImm(RSI, func);
+        as.MoveImm(RDX, pc);
+        as.Call(reinterpret_cast<const void*>(helpers_.fail));
+        as.Patch(as.Jump(), fail_exit);
+    };
+    auto compare = [&](const Instr& instr, Cond cond) {
+        as.Load(RAX, RBX, NoIndex, Disp(instr.b));
+        as.OpMem(false, 0x3B, RAX, RBX, NoIndex, Disp(instr.c));
+        // setcc al, movzx eax, al
+        as.Byte(0x0F), as.Byte(static_cast<uint8_t>(0x90 | cond)), as.Byte(0xC0);
+        as.Byte(0x0F), as.Byte(0xB6), as.Byte(0xC0);
+        as.Store(RBX, NoIndex, Disp(instr.a), RAX);
+    };
+
+    int begin = prog_.funcs[func].entry;
+    int end = end_[func];
+    vector<size_t> starts(end - begin);
+    // jumps are bound once every instruction has a start.
+    vector<pair<size_t, int>> jumps;
+    for (int pc = begin; pc < end; pc++) {
+        starts[pc - begin] = as.Size();
+        const Instr& instr = prog_.code[pc];
+        int a = static_cast<int>(instr.a);
+        switch (instr.Opcode()) {
+            case Op::Mov:
+                as.Load(RAX, RBX, NoIndex, Disp(instr.b));
+                as.Store(RBX, NoIndex, Disp(a), RAX);
+                break;
+            case Op::LoadK:
+                as.OpMem(false, 0xC7, 0, RBX, NoIndex, Disp(a));
+                as.Int32(instr.b);
+                break;
+            case Op::LoadGlobal:
+            case Op::StoreGlobal:
+            case Op::LoadGlobalElem:
+            case Op::StoreGlobalElem:
+                if (instr.b < 0 || instr.b >= MaxDisp) {
+                    return -1;
+                }
+                if (instr.Opcode() == Op::LoadGlobal) {
+                    as.Load(RAX, R12, NoIndex, Disp(instr.b));
+                    as.Store(RBX, NoIndex, Disp(a), RAX);
+                } else if (instr.Opcode() == Op::StoreGlobal) {
+                    as.Load(RAX, RBX, NoIndex, Disp(a));
+                    as.Store(R12, NoIndex, Disp(instr.b), RAX);
+                } else if (instr.Opcode() == Op::LoadGlobalElem) {
+                    // movsxd rax, index
+                    as.OpMem(true, 0x63, RAX, RBX, NoIndex, Disp(instr.c));
+                    as.Load(RCX, R12, RAX, Disp(instr.b));
+                    as.Store(RBX, NoIndex, Disp(a), RCX);
+                } else {
+                    as.OpMem(true, 0x63, RAX, RBX, NoIndex, Disp(instr.c));
+                    as.Load(RCX, RBX, NoIndex, Disp(a));
+                    as.Store(R12, RAX, Disp(instr.b), RCX);
+                }
+                break;
+            case Op::LoadLocalElem:
+                as.OpMem(true, 0x63, RAX, RBX, NoIndex, Disp(instr.c));
+                as.Load(RCX, RBX, RAX, Disp(instr.b));
+                as.Store(RBX, NoIndex, Disp(a), RCX);
+                break;
+            case Op::StoreLocalElem:
+                as.OpMem(true, 0x63, RAX, RBX, NoIndex, Disp(instr.c));
+                as.Load(RCX, RBX, NoIndex, Disp(a));
+                as.Store(RBX, RAX, Disp(instr.b), RCX);
+                break;
+            case Op::LoadData:
+                // lea rsi, r[a]
+                as.OpMem(true, 0x8D, RSI, RBX, NoIndex, Disp(a));
+                as.MoveImm(RDX, instr.b);
+                as.MoveImm(RCX, instr.c);
+                helper_call(reinterpret_cast<const void*>(helpers_.load_data));
+                break;
+            case Op::CheckIndex: {
+                as.Load(RAX, RBX, NoIndex, Disp(a));
+                // cmp eax, b is unsigned, so a negative index fails too.
+                as.OpReg(false, 0x81, 7, RAX);
+                as.Int32(instr.b);
+                size_t ok = as.Jump(Below);
+                fail(pc);
+                as.Bind(ok);
+                break;
+            }
+            case Op::Neg:
+                as.Load(RAX, RBX, NoIndex, Disp(instr.b));
+                as.OpReg(false, 0xF7, 3, RAX);
+                as.Store(RBX, NoIndex, Disp(a), RAX);
+                break;
+            case Op::Add:
+            case Op::Sub:
+            case Op::Mul: {
+                uint32_t op = instr.Opcode() == Op::Add ? 0x03 : instr.Opcode() == Op::Sub ? 0x2B : 0x0FAF;
+                as.Load(RAX, RBX, NoIndex, Disp(instr.b));
+                as.OpMem(false, op, RAX, RBX, NoIndex, Disp(instr.c));
+                as.Store(RBX, NoIndex, Disp(a), RAX);
+                break;
+            }
+            case Op::Div: {
+                as.Load(RCX, RBX, NoIndex, Disp(instr.c));
+                as.OpReg(false, 0x85, RCX, RCX);
+                size_t nonzero = as.Jump(NotEqual);
+                fail(pc);
+                as.Bind(nonzero);
+
+                // INT_MIN / -1 would trap, it wraps like the vm.
+                as.Load(RAX, RBX, NoIndex, Disp(instr.b));
+                as.OpReg(false, 0x81, 7, RCX);
+                as.Int32(-1);
+                size_t divide = as.Jump(NotEqual);
+                as.OpReg(false, 0xF7, 3, RAX);
+                size_t done = as.Jump();
+                as.Bind(divide);
+                // cdq, idiv ecx
+                as.Byte(0x99);
+                as.OpReg(false, 0xF7, 7, RCX);
+                as.Bind(done);
+                as.Store(RBX, NoIndex, Disp(a), RAX);
+                break;
+            }
+            case Op::Lss: compare(instr, Less); break;
+            case Op::Leq: compare(instr, LessEqual); break;
+            case Op::Gre: compare(instr, Greater); break;
+            case Op::Geq: compare(instr, GreaterEqual); break;
+            case Op::Eql: compare(instr, Equal); break;
+            case Op::Neq: compare(instr, NotEqual); break;
+            case Op::Jmp:
+            case Op::Loop:
+                jumps.emplace_back(as.Jump(), instr.b);
+                break;
+            case Op::Jz:
+            case Op::Jnz:
+                // cmp dword r[a], 0
+                as.OpMem(false, 0x83, 7, RBX, NoIndex, Disp(a));
+                as.Byte(0);
+                jumps.emplace_back(as.Jump(instr.Opcode() == Op::Jz ? Equal : NotEqual), instr.b);
+                break;
+            case Op::Call:
+                // the stack may move in the call, the frame is found again from r14.
+                as.MoveImm(RSI, func);
+                as.OpReg(false, 0x89, R14, RDX);
+                as.MoveImm(RCX, pc);
+                helper_call(reinterpret_cast<const void*>(helpers_.call));
+                as.OpMem(true, 0x8B, RBX, R13, NoIndex, offsetof(JitContext, stack));
+                as.OpMem(true, 0x8D, RBX, RBX, R14, 0);
+                as.OpMem(false, 0x83, 7, R13, NoIndex, offsetof(JitContext, failed));
+                as.Byte(0);
+                as.Patch(as.Jump(NotEqual), exit);
+                as.Store(RBX, NoIndex, Disp(a), RAX);
+                break;
+            case Op::Ret:
+                as.Load(RAX, RBX, NoIndex, Disp(a));
+                as.Patch(as.Jump(), exit);
+                break;
+            case Op::RetVoid:
+                as.OpReg(false, 0x31, RAX, RAX);
+                as.Patch(as.Jump(), exit);
+                break;
+            case Op::ReadInt:
+            case Op::ReadChar:
+                helper_call(reinterpret_cast<const void*>(instr.Opcode() == Op::ReadInt ? helpers_.read_int : helpers_.read_char));
+                as.Store(RBX, NoIndex, Disp(a), RAX);
+                break;
+            case Op::PrintInt:
+            case Op::PrintChar:
+                as.Load(RSI, RBX, NoIndex, Disp(a));
+                helper_call(reinterpret_cast<const void*>(instr.Opcode() == Op::PrintInt ? helpers_.print_int : helpers_.print_char));
+                break;
+            case Op::PrintStr:
+                as.MoveImm(RSI, instr.b);
+                helper_call(reinterpret_cast<const void*>(helpers_.print_str));
+                break;
+            case Op::PrintLine:
+                helper_call(reinterpret_cast<const void*>(helpers_.print_line));
+                break;
+            default:
+                // Halt ends the init function only, which is never hot.
+                return -1;
+        }
+    }
+
+    for (const auto& jump : jumps) {
+        if (jump.second < begin || jump.second >= end) {
+            return -1;
+        }
+        as.Patch(jump.first, starts[jump.second - begin]);
+    }
+
+    // code is written to a mapping which is made executable after, never both at once.
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t size = (as.Size() + page - 1) / page * page;
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return -1;
+    }
+    memcpy(mem, as.Code().data(), as.Size());
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, size);
+        return -1;
+    }
+    blocks_.emplace_back(mem, size);
+
+    auto code = static_cast<const uint8_t*>(mem);
+    for (int pc = begin; pc < end; pc++) {
+        start_[pc] = code + starts[pc - begin];
+    }
+    native_[func] = reinterpret_cast<NativeCode>(mem);
+    prof::Count(prof::FunctionsJitted);
+    return 0;
+}
+#else
+int Jit::Compile(int func) {
+    tried_[func] = true;
+    return -1;
+}
+#endif
+
+}// namespace vm
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "vm/bytecode.h"
+
+using namespace std;
+
+// VM_JIT is 1 where compiled code can run: x86-64 with the System V calling
+// convention and mmap, everywhere else Jit compiles nothing and the vm interprets.
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define VM_JIT 1
+#else
+#define VM_JIT 0
+#endif
+
+namespace vm {
+
+// JitContext is the state of the vm that compiled code reads, at fixed offsets.
+class JitContext {
+public:
+    // stack is the register stack, it may move while a call runs.
+    int32_t* stack = nullptr;
+    int32_t* globals = nullptr;
+    // failed is set by a helper once a runtime error happened, compiled code returns at once then.
+    int32_t failed = 0;
+    // owner is the vm, for the helpers.
+    void* owner = nullptr;
+};
+
+// JitHelpers are the operations compiled code leaves to the vm, it calls them with ctx first.
+class JitHelpers {
+public:
+    // call runs the Call instruction code[pc] of func, whose frame starts at register fp, and returns its result.
+    int32_t (*call)(JitContext* ctx, int32_t func, int32_t fp, int32_t pc);
+    // fail records the error of instruction code[pc] of func, value is the index a CheckIndex failed on.
+    void (*fail)(JitContext* ctx, int32_t func, int32_t pc, int32_t value);
+    void (*load_data)(JitContext* ctx, int32_t* dst, int32_t begin, int32_t size);
+    int32_t (*read_int)(JitContext* ctx);
+    int32_t (*read_char)(JitContext* ctx);
+    void (*print_int)(JitContext* ctx, int32_t value);
+    void (*print_char)(JitContext* ctx, int32_t value);
+    void (*print_str)(JitContext* ctx, int32_t index);
+    void (*print_line)(JitContext* ctx);
+};
+
+// NativeCode is a compiled function entered at the native code start of one of its
+// instructions, r is its frame. It returns the result of the function.
+typedef int32_t (*NativeCode)(JitContext* ctx, int32_t* r, const uint8_t* start);
+
+// Jit compiles functions of a program to x86-64 code, each instruction to a fixed
+// sequence of machine code. Registers stay in the frame in memory, so compiled and
+// interpreted functions share frames and the vm may go on with compiled code in the
+// middle of a call, e.g. at the back edge of a hot loop.
+class Jit {
+public:
+    Jit(const Program& prog, const JitHelpers& helpers);
+    ~Jit();
+
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+
+    // Supported reports whether compiled code can run on this platform.
+    static bool Supported() { return VM_JIT != 0; }
+
+    /**
+     * @brief Compile compiles function func, a function is tried only once.
+     *
+     * @return 0 if succeed, -1 if func has an instruction the jit doesn't compile,
+     * e.g. Halt, or code memory can't be mapped.
+     */
+    int Compile(int func);
+
+    bool Compiled(int func) const { return native_[func] != nullptr; }
+
+    // Enter runs compiled func from instruction pc with frame r, returns the result of func.
+    int32_t Enter(JitContext* ctx, int func, int pc, int32_t* r) const {
+        return native_[func](ctx, r, start_[pc]);
+    }
+private:
+    const Program& prog_;
+    JitHelpers helpers_;
+
+    // end_[func] is index of the instruction after the last one of func.
+    vector<int> end_;
+    vector<bool> tried_;
+    vector<NativeCode> native_;
+    // start_[pc] is the native code of instruction pc, nullptr if it isn't compiled.
+    vector<const uint8_t*> start_;
+    // blocks_ are the mapped code memory, with their sizes.
+    vector<pair<void*, size_t>> blocks_;
+};
+
+}// namespace vm
@@ -0,0 +1,414 @@
+#include <algorithm>
+
+#include "vm/vm.h"
+
+// VM_COMPUTED_GOTO selects the dispatch loop. With gcc and clang each op
+// jumps through a table of label addresses to the next one, so there is an
+// indirect branch per op for the predictor to learn, other compilers get a
+// switch in a loop.
+#if defined(__GNUC__)
+#define VM_COMPUTED_GOTO 1
+#else
+#define VM_COMPUTED_GOTO 0
+#endif
+
+namespace vm {
+
+// MaxStack is the most registers of all active frames, 256MB of them.
+static const size_t MaxStack = 1 << 26;
+
+// HotCount is the number of calls and back edges after which a function is compiled.
+static const uint32_t HotCount = 1000;
+
+// MaxNativeDepth bounds nested compiled calls, deeper calls are interpreted so a deep
+// recursion can't overflow the native stack.
+static const int MaxNativeDepth = 1000;
+
+// Wrap returns value truncated to 32 bits, the language has wrapping ints.
+static inline int32_t Wrap(uint32_t value) {
+    return static_cast<int32_t>(value);
+}
+
+VM::VM(const Program& prog, istream& in, ostream& out) :
+    prog_(prog), in_(in), out_(out), globals_(prog.num_globals, 0) {
+    for (const auto& block : prog.global_data) {
+        copy_n(prog.data.begin() + block.begin, block.size, globals_.begin() + block.addr);
+    }
+}
+
+void VM::SetJit(bool enabled) {
+    jit_.reset();
+    if (!enabled || !Jit::Supported()) {
+        return;
+    }
+
+    JitHelpers helpers;
+    helpers.call = JitCall;
+    helpers.fail = JitFail;
+    helpers.load_data = JitLoadData;
+    helpers.read_int = JitReadInt;
+    helpers.read_char = JitReadChar;
+    helpers.print_int = JitPrintInt;
+    helpers.print_char = JitPrintChar;
+    helpers.print_str = JitPrintStr;
+    helpers.print_line = JitPrintLine;
+    jit_.reset(new Jit(prog_, helpers));
+    hot_.assign(prog_.funcs.size(), 0);
+}
+
+int VM::Run(string* err) {
+    stack_.assign(max(prog_.funcs[prog_.entry].num_regs, 1), 0);
+    frames_.clear();
+    error_.clear();
+    ctx_.stack = stack_.data();
+    ctx_.globals = globals_.data();
+    ctx_.failed = 0;
+    ctx_.owner = this;
+
+    int32_t result = 0;
+    int ret = Execute(prog_.entry, 0, &result);
+    out_.Flush();
+    if (ret != 0) {
+        *err = "runtime error: " + error_ + " in function " + prog_.funcs[error_func_].name;
+        return -1;
+    }
+    return 0;
+}
+
+int VM::Execute(int func, int fp, int32_t* result) {
+    string error;
+    int32_t ret_value = 0;
+    // frames below base belong to the callers of func.
+    size_t base = frames_.size();
+
+    const Instr* code = prog_.code.data();
+    int32_t* r = stack_.data() + fp;
+    int32_t* g = globals_.data();
+    const Instr* pc = code + prog_.funcs[func].entry;
+
+#if VM_COMPUTED_GOTO
+    static const void* const labels[] = {
+#define VM_OP_LABEL(name) &&op_##name,
+        VM_OPS(VM_OP_LABEL)
+#undef VM_OP_LABEL
+    };
+#define VM_CASE(name) op_##name
+#define VM_DISPATCH() goto *labels[pc->op]
+    VM_DISPATCH();
+#else
+#define VM_CASE(name) case Op::name
+#define VM_DISPATCH() goto dispatch
+dispatch:
+    switch (pc->Opcode()) {
+#endif
+    VM_CASE(Mov):
+        r[pc->a] = r[pc->b];
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(LoadK):
+        r[pc->a] = pc->b;
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(LoadGlobal):
+        r[pc->a] = g[pc->b];
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(StoreGlobal):
+        g[pc->b] = r[pc->a];
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(LoadLocalElem):
+        r[pc->a] = r[pc->b + r[pc->c]];
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(StoreLocalElem):
+        r[pc->b + r[pc->c]] = r[pc->a];
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(LoadGlobalElem):
+        r[pc->a] = g[pc->b + r[pc->c]];
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(StoreGlobalElem):
+        g[pc->b + r[pc->c]] = r[pc->a];
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(LoadData):
+        copy_n(prog_.data.data() + pc->b, pc->c, r + pc->a);
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(CheckIndex):
+        if (static_cast<uint32_t>(r[pc->a]) >= static_cast<uint32_t>(pc->b)) {
+            error = "index " + to_string(r[pc->a]) + " out of range [0, " + to_string(pc->b) + ")";
+            goto fail;
+        }
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(Neg):
+        r[pc->a] = Wrap(0u - static_cast<uint32_t>(r[pc->b]));
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(Add):
+        r[pc->a] = Wrap(static_cast<uint32_t>(r[pc->b]) + static_cast<uint32_t>(r[pc->c]));
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(Sub):
+        r[pc->a] = Wrap(static_cast<uint32_t>(r[pc->b]) - static_cast<uint32_t>(r[pc->c]));
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(Mul):
+        r[pc->a] = Wrap(static_cast<uint32_t>(r[pc->b]) * static_cast<uint32_t>(r[pc->c]));
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(Div):
+        if (r[pc->c] == 0) {
+            error = "division by zero";
+            goto fail;
+        }
+        // INT_MIN / -1 overflows, it wraps like the other ops.
+        r[pc->a] = r[pc->c] == -1 ? Wrap(0u - static_cast<uint32_t>(r[pc->b])) : r[pc->b] / r[pc->c];
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(Lss):
+        r[pc->a] = r[pc->b] < r[pc->c];
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(Leq):
+        r[pc->a] = r[pc->b] <= r[pc->c];
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(Gre):
+        r[pc->a] = r[pc->b] > r[pc->c];
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(Geq):
+        r[pc->a] = r[pc->b] >= r[pc->c];
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(Eql):
+        r[pc->a] = r[pc->b] == r[pc->c];
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(Neq):
+        r[pc->a] = r[pc->b] != r[pc->c];
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(Jmp):
+        pc = code + pc->b;
+        VM_DISPATCH();
+    VM_CASE(Loop):
+        if (jit_ != nullptr && Hot(func)) {
+            // the rest of the call runs compiled, from the top of the loop.
+            if (RunNative(func, pc->b, r, &ret_value) != 0) {
+                return -1;
+            }
+            goto ret;
+        }
+        pc = code + pc->b;
+        VM_DISPATCH();
+    VM_CASE(Jz):
+        pc = r[pc->a] == 0 ? code + pc->b : pc + 1;
+        VM_DISPATCH();
+    VM_CASE(Jnz):
+        pc = r[pc->a] != 0 ? code + pc->b : pc + 1;
+        VM_DISPATCH();
+    VM_CASE(Call): {
+        int callee_fp = 0;
+        int32_t* callee_r = NewFrame(func, fp, *pc, &callee_fp);
+        if (callee_r == nullptr) {
+            error = "stack overflow";
+            goto fail;
+        }
+
+        if (jit_ != nullptr && Hot(pc->b)) {
+            int32_t value = 0;
+            if (RunNative(pc->b, prog_.funcs[pc->b].entry, callee_r, &value) != 0) {
+                return -1;
+            }
+            r = stack_.data() + fp;
+            r[pc->a] = value;
+            pc++;
+            VM_DISPATCH();
+        }
+
+        frames_.push_back(Frame{pc + 1, fp, static_cast<int>(pc->a), func});
+        func = pc->b;
+        fp = callee_fp;
+        r = callee_r;
+        pc = code + prog_.funcs[func].entry;
+        VM_DISPATCH();
+    }
+    VM_CASE(Ret):
+        ret_value = r[pc->a];
+        goto ret;
+    VM_CASE(RetVoid):
+        ret_value = 0;
+    ret:
+        if (frames_.size() == base) {
+            *result = ret_value;
+            return 0;
+        }
+        pc = frames_.back().ret_pc;
+        fp = frames_.back().fp;
+        func = frames_.back().func;
+        r = stack_.data() + fp;
+        r[frames_.back().dst] = ret_value;
+        frames_.pop_back();
+        VM_DISPATCH();
+    VM_CASE(ReadInt):
+        r[pc->a] = ReadInt();
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(ReadChar):
+        r[pc->a] = ReadChar();
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(PrintInt):
+        out_.WriteInt(r[pc->a]);
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(PrintChar):
+        out_.Put(static_cast<char>(r[pc->a]));
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(PrintStr):
+        out_.Write(prog_.strings[pc->b]);
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(PrintLine):
+        out_.Put('\n');
+        pc++;
+        VM_DISPATCH();
+    VM_CASE(Halt):
+        *result = 0;
+        return 0;
+#if !VM_COMPUTED_GOTO
+    }
+#endif
+#undef VM_CASE
+#undef VM_DISPATCH
+
+fail:
+    Fail(func, error);
+    return -1;
+}
+
+int32_t* VM::NewFrame(int func, int fp, const Instr& call, int* callee_fp) {
+    const Function& callee = prog_.funcs[call.b];
+    size_t begin = fp + prog_.funcs[func].num_regs;
+    size_t need = begin + callee.num_regs;
+    if (need > stack_.size()) {
+        if (need > MaxStack) {
+            return nullptr;
+        }
+        stack_.resize(max(need, stack_.size() * 2));
+        ctx_.stack = stack_.data();
+    }
+
+    int32_t* r = stack_.data() + fp;
+    int32_t* callee_r = stack_.data() + begin;
+    copy(r + call.c, r + call.c + callee.num_params, callee_r);
+    fill(callee_r + callee.num_params, callee_r + callee.num_regs, 0);
+    *callee_fp = static_cast<int>(begin);
+    return callee_r;
+}
+
+bool VM::Hot(int func) {
+    if (native_depth_ >= MaxNativeDepth) {
+        return false;
+    }
+    if (hot_[func] < HotCount && ++hot_[func] < HotCount) {
+        return false;
+    }
+    return jit_->Compile(func) == 0;
+}
+
+int VM::RunNative(int func, int pc, int32_t* r, int32_t* result) {
+    native_depth_++;
+    *result = jit_->Enter(&ctx_, func, pc, r);
+    native_depth_--;
+    return ctx_.failed ? -1 : 0;
+}
+
+void VM::Fail(int func, const string& error) {
+    error_ = error;
+    error_func_ = func;
+    ctx_.failed = 1;
+}
+
+int32_t VM::JitCall(JitContext* ctx, int32_t func, int32_t fp, int32_t pc) {
+    VM* vm = static_cast<VM*>(ctx->owner);
+    const Instr& call = vm->prog_.code[pc];
+    int callee_fp = 0;
+    int32_t* callee_r = vm->NewFrame(func, fp, call, &callee_fp);
+    if (callee_r == nullptr) {
+        vm->Fail(func, "stack overflow");
+        return 0;
+    }
+
+    int32_t result = 0;
+    if (vm->Hot(call.b)) {
+        vm->RunNative(call.b, vm->prog_.funcs[call.b].entry, callee_r, &result);
+    } else {
+        vm->Execute(call.b, callee_fp, &result);
+    }
+    return result;
+}
+
+void VM::JitFail(JitContext* ctx, int32_t func, int32_t pc, int32_t value) {
+    VM* vm = static_cast<VM*>(ctx->owner);
+    const Instr& instr = vm->prog_.code[pc];
+    if (instr.Opcode() == Op::CheckIndex) {
+        vm->Fail(func, "index " + to_string(value) + " out of range [0, " + to_string(instr.b) + ")");
+    } else {
+        vm->Fail(func, "division by zero");
+    }
+}
+
+void VM::JitLoadData(JitContext* ctx, int32_t* dst, int32_t begin, int32_t size) {
+    VM* vm = static_cast<VM*>(ctx->owner);
+    copy_n(vm->prog_.data.data() + begin, size, dst);
+}
+
+int32_t VM::JitReadInt(JitContext* ctx) {
+    return static_cast<VM*>(ctx->owner)->ReadInt();
+}
+
+int32_t VM::JitReadChar(JitContext* ctx) {
+    return static_cast<VM*>(ctx->owner)->ReadChar();
+}
+
+void VM::JitPrintInt(JitContext* ctx, int32_t value) {
+    static_cast<VM*>(ctx->owner)->out_.WriteInt(value);
+}
+
+void VM::JitPrintChar(JitContext* ctx, int32_t value) {
+    static_cast<VM*>(ctx->owner)->out_.Put(static_cast<char>(value));
+}
+
+void VM::JitPrintStr(JitContext* ctx, int32_t index) {
+    VM* vm = static_cast<VM*>(ctx->owner);
+    vm->out_.Write(vm->prog_.strings[index]);
+}
+
+void VM::JitPrintLine(JitContext* ctx) {
+    static_cast<VM*>(ctx->owner)->out_.Put('\n');
+}
+
+int32_t VM::ReadInt() {
+    int64_t value = 0;
+    if (!in_.ReadInt(&value)) {
+        return 0;
+    }
+    return Wrap(static_cast<uint32_t>(value));
+}
+
+int32_t VM::ReadChar() {
+    char ch = 0;
+    if (!in_.ReadChar(&ch)) {
+        return 0;
+    }
+    return static_cast<unsigned char>(ch);
+}
+
+}// namespace vm
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "runtime/io.h"
+#include "vm/bytecode.h"
+#include "vm/jit.h"
+
+using namespace std;
+
+namespace vm {
+
+// VM runs a program on a register machine.
+// Frames of all active calls are windows of one register stack, a callee
+// frame starts right after its caller's, so args are copied only once.
+// With the jit on, execution is tiered: every function starts interpreted, and once its
+// calls and loop back edges reach HotCount it is compiled to native code, which later
+// calls run and a running call switches to at its next back edge.
+class VM {
+public:
+    VM(const Program& prog, istream& in, ostream& out);
+
+    /**
+     * @brief SetJit turns the tiered execution on or off, it is off by default and
+     * stays off where Jit::Supported is false.
+     */
+    void SetJit(bool enabled);
+
+    /**
+     * @brief Run executes the program from its entry until it halts,
+     * output is buffered and flushed to out before returning.
+     *
+     * @param err runtime error, e.g. division by zero.
+     * @return 0 if succeed, -1 if failed.
+     */
+    int Run(string* err);
+private:
+    // Frame is the caller state saved by a call.
+    struct Frame {
+        const Instr* ret_pc;
+        int fp;
+        int dst;
+        int func;
+    };
+
+    /**
+     * @brief Execute interprets func on the frame at register fp until it returns,
+     * calls of the function are interpreted too unless their callee is compiled.
+     *
+     * @return 0 if succeed, -1 if a runtime error was recorded in error_.
+     */
+    int Execute(int func, int fp, int32_t* result);
+
+    // NewFrame sets up the callee frame of call in func, whose frame is at fp, returns
+    // its registers or nullptr on stack overflow. Registers of fp may have moved after.
+    int32_t* NewFrame(int func, int fp, const Instr& call, int* callee_fp);
+
+    // Hot counts a call or a back edge of func, returns whether func should run compiled.
+    bool Hot(int func);
+
+    // RunNative runs compiled func from instruction pc on frame r, returns -1 if it failed.
+    int RunNative(int func, int pc, int32_t* r, int32_t* result);
+
+    void Fail(int func, const string& error);
+
+    // helpers called by compiled code, see JitHelpers.
+    static int32_t JitCall(JitContext* ctx, int32_t func, int32_t fp, int32_t pc);
+    static void JitFail(JitContext* ctx, int32_t func, int32_t pc, int32_t value);
+    static void JitLoadData(JitContext* ctx, int32_t* dst, int32_t begin, int32_t size);
+    static int32_t JitReadInt(JitContext* ctx);
+    static int32_t JitReadChar(JitContext* ctx);
+    static void JitPrintInt(JitContext* ctx, int32_t value);
+    static void JitPrintChar(JitContext* ctx, int32_t value);
+    static void JitPrintStr(JitContext* ctx, int32_t index);
+    static void JitPrintLine(JitContext* ctx);
+
+    // ReadInt scans an int, skipping blanks, 0 if no int is left.
+    int32_t ReadInt();
+
+    // ReadChar scans a not blank char, 0 if no char is left.
+    int32_t ReadChar();
+
+
+    const Program& prog_;
+    runtime::Reader in_;
+    runtime::Writer out_;
+
+    vector<int32_t> globals_;
+    vector<int32_t> stack_;
+    vector<Frame> frames_;
+
+    // error_ is the runtime error of function error_func_.
+    string error_;
+    int error_func_ = 0;
+
+    // jit_ is nullptr unless the jit is on, then hot_[func] counts up to HotCount.
+    unique_ptr<Jit> jit_;
+    vector<uint32_t> hot_;
+    JitContext ctx_;
+    // native_depth_ is the number of compiled calls running, they nest on the native stack.
+    int native_depth_ = 0;
+};
+
+}// namespace vm